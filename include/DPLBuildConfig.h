@@ -64,6 +64,13 @@
  */
 /* #define DXPORTLIB_DRAW_OPENGL_ES2 */
 
+/* For OpenGL, define this to check for GL errors after every step of
+ * building a shader, rather than once per program. This is automatically
+ * enabled for debug builds, meaning those with _DEBUG defined (Visual C)
+ * or without NDEBUG defined (everything else, autotools included).
+ */
+/* #define DXPORTLIB_GL_DEBUG */
+
 /* Disables support for sound.
  */
 /* #define DXPORTLIB_NO_SOUND */
@@ -103,6 +110,10 @@
 #  endif
 #endif
 
+#if (defined(_DEBUG) || !defined(NDEBUG)) && !defined(DXPORTLIB_GL_DEBUG)
+#  define DXPORTLIB_GL_DEBUG
+#endif
+
 /* D3D9 not available on non-Windows platforms */
 #if !defined(WIN32)
 #  ifdef DXPORTLIB_DRAW_DIRECT3D9
@@ -606,6 +606,15 @@ typedef struct _DISPLAYMODEDATA {
 #define DX_SOUNDDATATYPE_MEMPRESS               (2)
 #define DX_SOUNDDATATYPE_FILE                   (3)
 
+/* What happens when every voice is busy and another sound starts. */
+#define DX_VOICESTEAL_EXT_NONE                  (0)
+#define DX_VOICESTEAL_EXT_OLDEST                (1)
+#define DX_VOICESTEAL_EXT_QUIETEST              (2)
+
+/* Sample formats the sound device can be opened with. */
+#define DX_SOUNDFORMAT_EXT_S16                  (0)
+#define DX_SOUNDFORMAT_EXT_F32                  (1)
+
 #ifdef __cplusplus
 } /* namespace */
 
@@ -67,6 +67,23 @@ extern DXCALL int ProcessMessage(void);
 // - Waits the given number of milliseconds.
 extern DXCALL int WaitTimer(int msTime);
 
+// - DxPortLib extension: Sets the frame rate EXT_SyncFrame keeps to.
+// 0 turns pacing off, leaving EXT_SyncFrame to only keep statistics.
+// Default: 0.
+extern DXCALL int EXT_SetFrameRate(int framesPerSecond);
+
+// - DxPortLib extension: Waits until the next frame is due, with
+// sub-millisecond precision. A late frame is made up for by the
+// next one, so the frame rate holds on average.
+// Returns TRUE if this frame was already late.
+extern DXCALL int EXT_SyncFrame();
+
+// - DxPortLib extension: Gets frame times over the last 256 frames, in
+// microseconds, and how many frames were late. Any pointer may be NULL.
+extern DXCALL int EXT_GetFrameStats(int *averageTime, int *minTime,
+                                    int *maxTime, int *p99Time,
+                                    int *missedCount);
+
 // - Waits for a key to be pressed.
 extern DXCALL int WaitKey();
 
@@ -107,6 +124,11 @@ extern DXCALL void EXT_SetOnlyWindowSize(int width, int height,
 // Defaults to the currently active character set.
 extern DXCALL int EXT_FileRead_SetCharSet(int charset);
 
+// - DxPortLib extension: Sets the size of the read buffer each file
+// stream handle gets. Only affects handles opened afterwards.
+// Default: 32768 bytes. The minimum is 64.
+extern DXCALL int EXT_FileRead_SetBufferSize(int bufferSize);
+
 // - Opens a file stream handle to the given file.
 // Returns -1 on failure, otherwise returns the stream handle.
 extern DXCALL int FileRead_openW(const wchar_t *filename, int ASync = DXFALSE);
@@ -212,6 +234,18 @@ DXUNICALL_WRAP(int, SetDXArchiveExtension, (const TCHAR *extension = NULL), (ext
 //   If TRUE, tries to load from normal files then dxa files.
 extern DXCALL int SetDXArchivePriority(int priority = 0);
 
+// - If TRUE, dxa archives opened from now on are memory mapped instead of
+//   being read through a file handle, and files are decoded straight from
+//   the mapping.
+// Default is FALSE.
+extern DXCALL int EXT_SetDXArchiveMapFlag(int flag);
+
+// - If TRUE, large compressed files in dxa archives are decompressed as
+//   they are read, keeping only a window of the output in memory.
+//   Otherwise they are decompressed whole when opened.
+// Default is TRUE.
+extern DXCALL int EXT_SetDXArchiveStreamCompressedFlag(int flag);
+
 // - Preloads the dxa archive to memory.
 // NOTICE: async is not currently supported and will be ignored.
 extern DXCALL int DXArchivePreLoadW(const wchar_t *dxaFilename,
@@ -528,6 +562,26 @@ extern DXCALL int SetUseTransColor(int flag);
 // Default is FALSE.
 extern DXCALL int SetUsePremulAlphaConvertLoad(int flag);
 
+// - TRUE if loaded graphs up to maxGraphSize pixels on each side are to
+//   be packed together into shared textures of pageSize*pageSize.
+//   LoadDivGraph packs each cell separately when the cells fit.
+// NOTICE: SetWrap is not available for packed graphs.
+// Default is FALSE.
+extern DXCALL int EXT_SetUseGraphAtlas(int flag, int maxGraphSize = 256,
+                                       int pageSize = 2048);
+
+// - TRUE if graphs, sounds and fonts are to be loaded in the background.
+//   The load functions return a handle immediately; using the handle
+//   before it has finished loading waits for it.
+// Default is FALSE.
+extern DXCALL int SetUseASyncLoadFlag(int flag);
+extern DXCALL int GetUseASyncLoadFlag();
+// - Returns TRUE if the handle is still loading, FALSE if it is ready,
+//   and -1 if it is not valid (this includes a failed load).
+extern DXCALL int CheckHandleASyncLoad(int handle);
+// - Gets the number of handles still loading in the background.
+extern DXCALL int GetASyncLoadNum();
+
 // NOTICE: For all drawing functions, the following applies:
 // - FillFlag, if TRUE, will draw a solid. Otherwise, edges only.
 // - blendFlag, if TRUE, draws with blending enabled.
@@ -701,6 +755,10 @@ extern DXCALL int SetDrawArea(int x1, int y1, int x2, int y2);
 extern DXCALL int SetDrawMode(int drawMode);
 extern DXCALL int GetDrawMode();
 
+// - Allows draws to be reordered to reduce texture and blend changes.
+//   Only draws that do not overlap on screen are moved past each other.
+extern DXCALL int EXT_SetUseDrawSorting(int flag);
+
 // - Sets the current blending mode from DX_BLENDMODE_*
 extern DXCALL int SetDrawBlendMode(int blendMode, int alpha);
 extern DXCALL int GetDrawBlendMode(int *blendMode, int *alpha);
@@ -1114,6 +1172,54 @@ extern DXCALL int SetFontCacheUsePremulAlphaFlag(int flag);
 // - Gets if font textures will be generated with premultiplied alpha.
 extern DXCALL int GetFontCacheUsePremulAlphaFlag();
 
+// - Gets glyph cache statistics for a font handle: the number of texture
+//   pages, the number of cached glyphs, the fraction of the page area
+//   in use (0.0 to 1.0), and the number of pages added after the first.
+// Any of the pointers may be NULL.
+extern DXCALL int EXT_GetFontCacheStatsToHandle(int fontHandle,
+                                                int *pageCount = NULL,
+                                                int *glyphCount = NULL,
+                                                double *occupancy = NULL,
+                                                int *growCount = NULL);
+
+// - Lays out a string once, for drawing many times with EXT_DrawTextLayout.
+// Returns a text layout handle.
+// Drawing a layout skips text conversion and glyph lookups entirely.
+extern DXCALL int EXT_CreateTextLayoutToHandleW(const wchar_t *string, int fontHandle,
+                                                double exRateX = 1.0, double exRateY = 1.0);
+extern DXCALL int EXT_CreateTextLayoutToHandleA(const char *string, int fontHandle,
+                                                double exRateX = 1.0, double exRateY = 1.0);
+DXUNICALL_WRAP(int, EXT_CreateTextLayoutToHandle,
+               (const TCHAR *string, int fontHandle,
+                double exRateX = 1.0, double exRateY = 1.0),
+               (string, fontHandle, exRateX, exRateY))
+// - Draws a text layout at the given position, with the given colors.
+// If the font's spacing was changed, the layout is redone first.
+// Fails with -1 once the font has been deleted.
+extern DXCALL int EXT_DrawTextLayout(int x, int y, int layoutHandle,
+                                     DXCOLOR color, DXCOLOR edgeColor = 0);
+// - Deletes a text layout handle.
+extern DXCALL int EXT_DeleteTextLayout(int layoutHandle);
+// - Sets how many layouts the DrawString functions keep cached, so that
+//   strings drawn every frame are only laid out once.
+// Default is 128. 0 disables the cache.
+extern DXCALL int EXT_SetTextLayoutCacheSize(int layoutCount);
+
+// - Starts caching glyphs for every character in the string on background
+//   threads, so they don't have to be drawn the first time they are used.
+// The string can be anything, such as a whole script file.
+// Drawing with the font while this happens is fine.
+extern DXCALL int EXT_PrewarmFontToHandleW(const wchar_t *characters, int fontHandle);
+extern DXCALL int EXT_PrewarmFontToHandleA(const char *characters, int fontHandle);
+DXUNICALL_WRAP(int, EXT_PrewarmFontToHandle,
+               (const TCHAR *characters, int fontHandle),
+               (characters, fontHandle))
+// - Same as EXT_PrewarmFontToHandle, for a range of codepoints.
+extern DXCALL int EXT_PrewarmFontRangeToHandle(int firstCodepoint, int lastCodepoint,
+                                               int fontHandle);
+// - Returns TRUE if glyphs are still being pre-warmed for the font.
+extern DXCALL int EXT_CheckFontPrewarmToHandle(int fontHandle);
+
 #endif /* #ifndef DX_NON_FONT */
 
 // ------------------------------------------------------------ DxAudio.cpp
@@ -1141,6 +1247,23 @@ extern DXCALL int ChangeVolumeSoundMem(int volume, int soundID);
 // Default: FALSE.
 extern DXCALL int SetUseOldVolumeCalcFlag(int volumeFlag);
 
+// - Sets the pan of the sound in decibels from -10000 (left) to 10000
+//   (right). The opposite side is turned down by that much.
+extern DXCALL int SetPanSoundMem(int pan, int soundID);
+// - Sets the pan of the sound linearly from -255 (left) to 255 (right).
+extern DXCALL int ChangePanSoundMem(int pan, int soundID);
+// - Returns the pan of the sound, in decibels.
+extern DXCALL int GetPanSoundMem(int soundID);
+
+// - Plays the sound back as if it were recorded at frequency, in Hz,
+//   changing its pitch and speed. -1 goes back to its own frequency.
+// Does not work for streamed (OGG) sounds.
+extern DXCALL int SetFrequencySoundMem(int frequency, int soundID);
+// - Returns the frequency the sound is played back at.
+extern DXCALL int GetFrequencySoundMem(int soundID);
+// - Plays the sound back at its own frequency again.
+extern DXCALL int ResetFrequencySoundMem(int soundID);
+
 // - Loads a sound file, returning a playable handle.
 // WAV files are loaded whole, OGG files are streamed.
 extern DXCALL int LoadSoundMemW(const wchar_t *filename,
@@ -1161,6 +1284,10 @@ DXUNICALL_WRAP(int, LoadSoundMem2,
                (const TCHAR *filename, const TCHAR *filename2),
                (filename, filename2))
 
+// - Makes a new handle that plays the same sound as srcSoundHandle,
+// sharing its data. Does not work for streamed (OGG) sounds.
+extern DXCALL int DuplicateSoundMem(int srcSoundHandle, int bufferNum = 3);
+
 // - Deletes a sound handle.
 extern DXCALL int DeleteSoundMem(int soundID, int LogOutFlag = DXFALSE);
 
@@ -1175,6 +1302,45 @@ extern DXCALL int GetCreateSoundDataType();
 // - Gets the current sound position in samples.
 extern DXCALL int GetCurrentPositionSoundMem(int soundID);
 
+// - Sets how far ahead OGG streams are decoded, in milliseconds.
+// Streams are decoded on a background thread, so this is how long a
+// stall it can ride out. Only affects sounds loaded afterwards.
+// Default: 250.
+extern DXCALL int EXT_SetStreamSoundBufferTime(int milliseconds);
+
+// - Returns how many times a streamed sound has run out of decoded
+//   audio while playing. Always 0 for sounds that are not streamed.
+extern DXCALL int EXT_GetStreamSoundUnderrunCount(int soundID);
+
+// - Sets what happens when all 256 voices are playing and another
+//   sound starts. DX_VOICESTEAL_EXT_NONE does not play the new sound,
+//   _OLDEST and _QUIETEST cut off an older sound to make room.
+//   Streamed sounds are never cut off.
+// Default: DX_VOICESTEAL_EXT_OLDEST.
+extern DXCALL int EXT_SetSoundVoiceStealMode(int mode);
+
+// - Sets the sound device's buffer size, in frames. Smaller buffers
+//   mean lower latency, but are more likely to crackle. Rounded up to
+//   a power of two. Must be set before any sounds are loaded.
+// Default: 1024.
+extern DXCALL int EXT_SetSoundDeviceBufferSize(int frames);
+// - Sets the sound device's sample rate. The device may pick another
+//   if it cannot do this one. Must be set before any sounds are loaded.
+// Default: 44100.
+extern DXCALL int EXT_SetSoundDeviceFrequency(int frequency);
+// - Sets the sound device's sample format, DX_SOUNDFORMAT_EXT_S16 or
+//   DX_SOUNDFORMAT_EXT_F32. Must be set before any sounds are loaded.
+// Default: DX_SOUNDFORMAT_EXT_S16.
+extern DXCALL int EXT_SetSoundDeviceFormat(int format);
+// - Returns what the sound device was really opened with. Any pointer
+//   may be NULL.
+extern DXCALL int EXT_GetSoundDeviceState(int *frequency, int *bufferFrames, int *format);
+// - Returns the measured sound latency and callback jitter, both in
+//   microseconds. Latency is from PlaySoundMem until the sound leaves
+//   the device buffer, averaged over recent plays. Jitter is how far
+//   the device's callbacks stray from a steady rate, on average.
+extern DXCALL int EXT_GetSoundDeviceLatency(int *latency, int *jitter);
+
 #endif /* #ifndef DX_NON_SOUND */
 
 // ----------------------------------------------------------- DxMemory.cpp
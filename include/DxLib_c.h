@@ -53,6 +53,11 @@ extern DXCALL int DxLib_IsInit(void);
 extern DXCALL int DxLib_ProcessMessage(void);
 
 extern DXCALL int DxLib_WaitTimer(int msTime);
+extern DXCALL int DxLib_EXT_SetFrameRate(int framesPerSecond);
+extern DXCALL int DxLib_EXT_SyncFrame();
+extern DXCALL int DxLib_EXT_GetFrameStats(int *averageTime, int *minTime,
+                                          int *maxTime, int *p99Time,
+                                          int *missedCount);
 extern DXCALL int DxLib_WaitKey();
 
 extern DXCALL int DxLib_GetDateTime(DATEDATA *dateBuf);
@@ -75,6 +80,7 @@ extern DXCALL void DxLib_EXT_SetOnlyWindowSize(int width, int height,
 
 /* ----------------------------------------------------------- DxFile.cpp */
 extern DXCALL int DxLib_EXT_FileRead_SetCharSet(int charset);
+extern DXCALL int DxLib_EXT_FileRead_SetBufferSize(int bufferSize);
 
 extern DXCALL int DxLib_FileRead_openW(const wchar_t *filename, int ASync);
 extern DXCALL int DxLib_FileRead_openA(const char *filename, int ASync);
@@ -155,6 +161,8 @@ DXUNICALL_WRAP(int, DxLib_SetDXArchiveExtension,
                (const TCHAR *extension), (extension))
 
 extern DXCALL int DxLib_SetDXArchivePriority(int priority);
+extern DXCALL int DxLib_EXT_SetDXArchiveMapFlag(int flag);
+extern DXCALL int DxLib_EXT_SetDXArchiveStreamCompressedFlag(int flag);
 
 extern DXCALL int DxLib_DXArchivePreLoadW(const wchar_t *dxaFilename, int async);
 extern DXCALL int DxLib_DXArchivePreLoadA(const char *dxaFilename, int async);
@@ -353,6 +361,13 @@ extern DXCALL int DxLib_GetTransColor(int *r, int *g, int *b);
 extern DXCALL int DxLib_SetUseTransColor(int flag);
 
 extern DXCALL int DxLib_SetUsePremulAlphaConvertLoad(int flag);
+extern DXCALL int DxLib_EXT_SetUseGraphAtlas(int flag, int maxGraphSize,
+                                             int pageSize);
+
+extern DXCALL int DxLib_SetUseASyncLoadFlag(int flag);
+extern DXCALL int DxLib_GetUseASyncLoadFlag();
+extern DXCALL int DxLib_CheckHandleASyncLoad(int handle);
+extern DXCALL int DxLib_GetASyncLoadNum();
 
 extern DXCALL int DxLib_DrawPixel(int x, int y, DXCOLOR color);
 
@@ -509,6 +524,7 @@ extern DXCALL int DxLib_SetDrawArea(int x1, int y1, int x2, int y2);
 
 extern DXCALL int DxLib_SetDrawMode(int drawMode);
 extern DXCALL int DxLib_GetDrawMode();
+extern DXCALL int DxLib_EXT_SetUseDrawSorting(int flag);
 extern DXCALL int DxLib_SetDrawBlendMode(int blendMode, int alpha);
 extern DXCALL int DxLib_GetDrawBlendMode(int *blendMode, int *alpha);
 extern DXCALL int DxLib_SetDrawBright(int redBright,
@@ -819,6 +835,30 @@ DXUNICALL_WRAP(int, DxLib_SetDefaultFontState,
 
 extern DXCALL int DxLib_SetFontCacheUsePremulAlphaFlag(int flag);
 extern DXCALL int DxLib_GetFontCacheUsePremulAlphaFlag();
+extern DXCALL int DxLib_EXT_GetFontCacheStatsToHandle(int fontHandle,
+                int *pageCount, int *glyphCount, double *occupancy, int *growCount);
+
+extern DXCALL int DxLib_EXT_CreateTextLayoutToHandleW(const wchar_t *string, int fontHandle,
+                                                      double exRateX, double exRateY);
+extern DXCALL int DxLib_EXT_CreateTextLayoutToHandleA(const char *string, int fontHandle,
+                                                      double exRateX, double exRateY);
+DXUNICALL_WRAP(int, DxLib_EXT_CreateTextLayoutToHandle,
+               (const TCHAR *string, int fontHandle,
+                double exRateX, double exRateY),
+               (string, fontHandle, exRateX, exRateY))
+extern DXCALL int DxLib_EXT_DrawTextLayout(int x, int y, int layoutHandle,
+                                           DXCOLOR color, DXCOLOR edgeColor);
+extern DXCALL int DxLib_EXT_DeleteTextLayout(int layoutHandle);
+extern DXCALL int DxLib_EXT_SetTextLayoutCacheSize(int layoutCount);
+
+extern DXCALL int DxLib_EXT_PrewarmFontToHandleW(const wchar_t *characters, int fontHandle);
+extern DXCALL int DxLib_EXT_PrewarmFontToHandleA(const char *characters, int fontHandle);
+DXUNICALL_WRAP(int, DxLib_EXT_PrewarmFontToHandle,
+               (const TCHAR *characters, int fontHandle),
+               (characters, fontHandle))
+extern DXCALL int DxLib_EXT_PrewarmFontRangeToHandle(int firstCodepoint, int lastCodepoint,
+                                                     int fontHandle);
+extern DXCALL int DxLib_EXT_CheckFontPrewarmToHandle(int fontHandle);
 
 #endif /* #ifndef DX_NON_FONT */
 
@@ -835,6 +875,14 @@ extern DXCALL int DxLib_SetVolumeSoundMem(int volume, int soundID);
 extern DXCALL int DxLib_ChangeVolumeSoundMem(int volume, int soundID);
 extern DXCALL int DxLib_SetUseOldVolumeCalcFlag(int volumeFlag);
 
+extern DXCALL int DxLib_SetPanSoundMem(int pan, int soundID);
+extern DXCALL int DxLib_ChangePanSoundMem(int pan, int soundID);
+extern DXCALL int DxLib_GetPanSoundMem(int soundID);
+
+extern DXCALL int DxLib_SetFrequencySoundMem(int frequency, int soundID);
+extern DXCALL int DxLib_GetFrequencySoundMem(int soundID);
+extern DXCALL int DxLib_ResetFrequencySoundMem(int soundID);
+
 extern DXCALL int DxLib_LoadSoundMemW(
                 const wchar_t *filename, int bufferNum, int unionHandle);
 extern DXCALL int DxLib_LoadSoundMemA(
@@ -851,6 +899,8 @@ DXUNICALL_WRAP(int, DxLib_LoadSoundMem2,
                (const TCHAR *filename, const TCHAR *filename2),
                (filename, filename2))
 
+extern DXCALL int DxLib_DuplicateSoundMem(int srcSoundHandle, int bufferNum);
+
 extern DXCALL int DxLib_DeleteSoundMem(int soundID,
                                        int LogOutFlag);
 
@@ -861,6 +911,16 @@ extern DXCALL int DxLib_GetCreateSoundDataType();
 
 extern DXCALL int DxLib_GetCurrentPositionSoundMem(int soundID);
 
+extern DXCALL int DxLib_EXT_SetStreamSoundBufferTime(int milliseconds);
+extern DXCALL int DxLib_EXT_GetStreamSoundUnderrunCount(int soundID);
+extern DXCALL int DxLib_EXT_SetSoundVoiceStealMode(int mode);
+
+extern DXCALL int DxLib_EXT_SetSoundDeviceBufferSize(int frames);
+extern DXCALL int DxLib_EXT_SetSoundDeviceFrequency(int frequency);
+extern DXCALL int DxLib_EXT_SetSoundDeviceFormat(int format);
+extern DXCALL int DxLib_EXT_GetSoundDeviceState(int *frequency, int *bufferFrames, int *format);
+extern DXCALL int DxLib_EXT_GetSoundDeviceLatency(int *latency, int *jitter);
+
 #endif /* #ifndef DX_NON_SOUND */
 
 /* --------------------------------------------------------- DxMemory.cpp */
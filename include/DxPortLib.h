@@ -55,6 +55,22 @@ int DPLCALL ConvertStringToWideChar(
 
 } // namespace DPL::Text
 
+namespace Render { // DPL::Render
+
+typedef DPL_RenderStats Stats;
+
+int DPLCALL GetStats(Stats *frameStats, Stats *totalStats = NULL);
+
+typedef DPL_FrameLatencyStats FrameLatencyStats;
+
+int DPLCALL SetMaxFramesInFlight(int frames = 2);
+int DPLCALL GetFrameLatencyStats(FrameLatencyStats *stats);
+
+int DPLCALL SetShaderCacheFile(const char *filename);
+int DPLCALL PrecompileShaders();
+
+} // namespace DPL::Render
+
 class WinINI {
 public:
     DPLCALL WinINI();
@@ -35,6 +35,8 @@
 #  undef DPLCALL
 #endif
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -112,6 +114,62 @@ extern DPLCALL int DPL_WinINI_DeleteValue(
 extern DPLCALL int DPL_WinINI_DeleteSection(
     int handle, const char *sectionName);
 
+/* Renderer statistics. Counters cover either the last completed frame,
+ * or everything since the renderer was initialized. */
+typedef struct _DPL_RenderStats {
+    int frameCount;
+    
+    /* Client-side vertex data appended to the streaming buffers. */
+    int64_t streamBytesUploaded;
+    int streamUploadCount;
+    int streamWrapCount;
+    int streamStallCount;
+    int streamOrphanCount;
+    int streamFallbackCount;
+    
+    /* Render state changes sent to GL, and redundant ones skipped. */
+    int stateChangeCount;
+    int stateElidedCount;
+} DPL_RenderStats;
+
+extern DPLCALL int DPL_Render_GetStats(
+    DPL_RenderStats *frameStats, DPL_RenderStats *totalStats);
+
+/* Frame latency limiting. Before a frame is started, the renderer waits
+ * until no more than maxFramesInFlight frames are queued on the GPU,
+ * counting the new one. Times are in microseconds. */
+typedef struct _DPL_FrameLatencyStats {
+    int maxFramesInFlight;
+    
+    /* Frames still queued when the last frame was started. */
+    int framesInFlight;
+    
+    /* Sync objects are missing, so the whole queue is waited on. */
+    int usingFinish;
+    
+    /* Waits so far, and how many of them had to block. */
+    int frameCount;
+    int waitCount;
+    int lastWaitTime;
+    int maxWaitTime;
+    int64_t totalWaitTime;
+} DPL_FrameLatencyStats;
+
+/* Default: 2. */
+extern DPLCALL int DPL_Render_SetMaxFramesInFlight(int frames);
+extern DPLCALL int DPL_Render_GetFrameLatencyStats(
+    DPL_FrameLatencyStats *stats);
+
+/* Shader program cache. Where the driver supports it, linked shader
+ * programs are saved to this file (UTF-8 path) and loaded back on later
+ * runs instead of being compiled again. Set it before anything is drawn.
+ * Default: NULL, which turns the cache off. */
+extern DPLCALL int DPL_Render_SetShaderCacheFile(const char *filename);
+
+/* Builds every stock shader now, rather than the first time each one is
+ * drawn with. Returns how many are ready, or -1 without shaders. */
+extern DPLCALL int DPL_Render_PrecompileShaders();
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -376,6 +376,12 @@ public:
     // If you want to use anything other than UTF8, use this.
     static LUNACALL void EXTSetUseCharset(int dxCharset);
     
+    // Frame times over the last 256 frames, in microseconds, and how
+    // many frames missed their deadline. Any pointer may be NULL.
+    static LUNACALL void EXTGetFrameStats(Sint32 *averageTime, Sint32 *minTime,
+                             Sint32 *maxTime, Sint32 *p99Time,
+                             Sint32 *missedCount);
+    
     static LUNACALL void EXTGetSaveFolder(char *buffer, int bufferLength,
                              const char *org, const char *app,
                              int destEncoding);
@@ -29,6 +29,24 @@
 
 namespace DPL {
 
+/* -------------------------------------------------------------- Render */
+
+int Render::GetStats(Stats *frameStats, Stats *totalStats) {
+    return DPL_Render_GetStats(frameStats, totalStats);
+}
+int Render::SetMaxFramesInFlight(int frames) {
+    return DPL_Render_SetMaxFramesInFlight(frames);
+}
+int Render::GetFrameLatencyStats(FrameLatencyStats *stats) {
+    return DPL_Render_GetFrameLatencyStats(stats);
+}
+int Render::SetShaderCacheFile(const char *filename) {
+    return DPL_Render_SetShaderCacheFile(filename);
+}
+int Render::PrecompileShaders() {
+    return DPL_Render_PrecompileShaders();
+}
+
 /* ---------------------------------------------------------------- Text */
 
 int Text::SetDefaultEncoding(int encoding) {
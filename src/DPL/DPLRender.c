@@ -0,0 +1,60 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+    
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "DxPortLib_c.h"
+
+#include "DPL/DPLInternal.h"
+
+#include "PL/PLInternal.h"
+
+int DPL_Render_GetStats(DPL_RenderStats *frameStats, DPL_RenderStats *totalStats) {
+    if (PLG.GetRenderStats == NULL) {
+        if (frameStats != NULL) {
+            memset(frameStats, 0, sizeof(DPL_RenderStats));
+        }
+        if (totalStats != NULL) {
+            memset(totalStats, 0, sizeof(DPL_RenderStats));
+        }
+        return -1;
+    }
+    
+    return PLG.GetRenderStats(frameStats, totalStats);
+}
+
+int DPL_Render_SetMaxFramesInFlight(int frames) {
+    return PL_FrameLatency_SetMaxFrames(frames);
+}
+
+int DPL_Render_GetFrameLatencyStats(DPL_FrameLatencyStats *stats) {
+    return PL_FrameLatency_GetStats(stats);
+}
+
+int DPL_Render_SetShaderCacheFile(const char *filename) {
+    return PL_ShaderCache_SetFilename(filename);
+}
+
+int DPL_Render_PrecompileShaders() {
+    if (PLG.PrecompileShaders == NULL) {
+        return -1;
+    }
+    
+    return PLG.PrecompileShaders();
+}
@@ -0,0 +1,600 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+    
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "DPLBuildConfig.h"
+
+#ifdef DXPORTLIB_DXLIB_INTERFACE
+
+#include "PL/PLInternal.h"
+#include "DxInternal.h"
+
+/* ---------------------------------------------------------- GRAPH ATLAS */
+/* Packs small loaded graphs together into shared textures, so drawing
+ * lots of them does not have to switch textures between each one.
+ *
+ * Each page is one large texture filled by a skyline packer: the page
+ * keeps the height of its contents across its width, and each image is
+ * placed as low as it fits. Images are stored with a border of repeated
+ * edge pixels, so filtering never samples their neighbours.
+ *
+ * Each image is a slot, refcounted by the graphs that point into it.
+ * When a slot is freed its space goes on the page's free list, to be
+ * reused by anything that fits in it. Once a page is empty it is reset,
+ * and any empty pages beyond the first are released.
+ *
+ * Images are never moved once placed, as that would mean reading the
+ * textures back.
+ */
+
+#define ATLAS_BORDER 1
+#define ATLAS_MAX_PAGES 32
+
+#define ATLAS_DEFAULT_MAXGRAPHSIZE 256
+#define ATLAS_DEFAULT_PAGESIZE 2048
+
+typedef struct SkylineNode {
+    int x, y, w;
+} SkylineNode;
+
+typedef struct AtlasPage {
+    int inUse;
+    int textureRefID;
+    int hasAlphaChannel;
+    int size;
+    
+    SkylineNode *skyline;
+    int skylineCount;
+    
+    PLRect *freeRects;
+    int freeRectCount;
+    int freeRectCapacity;
+    
+    int slotCount;
+} AtlasPage;
+
+typedef struct AtlasSlot {
+    int pageIndex;
+    PLRect rect;
+    int refCount;
+    int nextFreeSlotID;
+} AtlasSlot;
+
+static int s_atlasEnabled = DXFALSE;
+static int s_maxGraphSize = ATLAS_DEFAULT_MAXGRAPHSIZE;
+static int s_pageSize = ATLAS_DEFAULT_PAGESIZE;
+
+static AtlasPage s_pages[ATLAS_MAX_PAGES];
+
+static AtlasSlot *s_slots = NULL;
+static int s_slotCapacity = 0;
+static int s_firstFreeSlotID = -1;
+
+/* ------------------------------------------------------------- Skyline */
+
+static void s_ResetPage(AtlasPage *page) {
+    page->skyline[0].x = 0;
+    page->skyline[0].y = 0;
+    page->skyline[0].w = page->size;
+    page->skylineCount = 1;
+    
+    page->freeRectCount = 0;
+}
+
+/* Returns the y position a w*h rect would sit at, if placed at the
+ * start of node index, or -1 if it does not fit there. */
+static int s_SkylineFit(const AtlasPage *page, int index, int w, int h) {
+    int x = page->skyline[index].x;
+    int y = 0;
+    int remaining = w;
+    
+    if ((x + w) > page->size) {
+        return -1;
+    }
+    
+    while (remaining > 0) {
+        const SkylineNode *node = &page->skyline[index];
+        if (node->y > y) {
+            y = node->y;
+        }
+        if ((y + h) > page->size) {
+            return -1;
+        }
+        remaining -= node->w;
+        index += 1;
+    }
+    
+    return y;
+}
+
+static void s_SkylineRemove(AtlasPage *page, int index) {
+    int i;
+    
+    for (i = index; i < (page->skylineCount - 1); ++i) {
+        page->skyline[i] = page->skyline[i + 1];
+    }
+    page->skylineCount -= 1;
+}
+
+static void s_SkylineAdd(AtlasPage *page, int index, int x, int y, int w, int h) {
+    int i;
+    
+    for (i = page->skylineCount; i > index; --i) {
+        page->skyline[i] = page->skyline[i - 1];
+    }
+    page->skyline[index].x = x;
+    page->skyline[index].y = y + h;
+    page->skyline[index].w = w;
+    page->skylineCount += 1;
+    
+    /* Trim the nodes now hidden underneath the new one. */
+    i = index + 1;
+    while (i < page->skylineCount) {
+        SkylineNode *prev = &page->skyline[i - 1];
+        SkylineNode *node = &page->skyline[i];
+        int overlap = (prev->x + prev->w) - node->x;
+    
+        if (overlap <= 0) {
+            break;
+        }
+    
+        node->x += overlap;
+        node->w -= overlap;
+        if (node->w > 0) {
+            break;
+        }
+        s_SkylineRemove(page, i);
+    }
+    
+    /* Merge neighbours of the same height. */
+    i = 0;
+    while (i < (page->skylineCount - 1)) {
+        if (page->skyline[i].y == page->skyline[i + 1].y) {
+            page->skyline[i].w += page->skyline[i + 1].w;
+            s_SkylineRemove(page, i + 1);
+        } else {
+            i += 1;
+        }
+    }
+}
+
+static int s_SkylineInsert(AtlasPage *page, int w, int h, PLRect *rect) {
+    int bestIndex = -1;
+    int bestBottom = page->size + 1;
+    int bestWidth = 0;
+    int bestY = 0;
+    int i;
+    
+    for (i = 0; i < page->skylineCount; ++i) {
+        int y = s_SkylineFit(page, i, w, h);
+        if (y < 0) {
+            continue;
+        }
+        if ((y + h) < bestBottom
+            || ((y + h) == bestBottom && page->skyline[i].w < bestWidth)
+        ) {
+            bestIndex = i;
+            bestBottom = y + h;
+            bestWidth = page->skyline[i].w;
+            bestY = y;
+        }
+    }
+    
+    if (bestIndex < 0) {
+        return -1;
+    }
+    
+    rect->x = page->skyline[bestIndex].x;
+    rect->y = bestY;
+    rect->w = w;
+    rect->h = h;
+    
+    s_SkylineAdd(page, bestIndex, rect->x, rect->y, w, h);
+    
+    return 0;
+}
+
+/* ----------------------------------------------------------- Free list */
+
+static void s_FreeListAdd(AtlasPage *page, const PLRect *rect) {
+    PLRect r = *rect;
+    int i;
+    
+    if (r.w <= 0 || r.h <= 0) {
+        return;
+    }
+    
+    /* Join with a free neighbour that shares a full edge. */
+    i = 0;
+    while (i < page->freeRectCount) {
+        PLRect *f = &page->freeRects[i];
+        if (f->x == r.x && f->w == r.w && (f->y + f->h == r.y || r.y + r.h == f->y)) {
+            r.y = (f->y < r.y) ? f->y : r.y;
+            r.h += f->h;
+        } else if (f->y == r.y && f->h == r.h && (f->x + f->w == r.x || r.x + r.w == f->x)) {
+            r.x = (f->x < r.x) ? f->x : r.x;
+            r.w += f->w;
+        } else {
+            i += 1;
+            continue;
+        }
+    
+        page->freeRectCount -= 1;
+        page->freeRects[i] = page->freeRects[page->freeRectCount];
+        i = 0;
+    }
+    
+    if (page->freeRectCount >= page->freeRectCapacity) {
+        int newCapacity = (page->freeRectCapacity > 0) ? (page->freeRectCapacity * 2) : 16;
+        PLRect *newRects = (PLRect *)DXREALLOC(page->freeRects, sizeof(PLRect) * (size_t)newCapacity);
+        if (newRects == NULL) {
+            return;
+        }
+        page->freeRects = newRects;
+        page->freeRectCapacity = newCapacity;
+    }
+    
+    page->freeRects[page->freeRectCount] = r;
+    page->freeRectCount += 1;
+}
+
+static int s_FreeListInsert(AtlasPage *page, int w, int h, PLRect *rect) {
+    int bestIndex = -1;
+    int bestArea = 0;
+    int i;
+    PLRect f, right, bottom;
+    
+    for (i = 0; i < page->freeRectCount; ++i) {
+        const PLRect *r = &page->freeRects[i];
+        if (r->w >= w && r->h >= h) {
+            int area = r->w * r->h;
+            if (bestIndex < 0 || area < bestArea) {
+                bestIndex = i;
+                bestArea = area;
+            }
+        }
+    }
+    
+    if (bestIndex < 0) {
+        return -1;
+    }
+    
+    f = page->freeRects[bestIndex];
+    page->freeRectCount -= 1;
+    page->freeRects[bestIndex] = page->freeRects[page->freeRectCount];
+    
+    rect->x = f.x;
+    rect->y = f.y;
+    rect->w = w;
+    rect->h = h;
+    
+    /* Split what's left along the shorter side. */
+    right.x = f.x + w;
+    right.y = f.y;
+    right.w = f.w - w;
+    bottom.x = f.x;
+    bottom.y = f.y + h;
+    bottom.h = f.h - h;
+    if ((f.w - w) < (f.h - h)) {
+        right.h = h;
+        bottom.w = f.w;
+    } else {
+        right.h = f.h;
+        bottom.w = w;
+    }
+    
+    s_FreeListAdd(page, &right);
+    s_FreeListAdd(page, &bottom);
+    
+    return 0;
+}
+
+/* --------------------------------------------------------------- Pages */
+
+static int s_CreatePage(int hasAlphaChannel) {
+    AtlasPage *page;
+    int pageIndex;
+    
+    for (pageIndex = 0; pageIndex < ATLAS_MAX_PAGES; ++pageIndex) {
+        if (s_pages[pageIndex].inUse == DXFALSE) {
+            break;
+        }
+    }
+    if (pageIndex >= ATLAS_MAX_PAGES) {
+        return -1;
+    }
+    
+    page = &s_pages[pageIndex];
+    
+    page->textureRefID = PLG.Texture_CreateFromDimensions(s_pageSize, s_pageSize, hasAlphaChannel);
+    if (page->textureRefID < 0) {
+        return -1;
+    }
+    
+    page->skyline = (SkylineNode *)DXALLOC(sizeof(SkylineNode) * (size_t)(s_pageSize + 1));
+    if (page->skyline == NULL) {
+        PLG.Texture_Release(page->textureRefID);
+        return -1;
+    }
+    
+    PLG.Texture_AddRef(page->textureRefID);
+    
+    page->inUse = DXTRUE;
+    page->hasAlphaChannel = hasAlphaChannel;
+    page->size = s_pageSize;
+    page->freeRects = NULL;
+    page->freeRectCapacity = 0;
+    page->slotCount = 0;
+    s_ResetPage(page);
+    
+    return pageIndex;
+}
+
+static void s_ReleasePage(AtlasPage *page) {
+    if (page->inUse == DXFALSE) {
+        return;
+    }
+    
+    PLG.Texture_Release(page->textureRefID);
+    
+    DXFREE(page->skyline);
+    if (page->freeRects != NULL) {
+        DXFREE(page->freeRects);
+    }
+    
+    page->inUse = DXFALSE;
+    page->skyline = NULL;
+    page->freeRects = NULL;
+}
+
+/* Keeps one empty page around for reuse, releasing any others. */
+static void s_TrimEmptyPages() {
+    int keptEmptyFlag = DXFALSE;
+    int i;
+    
+    for (i = 0; i < ATLAS_MAX_PAGES; ++i) {
+        AtlasPage *page = &s_pages[i];
+        if (page->inUse == DXFALSE || page->slotCount > 0) {
+            continue;
+        }
+        if (keptEmptyFlag == DXFALSE) {
+            keptEmptyFlag = DXTRUE;
+        } else {
+            s_ReleasePage(page);
+        }
+    }
+}
+
+static int s_PageInsert(AtlasPage *page, int w, int h, PLRect *rect) {
+    if (s_FreeListInsert(page, w, h, rect) == 0) {
+        return 0;
+    }
+    return s_SkylineInsert(page, w, h, rect);
+}
+
+/* --------------------------------------------------------------- Slots */
+
+static AtlasSlot *s_GetSlot(int slotID) {
+    if (slotID < 0 || slotID >= s_slotCapacity || s_slots[slotID].pageIndex < 0) {
+        return NULL;
+    }
+    return &s_slots[slotID];
+}
+
+static int s_AllocateSlotID() {
+    int slotID;
+    
+    if (s_firstFreeSlotID < 0) {
+        int newCapacity = (s_slotCapacity > 0) ? (s_slotCapacity * 2) : 256;
+        AtlasSlot *newSlots = (AtlasSlot *)DXREALLOC(s_slots, sizeof(AtlasSlot) * (size_t)newCapacity);
+        int i;
+    
+        if (newSlots == NULL) {
+            return -1;
+        }
+    
+        for (i = newCapacity - 1; i >= s_slotCapacity; --i) {
+            newSlots[i].pageIndex = -1;
+            newSlots[i].nextFreeSlotID = s_firstFreeSlotID;
+            s_firstFreeSlotID = i;
+        }
+    
+        s_slots = newSlots;
+        s_slotCapacity = newCapacity;
+    }
+    
+    slotID = s_firstFreeSlotID;
+    s_firstFreeSlotID = s_slots[slotID].nextFreeSlotID;
+    
+    return slotID;
+}
+
+/* ------------------------------------------------------------ Interface */
+
+int Dx_Atlas_CanInsert(int w, int h) {
+    if (s_atlasEnabled == DXFALSE) {
+        return DXFALSE;
+    }
+    if (w <= 0 || h <= 0 || w > s_maxGraphSize || h > s_maxGraphSize) {
+        return DXFALSE;
+    }
+    if ((w + (ATLAS_BORDER * 2)) > s_pageSize || (h + (ATLAS_BORDER * 2)) > s_pageSize) {
+        return DXFALSE;
+    }
+    return DXTRUE;
+}
+
+/* Copies rect from the surface (or all of it, if NULL) into an atlas
+ * page. On success, returns a slot ID with one reference, and fills in
+ * the page texture and the area the image was placed at. */
+int Dx_Atlas_Insert(int surfaceID, const PLRect *rect,
+                    int *dTextureRefID, PLRect *dRect) {
+    int hasAlphaChannel = PL_Surface_HasTransparency(surfaceID);
+    int extrudedID;
+    int pageIndex, slotID;
+    int w, h;
+    AtlasPage *page;
+    AtlasSlot *slot;
+    PLRect pageRect;
+    
+    if (rect != NULL) {
+        w = rect->w;
+        h = rect->h;
+    } else if (PL_Surface_GetSize(surfaceID, &w, &h) < 0) {
+        return -1;
+    }
+    if (Dx_Atlas_CanInsert(w, h) == DXFALSE) {
+        return -1;
+    }
+    
+    extrudedID = PL_Surface_CreateExtruded(surfaceID, rect, ATLAS_BORDER);
+    if (extrudedID < 0) {
+        return -1;
+    }
+    PL_Surface_GetSize(extrudedID, &w, &h);
+    
+    /* Find a page with room, or start a new one. */
+    page = NULL;
+    for (pageIndex = 0; pageIndex < ATLAS_MAX_PAGES; ++pageIndex) {
+        AtlasPage *p = &s_pages[pageIndex];
+        if (p->inUse != DXFALSE && p->hasAlphaChannel == hasAlphaChannel
+            && s_PageInsert(p, w, h, &pageRect) == 0
+        ) {
+            page = p;
+            break;
+        }
+    }
+    if (page == NULL) {
+        pageIndex = s_CreatePage(hasAlphaChannel);
+        if (pageIndex < 0 || s_PageInsert(&s_pages[pageIndex], w, h, &pageRect) < 0) {
+            PL_Surface_Delete(extrudedID);
+            return -1;
+        }
+        page = &s_pages[pageIndex];
+    }
+    
+    slotID = s_AllocateSlotID();
+    if (slotID < 0) {
+        s_FreeListAdd(page, &pageRect);
+        PL_Surface_Delete(extrudedID);
+        return -1;
+    }
+    
+    PL_Surface_DrawToTexture(extrudedID, page->textureRefID, &pageRect);
+    PL_Surface_Delete(extrudedID);
+    
+    slot = &s_slots[slotID];
+    slot->pageIndex = pageIndex;
+    slot->rect = pageRect;
+    slot->refCount = 1;
+    slot->nextFreeSlotID = -1;
+    page->slotCount += 1;
+    
+    if (dTextureRefID != NULL) {
+        *dTextureRefID = page->textureRefID;
+    }
+    if (dRect != NULL) {
+        dRect->x = pageRect.x + ATLAS_BORDER;
+        dRect->y = pageRect.y + ATLAS_BORDER;
+        dRect->w = pageRect.w - (ATLAS_BORDER * 2);
+        dRect->h = pageRect.h - (ATLAS_BORDER * 2);
+    }
+    
+    return slotID;
+}
+
+int Dx_Atlas_AddRef(int slotID) {
+    AtlasSlot *slot = s_GetSlot(slotID);
+    if (slot == NULL) {
+        return -1;
+    }
+    
+    slot->refCount += 1;
+    
+    return 0;
+}
+
+int Dx_Atlas_Release(int slotID) {
+    AtlasSlot *slot = s_GetSlot(slotID);
+    AtlasPage *page;
+    if (slot == NULL) {
+        return -1;
+    }
+    
+    slot->refCount -= 1;
+    if (slot->refCount > 0) {
+        return 0;
+    }
+    
+    page = &s_pages[slot->pageIndex];
+    page->slotCount -= 1;
+    if (page->slotCount > 0) {
+        s_FreeListAdd(page, &slot->rect);
+    } else {
+        s_ResetPage(page);
+        s_TrimEmptyPages();
+    }
+    
+    slot->pageIndex = -1;
+    slot->nextFreeSlotID = s_firstFreeSlotID;
+    s_firstFreeSlotID = slotID;
+    
+    return 0;
+}
+
+int Dx_Atlas_SetParams(int flag, int maxGraphSize, int pageSize) {
+    s_atlasEnabled = (flag == 0) ? DXFALSE : DXTRUE;
+    
+    if (maxGraphSize > 0) {
+        s_maxGraphSize = maxGraphSize;
+    }
+    
+    /* Only affects pages created from now on. */
+    if (pageSize > 0) {
+        s_pageSize = pageSize;
+    }
+    
+    return 0;
+}
+
+int Dx_Atlas_ResetSettings() {
+    s_atlasEnabled = DXFALSE;
+    s_maxGraphSize = ATLAS_DEFAULT_MAXGRAPHSIZE;
+    s_pageSize = ATLAS_DEFAULT_PAGESIZE;
+    
+    return 0;
+}
+
+void Dx_Atlas_End() {
+    int i;
+    
+    for (i = 0; i < ATLAS_MAX_PAGES; ++i) {
+        s_ReleasePage(&s_pages[i]);
+    }
+    
+    if (s_slots != NULL) {
+        DXFREE(s_slots);
+    }
+    s_slots = NULL;
+    s_slotCapacity = 0;
+    s_firstFreeSlotID = -1;
+}
+
+#endif /* #ifdef DXPORTLIB_DXLIB_INTERFACE */
@@ -45,13 +45,23 @@
  * - Streaming of archive data.
  * - Codepage support.
  * - Preloading an entire archive to memory.
+ * - Memory mapping an archive, which reads entries straight from the mapping.
+ * - A hashed index of every file's full path, for constant time lookups.
+ * - Incrementally streaming large compressed files.
  *
  * What this does not implement:
- * - Incrementally streaming compressed data. (not immediately necessary.)
  * - Asynchronous loading. (technically the streaming can do it for non-compressed data)
  */
 
 /* ------------------------------------------------------------ DXARCHIVE INTERNAL DATA TYPES */
+typedef struct DXAIndexEntry {
+    uint32_t Hash;
+    uint32_t PathOffset;
+    uint64_t FileAddress;
+} DXAIndexEntry;
+
+#define DXA_INDEX_EMPTY ((uint32_t)0xffffffff)
+
 struct DXArchive {
     SDL_RWops *File;
     
@@ -74,6 +84,18 @@ struct DXArchive {
     
     unsigned char *PreloadData;
     unsigned int PreloadSize;
+    
+    /* Raw (still encoded) archive contents, if mapped. */
+    const unsigned char *MapData;
+    uint64_t MapSize;
+    void *MapHandle;
+    
+    /* Open addressed table of full paths, built when the archive is
+     * opened. Paths are stored uppercased, in the archive's charset,
+     * with '/' between directories. */
+    DXAIndexEntry *IndexTable;
+    unsigned int IndexMask;
+    char *IndexPaths;
 };
 
 typedef struct DXArchiveHeader {
@@ -273,7 +295,7 @@ static uint64_t DXA_GetDirectoryAddress(
     return INVALID_DIRECTORY;
 }
 
-static uint64_t DXA_GetFileAddress(DXArchive *archive, const char *filename) {
+static uint64_t DXA_ScanFileAddress(DXArchive *archive, const char *filename) {
     char fileBuf[2048];
     const char *src;
     unsigned int parity = 0;
@@ -318,32 +340,274 @@ static uint64_t DXA_GetFileAddress(DXArchive *archive, const char *filename) {
     return 0;
 }
 
+/* ------------------------------------------------------------ DXARCHIVE FILENAME INDEX */
+#define DXA_INDEX_MAX_DEPTH 64
+#define DXA_INDEX_MAX_PATH 2048
+
+static uint32_t DXA_HashPath(const char *path, int length) {
+    uint32_t hash = 2166136261u;
+    int i;
+    
+    for (i = 0; i < length; ++i) {
+        hash ^= (unsigned char)path[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Converts a UTF-8 path into the form used by the index, following the
+ * same rules as DXA_GetDirectoryAddress. Returns the length, or -1. */
+static int DXA_MakeIndexKey(DXArchive *archive, const char *filename, char *keyBuf, int keySize) {
+    const char *src = filename;
+    int charSet = (int)archive->CharSet;
+    int index = 0;
+    int componentStart = 0;
+    unsigned int ch;
+    
+    while ((ch = PL_Text_ReadUTF8Char(&src)) != '\0') {
+        if (ch == '\\' || ch == '/') {
+            /* Empty components are skipped entirely. */
+            if (index > componentStart) {
+                if (index >= keySize - 1) {
+                    return -1;
+                }
+                keyBuf[index++] = '/';
+                componentStart = index;
+            }
+        } else {
+            if (ch >= 'a' && ch <= 'z') {
+                ch = ch + 'A' - 'a';
+            }
+            
+            index += PL_Text_WriteChar(keyBuf + index, ch, keySize - 1 - index, charSet);
+            if (index >= keySize - 1) {
+                return -1;
+            }
+        }
+    }
+    keyBuf[index] = '\0';
+    
+    return index;
+}
+
+typedef struct DXAIndexBuilder {
+    unsigned int fileCount;
+    unsigned int pathBytes;
+    
+    /* NULL while counting. */
+    DXAIndexEntry *table;
+    unsigned int mask;
+    char *paths;
+    unsigned int pathOffset;
+} DXAIndexBuilder;
+
+static void DXA_IndexInsert(DXAIndexBuilder *builder, const char *path, int length, uint64_t fileAddress) {
+    uint32_t hash = DXA_HashPath(path, length);
+    unsigned int slot = hash & builder->mask;
+    
+    while (builder->table[slot].PathOffset != DXA_INDEX_EMPTY) {
+        DXAIndexEntry *entry = &builder->table[slot];
+        if (entry->Hash == hash && !SDL_strcmp(builder->paths + entry->PathOffset, path)) {
+            /* Duplicate path; the first one wins, as with the scan. */
+            return;
+        }
+        slot = (slot + 1) & builder->mask;
+    }
+    
+    SDL_memcpy(builder->paths + builder->pathOffset, path, length + 1);
+    builder->table[slot].Hash = hash;
+    builder->table[slot].PathOffset = builder->pathOffset;
+    builder->table[slot].FileAddress = fileAddress;
+    builder->pathOffset += length + 1;
+}
+
+static int DXA_IndexDirectory(DXArchive *archive, DXAIndexBuilder *builder,
+                              uint64_t directoryAddress,
+                              char *pathBuf, int pathLength, int depth) {
+    DXArchiveDirectoryInfo dirInfo;
+    uint64_t fileAddress;
+    uint64_t fileSize;
+    uint64_t i;
+    
+    if (depth > DXA_INDEX_MAX_DEPTH) {
+        return -1;
+    }
+    
+    if (archive->Version >= 6) {
+        fileSize = sizeof(DXArchiveFileInfo);
+    } else if (archive->Version >= 1) {
+        fileSize = sizeof(DXArchiveFileInfoV5);
+    } else {
+        fileSize = sizeof(DXArchiveFileInfoV1);
+    }
+    
+    DXA_GetDirectoryInfo(archive, directoryAddress, &dirInfo);
+    fileAddress = dirInfo.FileInfoAddress;
+    for (i = 0; i < dirInfo.FileInfoCount; ++i, fileAddress += fileSize) {
+        DXArchiveFileInfo fileInfo;
+        const char *name;
+        int nameLength;
+        
+        DXA_GetFileInfo(archive, fileAddress, &fileInfo);
+        DXA_GetFileNameInfo(archive, fileInfo.NameAddress, NULL, &name);
+        
+        nameLength = (int)SDL_strlen(name);
+        if (nameLength == 0 || pathLength + nameLength + 2 > DXA_INDEX_MAX_PATH) {
+            return -1;
+        }
+        SDL_memcpy(pathBuf + pathLength, name, nameLength + 1);
+        
+        if ((fileInfo.Attributes & DXA_ATTRIBUTE_DIRECTORY) != 0) {
+            pathBuf[pathLength + nameLength] = '/';
+            if (DXA_IndexDirectory(archive, builder, fileInfo.DataAddress,
+                                   pathBuf, pathLength + nameLength + 1, depth + 1) < 0) {
+                return -1;
+            }
+        } else if (builder->table == NULL) {
+            builder->fileCount += 1;
+            builder->pathBytes += pathLength + nameLength + 1;
+        } else {
+            DXA_IndexInsert(builder, pathBuf, pathLength + nameLength, fileAddress);
+        }
+    }
+    
+    return 0;
+}
+
+/* Builds the filename index. Archives the index can't describe are left
+ * without one, and fall back to scanning. */
+static void DXA_BuildIndex(DXArchive *archive) {
+    DXAIndexBuilder builder;
+    char pathBuf[DXA_INDEX_MAX_PATH];
+    unsigned int tableSize;
+    unsigned int i;
+    
+    SDL_memset(&builder, 0, sizeof(builder));
+    
+    /* Count first, so everything can be allocated exactly once. */
+    if (DXA_IndexDirectory(archive, &builder, 0, pathBuf, 0, 0) < 0
+        || builder.fileCount == 0
+    ) {
+        return;
+    }
+    
+    /* Keep the load factor at or below one half. */
+    tableSize = 16;
+    while (tableSize < builder.fileCount * 2) {
+        tableSize <<= 1;
+    }
+    
+    builder.table = (DXAIndexEntry *)DXALLOC(sizeof(DXAIndexEntry) * tableSize);
+    builder.paths = (char *)DXALLOC(builder.pathBytes);
+    builder.mask = tableSize - 1;
+    if (builder.table == NULL || builder.paths == NULL) {
+        DXFREE(builder.table);
+        DXFREE(builder.paths);
+        return;
+    }
+    for (i = 0; i < tableSize; ++i) {
+        builder.table[i].PathOffset = DXA_INDEX_EMPTY;
+    }
+    
+    if (DXA_IndexDirectory(archive, &builder, 0, pathBuf, 0, 0) < 0) {
+        DXFREE(builder.table);
+        DXFREE(builder.paths);
+        return;
+    }
+    
+    archive->IndexTable = builder.table;
+    archive->IndexMask = builder.mask;
+    archive->IndexPaths = builder.paths;
+}
+
+static uint64_t DXA_GetFileAddress(DXArchive *archive, const char *filename) {
+    char keyBuf[DXA_INDEX_MAX_PATH];
+    int length;
+    uint32_t hash;
+    unsigned int slot;
+    
+    if (archive->IndexTable == NULL) {
+        return DXA_ScanFileAddress(archive, filename);
+    }
+    
+    length = DXA_MakeIndexKey(archive, filename, keyBuf, DXA_INDEX_MAX_PATH);
+    if (length <= 0) {
+        return 0;
+    }
+    
+    hash = DXA_HashPath(keyBuf, length);
+    slot = hash & archive->IndexMask;
+    while (archive->IndexTable[slot].PathOffset != DXA_INDEX_EMPTY) {
+        const DXAIndexEntry *entry = &archive->IndexTable[slot];
+        if (entry->Hash == hash && !SDL_strcmp(archive->IndexPaths + entry->PathOffset, keyBuf)) {
+            return entry->FileAddress;
+        }
+        slot = (slot + 1) & archive->IndexMask;
+    }
+    
+    return 0;
+}
+
+/* Returns a pointer to the decoded data in place, if it is available
+ * without copying from the preload buffer. */
+static const unsigned char *DXA_GetPlainView(DXArchive *archive, uint64_t address, uint64_t length) {
+    if (archive->PreloadData != NULL) {
+        if ((address + length) > archive->PreloadSize) {
+            return NULL;
+        }
+        return archive->PreloadData + address;
+    }
+    return NULL;
+}
+
+static int DXA_ReadData(DXArchive *archive, uint64_t address, void *dest, uint64_t length) {
+    if (archive->PreloadData != NULL) {
+        if ((address + length) > archive->PreloadSize) {
+            return -1;
+        }
+        SDL_memcpy(dest, archive->PreloadData + address, (size_t)length);
+        return 0;
+    }
+    if (archive->MapData != NULL) {
+        if ((address + length) > archive->MapSize) {
+            return -1;
+        }
+        DXA_Decode(archive, archive->MapData + address, dest, length, address);
+        return 0;
+    }
+    return DXA_ReadAndDecode(archive, address, dest, length);
+}
+
 static int DXA_ReadCompressedFile(
     DXArchive *archive, DXArchiveFileInfo *fileInfo, unsigned char **dData, unsigned int *dSize
 ) {
-    unsigned char *data = (unsigned char *)DXALLOC((size_t)fileInfo->CompressedDataSize);
+    unsigned char *data = NULL;
+    const unsigned char *src;
     unsigned char *decompressed;
     uint64_t address = archive->DataAddress + fileInfo->DataAddress;
     
-    if (archive->PreloadData != NULL) {
-        if ((address + fileInfo->CompressedDataSize) > archive->PreloadSize) {
+    src = DXA_GetPlainView(archive, address, fileInfo->CompressedDataSize);
+    if (src == NULL) {
+        data = (unsigned char *)DXALLOC((size_t)fileInfo->CompressedDataSize);
+        if (DXA_ReadData(archive, address, data, fileInfo->CompressedDataSize) < 0) {
             DXFREE(data);
             return -1;
         }
-        SDL_memcpy(data, archive->PreloadData + address, (size_t)fileInfo->CompressedDataSize);
-    } else if (DXA_ReadAndDecode(archive, address, data, fileInfo->CompressedDataSize) < 0) {
-        DXFREE(data);
-        return -1;
+        src = data;
     }
     
     decompressed = (unsigned char *)DXALLOC((size_t)fileInfo->DataSize);
-    if (DXA_Decompress(data, decompressed, fileInfo->DataSize) < 0) {
+    if (DXA_Decompress(src, decompressed, fileInfo->DataSize) < 0) {
         DXFREE(decompressed);
-        DXFREE(data);
+        if (data != NULL) {
+            DXFREE(data);
+        }
         return -1;
     }
     
-    DXFREE(data);
+    if (data != NULL) {
+        DXFREE(data);
+    }
     
     *dData = decompressed;
     *dSize = (unsigned int)fileInfo->DataSize;
@@ -364,13 +628,7 @@ int DXA_ReadFile(DXArchive *archive, const char *filename, unsigned char **dData
         unsigned char *data = (unsigned char *)DXALLOC((size_t)fileInfo.DataSize);
         uint64_t address = archive->DataAddress + fileInfo.DataAddress;
         
-        if (archive->PreloadData != NULL) {
-            if ((address + fileInfo.DataSize) > archive->PreloadSize) {
-                DXFREE(data);
-                return -1;
-            }
-            SDL_memcpy(data, archive->PreloadData + address, (size_t)fileInfo.DataSize);
-        } else if (DXA_ReadAndDecode(archive, address, data, fileInfo.DataSize) < 0) {
+        if (DXA_ReadData(archive, address, data, fileInfo.DataSize) < 0) {
             DXFREE(data);
             return -1;
         }
@@ -402,6 +660,15 @@ void DXA_CloseArchive(DXArchive *archive) {
     archive->SearchInfoTable = NULL;
     archive->FileNameInfoTable = NULL;
     
+    if (archive->IndexTable != NULL) {
+        DXFREE(archive->IndexTable);
+        archive->IndexTable = NULL;
+    }
+    if (archive->IndexPaths != NULL) {
+        DXFREE(archive->IndexPaths);
+        archive->IndexPaths = NULL;
+    }
+    
     SDL_free(archive->utf8Filename);
     
     if (archive->PreloadData != NULL) {
@@ -410,6 +677,13 @@ void DXA_CloseArchive(DXArchive *archive) {
     }
     archive->PreloadSize = 0;
     
+    if (archive->MapData != NULL) {
+        PL_Platform_UnmapFile((void *)archive->MapData, (int64_t)archive->MapSize, archive->MapHandle);
+        archive->MapData = NULL;
+        archive->MapSize = 0;
+        archive->MapHandle = NULL;
+    }
+    
     SDL_RWclose(archive->File);
     archive->File = NULL;
     
@@ -425,12 +699,16 @@ int DXA_PreloadArchive(DXArchive *archive) {
         if (preloadSize > 0) {
             preloadData = DXALLOC(preloadSize + 12);
             
-            SDL_RWseek(archive->File, 0, RW_SEEK_SET);
-            if (SDL_RWread(archive->File, preloadData, preloadSize, 1) < 1) {
-                DXFREE(preloadData);
-                return -1;
+            if (archive->MapData != NULL && preloadSize <= archive->MapSize) {
+                DXA_Decode(archive, archive->MapData, preloadData, preloadSize, 0);
+            } else {
+                SDL_RWseek(archive->File, 0, RW_SEEK_SET);
+                if (SDL_RWread(archive->File, preloadData, preloadSize, 1) < 1) {
+                    DXFREE(preloadData);
+                    return -1;
+                }
+                DXA_Decode(archive, preloadData, preloadData, preloadSize, 0);
             }
-            DXA_Decode(archive, preloadData, preloadData, preloadSize, 0);
             
             archive->PreloadData = preloadData;
             archive->PreloadSize = preloadSize;
@@ -439,6 +717,30 @@ int DXA_PreloadArchive(DXArchive *archive) {
     return 0;
 }
 
+/* Maps the archive into memory. Entries are then decoded straight from
+ * the mapping, with no file handle to share between streams.
+ * Fails harmlessly where mapping isn't supported. */
+int DXA_MapArchive(DXArchive *archive) {
+    const unsigned char *mapData;
+    int64_t mapSize = 0;
+    void *mapHandle = NULL;
+    
+    if (archive->MapData != NULL) {
+        return 0;
+    }
+    
+    mapData = (const unsigned char *)PL_Platform_MapFile(archive->utf8Filename, &mapSize, &mapHandle);
+    if (mapData == NULL) {
+        return -1;
+    }
+    
+    archive->MapData = mapData;
+    archive->MapSize = (uint64_t)mapSize;
+    archive->MapHandle = mapHandle;
+    
+    return 0;
+}
+
 DXArchive *DXA_OpenArchive(const char *filename, const char *keyString) {
     SDL_RWops *rwops;
     DXArchive *archive;
@@ -456,6 +758,12 @@ DXArchive *DXA_OpenArchive(const char *filename, const char *keyString) {
     archive->DataBlob = NULL;
     archive->PreloadData = NULL;
     archive->PreloadSize = 0;
+    archive->MapData = NULL;
+    archive->MapSize = 0;
+    archive->MapHandle = NULL;
+    archive->IndexTable = NULL;
+    archive->IndexMask = 0;
+    archive->IndexPaths = NULL;
     
     DXA_SetArchiveKey(archive, keyString);
     
@@ -536,6 +844,8 @@ static int DXA_InitializeArchive(DXArchive *archive) {
         default: archive->CharSet = DX_CHARSET_DEFAULT; break;
     }
     
+    DXA_BuildIndex(archive);
+    
     return 0;
 }
 
@@ -612,12 +922,6 @@ static int DXA_ReadAndDecode(DXArchive *archive, uint64_t position, void *dest,
 
 static void DXA_Decode(DXArchive *archive, const void *vSrc, void *vDest, uint64_t length, uint64_t position) {
     unsigned char key[DXA_KEY_LENGTH];
-    unsigned int *iKey = (unsigned int *)key;
-    const unsigned char *src = (const unsigned char *)vSrc;
-    unsigned char *dest = (unsigned char *)vDest;
-    const unsigned int *iSrc = (const unsigned int *)src;
-    unsigned int *iDest = (unsigned int *)dest;
-    uint64_t count = length / 12;
     unsigned int offset = (unsigned int)(position % DXA_KEY_LENGTH);
     uint64_t i;
     unsigned char *srcKey = archive->Key;
@@ -636,18 +940,7 @@ static void DXA_Decode(DXArchive *archive, const void *vSrc, void *vDest, uint64
         }
     }
     
-    for (i = count; i > 0; --i) {
-        *iDest++ = *iSrc++ ^ iKey[0];
-        *iDest++ = *iSrc++ ^ iKey[1];
-        *iDest++ = *iSrc++ ^ iKey[2];
-    }
-    
-    count = (length - (count * 12));
-    src = (const unsigned char *)iSrc;
-    dest = (unsigned char *)iDest;
-    for (i = 0; i < count; ++i) {
-        *dest++ = *src++ ^ key[i];
-    }
+    DXA_Kernel_Xor((const unsigned char *)vSrc, (unsigned char *)vDest, (size_t)length, key);
 }
 
 void DXA_SetArchiveKey(DXArchive *archive, const char *keyString) {
@@ -758,16 +1051,8 @@ static int DXA_Decompress(const void *vSrc, void *vDest, uint64_t dest_len) {
         d_index += 1;
         
         /* - Copy from dictionary position. */
-        if (d_index < count) {
-            unsigned char *a = dest - d_index;
-            while (count-- > 0) {
-                *dest++ = *a++;
-            }
-        } else {
-            memcpy(dest, dest - d_index, count);
-            
-            dest += count;
-        }
+        DXA_Kernel_CopyMatch(dest, d_index, count);
+        dest += count;
     }
     
     return 0;
@@ -872,6 +1157,11 @@ int DXA_findNext(DXAFindData *dxaData, FILEINFOA *fileInfo) {
 
         if (s_checkFindFormat(dxaData, filename) == DXTRUE) {
             PL_Text_ConvertStrncpy(fileInfo->Name, g_DxUseCharSet, filename, -1, FILEINFONAMELEN);
+            if (entry.Attributes & DXA_ATTRIBUTE_DIRECTORY) {
+                fileInfo->DirFlag = DXTRUE;
+            } else {
+                fileInfo->Size = (LONGLONG)entry.DataSize;
+            }
             return 0;
         }
     }
@@ -1007,7 +1297,7 @@ static int SDLCALL DXA_Stream_Close(SDL_RWops *context) {
     return 0;
 }
 
-static SDL_RWops *DXA_Stream_Open(DXArchive *archive, DXArchiveFileInfo *fileInfo) {
+static SDL_RWops *DXA_Stream_Open(DXArchive *archive, uint64_t address, uint64_t length) {
     SDL_RWops *src = SDL_RWFromFile(archive->utf8Filename, "rb");
     DXAStreamRWops *dxaops;
     
@@ -1027,8 +1317,8 @@ static SDL_RWops *DXA_Stream_Open(DXArchive *archive, DXArchiveFileInfo *fileInf
     
     dxaops->archive = archive;
     dxaops->src = src;
-    dxaops->fileStartPosition = (Sint64)(fileInfo->DataAddress + archive->DataAddress);
-    dxaops->size = (Sint64)fileInfo->DataSize;
+    dxaops->fileStartPosition = (Sint64)address;
+    dxaops->size = (Sint64)length;
     dxaops->currentPosition = 0;
     
     return &dxaops->rwops;
@@ -1036,11 +1326,15 @@ static SDL_RWops *DXA_Stream_Open(DXArchive *archive, DXArchiveFileInfo *fileInf
 
 /* The DXA memory stream is basically the same as SDL_FromConstMem(),
  * except we free the memory once completed.
+ *
+ * If archive is set, the data is still encoded (it points into a
+ * mapped archive), and is decoded straight into the caller's buffer.
  */
 typedef struct DXAMemStreamRWops {
     SDL_RWops rwops;
     
     DXArchive *archive;
+    uint64_t archivePosition;
     
     int freeData;
     unsigned char *data;
@@ -1093,7 +1387,12 @@ static size_t SDLCALL DXA_MemStream_Read(SDL_RWops *context, void *ptr, size_t s
         total_size = remaining;
     }
     
-    SDL_memcpy(ptr, memstream->data + memstream->currentPosition, total_size);
+    if (memstream->archive != NULL) {
+        DXA_Decode(memstream->archive, memstream->data + memstream->currentPosition,
+                   ptr, total_size, memstream->archivePosition + memstream->currentPosition);
+    } else {
+        SDL_memcpy(ptr, memstream->data + memstream->currentPosition, total_size);
+    }
     
     memstream->currentPosition += total_size;
     
@@ -1127,6 +1426,8 @@ static SDL_RWops *DXA_MemStream_Open(unsigned char *data, size_t length, int fre
     memstream->rwops.close = DXA_MemStream_Close;
     
     memstream->rwops.type = SDL_RWOPS_UNKNOWN;
+    memstream->archive = NULL;
+    memstream->archivePosition = 0;
     memstream->data = data;
     memstream->size = length;
     memstream->currentPosition = 0;
@@ -1135,31 +1436,483 @@ static SDL_RWops *DXA_MemStream_Open(unsigned char *data, size_t length, int fre
     return &memstream->rwops;
 }
 
-SDL_RWops *DXA_OpenStream(DXArchive *archive, const char *filename) {
+static SDL_RWops *DXA_MemStream_OpenEncoded(DXArchive *archive, uint64_t address, size_t length) {
+    SDL_RWops *rwops = DXA_MemStream_Open((unsigned char *)archive->MapData + address, length, DXFALSE);
+    DXAMemStreamRWops *memstream = (DXAMemStreamRWops *)rwops;
+    
+    memstream->archive = archive;
+    memstream->archivePosition = address;
+    
+    return rwops;
+}
+
+/* ------------------------------------------------------------ DXARCHIVE LZ STREAMING */
+
+/* Decompresses an entry as it is read, instead of all at once.
+ *
+ * Only as much of the output as the largest back reference can reach is
+ * kept, in a ring buffer. As the format has no limit on that distance,
+ * the compressed data is scanned once on open to find it. Entries where
+ * that would not save much are left to DXA_ReadCompressedFile.
+ *
+ * Seeking backwards beyond the ring restarts decoding from the top.
+ */
+#define DXA_LZ_HEADER_SIZE 9
+#define DXA_LZ_MAX_TOKEN 8
+#define DXA_LZ_CHUNK_SIZE 65536
+#define DXA_LZ_MIN_WINDOW 65536
+
+typedef struct DXALZStreamRWops {
+    SDL_RWops rwops;
+    
+    /* The still compressed data, already decoded from the archive key. */
+    SDL_RWops *src;
+    uint64_t srcEnd;
+    uint64_t srcPosition;
+    
+    unsigned char code;
+    
+    unsigned char *chunk;
+    unsigned int chunkPosition;
+    unsigned int chunkLength;
+    
+    unsigned char *window;
+    uint64_t windowSize;
+    
+    uint64_t size;
+    uint64_t decoded;
+    uint64_t currentPosition;
+    
+    unsigned int matchRemaining;
+    unsigned int matchDistance;
+} DXALZStreamRWops;
+
+/* Parses one token. Returns its length in bytes, or 0 if fewer than that
+ * are available. *dCount is 0 for a literal byte. */
+static unsigned int DXA_LZ_ParseToken(const unsigned char *src, unsigned int available, unsigned char code,
+                                      unsigned char *dLiteral, unsigned int *dCount, unsigned int *dDistance) {
+    unsigned char control;
+    unsigned int length;
+    unsigned int count;
+    unsigned int distance;
+    
+    if (available < 1) {
+        return 0;
+    }
+    if (src[0] != code) {
+        *dLiteral = src[0];
+        *dCount = 0;
+        return 1;
+    }
+    
+    if (available < 2) {
+        return 0;
+    }
+    control = src[1];
+    if (control == code) {
+        *dLiteral = code;
+        *dCount = 0;
+        return 2;
+    }
+    if (control > code) {
+        control--;
+    }
+    
+    length = 2 + ((control & 4) ? 1 : 0) + (control & 3) + 1;
+    if (available < length) {
+        return 0;
+    }
+    
+    count = control >> 3;
+    src += 2;
+    if (control & 4) {
+        count |= (unsigned int)(*src++ << 5);
+    }
+    
+    distance = src[0];
+    if ((control & 3) >= 1) {
+        distance |= (unsigned int)src[1] << 8;
+    }
+    if ((control & 3) >= 2) {
+        distance |= (unsigned int)src[2] << 16;
+    }
+    if ((control & 3) >= 3) {
+        distance |= (unsigned int)src[3] << 24;
+    }
+    
+    *dCount = count + 4;
+    *dDistance = distance + 1;
+    return length;
+}
+
+/* Makes sure a whole token is buffered, unless the data ends first.
+ * Returns the number of bytes available from chunkPosition. */
+static unsigned int DXA_LZStream_Refill(DXALZStreamRWops *lz) {
+    unsigned int remaining = lz->chunkLength - lz->chunkPosition;
+    uint64_t want;
+    
+    if (remaining >= DXA_LZ_MAX_TOKEN) {
+        return remaining;
+    }
+    
+    SDL_memmove(lz->chunk, lz->chunk + lz->chunkPosition, remaining);
+    lz->chunkPosition = 0;
+    lz->chunkLength = remaining;
+    
+    want = DXA_LZ_CHUNK_SIZE - remaining;
+    if (want > lz->srcEnd - lz->srcPosition) {
+        want = lz->srcEnd - lz->srcPosition;
+    }
+    if (want > 0) {
+        size_t got = SDL_RWread(lz->src, lz->chunk + remaining, 1, (size_t)want);
+        lz->chunkLength += (unsigned int)got;
+        lz->srcPosition += got;
+    }
+    
+    return lz->chunkLength - lz->chunkPosition;
+}
+
+static void DXA_LZStream_Restart(DXALZStreamRWops *lz) {
+    SDL_RWseek(lz->src, DXA_LZ_HEADER_SIZE, RW_SEEK_SET);
+    lz->srcPosition = DXA_LZ_HEADER_SIZE;
+    lz->chunkPosition = 0;
+    lz->chunkLength = 0;
+    lz->decoded = 0;
+    lz->matchRemaining = 0;
+    lz->matchDistance = 0;
+}
+
+/* Finds the largest back reference distance. Returns -1 if the data
+ * refers to anything before its own start. */
+static int DXA_LZStream_Scan(DXALZStreamRWops *lz, uint64_t *dMaxDistance) {
+    uint64_t produced = 0;
+    uint64_t maxDistance = 0;
+    
+    DXA_LZStream_Restart(lz);
+    
+    while (produced < lz->size) {
+        unsigned int available = DXA_LZStream_Refill(lz);
+        unsigned char literal;
+        unsigned int count;
+        unsigned int distance;
+        unsigned int length;
+        
+        length = DXA_LZ_ParseToken(lz->chunk + lz->chunkPosition, available, lz->code,
+                                   &literal, &count, &distance);
+        if (length == 0) {
+            break;
+        }
+        lz->chunkPosition += length;
+        
+        if (count == 0) {
+            produced += 1;
+        } else {
+            if (distance > produced) {
+                return -1;
+            }
+            if (distance > maxDistance) {
+                maxDistance = distance;
+            }
+            produced += count;
+        }
+    }
+    
+    *dMaxDistance = maxDistance;
+    return 0;
+}
+
+/* Decodes until limit bytes of output exist, or the data runs out. */
+static void DXA_LZStream_Decode(DXALZStreamRWops *lz, uint64_t limit) {
+    unsigned char *window = lz->window;
+    uint64_t mask = lz->windowSize - 1;
+    
+    if (limit > lz->size) {
+        limit = lz->size;
+    }
+    
+    while (lz->decoded < limit) {
+        unsigned int available;
+        unsigned char literal;
+        unsigned int count;
+        unsigned int distance;
+        unsigned int length;
+        
+        if (lz->matchRemaining > 0) {
+            uint64_t n = lz->matchRemaining;
+            uint64_t destPos = lz->decoded & mask;
+            uint64_t srcPos = (lz->decoded - lz->matchDistance) & mask;
+            
+            if (n > limit - lz->decoded) {
+                n = limit - lz->decoded;
+            }
+            
+            if (srcPos + lz->matchDistance == destPos
+                && destPos + n <= lz->windowSize
+            ) {
+                DXA_Kernel_CopyMatch(window + destPos, lz->matchDistance, (size_t)n);
+            } else {
+                uint64_t i;
+                for (i = 0; i < n; ++i) {
+                    window[(lz->decoded + i) & mask] = window[(lz->decoded + i - lz->matchDistance) & mask];
+                }
+            }
+            
+            lz->decoded += n;
+            lz->matchRemaining -= (unsigned int)n;
+            continue;
+        }
+        
+        available = DXA_LZStream_Refill(lz);
+        length = DXA_LZ_ParseToken(lz->chunk + lz->chunkPosition, available, lz->code,
+                                   &literal, &count, &distance);
+        if (length == 0) {
+            break;
+        }
+        lz->chunkPosition += length;
+        
+        if (count == 0) {
+            window[lz->decoded & mask] = literal;
+            lz->decoded += 1;
+        } else {
+            if (distance > lz->decoded || distance >= lz->windowSize) {
+                break;
+            }
+            lz->matchRemaining = count;
+            lz->matchDistance = distance;
+        }
+    }
+}
+
+static Sint64 SDLCALL DXA_LZStream_Size(SDL_RWops *context) {
+    DXALZStreamRWops *lz = (DXALZStreamRWops *)context;
+    
+    return (Sint64)lz->size;
+}
+
+static Sint64 SDLCALL DXA_LZStream_Seek(SDL_RWops *context, Sint64 offset, int whence) {
+    DXALZStreamRWops *lz = (DXALZStreamRWops *)context;
+    Sint64 position = (Sint64)lz->currentPosition;
+    
+    switch(whence) {
+        case RW_SEEK_SET:
+            position = offset;
+            break;
+        case RW_SEEK_CUR:
+            position += offset;
+            break;
+        case RW_SEEK_END:
+            position = (Sint64)lz->size + offset;
+            break;
+    }
+    
+    if (position < 0) {
+        position = 0;
+    }
+    if (position > (Sint64)lz->size) {
+        position = (Sint64)lz->size;
+    }
+    
+    /* Decoding catches up on the next read. */
+    lz->currentPosition = (uint64_t)position;
+    
+    return position;
+}
+
+static size_t SDLCALL DXA_LZStream_Read(SDL_RWops *context, void *ptr, size_t size, size_t maxnum) {
+    DXALZStreamRWops *lz = (DXALZStreamRWops *)context;
+    unsigned char *dest = (unsigned char *)ptr;
+    uint64_t mask = lz->windowSize - 1;
+    size_t total_size = size * maxnum;
+    size_t copied = 0;
+    
+    if (size <= 0 || maxnum <= 0 || (size_t)(total_size / maxnum) != size) {
+        return 0;
+    }
+    
+    if (total_size > lz->size - lz->currentPosition) {
+        total_size = (size_t)(lz->size - lz->currentPosition);
+    }
+    
+    while (copied < total_size) {
+        uint64_t position = lz->currentPosition;
+        
+        if (position + lz->windowSize < lz->decoded) {
+            /* Fell out of the window. */
+            DXA_LZStream_Restart(lz);
+        }
+        
+        if (position >= lz->decoded) {
+            uint64_t want = total_size - copied;
+            uint64_t oldDecoded;
+            
+            if (want < DXA_LZ_CHUNK_SIZE) {
+                want = DXA_LZ_CHUNK_SIZE;
+            }
+            if (want > lz->windowSize) {
+                want = lz->windowSize;
+            }
+            
+            /* Anything skipped over by a seek is decoded and dropped. */
+            if (position > lz->decoded + lz->windowSize) {
+                want = 0;
+            }
+            
+            oldDecoded = lz->decoded;
+            DXA_LZStream_Decode(lz, position + want);
+            if (lz->decoded == oldDecoded) {
+                break;
+            }
+            continue;
+        } else {
+            uint64_t n = lz->decoded - position;
+            uint64_t windowPos = position & mask;
+            
+            if (n > total_size - copied) {
+                n = total_size - copied;
+            }
+            if (windowPos + n > lz->windowSize) {
+                n = lz->windowSize - windowPos;
+            }
+            
+            SDL_memcpy(dest + copied, lz->window + windowPos, (size_t)n);
+            copied += (size_t)n;
+            lz->currentPosition += n;
+        }
+    }
+    
+    return copied / size;
+}
+
+static size_t SDLCALL DXA_LZStream_DisableWrite(SDL_RWops *context, const void *ptr, size_t size, size_t num) {
+    return 0; /* writing is not supported. */
+}
+
+static int SDLCALL DXA_LZStream_Close(SDL_RWops *context) {
+    if (context != NULL) {
+        DXALZStreamRWops *lz = (DXALZStreamRWops *)context;
+        
+        SDL_RWclose(lz->src);
+        DXFREE(lz->chunk);
+        DXFREE(lz->window);
+        DXFREE(lz);
+    }
+    return 0;
+}
+
+/* Takes ownership of src, which must read the compressed data as stored.
+ * Returns NULL without closing src if streaming isn't worthwhile. */
+static SDL_RWops *DXA_LZStream_Open(SDL_RWops *src, DXArchiveFileInfo *fileInfo) {
+    DXALZStreamRWops *lz;
+    unsigned char header[DXA_LZ_HEADER_SIZE];
+    uint64_t srcLength;
+    uint64_t maxDistance;
+    uint64_t windowSize;
+    
+    if (fileInfo->CompressedDataSize < DXA_LZ_HEADER_SIZE
+        || fileInfo->DataSize < DXA_LZ_MIN_WINDOW * 2
+        || SDL_RWread(src, header, DXA_LZ_HEADER_SIZE, 1) < 1
+    ) {
+        return NULL;
+    }
+    
+    srcLength = DXA_LZ_HEADER_SIZE + SDL_SwapLE32(*(uint32_t *)(header + 4));
+    if (srcLength > fileInfo->CompressedDataSize) {
+        srcLength = fileInfo->CompressedDataSize;
+    }
+    
+    lz = (DXALZStreamRWops *)DXCALLOC(sizeof(DXALZStreamRWops));
+    lz->src = src;
+    lz->srcEnd = srcLength;
+    lz->code = header[8];
+    lz->size = fileInfo->DataSize;
+    lz->chunk = (unsigned char *)DXALLOC(DXA_LZ_CHUNK_SIZE);
+    
+    if (DXA_LZStream_Scan(lz, &maxDistance) < 0) {
+        DXFREE(lz->chunk);
+        DXFREE(lz);
+        return NULL;
+    }
+    
+    windowSize = DXA_LZ_MIN_WINDOW;
+    while (windowSize <= maxDistance) {
+        windowSize <<= 1;
+    }
+    if (windowSize * 2 > lz->size) {
+        DXFREE(lz->chunk);
+        DXFREE(lz);
+        return NULL;
+    }
+    
+    lz->window = (unsigned char *)DXALLOC((size_t)windowSize);
+    lz->windowSize = windowSize;
+    
+    lz->rwops.size = DXA_LZStream_Size;
+    lz->rwops.seek = DXA_LZStream_Seek;
+    lz->rwops.read = DXA_LZStream_Read;
+    lz->rwops.write = DXA_LZStream_DisableWrite;
+    lz->rwops.close = DXA_LZStream_Close;
+    
+    lz->rwops.type = SDL_RWOPS_UNKNOWN;
+    
+    DXA_LZStream_Restart(lz);
+    
+    return &lz->rwops;
+}
+
+/* ------------------------------------------------------------ DXARCHIVE STREAM OPENING */
+
+/* Opens a stream over a range of the archive, reading it as plainly as
+ * the archive allows. */
+static SDL_RWops *DXA_OpenRangeStream(DXArchive *archive, uint64_t address, uint64_t length) {
+    const unsigned char *view;
+    
+    if (archive->PreloadData != NULL || archive->MapData != NULL) {
+        if ((address + length) > (archive->PreloadData != NULL ? archive->PreloadSize : archive->MapSize)) {
+            return NULL;
+        }
+    }
+    
+    view = DXA_GetPlainView(archive, address, length);
+    if (view != NULL) {
+        return DXA_MemStream_Open((unsigned char *)view, (size_t)length, DXFALSE);
+    }
+    if (archive->MapData != NULL) {
+        return DXA_MemStream_OpenEncoded(archive, address, (size_t)length);
+    }
+    return DXA_Stream_Open(archive, address, length);
+}
+
+SDL_RWops *DXA_OpenStream(DXArchive *archive, const char *filename, int streamCompressed) {
     uint64_t fileAddress = DXA_GetFileAddress(archive, filename);
     DXArchiveFileInfo fileInfo;
+    uint64_t address;
     
     if (fileAddress == 0) {
         return NULL;
     }
     
     DXA_GetFileInfo(archive, fileAddress, &fileInfo);
+    address = archive->DataAddress + fileInfo.DataAddress;
+    
     if (fileInfo.CompressedDataSize == 0xffffffff) {
-        if (archive->PreloadData != NULL) {
-            uint64_t address = archive->DataAddress + fileInfo.DataAddress;
-            if ((address + fileInfo.DataSize) > archive->PreloadSize) {
-                return NULL;
-            }
-            return DXA_MemStream_Open(archive->PreloadData + address, (size_t)fileInfo.DataSize, DXFALSE);
-        }
-        return DXA_Stream_Open(archive, &fileInfo);
+        return DXA_OpenRangeStream(archive, address, fileInfo.DataSize);
     } else {
-        /* Compressed data streaming is not supported at this time, so just load the whole thing
-         * and return a memory stream.
-         */
         unsigned char *decompressed;
         unsigned int decompressedSize;
         
+        if (streamCompressed == DXTRUE) {
+            SDL_RWops *src = DXA_OpenRangeStream(archive, address, fileInfo.CompressedDataSize);
+            if (src != NULL) {
+                SDL_RWops *rwops = DXA_LZStream_Open(src, &fileInfo);
+                if (rwops != NULL) {
+                    return rwops;
+                }
+                SDL_RWclose(src);
+            }
+        }
+        
+        /* Small files, or ones that refer back too far to stream well,
+         * are loaded whole. */
         if (DXA_ReadCompressedFile(archive, &fileInfo, &decompressed, &decompressedSize) >= 0) {
             return DXA_MemStream_Open(decompressed, decompressedSize, DXTRUE);
         }
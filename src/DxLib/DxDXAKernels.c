@@ -0,0 +1,282 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+    
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "DPLBuildConfig.h"
+
+#ifdef DXPORTLIB_DXLIB_INTERFACE
+
+#ifndef DX_NON_DXA
+
+#include "PL/PLInternal.h"
+#include "DxInternal.h"
+
+#include "SDL.h"
+
+/* The two inner loops of reading an archive: undoing the key XOR, and
+ * copying LZ matches. Each has a plain C version and SSE2/AVX2 versions,
+ * picked at runtime from what the CPU supports.
+ *
+ * All versions produce identical output.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define DXA_KERNELS_X86
+#  define DXA_TARGET(x) __attribute__((target(x)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  define DXA_KERNELS_X86
+#  define DXA_TARGET(x)
+#endif
+
+#ifdef DXA_KERNELS_X86
+#  include <immintrin.h>
+#endif
+
+typedef void (*DXAXorFunction)(const unsigned char *src, unsigned char *dest,
+                               size_t length, const unsigned char *key);
+typedef void (*DXACopyMatchFunction)(unsigned char *dest, size_t distance, size_t count);
+
+static DXAXorFunction s_xorFunction = NULL;
+static DXACopyMatchFunction s_copyMatchFunction = NULL;
+
+/* ------------------------------------------------------------ SCALAR */
+
+static void DXA_Xor_Scalar(const unsigned char *src, unsigned char *dest,
+                           size_t length, const unsigned char *key) {
+    const unsigned int *iKey = (const unsigned int *)key;
+    const unsigned int *iSrc = (const unsigned int *)src;
+    unsigned int *iDest = (unsigned int *)dest;
+    size_t count = length / 12;
+    size_t i;
+    
+    for (i = count; i > 0; --i) {
+        *iDest++ = *iSrc++ ^ iKey[0];
+        *iDest++ = *iSrc++ ^ iKey[1];
+        *iDest++ = *iSrc++ ^ iKey[2];
+    }
+    
+    count = length - (count * 12);
+    src = (const unsigned char *)iSrc;
+    dest = (unsigned char *)iDest;
+    for (i = 0; i < count; ++i) {
+        *dest++ = *src++ ^ key[i];
+    }
+}
+
+static void DXA_CopyMatch_Scalar(unsigned char *dest, size_t distance, size_t count) {
+    const unsigned char *a = dest - distance;
+    
+    if (distance < count) {
+        while (count-- > 0) {
+            *dest++ = *a++;
+        }
+    } else {
+        memcpy(dest, a, count);
+    }
+}
+
+/* Widens a short-distance match by copying the pattern onto itself,
+ * doubling the distance each time, until it is at least minDistance.
+ * Returns how much of the match is left. */
+static DXINLINE size_t DXA_ReplicatePattern(unsigned char **pDest, size_t *pDistance,
+                                            size_t count, size_t minDistance) {
+    unsigned char *dest = *pDest;
+    const unsigned char *a = dest - *pDistance;
+    size_t distance = *pDistance;
+    
+    while (distance < minDistance && count > 0) {
+        size_t n = (distance < count) ? distance : count;
+        memcpy(dest, a, n);
+        dest += n;
+        count -= n;
+        distance += n;
+    }
+    
+    *pDest = dest;
+    *pDistance = distance;
+    return count;
+}
+
+#ifdef DXA_KERNELS_X86
+/* ------------------------------------------------------------ SSE2 */
+
+/* 48 bytes is the smallest whole number of both 12 byte keys and
+ * 16 byte registers. */
+DXA_TARGET("sse2")
+static void DXA_Xor_SSE2(const unsigned char *src, unsigned char *dest,
+                         size_t length, const unsigned char *key) {
+    unsigned char expanded[48];
+    __m128i k0, k1, k2;
+    size_t i;
+    
+    for (i = 0; i < 48; ++i) {
+        expanded[i] = key[i % DXA_KEY_LENGTH];
+    }
+    k0 = _mm_loadu_si128((const __m128i *)(expanded + 0));
+    k1 = _mm_loadu_si128((const __m128i *)(expanded + 16));
+    k2 = _mm_loadu_si128((const __m128i *)(expanded + 32));
+    
+    while (length >= 48) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 0));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+        _mm_storeu_si128((__m128i *)(dest + 0), _mm_xor_si128(a, k0));
+        _mm_storeu_si128((__m128i *)(dest + 16), _mm_xor_si128(b, k1));
+        _mm_storeu_si128((__m128i *)(dest + 32), _mm_xor_si128(c, k2));
+        src += 48;
+        dest += 48;
+        length -= 48;
+    }
+    
+    /* Whole periods leave the key where it started. */
+    DXA_Xor_Scalar(src, dest, length, key);
+}
+
+DXA_TARGET("sse2")
+static void DXA_CopyMatch_SSE2(unsigned char *dest, size_t distance, size_t count) {
+    if (distance >= count) {
+        memcpy(dest, dest - distance, count);
+        return;
+    }
+    
+    count = DXA_ReplicatePattern(&dest, &distance, count, 16);
+    
+    while (count >= 16) {
+        _mm_storeu_si128((__m128i *)dest, _mm_loadu_si128((const __m128i *)(dest - distance)));
+        dest += 16;
+        count -= 16;
+    }
+    DXA_CopyMatch_Scalar(dest, distance, count);
+}
+
+/* ------------------------------------------------------------ AVX2 */
+
+DXA_TARGET("avx2")
+static void DXA_Xor_AVX2(const unsigned char *src, unsigned char *dest,
+                         size_t length, const unsigned char *key) {
+    unsigned char expanded[96];
+    __m256i k0, k1, k2;
+    size_t i;
+    
+    for (i = 0; i < 96; ++i) {
+        expanded[i] = key[i % DXA_KEY_LENGTH];
+    }
+    k0 = _mm256_loadu_si256((const __m256i *)(expanded + 0));
+    k1 = _mm256_loadu_si256((const __m256i *)(expanded + 32));
+    k2 = _mm256_loadu_si256((const __m256i *)(expanded + 64));
+    
+    while (length >= 96) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + 0));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + 64));
+        _mm256_storeu_si256((__m256i *)(dest + 0), _mm256_xor_si256(a, k0));
+        _mm256_storeu_si256((__m256i *)(dest + 32), _mm256_xor_si256(b, k1));
+        _mm256_storeu_si256((__m256i *)(dest + 64), _mm256_xor_si256(c, k2));
+        src += 96;
+        dest += 96;
+        length -= 96;
+    }
+    
+    DXA_Xor_SSE2(src, dest, length, key);
+}
+
+DXA_TARGET("avx2")
+static void DXA_CopyMatch_AVX2(unsigned char *dest, size_t distance, size_t count) {
+    if (distance >= count) {
+        memcpy(dest, dest - distance, count);
+        return;
+    }
+    
+    count = DXA_ReplicatePattern(&dest, &distance, count, 32);
+    
+    while (count >= 32) {
+        _mm256_storeu_si256((__m256i *)dest, _mm256_loadu_si256((const __m256i *)(dest - distance)));
+        dest += 32;
+        count -= 32;
+    }
+    DXA_CopyMatch_Scalar(dest, distance, count);
+}
+#endif /* #ifdef DXA_KERNELS_X86 */
+
+/* ------------------------------------------------------------ DISPATCH */
+
+static int DXA_GetBestKernelLevel() {
+#ifdef DXA_KERNELS_X86
+#  if SDL_VERSION_ATLEAST(2, 0, 4)
+    if (SDL_HasAVX2()) {
+        return DXA_KERNEL_AVX2;
+    }
+#  endif
+    if (SDL_HasSSE2()) {
+        return DXA_KERNEL_SSE2;
+    }
+#endif
+    return DXA_KERNEL_SCALAR;
+}
+
+/* Picks which versions to use. level is one of the DXA_KERNEL_ values,
+ * or -1 for the best available; anything the CPU can't run is lowered.
+ * Returns the level in use.
+ *
+ * Archives can be read from loader threads, so this is done once by
+ * Dx_File_Init, before any of them can start. */
+int DXA_Kernel_SetLevel(int level) {
+    int bestLevel = DXA_GetBestKernelLevel();
+    
+    if (level < 0 || level > bestLevel) {
+        level = bestLevel;
+    }
+    
+    switch(level) {
+#ifdef DXA_KERNELS_X86
+        case DXA_KERNEL_AVX2:
+            s_xorFunction = DXA_Xor_AVX2;
+            s_copyMatchFunction = DXA_CopyMatch_AVX2;
+            break;
+        case DXA_KERNEL_SSE2:
+            s_xorFunction = DXA_Xor_SSE2;
+            s_copyMatchFunction = DXA_CopyMatch_SSE2;
+            break;
+#endif
+        default:
+            level = DXA_KERNEL_SCALAR;
+            s_xorFunction = DXA_Xor_Scalar;
+            s_copyMatchFunction = DXA_CopyMatch_Scalar;
+            break;
+    }
+    
+    return level;
+}
+
+/* XORs length bytes with the 12 byte key, repeating from its start. */
+void DXA_Kernel_Xor(const unsigned char *src, unsigned char *dest,
+                    size_t length, const unsigned char *key) {
+    s_xorFunction(src, dest, length, key);
+}
+
+/* Copies count bytes from distance bytes back, where the two may
+ * overlap. Never writes past dest + count. */
+void DXA_Kernel_CopyMatch(unsigned char *dest, size_t distance, size_t count) {
+    s_copyMatchFunction(dest, distance, count);
+}
+
+#endif /* #ifndef DX_NON_DXA */
+
+#endif /* #ifdef DXPORTLIB_DXLIB_INTERFACE */
@@ -140,27 +140,302 @@ typedef struct VertexCache {
     int blendFlag;
     
     int drawMode;
+    int quadFlag;
     
     unsigned char *vertexData;
     int vertexDataPosition;
     int vertexDataSize;
+    
+    /* Quads are written as 4 vertices each, and drawn with a static
+     * index buffer large enough to cover the whole cache. The vertices
+     * themselves are streamed like any others. */
+    unsigned short *quadIndexData;
+    int quadIndexCount;
+    int quadIndexBuffer;
 } VertexCache;
 
 static VertexCache s_cache;
 
+static int s_FlushCache();
+
+/* -------------------------------------------------------- DRAW SORTING */
+
+/* Optional deferred mode (EXT_SetUseDrawSorting).
+ *
+ * Instead of going straight into the cache, each draw is written to a
+ * separate buffer and recorded as a command. Once its vertices are known,
+ * it's given a batch: the most recent batch with the same state, provided
+ * nothing drawn after that batch overlaps it on screen. Otherwise, it
+ * starts a new batch.
+ *
+ * On flush, batches are drawn in order, each one in a single call, with
+ * their draws in the order they were made. Anything that would change
+ * the result of a draw (blend mode, draw area, draw screen...) already
+ * flushes the cache, so only draws between those are ever reordered.
+ */
+
+#define MAX_DEFERRED_BATCHES 64
+#define MAX_DEFERRED_DRAWS 4096
+
+typedef struct _DeferredDraw {
+    const VertexDefinition *definition;
+    int drawMode;
+    int textureRefID;
+    int blendFlag;
+    int quadFlag;
+    
+    int dataPosition;
+    int vertexCount;
+    
+    int next;
+} DeferredDraw;
+
+typedef struct _DeferredBatch {
+    const VertexDefinition *definition;
+    int drawMode;
+    int textureRefID;
+    int blendFlag;
+    int quadFlag;
+    
+    /* Screen area covered by everything in this batch. */
+    float x1, y1, x2, y2;
+    
+    int firstDraw;
+    int lastDraw;
+} DeferredBatch;
+
+typedef struct _DeferredList {
+    int enabled;
+    
+    unsigned char *data;
+    int dataPosition;
+    int dataSize;
+    
+    DeferredDraw *draws;
+    int drawCount;
+    
+    /* The last draw is only given a batch once its vertices are written. */
+    int pendingDraw;
+    
+    DeferredBatch batches[MAX_DEFERRED_BATCHES];
+    int batchCount;
+} DeferredList;
+
+static DeferredList s_deferred;
+
+static void s_DeferredGetBounds(const DeferredDraw *draw,
+                                float *x1, float *y1, float *x2, float *y2) {
+    const VertexDefinition *def = draw->definition;
+    const unsigned char *data = s_deferred.data + draw->dataPosition;
+    int positionOffset = 0;
+    int i;
+    
+    for (i = 0; i < def->elementCount; ++i) {
+        if (def->elements[i].vertexType == VERTEX_POSITION) {
+            positionOffset = def->elements[i].offset;
+            break;
+        }
+    }
+    
+    *x1 = *y1 = 1e30f;
+    *x2 = *y2 = -1e30f;
+    for (i = 0; i < draw->vertexCount; ++i) {
+        const float *pos = (const float *)(data + (i * def->vertexByteSize) + positionOffset);
+        if (pos[0] < *x1) { *x1 = pos[0]; }
+        if (pos[0] > *x2) { *x2 = pos[0]; }
+        if (pos[1] < *y1) { *y1 = pos[1]; }
+        if (pos[1] > *y2) { *y2 = pos[1]; }
+    }
+    
+    /* Lines and points cover pixels outside their vertices. */
+    if (draw->drawMode == PL_PRIM_LINES || draw->drawMode == PL_PRIM_POINTS) {
+        *x1 -= 1.0f; *y1 -= 1.0f;
+        *x2 += 1.0f; *y2 += 1.0f;
+    }
+}
+
+static int s_DeferredAssignPending() {
+    int drawIndex = s_deferred.pendingDraw;
+    DeferredDraw *draw;
+    DeferredBatch *batch;
+    float x1, y1, x2, y2;
+    int i, target;
+    
+    if (drawIndex < 0) {
+        return 0;
+    }
+    
+    draw = &s_deferred.draws[drawIndex];
+    s_DeferredGetBounds(draw, &x1, &y1, &x2, &y2);
+    
+    /* Walk back through the batches until one matches, giving up if
+     * the draw overlaps something that has to stay on top of it. */
+    target = -1;
+    for (i = s_deferred.batchCount - 1; i >= 0; --i) {
+        batch = &s_deferred.batches[i];
+        if (batch->definition == draw->definition
+            && batch->drawMode == draw->drawMode
+            && batch->textureRefID == draw->textureRefID
+            && batch->blendFlag == draw->blendFlag
+            && batch->quadFlag == draw->quadFlag
+        ) {
+            target = i;
+            break;
+        }
+        if (x1 < batch->x2 && batch->x1 < x2 && y1 < batch->y2 && batch->y1 < y2) {
+            break;
+        }
+    }
+    
+    if (target < 0) {
+        if (s_deferred.batchCount >= MAX_DEFERRED_BATCHES) {
+            return -1;
+        }
+        target = s_deferred.batchCount;
+        s_deferred.batchCount += 1;
+        
+        batch = &s_deferred.batches[target];
+        batch->definition = draw->definition;
+        batch->drawMode = draw->drawMode;
+        batch->textureRefID = draw->textureRefID;
+        batch->blendFlag = draw->blendFlag;
+        batch->quadFlag = draw->quadFlag;
+        batch->x1 = x1; batch->y1 = y1;
+        batch->x2 = x2; batch->y2 = y2;
+        batch->firstDraw = drawIndex;
+    } else {
+        batch = &s_deferred.batches[target];
+        if (x1 < batch->x1) { batch->x1 = x1; }
+        if (y1 < batch->y1) { batch->y1 = y1; }
+        if (x2 > batch->x2) { batch->x2 = x2; }
+        if (y2 > batch->y2) { batch->y2 = y2; }
+        s_deferred.draws[batch->lastDraw].next = drawIndex;
+    }
+    batch->lastDraw = drawIndex;
+    
+    s_deferred.pendingDraw = -1;
+    
+    return 0;
+}
+
+static void s_DeferredAddToCache(const DeferredDraw *draw) {
+    int n = draw->vertexCount * draw->definition->vertexByteSize;
+    
+    if (s_cache.definition != draw->definition
+        || s_cache.drawMode != draw->drawMode
+        || s_cache.textureRefID != draw->textureRefID
+        || s_cache.blendFlag != draw->blendFlag
+        || s_cache.quadFlag != draw->quadFlag
+    ) {
+        s_FlushCache();
+        s_cache.definition = draw->definition;
+        s_cache.drawMode = draw->drawMode;
+        s_cache.textureRefID = draw->textureRefID;
+        s_cache.blendFlag = draw->blendFlag;
+        s_cache.quadFlag = draw->quadFlag;
+    }
+    
+    memcpy(s_cache.vertexData + s_cache.vertexDataPosition,
+           s_deferred.data + draw->dataPosition, (size_t)n);
+    s_cache.vertexDataPosition += n;
+    s_cache.vertexCount += draw->vertexCount;
+}
+
+static int s_DeferredFlush() {
+    int i;
+    
+    /* If we ran out of batches, the last draw just goes on top. */
+    int lastDraw = -1;
+    if (s_DeferredAssignPending() < 0) {
+        lastDraw = s_deferred.pendingDraw;
+        s_deferred.pendingDraw = -1;
+    }
+    
+    for (i = 0; i < s_deferred.batchCount; ++i) {
+        int drawIndex = s_deferred.batches[i].firstDraw;
+        
+        while (drawIndex >= 0) {
+            s_DeferredAddToCache(&s_deferred.draws[drawIndex]);
+            drawIndex = s_deferred.draws[drawIndex].next;
+        }
+    }
+    if (lastDraw >= 0) {
+        s_DeferredAddToCache(&s_deferred.draws[lastDraw]);
+    }
+    s_FlushCache();
+    
+    s_deferred.dataPosition = 0;
+    s_deferred.drawCount = 0;
+    s_deferred.batchCount = 0;
+    
+    return 0;
+}
+
+static void *s_BeginDeferred(
+    const VertexDefinition *definition,
+    int vertexCount,
+    int drawMode, int textureRefID, int blendFlag, int quadFlag
+) {
+    int n = vertexCount * definition->vertexByteSize;
+    DeferredDraw *draw;
+    
+    if (s_DeferredAssignPending() < 0) {
+        /* Out of batches, so draw what we have and start over. */
+        s_DeferredFlush();
+    }
+    
+    if ((s_deferred.dataPosition + n) > s_deferred.dataSize
+        || s_deferred.drawCount >= MAX_DEFERRED_DRAWS
+    ) {
+        s_DeferredFlush();
+    }
+    
+    draw = &s_deferred.draws[s_deferred.drawCount];
+    draw->definition = definition;
+    draw->drawMode = drawMode;
+    draw->textureRefID = textureRefID;
+    draw->blendFlag = blendFlag;
+    draw->quadFlag = quadFlag;
+    draw->dataPosition = s_deferred.dataPosition;
+    draw->vertexCount = vertexCount;
+    draw->next = -1;
+    
+    s_deferred.pendingDraw = s_deferred.drawCount;
+    s_deferred.drawCount += 1;
+    s_deferred.dataPosition += n;
+    
+    return s_deferred.data + draw->dataPosition;
+}
+
+int Dx_Draw_SetUseDrawSorting(int flag) {
+    Dx_Draw_FlushCache();
+    
+    s_deferred.enabled = (flag != 0) ? DXTRUE : DXFALSE;
+    
+    return 0;
+}
+
+/* --------------------------------------------------------- CACHE ACCESS */
+
 /* Given a call with a vertex definition and the number of vertices,
  * returns the starting vertex pointer.
  */
 static void *s_BeginCache(
     const VertexDefinition *definition,
     int vertexCount,
-    int drawMode, int textureRefID, int blendFlag
+    int drawMode, int textureRefID, int blendFlag, int quadFlag
 ) {
     /* - If this is the same as the last definition, try to continue it. */
     int vertexSize = definition->vertexByteSize;
     
+    if (s_deferred.enabled == DXTRUE) {
+        return s_BeginDeferred(definition, vertexCount,
+                               drawMode, textureRefID, blendFlag, quadFlag);
+    }
+    
     if (s_cache.definition == definition
         && s_cache.drawMode == drawMode
+        && s_cache.quadFlag == quadFlag
         && s_cache.textureRefID == textureRefID
         && s_cache.blendFlag == blendFlag
     ) {
@@ -181,6 +456,7 @@ static void *s_BeginCache(
     /* - Set up the new definition. */
     s_cache.definition = definition;
     s_cache.drawMode = drawMode;
+    s_cache.quadFlag = quadFlag;
     s_cache.blendFlag = blendFlag;
     s_cache.textureRefID = textureRefID;
     s_cache.vertexCount = vertexCount;
@@ -198,9 +474,18 @@ static void *s_BeginCache(
     VertexType *vertexName = (VertexType *)s_BeginCache( \
                                &s_ ## VertexType ## Definition, \
                                vertexCount, \
-                               drawMode, textureRefID, blendFlag)
+                               drawMode, textureRefID, blendFlag, DXFALSE)
 
-int Dx_Draw_FlushCache() {
+/* Same as START, but fetches 4 vertices per quad, in the order:
+ * top-left, top-right, bottom-left, bottom-right.
+ */
+#define START_QUADS(vertexName, VertexType, textureRefID, quadCount, blendFlag) \
+    VertexType *vertexName = (VertexType *)s_BeginCache( \
+                               &s_ ## VertexType ## Definition, \
+                               (quadCount) * 4, \
+                               PL_PRIM_TRIANGLES, textureRefID, blendFlag, DXTRUE)
+
+static int s_FlushCache() {
     if (s_cache.definition == NULL || s_cache.vertexCount == 0) {
         s_cache.vertexDataPosition = 0;
         return 0;
@@ -217,11 +502,29 @@ int Dx_Draw_FlushCache() {
                         s_cache.textureRefID);
     }
     
-    PLG.DrawVertexArray(
-        s_cache.definition,
-        (const char *)s_cache.vertexData,
-        s_cache.drawMode,
-        0, s_cache.vertexCount);
+    if (s_cache.quadFlag) {
+        int indexCount = (s_cache.vertexCount / 4) * 6;
+        
+        if (s_cache.quadIndexBuffer >= 0) {
+            PLG.DrawVertexArrayIndexBuffer(
+                s_cache.definition,
+                (const char *)s_cache.vertexData, 0, s_cache.vertexCount,
+                s_cache.quadIndexBuffer,
+                PL_PRIM_TRIANGLES, 0, indexCount);
+        } else {
+            PLG.DrawVertexIndexArray(
+                s_cache.definition,
+                (const char *)s_cache.vertexData, 0, s_cache.vertexCount,
+                s_cache.quadIndexData,
+                PL_PRIM_TRIANGLES, 0, indexCount);
+        }
+    } else {
+        PLG.DrawVertexArray(
+            s_cache.definition,
+            (const char *)s_cache.vertexData,
+            s_cache.drawMode,
+            0, s_cache.vertexCount);
+    }
     
     s_FinishDrawMode();
     
@@ -232,7 +535,17 @@ int Dx_Draw_FlushCache() {
     return 0;
 }
 
+int Dx_Draw_FlushCache() {
+    if (s_deferred.drawCount > 0) {
+        return s_DeferredFlush();
+    }
+    
+    return s_FlushCache();
+}
+
 int Dx_Draw_InitCache() {
+    int i, quadCount;
+    
     memset(&s_cache, 0, sizeof(s_cache));
     
     /* 256kb should be enough for anybody */
@@ -240,15 +553,62 @@ int Dx_Draw_InitCache() {
     s_cache.vertexDataSize = 256 * 1024;
     s_cache.vertexData = DXALLOC((size_t)s_cache.vertexDataSize);
     
+    /* Enough quads to fill the cache with the smallest vertex type. */
+    quadCount = (s_cache.vertexDataSize / (int)sizeof(VertexPosition2Color)) / 4;
+    s_cache.quadIndexCount = quadCount * 6;
+    s_cache.quadIndexData = DXALLOC((size_t)s_cache.quadIndexCount * sizeof(unsigned short));
+    for (i = 0; i < quadCount; ++i) {
+        unsigned short *index = s_cache.quadIndexData + (i * 6);
+        unsigned short base = (unsigned short)(i * 4);
+        index[0] = base + 0;
+        index[1] = base + 1;
+        index[2] = base + 2;
+        index[3] = base + 2;
+        index[4] = base + 1;
+        index[5] = base + 3;
+    }
+    
+    s_cache.quadIndexBuffer = PLG.IndexBuffer_Create(
+        s_cache.quadIndexData, s_cache.quadIndexCount, DXTRUE);
+    
+    s_deferred.dataPosition = 0;
+    s_deferred.dataSize = s_cache.vertexDataSize;
+    s_deferred.data = DXALLOC((size_t)s_deferred.dataSize);
+    s_deferred.draws = DXALLOC(sizeof(DeferredDraw) * MAX_DEFERRED_DRAWS);
+    s_deferred.drawCount = 0;
+    s_deferred.batchCount = 0;
+    s_deferred.pendingDraw = -1;
+    
     return 0;
 }
 
 int Dx_Draw_DestroyCache() {
+    if (s_deferred.data != NULL) {
+        DXFREE(s_deferred.data);
+    }
+    if (s_deferred.draws != NULL) {
+        DXFREE(s_deferred.draws);
+    }
+    s_deferred.data = NULL;
+    s_deferred.draws = NULL;
+    s_deferred.dataPosition = 0;
+    s_deferred.dataSize = 0;
+    s_deferred.drawCount = 0;
+    s_deferred.batchCount = 0;
+    s_deferred.pendingDraw = -1;
+    
+    if (s_cache.quadIndexBuffer >= 0) {
+        PLG.IndexBuffer_Delete(s_cache.quadIndexBuffer);
+    }
+    if (s_cache.quadIndexData != NULL) {
+        DXFREE(s_cache.quadIndexData);
+    }
     if (s_cache.vertexData != NULL) {
         DXFREE(s_cache.vertexData);
     }
     
     memset(&s_cache, 0, sizeof(s_cache));
+    s_cache.quadIndexBuffer = -1;
     
     return 0;
 }
@@ -292,7 +652,7 @@ int Dx_Draw_LineF(float x1, float y1, float x2, float y2, DXCOLOR color, int thi
         float l = (float)SDL_sqrt((dx * dx) + (dy * dy));
         
         if (l > 0) {
-            START(v, VertexPosition2Color, PL_PRIM_TRIANGLES, -1, 6, DXTRUE);
+            START_QUADS(v, VertexPosition2Color, -1, 1, DXTRUE);
             float t = (float)thickness * 0.5f;
             float nx = (dx / l) * t;
             float ny = (dy / l) * t;
@@ -300,9 +660,7 @@ int Dx_Draw_LineF(float x1, float y1, float x2, float y2, DXCOLOR color, int thi
             v[0].x = x1 - ny; v[0].y = y1 + nx; v[0].color = vColor;
             v[1].x = x2 - ny; v[1].y = y2 + nx; v[1].color = vColor;
             v[2].x = x1 + ny; v[2].y = y1 - nx; v[2].color = vColor;
-            v[3] = v[2];
-            v[4] = v[1];
-            v[5].x = x2 + ny; v[5].y = y2 - nx; v[5].color = vColor;
+            v[3].x = x2 + ny; v[3].y = y2 - nx; v[3].color = vColor;
         }
     }
     
@@ -417,14 +775,12 @@ int Dx_Draw_QuadrangleF(
     Uint32 vColor = s_ModulateColor(color);
     
     if (fillFlag) {
-        START(v, VertexPosition2Color, PL_PRIM_TRIANGLES, -1, 6, DXTRUE);
+        START_QUADS(v, VertexPosition2Color, -1, 1, DXTRUE);
     
         v[0].x = x1; v[0].y = y1; v[0].color = vColor;
         v[1].x = x2; v[1].y = y2; v[1].color = vColor;
         v[2].x = x3; v[2].y = y3; v[2].color = vColor;
-        v[3] = v[2];
-        v[4] = v[1];
-        v[5].x = x4; v[5].y = y4; v[5].color = vColor;
+        v[3].x = x4; v[3].y = y4; v[3].color = vColor;
     } else {
         START(v, VertexPosition2Color, PL_PRIM_LINES, -1, 8, DXTRUE);
     
@@ -456,14 +812,12 @@ int Dx_Draw_BoxF(float x1, float y1, float x2, float y2, DXCOLOR color, int Fill
     
     if (FillFlag) {
         /* TRIANGLES instead of TRIANGLE_STRIP so that we can batch. */
-        START(v, VertexPosition2Color, PL_PRIM_TRIANGLES, -1, 6, DXTRUE);
+        START_QUADS(v, VertexPosition2Color, -1, 1, DXTRUE);
         
         v[0].x = x1; v[0].y = y1; v[0].color = vColor;
         v[1].x = x2; v[1].y = y1; v[1].color = vColor;
         v[2].x = x1; v[2].y = y2; v[2].color = vColor;
-        v[3] = v[2];
-        v[4] = v[1];
-        v[5].x = x2; v[5].y = y2; v[5].color = vColor;
+        v[3].x = x2; v[3].y = y2; v[3].color = vColor;
     } else {
         /* LINES instead of LINE_LOOP so that we can batch. */
         START(v, VertexPosition2Color, PL_PRIM_LINES, -1, 8, DXTRUE);
@@ -491,7 +845,7 @@ int Dx_Draw_GraphF(float x1, float y1, int graphID, int blendFlag) {
     float xMult, yMult;
     if (Dx_Graph_GetTextureInfo(graphID, &textureRefID, &texRect, &xMult, &yMult) >= 0) {
         Uint32 vColor = s_GetColor();
-        START(v, VertexPosition2Tex2Color, PL_PRIM_TRIANGLES, textureRefID, 6, blendFlag);
+        START_QUADS(v, VertexPosition2Tex2Color, textureRefID, 1, blendFlag);
         float x2, y2;
         float tx1 = (float)texRect.x * xMult;
         float ty1 = (float)texRect.y * yMult;
@@ -505,9 +859,7 @@ int Dx_Draw_GraphF(float x1, float y1, int graphID, int blendFlag) {
         v[0].x = x1; v[0].y = y1; v[0].tcx = tx1; v[0].tcy = ty1; v[0].color = vColor;
         v[1].x = x2; v[1].y = y1; v[1].tcx = tx2; v[1].tcy = ty1; v[1].color = vColor;
         v[2].x = x1; v[2].y = y2; v[2].tcx = tx1; v[2].tcy = ty2; v[2].color = vColor;
-        v[3] = v[2];
-        v[4] = v[1];
-        v[5].x = x2; v[5].y = y2; v[5].tcx = tx2; v[5].tcy = ty2; v[5].color = vColor;
+        v[3].x = x2; v[3].y = y2; v[3].tcx = tx2; v[3].tcy = ty2; v[3].color = vColor;
     }
     
     return 0;
@@ -523,7 +875,7 @@ int Dx_Draw_ExtendGraphF(float x1, float y1, float x2, float y2, int graphID, in
     float xMult, yMult;
     if (Dx_Graph_GetTextureInfo(graphID, &textureRefID, &texRect, &xMult, &yMult) >= 0) {
         Uint32 vColor = s_GetColor();
-        START(v, VertexPosition2Tex2Color, PL_PRIM_TRIANGLES, textureRefID, 6, blendFlag);
+        START_QUADS(v, VertexPosition2Tex2Color, textureRefID, 1, blendFlag);
         float tx1 = (float)texRect.x * xMult;
         float ty1 = (float)texRect.y * yMult;
         float tx2 = tx1 + ((float)texRect.w * xMult);
@@ -532,9 +884,7 @@ int Dx_Draw_ExtendGraphF(float x1, float y1, float x2, float y2, int graphID, in
         v[0].x = x1; v[0].y = y1; v[0].tcx = tx1; v[0].tcy = ty1; v[0].color = vColor;
         v[1].x = x2; v[1].y = y1; v[1].tcx = tx2; v[1].tcy = ty1; v[1].color = vColor;
         v[2].x = x1; v[2].y = y2; v[2].tcx = tx1; v[2].tcy = ty2; v[2].color = vColor;
-        v[3] = v[2];
-        v[4] = v[1];
-        v[5].x = x2; v[5].y = y2; v[5].tcx = tx2; v[5].tcy = ty2; v[5].color = vColor;
+        v[3].x = x2; v[3].y = y2; v[3].tcx = tx2; v[3].tcy = ty2; v[3].color = vColor;
     }
     
     return 0;
@@ -622,14 +972,12 @@ int Dx_Draw_RectGraphF(float dx, float dy, int sx, int sy, int sw, int sh,
         
         /* - draw! */
         {
-            START(v, VertexPosition2Tex2Color, PL_PRIM_TRIANGLES, textureRefID, 6, blendFlag);
+            START_QUADS(v, VertexPosition2Tex2Color, textureRefID, 1, blendFlag);
             
             v[0].x = dx1; v[0].y = dy1; v[0].tcx = tx1; v[0].tcy = ty1; v[0].color = vColor;
             v[1].x = dx2; v[1].y = dy1; v[1].tcx = tx2; v[1].tcy = ty1; v[1].color = vColor;
             v[2].x = dx1; v[2].y = dy2; v[2].tcx = tx1; v[2].tcy = ty2; v[2].color = vColor;
-            v[3] = v[2];
-            v[4] = v[1];
-            v[5].x = dx2; v[5].y = dy2; v[5].tcx = tx2; v[5].tcy = ty2; v[5].color = vColor;
+            v[3].x = dx2; v[3].y = dy2; v[3].tcx = tx2; v[3].tcy = ty2; v[3].color = vColor;
         }
     }
     
@@ -650,7 +998,7 @@ int Dx_EXT_Draw_RectGraphFastF(
     float xMult, yMult;
     if (Dx_Graph_GetTextureInfo(graphID, &textureRefID, &texRect, &xMult, &yMult) >= 0) {
         Uint32 vColor = s_GetColor();
-        START(v, VertexPosition2Tex2Color, PL_PRIM_TRIANGLES, textureRefID, 6, blendFlag);
+        START_QUADS(v, VertexPosition2Tex2Color, textureRefID, 1, blendFlag);
         float dx2, dy2;
         float tx1 = (float)(texRect.x + sx) * xMult;
         float ty1 = (float)(texRect.y + sy) * yMult;
@@ -664,9 +1012,58 @@ int Dx_EXT_Draw_RectGraphFastF(
         v[0].x = dx1; v[0].y = dy1; v[0].tcx = tx1; v[0].tcy = ty1; v[0].color = vColor;
         v[1].x = dx2; v[1].y = dy1; v[1].tcx = tx2; v[1].tcy = ty1; v[1].color = vColor;
         v[2].x = dx1; v[2].y = dy2; v[2].tcx = tx1; v[2].tcy = ty2; v[2].color = vColor;
-        v[3] = v[2];
-        v[4] = v[1];
-        v[5].x = dx2; v[5].y = dy2; v[5].tcx = tx2; v[5].tcy = ty2; v[5].color = vColor;
+        v[3].x = dx2; v[3].y = dy2; v[3].tcx = tx2; v[3].tcy = ty2; v[3].color = vColor;
+    }
+    
+    return 0;
+}
+
+/* Draws a run of quads from one graph, offset by (x, y), in the current
+ * color. Source coordinates are in pixels within the graph, as with
+ * the RectGraph functions.
+ */
+int Dx_Draw_RectQuadRunF(float x, float y, const DxRectQuad *quads, int quadCount,
+                         int graphID, int blendFlag) {
+    PLRect texRect;
+    int textureRefID;
+    float xMult, yMult;
+    float texX, texY;
+    Uint32 vColor;
+    
+    if (Dx_Graph_GetTextureInfo(graphID, &textureRefID, &texRect, &xMult, &yMult) < 0) {
+        return -1;
+    }
+    
+    vColor = s_GetColor();
+    texX = (float)texRect.x;
+    texY = (float)texRect.y;
+    
+    /* Stay well under what the vertex cache holds at once. */
+    while (quadCount > 0) {
+        int count = (quadCount < 1024) ? quadCount : 1024;
+        START_QUADS(v, VertexPosition2Tex2Color, textureRefID, count, blendFlag);
+        int i;
+        
+        for (i = 0; i < count; ++i) {
+            const DxRectQuad *q = &quads[i];
+            float dx1 = x + q->x1;
+            float dy1 = y + q->y1;
+            float dx2 = x + q->x2;
+            float dy2 = y + q->y2;
+            float tx1 = (texX + q->sx1) * xMult;
+            float ty1 = (texY + q->sy1) * yMult;
+            float tx2 = (texX + q->sx2) * xMult;
+            float ty2 = (texY + q->sy2) * yMult;
+            
+            v[0].x = dx1; v[0].y = dy1; v[0].tcx = tx1; v[0].tcy = ty1; v[0].color = vColor;
+            v[1].x = dx2; v[1].y = dy1; v[1].tcx = tx2; v[1].tcy = ty1; v[1].color = vColor;
+            v[2].x = dx1; v[2].y = dy2; v[2].tcx = tx1; v[2].tcy = ty2; v[2].color = vColor;
+            v[3].x = dx2; v[3].y = dy2; v[3].tcx = tx2; v[3].tcy = ty2; v[3].color = vColor;
+            v += 4;
+        }
+        
+        quads += count;
+        quadCount -= count;
     }
     
     return 0;
@@ -680,7 +1077,7 @@ int Dx_Draw_RectExtendGraphF(float dx1, float dy1, float dx2, float dy2,
     float xMult, yMult;
     if (Dx_Graph_GetTextureInfo(graphID, &textureRefID, &texRect, &xMult, &yMult) >= 0) {
         Uint32 vColor = s_GetColor();
-        START(v, VertexPosition2Tex2Color, PL_PRIM_TRIANGLES, textureRefID, 6, blendFlag);
+        START_QUADS(v, VertexPosition2Tex2Color, textureRefID, 1, blendFlag);
         float tx1 = (float)(texRect.x + sx) * xMult;
         float ty1 = (float)(texRect.y + sy) * yMult;
         float tx2 = tx1 + ((float)sw * xMult);
@@ -689,9 +1086,7 @@ int Dx_Draw_RectExtendGraphF(float dx1, float dy1, float dx2, float dy2,
         v[0].x = dx1; v[0].y = dy1; v[0].tcx = tx1; v[0].tcy = ty1; v[0].color = vColor;
         v[1].x = dx2; v[1].y = dy1; v[1].tcx = tx2; v[1].tcy = ty1; v[1].color = vColor;
         v[2].x = dx1; v[2].y = dy2; v[2].tcx = tx1; v[2].tcy = ty2; v[2].color = vColor;
-        v[3] = v[2];
-        v[4] = v[1];
-        v[5].x = dx2; v[5].y = dy2; v[5].tcx = tx2; v[5].tcy = ty2; v[5].color = vColor;
+        v[3].x = dx2; v[3].y = dy2; v[3].tcx = tx2; v[3].tcy = ty2; v[3].color = vColor;
     }
     
     return 0;
@@ -726,7 +1121,7 @@ static int s_Draw_RotaGraphMain(
      * - Draw!
      */
     Uint32 vColor = s_GetColor();
-    START(v, VertexPosition2Tex2Color, PL_PRIM_TRIANGLES, textureRefID, 6, blendFlag);
+    START_QUADS(v, VertexPosition2Tex2Color, textureRefID, 1, blendFlag);
     float tw = (float)texRect->w;
     float th = (float)texRect->h;
     float tx1 = (float)texRect->x * xMult;
@@ -769,9 +1164,7 @@ static int s_Draw_RotaGraphMain(
     v[0].x = x - xext1; v[0].y = y - yext1; v[0].tcx = tx1; v[0].tcy = ty1; v[0].color = vColor;
     v[1].x = x + xext2; v[1].y = y - yext2; v[1].tcx = tx2; v[1].tcy = ty1; v[1].color = vColor;
     v[2].x = x - xext2; v[2].y = y + yext2; v[2].tcx = tx1; v[2].tcy = ty2; v[2].color = vColor;
-    v[3] = v[2];
-    v[4] = v[1];
-    v[5].x = x + xext1; v[5].y = y + yext1; v[5].tcx = tx2; v[5].tcy = ty2; v[5].color = vColor;
+    v[3].x = x + xext1; v[3].y = y + yext1; v[3].tcx = tx2; v[3].tcy = ty2; v[3].color = vColor;
     
     return 0;
 }
@@ -968,7 +1361,7 @@ int Dx_Draw_ModiGraphF(
     float xMult, yMult;
     if (Dx_Graph_GetTextureInfo(graphID, &textureRefID, &texRect, &xMult, &yMult) >= 0) {
         Uint32 vColor = s_GetColor();
-        START(v, VertexPosition2Tex2Color, PL_PRIM_TRIANGLES, textureRefID, 6, blendFlag);
+        START_QUADS(v, VertexPosition2Tex2Color, textureRefID, 1, blendFlag);
         float tx1 = (float)texRect.x * xMult;
         float ty1 = (float)texRect.y * yMult;
         float tx2 = tx1 + ((float)texRect.w * xMult);
@@ -977,9 +1370,7 @@ int Dx_Draw_ModiGraphF(
         v[0].x = x1; v[0].y = y1; v[0].tcx = tx1; v[0].tcy = ty1; v[0].color = vColor;
         v[1].x = x2; v[1].y = y2; v[1].tcx = tx2; v[1].tcy = ty1; v[1].color = vColor;
         v[2].x = x4; v[2].y = y4; v[2].tcx = tx1; v[2].tcy = ty2; v[2].color = vColor;
-        v[3] = v[2];
-        v[4] = v[1];
-        v[5].x = x3; v[5].y = y3; v[5].tcx = tx2; v[5].tcy = ty2; v[5].color = vColor;
+        v[3].x = x3; v[3].y = y3; v[3].tcx = tx2; v[3].tcy = ty2; v[3].color = vColor;
     }
     
     return 0;
@@ -1001,7 +1392,7 @@ int Dx_Draw_TurnGraphF(float x1, float y1, int graphID, int blendFlag) {
     float xMult, yMult;
     if (Dx_Graph_GetTextureInfo(graphID, &textureRefID, &texRect, &xMult, &yMult) >= 0) {
         Uint32 vColor = s_GetColor();
-        START(v, VertexPosition2Tex2Color, PL_PRIM_TRIANGLES, textureRefID, 6, blendFlag);
+        START_QUADS(v, VertexPosition2Tex2Color, textureRefID, 1, blendFlag);
         float x2, y2;
         float tx1 = (float)texRect.x * xMult;
         float ty1 = (float)texRect.y * yMult;
@@ -1015,9 +1406,7 @@ int Dx_Draw_TurnGraphF(float x1, float y1, int graphID, int blendFlag) {
         v[0].x = x1; v[0].y = y1; v[0].tcx = tx2; v[0].tcy = ty1; v[0].color = vColor;
         v[1].x = x2; v[1].y = y1; v[1].tcx = tx1; v[1].tcy = ty1; v[1].color = vColor;
         v[2].x = x1; v[2].y = y2; v[2].tcx = tx2; v[2].tcy = ty2; v[2].color = vColor;
-        v[3] = v[2];
-        v[4] = v[1];
-        v[5].x = x2; v[5].y = y2; v[5].tcx = tx1; v[5].tcy = ty2; v[5].color = vColor;
+        v[3].x = x2; v[3].y = y2; v[3].tcx = tx1; v[3].tcy = ty2; v[3].color = vColor;
     }
     
     return 0;
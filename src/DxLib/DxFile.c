@@ -49,6 +49,8 @@ static char s_defaultArchiveString[DXA_KEY_LENGTH + 1] = { '\0' };
 static char s_archiveExtension[64] = { '\0' };
 static int s_initialized = DXFALSE;
 static int s_filePriorityFlag = DXFALSE;
+static int s_mapArchiveFlag = DXFALSE;
+static int s_streamCompressedFlag = DXTRUE;
 static int s_fileUseCharset = DX_CHARSET_DEFAULT;
 
 /* ------------------------------------------------------------- ARCHIVE MANAGER */
@@ -84,6 +86,10 @@ static DXArchive *s_GetArchive(const char *filename) {
     /* - Since it isn't, try to load it up. */
     archive = DXA_OpenArchive(filename, s_defaultArchiveString);
     if (archive != NULL) {
+        if (s_mapArchiveFlag) {
+            DXA_MapArchive(archive);
+        }
+        
         /* - On success, add to the open list. */
         entry = DXALLOC(sizeof(ArchiveListEntry));
         entry->archive = archive;
@@ -233,20 +239,24 @@ static DXArchive *s_TryGetArchive(
 }
 
 /* ------------------------------------------------------------ STREAM INTERFACE */
+/* The archive list and archive files are shared with background
+ * loading threads, so anything using them holds the PL_File lock. */
 SDL_RWops *Dx_File_OpenArchiveStream(const char *filename) {
     /* Extract the archive name from the filename. */
     char buf[2048];
     const char *end;
-    DXArchive *archive = s_TryGetArchive(filename, buf, 2048, &end);
+    DXArchive *archive;
+    SDL_RWops *rwops = NULL;
+    
+    PL_File_Lock();
+    archive = s_TryGetArchive(filename, buf, 2048, &end);
     if (archive != 0) {
-        SDL_RWops *rwops = DXA_OpenStream(archive, end + 1);
         /* If we can open from the stream, do that. */
-        if (rwops != NULL) {
-            return rwops;
-        }
+        rwops = DXA_OpenStream(archive, end + 1, s_streamCompressedFlag);
     }
+    PL_File_Unlock();
     
-    return NULL;
+    return rwops;
 }
 
 SDL_RWops *Dx_File_OpenDirectStream(const char *filename) {
@@ -380,14 +390,18 @@ DWORD_PTR Dx_FileRead_findFirst(const char *filePath, FILEINFOA *fileInfo) {
     if (s_useArchiveFlag == DXTRUE) {
         char buf[2048];
         const char *end;
-        DXArchive *archive = s_TryGetArchive(filePath, buf, 2048, &end);
+        DXArchive *archive;
 
+        PL_File_Lock();
+        archive = s_TryGetArchive(filePath, buf, 2048, &end);
         if (archive != NULL) {
             data->dxaData = DXA_findFirst(archive, end + 1, fileInfo);
-            if (data->dxaData != 0) {
-                data->dxaFlag = DXTRUE;
-                return (DWORD_PTR)data;
-            }
+        }
+        PL_File_Unlock();
+
+        if (data->dxaData != 0) {
+            data->dxaFlag = DXTRUE;
+            return (DWORD_PTR)data;
         }
     }
 #endif
@@ -447,7 +461,7 @@ int Dx_FileRead_findClose(DWORD_PTR fileHandle) {
 }
 
 /* ------------------------------------------------------------ PUBLIC INTERFACE */
-int Dx_File_EXTSetDXArchiveAlias(const char *srcName, const char *destName) {
+static int s_SetDXArchiveAlias(const char *srcName, const char *destName) {
     ArchiveAliasEntry **pEntry = &s_archiveAliases;
     
     while (*pEntry != NULL) {
@@ -478,6 +492,16 @@ int Dx_File_EXTSetDXArchiveAlias(const char *srcName, const char *destName) {
     return 0;
 }
 
+int Dx_File_EXTSetDXArchiveAlias(const char *srcName, const char *destName) {
+    int retval;
+    
+    PL_File_Lock();
+    retval = s_SetDXArchiveAlias(srcName, destName);
+    PL_File_Unlock();
+    
+    return retval;
+}
+
 /* Sets the "encryption" key to use for the packfile. */
 int Dx_File_SetDXArchiveKeyString(const char *keyString) {
     int n = 0;
@@ -511,6 +535,22 @@ int Dx_File_SetDXArchivePriority(int priority) {
     return 0;
 }
 
+/* Archives opened after this is set are memory mapped, where the
+ * platform supports it. */
+int Dx_File_EXTSetDXArchiveMapFlag(int flag) {
+    s_mapArchiveFlag = (flag == DXFALSE) ? DXFALSE : DXTRUE;
+    
+    return 0;
+}
+
+/* Large compressed files are decompressed as they are read, unless
+ * this is turned off. */
+int Dx_File_EXTSetDXArchiveStreamCompressedFlag(int flag) {
+    s_streamCompressedFlag = (flag == DXFALSE) ? DXFALSE : DXTRUE;
+    
+    return 0;
+}
+
 /* Setting this flag tells the archiver to check the archives instead of a direct
  * file access.
  */
@@ -528,12 +568,18 @@ int Dx_File_GetUseDXArchiveFlag() {
 
 int Dx_File_DXArchivePreLoad(const char *dxaFilename, int async) {
     char buf[2048];
-    DXArchive *archive = s_TryGetArchive(dxaFilename, buf, 2048, NULL);
+    DXArchive *archive;
+    int retval = -1;
+    
+    PL_File_Lock();
+    archive = s_TryGetArchive(dxaFilename, buf, 2048, NULL);
     if (archive != 0) {
         /* FIXME async not supported */
-        return DXA_PreloadArchive(archive);
+        retval = DXA_PreloadArchive(archive);
     }
-    return -1;
+    PL_File_Unlock();
+    
+    return retval;
 }
 int Dx_File_DXArchiveCheckIdle(const char *dxaFilename) {
     /* This has no meaning when async is not supported,
@@ -542,27 +588,58 @@ int Dx_File_DXArchiveCheckIdle(const char *dxaFilename) {
 }
 int Dx_File_DXArchiveRelease(const char *dxaFilename) {
     char buf[2048];
-    DXArchive *archive = s_TryGetArchive(dxaFilename, buf, 2048, NULL);
+    DXArchive *archive;
+    int retval = -1;
+    
+    PL_File_Lock();
+    archive = s_TryGetArchive(dxaFilename, buf, 2048, NULL);
     if (archive != 0) {
-        return s_CloseArchive(archive);
+        retval = s_CloseArchive(archive);
     }
-    return -1;
+    PL_File_Unlock();
+    
+    return retval;
 }
 
 int Dx_File_DXArchiveCheckFile(const char *dxaFilename, const char *filename) {
     char buf[2048];
     DXArchive *archive;
+    int retval = -1;
+    
+    PL_File_Lock();
     if (s_GetArchiveFilename(dxaFilename, buf, 2048, NULL, 1) > 0) {
         archive = s_GetArchive(buf);
         if (archive != NULL) {
-            return DXA_TestFile(archive, filename);
+            retval = DXA_TestFile(archive, filename);
         }
     }
-    return -1;
+    PL_File_Unlock();
+    
+    return retval;
 }
 
+/* FileRead handles read through a buffer of their own, so that getc
+ * and gets do not go to the stream for every byte, which is slow
+ * enough on plain files and much worse on archives.
+ *
+ * buffer[bufferPos...bufferLength) is what comes next in the file, and
+ * bufferStart is the file position of buffer[0]. The stream itself is
+ * always at bufferStart + bufferLength.
+ */
+#define FILEREAD_DEFAULT_BUFFER_SIZE 32768
+#define FILEREAD_MIN_BUFFER_SIZE 64
+
+static int s_fileReadBufferSize = FILEREAD_DEFAULT_BUFFER_SIZE;
+
 typedef struct FileHandle {
     SDL_RWops *rwops;
+    int64_t fileSize;
+    
+    char *buffer;
+    int bufferSize;
+    int bufferPos;
+    int bufferLength;
+    int64_t bufferStart;
 } FileHandle;
 
 int PLEXT_FileRead_SetCharSet(int charset) {
@@ -571,6 +648,175 @@ int PLEXT_FileRead_SetCharSet(int charset) {
     return 0;
 }
 
+int PLEXT_FileRead_SetBufferSize(int bufferSize) {
+    if (bufferSize < FILEREAD_MIN_BUFFER_SIZE) {
+        bufferSize = FILEREAD_MIN_BUFFER_SIZE;
+    }
+    s_fileReadBufferSize = bufferSize;
+    
+    return 0;
+}
+
+/* Makes sure at least count bytes are buffered, unless the file ends
+ * first, moving what is left to the front to make room. Returns how
+ * many bytes are buffered. */
+static int s_FileBufferFill(FileHandle *handle, int count) {
+    int available = handle->bufferLength - handle->bufferPos;
+    
+    if (available >= count) {
+        return available;
+    }
+    
+    if (handle->bufferPos > 0) {
+        memmove(handle->buffer, handle->buffer + handle->bufferPos, (size_t)available);
+        handle->bufferStart += handle->bufferPos;
+        handle->bufferPos = 0;
+        handle->bufferLength = available;
+    }
+    
+    while (handle->bufferLength < count) {
+        size_t amount = SDL_RWread(handle->rwops,
+                                   handle->buffer + handle->bufferLength, 1,
+                                   (size_t)(handle->bufferSize - handle->bufferLength));
+        if (amount == 0) {
+            break;
+        }
+        handle->bufferLength += (int)amount;
+    }
+    
+    return handle->bufferLength - handle->bufferPos;
+}
+
+/* Reads up to size bytes, returning how many there were. Large reads
+ * skip the buffer once it is empty. */
+static int s_FileBufferRead(FileHandle *handle, void *data, int size) {
+    char *dest = (char *)data;
+    int total = 0;
+    
+    while (size > 0) {
+        int available = handle->bufferLength - handle->bufferPos;
+    
+        if (available == 0) {
+            if (size >= handle->bufferSize) {
+                int amount = (int)SDL_RWread(handle->rwops, dest, 1, (size_t)size);
+                handle->bufferStart += handle->bufferLength + amount;
+                handle->bufferPos = 0;
+                handle->bufferLength = 0;
+                return total + amount;
+            }
+    
+            available = s_FileBufferFill(handle, size);
+            if (available == 0) {
+                break;
+            }
+        }
+    
+        if (available > size) {
+            available = size;
+        }
+        memcpy(dest, handle->buffer + handle->bufferPos, (size_t)available);
+        handle->bufferPos += available;
+        dest += available;
+        size -= available;
+        total += available;
+    }
+    
+    return total;
+}
+
+static int64_t s_FileTell(FileHandle *handle) {
+    return handle->bufferStart + handle->bufferPos;
+}
+
+/* Streams that cannot tell their size are at the end once a read
+ * comes back empty. */
+static int s_FileEOF(FileHandle *handle) {
+    if (handle->fileSize < 0) {
+        return (s_FileBufferFill(handle, 1) <= 0) ? DXTRUE : DXFALSE;
+    }
+    return (s_FileTell(handle) >= handle->fileSize) ? DXTRUE : DXFALSE;
+}
+
+/* Reads the next whole character in the file's charset, or returns -1
+ * at the end of the file. *length is set to its size in bytes. */
+static int s_FileReadChar(FileHandle *handle, int *length) {
+    char temp[8];
+    const char *reader = temp;
+    const char *data;
+    int available = s_FileBufferFill(handle, 8);
+    int pos = 1;
+    
+    if (available <= 0) {
+        return -1;
+    }
+    
+    data = handle->buffer + handle->bufferPos;
+    while (pos < 7 && PL_Text_IsIncompleteMultibyte(data, pos, s_fileUseCharset)) {
+        if (pos >= available) {
+            handle->bufferPos += available;
+            return -1;
+        }
+        pos += 1;
+    }
+    
+    memcpy(temp, data, (size_t)pos);
+    temp[pos] = '\0';
+    handle->bufferPos += pos;
+    *length = pos;
+    
+    return (int)PL_Text_ReadChar(&reader, s_fileUseCharset);
+}
+
+/* If the rest of the line is already buffered, is in the charset the
+ * caller wants, and fits, copies it straight across without the '\r's.
+ * Returns the length copied, or -1 if it has to go character by
+ * character instead. '\n' never turns up inside a multibyte character
+ * in the charsets supported, so memchr can find the end of the line. */
+static int s_FileCopyLine(FileHandle *handle, char *dest, int destSize) {
+    const char *start = handle->buffer + handle->bufferPos;
+    const char *newline;
+    const char *p;
+    int lineLength;
+    int length = 0;
+    
+    if (s_fileUseCharset != g_DxUseCharSet) {
+        return -1;
+    }
+    
+    newline = (const char *)memchr(start, '\n', (size_t)(handle->bufferLength - handle->bufferPos));
+    if (newline == NULL) {
+        return -1;
+    }
+    lineLength = (int)(newline - start);
+    if (lineLength > destSize) {
+        return -1;
+    }
+    
+    /* A broken character just before the newline would swallow it. */
+    for (p = start; p < newline; ) {
+        int pos = 1;
+        while (pos < 7 && PL_Text_IsIncompleteMultibyte(p, pos, s_fileUseCharset)) {
+            pos += 1;
+        }
+        p += pos;
+    }
+    if (p != newline) {
+        return -1;
+    }
+    
+    for (p = start; p < newline; ) {
+        const char *cr = (const char *)memchr(p, '\r', (size_t)(newline - p));
+        const char *end = (cr != NULL) ? cr : newline;
+        memcpy(dest + length, p, (size_t)(end - p));
+        length += (int)(end - p);
+        p = (cr != NULL) ? (cr + 1) : newline;
+    }
+    
+    handle->bufferPos += lineLength + 1;
+    
+    return length;
+}
+
 int Dx_FileRead_open(const char *filename) {
     SDL_RWops *rwops = Dx_File_OpenStream(filename);
     int fileDataID;
@@ -586,8 +832,16 @@ int Dx_FileRead_open(const char *filename) {
         return -1;
     }
     
-    handle = (FileHandle *)PL_Handle_AllocateData(fileDataID, sizeof(FileHandle));
+    /* The buffer goes on the end of the handle data. */
+    handle = (FileHandle *)PL_Handle_AllocateData(fileDataID,
+                 sizeof(FileHandle) + (size_t)s_fileReadBufferSize);
     handle->rwops = rwops;
+    handle->fileSize = SDL_RWsize(rwops);
+    handle->buffer = (char *)(handle + 1);
+    handle->bufferSize = s_fileReadBufferSize;
+    handle->bufferPos = 0;
+    handle->bufferLength = 0;
+    handle->bufferStart = SDL_RWtell(rwops);
     
     return fileDataID;
 }
@@ -615,19 +869,35 @@ int Dx_FileRead_close(int fileHandle) {
 int64_t Dx_FileRead_tell(int fileHandle) {
     FileHandle *handle = (FileHandle *)PL_Handle_GetData(fileHandle, DXHANDLE_FILE);
     if (handle != NULL) {
-        SDL_RWops *rwops = handle->rwops;
-        return SDL_RWtell(rwops);
+        return s_FileTell(handle);
     }
     return 0;
 }
 int Dx_FileRead_seek(int fileHandle, int64_t position, int origin) {
     FileHandle *handle = (FileHandle *)PL_Handle_GetData(fileHandle, DXHANDLE_FILE);
     if (handle != NULL) {
-        SDL_RWops *rwops = handle->rwops;
+        int64_t target;
         switch(origin) {
-            case 0: SDL_RWseek(rwops, position, RW_SEEK_SET); break;
-            case 1: SDL_RWseek(rwops, position, RW_SEEK_CUR); break;
-            case 2: SDL_RWseek(rwops, position, RW_SEEK_END); break;
+            case 0: target = position; break;
+            case 1: target = s_FileTell(handle) + position; break;
+            case 2: target = handle->fileSize + position; break;
+            default: return 0;
+        }
+        if (target < 0) {
+            target = 0;
+        }
+        
+        /* Stay in the buffer if possible, so seeking back and forth
+         * over a small area does not touch the stream. */
+        if (target >= handle->bufferStart
+            && target <= handle->bufferStart + handle->bufferLength
+        ) {
+            handle->bufferPos = (int)(target - handle->bufferStart);
+        } else {
+            SDL_RWseek(handle->rwops, target, RW_SEEK_SET);
+            handle->bufferStart = target;
+            handle->bufferPos = 0;
+            handle->bufferLength = 0;
         }
     }
     return 0;
@@ -635,51 +905,40 @@ int Dx_FileRead_seek(int fileHandle, int64_t position, int origin) {
 
 int Dx_FileRead_read(void *data, int size, int fileHandle) {
     FileHandle *handle = (FileHandle *)PL_Handle_GetData(fileHandle, DXHANDLE_FILE);
-    if (handle != NULL) {
-        SDL_RWops *rwops = handle->rwops;
-        return (int)SDL_RWread(rwops, data, (size_t)size, 1) * size;
+    if (handle != NULL && size > 0) {
+        return (s_FileBufferRead(handle, data, size) == size) ? size : 0;
     }
     return 0;
 }
 int Dx_FileRead_eof(int fileHandle) {
     FileHandle *handle = (FileHandle *)PL_Handle_GetData(fileHandle, DXHANDLE_FILE);
     if (handle != NULL) {
-        SDL_RWops *rwops = handle->rwops;
-        return (SDL_RWsize(rwops) == SDL_RWtell(rwops)) ? DXTRUE : DXFALSE;
+        return s_FileEOF(handle);
     }
     return DXFALSE;
 }
 
-static int Dx_FileRead_getWholeChar(int fileHandle) {
-    FileHandle *handle = (FileHandle *)PL_Handle_GetData(fileHandle, DXHANDLE_FILE);
-    if (handle != NULL) {
-        SDL_RWops *rwops = handle->rwops;
-        char buffer[8];
-        const char *reader = buffer;
-        int pos = 0;
-        
-        do {
-            if (SDL_RWread(rwops, buffer + pos, sizeof(char), 1) < 1) {
-                return -1;
-            }
-            pos += 1;
-        } while (pos < 7 && PL_Text_IsIncompleteMultibyte(buffer, pos, s_fileUseCharset));
-        buffer[pos] = '\0';
-        
-        return PL_Text_ReadChar(&reader, s_fileUseCharset);
-    }
-    return -1;
-}
-
+/* A character that does not fit ends the line early, and is left for
+ * the next read. */
 int Dx_FileRead_getsA(char *buffer, int bufferSize, int fileHandle) {
-    int ch;
+    FileHandle *handle = (FileHandle *)PL_Handle_GetData(fileHandle, DXHANDLE_FILE);
     int remaining = bufferSize - 1;
+    int ch;
+    int chLength;
+    int length;
     
-    if (Dx_FileRead_eof(fileHandle)) {
+    if (handle == NULL || s_FileEOF(handle)) {
         return -1;
     }
     
-    while (remaining > 0 && (ch = Dx_FileRead_getWholeChar(fileHandle)) != -1) {
+    length = s_FileCopyLine(handle, buffer, remaining);
+    if (length >= 0) {
+        buffer[length] = '\0';
+        return length;
+    }
+    
+    while (remaining > 0 && (ch = s_FileReadChar(handle, &chLength)) != -1) {
+        char temp[8];
         int chSize;
         
         if (ch == '\r') {
@@ -688,7 +947,12 @@ int Dx_FileRead_getsA(char *buffer, int bufferSize, int fileHandle) {
         if (ch == '\n') {
             break;
         }
-        chSize = PL_Text_WriteChar(buffer, ch, remaining, g_DxUseCharSet);
+        chSize = PL_Text_WriteChar(temp, (unsigned int)ch, 8, g_DxUseCharSet);
+        if (chSize > remaining) {
+            handle->bufferPos -= chLength;
+            break;
+        }
+        memcpy(buffer, temp, (size_t)chSize);
         remaining -= chSize;
         buffer += chSize;
     }
@@ -698,16 +962,18 @@ int Dx_FileRead_getsA(char *buffer, int bufferSize, int fileHandle) {
     return bufferSize - remaining - 1;
 }
 int Dx_FileRead_getsW(wchar_t *buffer, int bufferSize, int fileHandle) {
-    int ch;
+    FileHandle *handle = (FileHandle *)PL_Handle_GetData(fileHandle, DXHANDLE_FILE);
     int remaining = bufferSize - 1;
+    int ch;
+    int chLength;
     
-    if (Dx_FileRead_eof(fileHandle)) {
+    if (handle == NULL || s_FileEOF(handle)) {
         return -1;
     }
     
     /* TODO: support and skip 0xfeff header. */
     
-    while (remaining > 0 && (ch = Dx_FileRead_getWholeChar(fileHandle)) != -1) {
+    while (remaining > 0 && (ch = s_FileReadChar(handle, &chLength)) != -1) {
         if (ch == '\r') {
             continue;
         }
@@ -727,9 +993,11 @@ int Dx_FileRead_getsW(wchar_t *buffer, int bufferSize, int fileHandle) {
 char Dx_FileRead_getcA(int fileHandle) {
     FileHandle *handle = (FileHandle *)PL_Handle_GetData(fileHandle, DXHANDLE_FILE);
     if (handle != NULL) {
-        SDL_RWops *rwops = handle->rwops;
         char ch;
-        if (SDL_RWread(rwops, &ch, sizeof(char), 1) < 1) {
+        if (handle->bufferPos < handle->bufferLength) {
+            return handle->buffer[handle->bufferPos++];
+        }
+        if (s_FileBufferRead(handle, &ch, sizeof(char)) < (int)sizeof(char)) {
             return (char)-1;
         }
         
@@ -740,9 +1008,8 @@ char Dx_FileRead_getcA(int fileHandle) {
 wchar_t Dx_FileRead_getcW(int fileHandle) {
     FileHandle *handle = (FileHandle *)PL_Handle_GetData(fileHandle, DXHANDLE_FILE);
     if (handle != NULL) {
-        SDL_RWops *rwops = handle->rwops;
         wchar_t ch;
-        if (SDL_RWread(rwops, &ch, sizeof(wchar_t), 1) < 1) {
+        if (s_FileBufferRead(handle, &ch, sizeof(wchar_t)) < (int)sizeof(wchar_t)) {
             return (wchar_t)-1;
         }
         
@@ -784,6 +1051,10 @@ int Dx_File_OpenRead(const char *filename) {
 
 int Dx_File_Init() {
     s_initialized = DXTRUE;
+    
+#ifndef DX_NON_DXA
+    DXA_Kernel_SetLevel(-1);
+#endif
 
     s_OpenArchives();
     
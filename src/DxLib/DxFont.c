@@ -43,13 +43,19 @@
  * 
  * - Mappings exist to give names to ttf files.
  * - Font handles are instances of individual font files.
- * - Every font instance maintains a glyph texture and a glyph cache.
- * - As glyphs are cached, they are drawn onto the glyph texture
+ * - Every font instance maintains a set of glyph texture pages and a
+ *   glyph cache.
+ * - As glyphs are cached, they are drawn onto the newest page
  *   dynamically.
  * - Extraneous edging of glyphs is stored as a separate glyph on the
  *   texture.
- * - If the glyph texture runs out of room, it is automatically grown
- *   and all glyphs are redrawn onto the new texture.
+ * - If the newest page runs out of room, another page is added, twice
+ *   the size of the last up to a limit. Glyphs already cached stay
+ *   where they are, so nothing is ever redrawn.
+ * - Glyphs can also be rendered ahead of time on worker threads, and
+ *   uploaded a band at a time.
+ * - Strings are laid out into runs of quads per page before drawing,
+ *   and recently drawn strings keep their layouts.
  * - The "default" font handle has a tiny system to update it on
  *   demand.
  * 
@@ -82,7 +88,7 @@ typedef struct GlyphRect {
     unsigned short h;
 } GlyphRect;
 
-/* 20 bytes/glyph */
+/* 28 bytes/glyph */
 typedef struct GlyphData {
     unsigned int glyphID;
     
@@ -91,9 +97,22 @@ typedef struct GlyphData {
     
     short xOffset;
     short advance;
-    unsigned int nextGlyph;
+    
+    unsigned char page;
+    unsigned char edgePage;
 } GlyphData;
 
+/* Glyph IDs are split into a page and an entry within it. */
+#define GLYPHINDEX_PAGE_COUNT   256
+#define GLYPHINDEX_PAGE_SIZE    256
+
+#define GLYPHPAGE_FIRST_SIZE    256
+#define GLYPHPAGE_MAX_SIZE      2048
+#define GLYPHPAGE_MAX_COUNT     256
+
+/* Pre-warm jobs that may run at once for a single font. */
+#define PREWARM_MAX_JOBS        4
+
 typedef struct GlyphTexture {
     int textureID;
     int graphID;
@@ -104,10 +123,21 @@ typedef struct GlyphTexture {
     int Y;
     int X;
     int NextY;
+    
+    int usedPixels;
 } GlyphTexture;
 
 typedef struct FontData {
     TTF_Font *font;
+    void *fontFileData;
+    size_t fontFileSize;
+    char *filename;
+    int directFileAccessOnly;
+    /* generation is set once when the font is made, and tells a font
+     * apart from a later one given the same handle. serial also changes
+     * whenever the font lays text out differently. */
+    unsigned int generation;
+    unsigned int serial;
     int ptSize;
     int fontType;
     int edgeSize;
@@ -120,13 +150,17 @@ typedef struct FontData {
     double exRateX;
     double exRateY;
     
-    GlyphTexture glyphTexture;
+    GlyphTexture *glyphPages;
+    int glyphPageCount;
+    int glyphGrowCount;
     
     GlyphData *glyphData;
     unsigned int glyphDataSize;
     unsigned int glyphDataCount;
-    unsigned int glyphHash[256];
+    unsigned int *glyphIndex[GLYPHINDEX_PAGE_COUNT];
     unsigned int glyphTotal;
+    
+    int prewarmJobs[PREWARM_MAX_JOBS];
 } FontData;
 
 typedef struct DefaultFontInfo {
@@ -155,6 +189,7 @@ static DefaultFontInfo s_defaultFontInfo = {
 };
 static int s_defaultFontRefreshFlag = DXTRUE;
 static int s_applyPMA = DXFALSE;
+static unsigned int s_fontSerial = 0;
 
 /* ------------------------------------------------------- FONT MAPPINGS */
 
@@ -164,6 +199,7 @@ static void s_Initialize() {
     }
     
     s_pixelFormat = SDL_AllocFormat(SDL_PIXELFORMAT_ARGB8888);
+    FontEdge_Kernel_SetLevel(-1);
     s_defaultFontHandle = -1;
     
     TTF_Init();
@@ -172,7 +208,9 @@ static void s_Initialize() {
     s_fontInitialized = DXTRUE;
 }
 
+/* If the font is still being loaded, this finishes loading it first. */
 static FontData *s_GetFontData(int ID) {
+    PL_Async_WaitHandle(ID);
     return (FontData *)PL_Handle_GetData(ID, DXHANDLE_FONT);
 }
 
@@ -190,6 +228,12 @@ static int s_AllocateFontDataID(
     
     fontData = (FontData *)PL_Handle_AllocateData(fontDataID, sizeof(FontData));
     fontData->font = font;
+    fontData->fontFileData = NULL;
+    fontData->fontFileSize = 0;
+    fontData->filename = PL_Text_Strdup(mapping->filename);
+    fontData->directFileAccessOnly = mapping->directFileAccessOnly;
+    fontData->serial = ++s_fontSerial;
+    fontData->generation = fontData->serial;
     
     fontData->ptSize = ptSize;
     fontData->edgeSize = 1;
@@ -198,22 +242,22 @@ static int s_AllocateFontDataID(
     fontData->exRateX = mapping->exRateX;
     fontData->exRateY = mapping->exRateY;
     
-    fontData->glyphTexture.textureID = -1;
-    fontData->glyphTexture.graphID = -1;
-    fontData->glyphTexture.width = 0;
-    fontData->glyphTexture.height = 0;
-    fontData->glyphTexture.X = 0;
-    fontData->glyphTexture.Y = 0;
-    fontData->glyphTexture.NextY = 0;
+    fontData->glyphPages = NULL;
+    fontData->glyphPageCount = 0;
+    fontData->glyphGrowCount = 0;
     
     fontData->glyphData = 0;
     fontData->glyphDataSize = 0;
     fontData->glyphDataCount = 0;
-    for (i = 0; i < 256; ++i) {
-        fontData->glyphHash[i] = 0xffff;
+    for (i = 0; i < GLYPHINDEX_PAGE_COUNT; ++i) {
+        fontData->glyphIndex[i] = NULL;
     }
     fontData->glyphTotal = 0;
     
+    for (i = 0; i < PREWARM_MAX_JOBS; ++i) {
+        fontData->prewarmJobs[i] = -1;
+    }
+    
     return fontDataID;
 }
 
@@ -311,28 +355,45 @@ int PLEXT_Font_InitFontMappings() {
  * as characters are recognized.
  * 
  * Unlike DxLib we keep a much smaller set of data for glyph information,
- * with a 256 entry hash table and no limit on available glyphs in existence.
+ * with no limit on available glyphs in existence.
+ *
+ * Glyphs are found through a two level table covering every glyph ID:
+ * the high byte picks a page of 256 entries, allocated when first used,
+ * and the low byte an entry, which is the glyph's slot plus one.
  */
 
-static void s_AddGlyphToTexture(FontData *fontData, GlyphData *glyph);
-
 static GlyphData *s_GetGlyph(FontData *fontData, unsigned int glyphID) {
-    unsigned int s = fontData->glyphHash[glyphID & 0xff];
-    while (s != 0xffff) {
-        GlyphData *glyph = &fontData->glyphData[s];
-        if (glyph->glyphID == glyphID) {
-            return glyph;
-        }
-        
-        s = glyph->nextGlyph;
+    unsigned int *indexPage;
+    unsigned int slot;
+    
+    if (glyphID > 65535) {
+        return NULL;
     }
     
-    return NULL;
+    indexPage = fontData->glyphIndex[glyphID >> 8];
+    if (indexPage == NULL) {
+        return NULL;
+    }
+    
+    slot = indexPage[glyphID & 0xff];
+    if (slot == 0) {
+        return NULL;
+    }
+    
+    return &fontData->glyphData[slot - 1];
 }
 
 static GlyphData *s_AllocateGlyph(FontData *fontData, unsigned int glyphID) {
     GlyphData *glyph;
     unsigned int glyphSlot;
+    unsigned int **indexPage = &fontData->glyphIndex[glyphID >> 8];
+    
+    if (*indexPage == NULL) {
+        *indexPage = (unsigned int *)DXCALLOC(sizeof(unsigned int) * GLYPHINDEX_PAGE_SIZE);
+        if (*indexPage == NULL) {
+            return NULL;
+        }
+    }
     
     if (fontData->glyphDataCount == fontData->glyphDataSize) {
         fontData->glyphDataSize += 1024;
@@ -351,125 +412,85 @@ static GlyphData *s_AllocateGlyph(FontData *fontData, unsigned int glyphID) {
     
     glyph->advance = 0;
     glyph->glyphID = glyphID;
-    glyph->nextGlyph = fontData->glyphHash[glyphID & 0xff];
-    fontData->glyphHash[glyphID & 0xff] = glyphSlot;
+    (*indexPage)[glyphID & 0xff] = glyphSlot + 1;
     
     fontData->glyphTotal += 1;
     
     glyph->xOffset = 0;
+    glyph->page = 0;
+    glyph->edgePage = 0;
     
     return glyph;
 }
 
-static void s_GrowGlyphTexture(FontData *fontData) {
-    static int nestCount = 0;
-    GlyphTexture *glyphTexture = &fontData->glyphTexture;
-    unsigned int glyphsLeft;
+/* Adds an empty page for glyphs at least minW*minH in size. */
+static int s_AddGlyphPage(FontData *fontData, int minW, int minH) {
+    GlyphTexture *page;
     PLRect texRect;
-    int nest;
-    int i;
+    int size;
+    
+    if (fontData->glyphPageCount >= GLYPHPAGE_MAX_COUNT) {
+        return -1;
+    }
     
-    if (glyphTexture->graphID < 0) {
-        glyphTexture->width = 256;
-        glyphTexture->height = 256;
+    if (fontData->glyphPageCount == 0) {
+        size = GLYPHPAGE_FIRST_SIZE;
     } else {
-        if (glyphTexture->width <= glyphTexture->height) {
-            glyphTexture->width *= 2;
-        } else {
-            glyphTexture->height *= 2;
+        size = fontData->glyphPages[fontData->glyphPageCount - 1].width * 2;
+        if (size > GLYPHPAGE_MAX_SIZE) {
+            size = GLYPHPAGE_MAX_SIZE;
         }
-        
-        PLG.Texture_Release(glyphTexture->textureID);
-        Dx_Graph_Delete(glyphTexture->graphID);
+    }
+    while (size < minW || size < minH) {
+        size *= 2;
+    }
+    if (size > GLYPHPAGE_MAX_SIZE) {
+        return -1;
     }
     
-    glyphTexture->textureID = PLG.Texture_CreateFromDimensions(
-            glyphTexture->width,
-            glyphTexture->height,
-            DXTRUE
-        );
+    if (fontData->glyphPages == NULL) {
+        fontData->glyphPages = DXALLOC(sizeof(GlyphTexture));
+    } else {
+        fontData->glyphPages = DXREALLOC(fontData->glyphPages,
+                                         sizeof(GlyphTexture) * (fontData->glyphPageCount + 1));
+    }
     
-    PLG.Texture_AddRef(glyphTexture->textureID);
+    page = &fontData->glyphPages[fontData->glyphPageCount];
+    page->width = size;
+    page->height = size;
+    page->X = 0;
+    page->Y = 0;
+    page->NextY = 0;
+    page->usedPixels = 0;
+    
+    page->textureID = PLG.Texture_CreateFromDimensions(size, size, DXTRUE);
+    if (page->textureID < 0) {
+        return -1;
+    }
+    
+    PLG.Texture_AddRef(page->textureID);
     
     texRect.x = 0;
     texRect.y = 0;
-    texRect.w = glyphTexture->width;
-    texRect.h = glyphTexture->height;
+    texRect.w = size;
+    texRect.h = size;
     
-    glyphTexture->graphID = Dx_Graph_FromTexture(
-        glyphTexture->textureID, texRect
-        );
-    
-    glyphTexture->X = 0;
-    glyphTexture->Y = 0;
-    glyphTexture->NextY = 0;
+    page->graphID = Dx_Graph_FromTexture(page->textureID, texRect);
     
-    /* Redo all glyphs. */
-    glyphsLeft = fontData->glyphTotal;
-    nestCount += 1;
-    nest = nestCount;
-    for (i = 0; i < 256 && glyphsLeft > 0; ++i) {
-        unsigned int glyphID = fontData->glyphHash[i];
-        
-        while (glyphID != 65535) {
-            GlyphData *glyph = &fontData->glyphData[glyphID];
-            
-            s_AddGlyphToTexture(fontData, glyph);
-            
-            if (nest != nestCount) {
-                return;
-            }
-            
-            glyphsLeft -= 1;
-            
-            glyphID = glyph->nextGlyph;
-        }
+    if (fontData->glyphPageCount > 0) {
+        fontData->glyphGrowCount += 1;
     }
+    fontData->glyphPageCount += 1;
+    
+    return 0;
 }
 
-static const unsigned char s_fontEdgePattern2[5 * 5] = {
-    0, 1, 1, 1, 0,
-    1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1,
-    0, 1, 1, 1, 0
-};
-static const unsigned char s_fontEdgePattern3[7 * 7] = {
-    0, 0, 0, 1, 0, 0, 0,
-    0, 1, 1, 1, 1, 1, 0,
-    0, 1, 1, 1, 1, 1, 0,
-    1, 1, 1, 1, 1, 1, 1,
-    0, 1, 1, 1, 1, 1, 0,
-    0, 1, 1, 1, 1, 1, 0,
-    0, 0, 0, 1, 0, 0, 0
-};
-static const unsigned char s_fontEdgePattern4[9 * 9] = {
-    0, 0, 1, 1, 1, 1, 1, 0, 0,
-    0, 1, 1, 1, 1, 1, 1, 1, 0,
-    1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1,
-    0, 1, 1, 1, 1, 1, 1, 1, 0,
-    0, 0, 1, 1, 1, 1, 1, 0, 0
-};
-static const unsigned char *s_fontEdgePatternTable[3] = {
-    s_fontEdgePattern2,
-    s_fontEdgePattern3,
-    s_fontEdgePattern4
-};
-
-static SDL_Surface *s_DrawEdge(FontData *fontData, SDL_Surface *surface) {
+/* Draws the edge of a glyph, as a new surface edgeSize larger on every
+ * side. Safe on worker threads. */
+static SDL_Surface *s_DrawEdge(int edgeSize, SDL_Surface *surface) {
     SDL_Surface *textSurface;
-    unsigned int *srcPixels;
-    unsigned int *destPixels;
-    int srcPitch = surface->pitch / 4;
-    int destPitch;
-    int edgeSize = fontData->edgeSize;
     int width = surface->w + edgeSize + edgeSize;
     int height = surface->h + edgeSize + edgeSize;
-    int x, y;
     
     textSurface = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32,
                                        0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
@@ -477,78 +498,30 @@ static SDL_Surface *s_DrawEdge(FontData *fontData, SDL_Surface *surface) {
         return NULL;
     }
     
-    destPitch = textSurface->pitch / 4;
-    destPixels = textSurface->pixels;
-    
-    /* Pass one - create the edge mask. */
-    if (edgeSize == 1) {
-        srcPixels = surface->pixels;
-        destPixels += destPitch + 1;
-        for (y = 0; y < surface->h; ++y) {
-            for (x = 0; x < surface->w; ++x) {
-                unsigned int alpha = srcPixels[x];
-                if (alpha > 0xffffff) {
-                    destPixels[x] = 0xffffffff;
-                    
-                    if (destPixels[x + 1] < alpha) { destPixels[x + 1] = alpha; }
-                    if (destPixels[x - 1] < alpha) { destPixels[x - 1] = alpha; }
-                    if (destPixels[x + destPitch] < alpha) { destPixels[x + destPitch] = alpha; }
-                    if (destPixels[x - destPitch] < alpha) { destPixels[x - destPitch] = alpha; }
-                }
-            }
-            srcPixels += srcPitch;
-            destPixels += destPitch;
-        }
-    } else if (edgeSize >= 2 && edgeSize <= 4) {
-        const unsigned char *edgePattern;
-        int ec = edgeSize + edgeSize + 1;
-        int offset = (edgeSize * destPitch) + edgeSize;
-        
-        edgePattern = s_fontEdgePatternTable[edgeSize - 2];
-        
-        srcPixels = surface->pixels;
-        destPixels += offset;
-        for (y = 0; y < surface->h; ++y) {
-            for (x = 0; x < surface->w; ++x) {
-                unsigned int alpha = srcPixels[x];
-                if (alpha > 0xffffff) {
-                    const unsigned char *pattern = edgePattern;
-                    unsigned int *dest;
-                    int bx, by;
-                    
-                    destPixels[x] = alpha;
-                    
-                    dest = destPixels + x - offset;
-                    
-                    for (by = 0; by < ec; ++by) {
-                        for (bx = 0; bx < ec; ++bx) {
-                            if (*pattern++ > 0 && dest[bx] < alpha) {
-                                dest[bx] = alpha;
-                            }
-                        }
-                        dest += destPitch;
-                    }
-                }
-            }
-            srcPixels += srcPitch;
-            destPixels += destPitch;
-        }
+    if (FontEdge_Draw((const unsigned int *)surface->pixels, surface->pitch / 4,
+                      surface->w, surface->h, edgeSize,
+                      (unsigned int *)textSurface->pixels, textSurface->pitch / 4) < 0
+    ) {
+        SDL_FreeSurface(textSurface);
+        return NULL;
     }
     
     return textSurface;
 }
 
-static SDL_Surface *s_GetGlyphSurface(FontData *fontData, GlyphData *glyph) {
+/* Renders a glyph. Only uses the font given, so this is safe on a worker
+ * thread with a font of its own. */
+static SDL_Surface *s_RenderGlyphSurface(TTF_Font *font, int fontType, unsigned int glyphID) {
     SDL_Color color;
     color.r = 0xff;
     color.g = 0xff;
     color.b = 0xff;
     color.a = 0xff;
-    switch((fontData->fontType &~ DX_FONTTYPE_EDGE)) {
+    switch((fontType &~ DX_FONTTYPE_EDGE)) {
         case DX_FONTTYPE_NORMAL: {
             SDL_Surface *BWsurface;
             SDL_Surface *textSurface = NULL;
-            BWsurface = TTF_RenderGlyph_Solid(fontData->font, (Uint16)glyph->glyphID, color);
+            BWsurface = TTF_RenderGlyph_Solid(font, (Uint16)glyphID, color);
             if (BWsurface != NULL) {
                 textSurface = SDL_ConvertSurface(BWsurface, s_pixelFormat, 0);
                 SDL_FreeSurface(BWsurface);
@@ -557,58 +530,78 @@ static SDL_Surface *s_GetGlyphSurface(FontData *fontData, GlyphData *glyph) {
         }
         default:
             /* Any of the DX_FONTTYPE_ANTIALIASING* entries */
-            return TTF_RenderGlyph_Blended(fontData->font, (Uint16)glyph->glyphID, color);
+            return TTF_RenderGlyph_Blended(font, (Uint16)glyphID, color);
     }
 }
 
-static int s_FitSurface(FontData *fontData, SDL_Surface *surface, GlyphRect *rect) {
-    GlyphTexture *glyphTexture = &fontData->glyphTexture;
-    int x, y, w, h, nextY;
-    PLRect texRect;
+/* Finds a place for a w*h glyph on the page, shelf by shelf. */
+static int s_FindRoom(GlyphTexture *page, int w, int h, int *dX, int *dY) {
+    int x = page->X;
+    int y = page->Y;
     
-    /* - Fit glyph onto the texture, updating the next position. */
-    x = glyphTexture->X;
-    y = glyphTexture->Y;
-    w = surface->w;
-    h = surface->h;
-    if ((x + w) > glyphTexture->width) {
-        if (w > glyphTexture->width) {
-            SDL_FreeSurface(surface);
-            
-            s_GrowGlyphTexture(fontData);
-            
-            return -1;
-        }
+    if ((x + w) > page->width) {
         x = 0;
-        y = glyphTexture->NextY;
-        
-        glyphTexture->X = x;
-        glyphTexture->Y = y;
+        y = page->NextY;
     }
-    
-    nextY = y + h;
-    if (nextY > glyphTexture->height) {
-        s_GrowGlyphTexture(fontData);
-        
+    if ((x + w) > page->width || (y + h) > page->height) {
         return -1;
     }
     
-    if (nextY > glyphTexture->NextY) {
-        glyphTexture->NextY = nextY;
+    *dX = x;
+    *dY = y;
+    return 0;
+}
+
+/* Reserves room for a w*h glyph, without drawing anything there. */
+static int s_PlaceGlyph(FontData *fontData, int w, int h,
+                        GlyphRect *rect, unsigned char *dPage) {
+    GlyphTexture *page = NULL;
+    int x, y;
+    
+    /* - Fit glyph onto the newest page, adding a page if it's full. */
+    if (fontData->glyphPageCount > 0) {
+        page = &fontData->glyphPages[fontData->glyphPageCount - 1];
     }
+    if (page == NULL || s_FindRoom(page, w, h, &x, &y) < 0) {
+        if (s_AddGlyphPage(fontData, w, h) < 0) {
+            return -1;
+        }
+        page = &fontData->glyphPages[fontData->glyphPageCount - 1];
+        if (s_FindRoom(page, w, h, &x, &y) < 0) {
+            return -1;
+        }
+    }
+    
+    page->X = x + w;
+    page->Y = y;
+    if ((y + h) > page->NextY) {
+        page->NextY = y + h;
+    }
+    page->usedPixels += w * h;
     
     rect->x = (unsigned short)x;
     rect->y = (unsigned short)y;
     rect->w = (unsigned short)w;
     rect->h = (unsigned short)h;
-    texRect.x = x;
-    texRect.y = y;
-    texRect.w = w;
-    texRect.h = h;
+    *dPage = (unsigned char)(fontData->glyphPageCount - 1);
     
-    PLG.Texture_BlitSurface(glyphTexture->textureID, surface, &texRect);
+    return 0;
+}
+
+static int s_FitSurface(FontData *fontData, SDL_Surface *surface,
+                        GlyphRect *rect, unsigned char *dPage) {
+    PLRect texRect;
+    
+    if (s_PlaceGlyph(fontData, surface->w, surface->h, rect, dPage) < 0) {
+        return -1;
+    }
     
-    glyphTexture->X = x + w;
+    texRect.x = rect->x;
+    texRect.y = rect->y;
+    texRect.w = rect->w;
+    texRect.h = rect->h;
+    
+    PLG.Texture_BlitSurface(fontData->glyphPages[*dPage].textureID, surface, &texRect);
     
     return 0;
 }
@@ -618,7 +611,7 @@ static void s_AddGlyphToTexture(FontData *fontData, GlyphData *glyph) {
     int retval;
     
     /* - Get glyph. */
-    surface = s_GetGlyphSurface(fontData, glyph);
+    surface = s_RenderGlyphSurface(fontData->font, fontData->fontType, glyph->glyphID);
     if (surface == NULL) {
         return;
     }
@@ -627,13 +620,14 @@ static void s_AddGlyphToTexture(FontData *fontData, GlyphData *glyph) {
         PL_Surface_ApplyPMAToSDLSurface(surface);
     }
     
-    retval = s_FitSurface(fontData, surface, &glyph->rect);
+    retval = s_FitSurface(fontData, surface, &glyph->rect, &glyph->page);
     glyph->edgeRect = glyph->rect;
+    glyph->edgePage = glyph->page;
     
     if (retval >= 0 && (fontData->fontType & DX_FONTTYPE_EDGE) != 0) {
-        SDL_Surface *edgeSurface = s_DrawEdge(fontData, surface);
+        SDL_Surface *edgeSurface = s_DrawEdge(fontData->edgeSize, surface);
         if (edgeSurface != NULL) {
-            s_FitSurface(fontData, edgeSurface, &glyph->edgeRect);
+            s_FitSurface(fontData, edgeSurface, &glyph->edgeRect, &glyph->edgePage);
             
             SDL_FreeSurface(edgeSurface);
         }
@@ -642,9 +636,33 @@ static void s_AddGlyphToTexture(FontData *fontData, GlyphData *glyph) {
     SDL_FreeSurface(surface);
 }
 
+/* Fills in a new glyph's size and advance. Returns -1 if it has
+ * nothing to draw. */
+static int s_SetGlyphMetrics(FontData *fontData, GlyphData *glyph,
+                             int minX, int maxX, int minY, int maxY, int advance) {
+    glyph->rect.x = 0;
+    glyph->rect.y = 0;
+    glyph->rect.w = (unsigned short)(maxX - minX);
+    glyph->rect.h = (unsigned short)(maxY - minY);
+    glyph->edgeRect.x = 0;
+    glyph->edgeRect.y = 0;
+    glyph->edgeRect.w = (unsigned short)(maxX - minX);
+    glyph->edgeRect.h = (unsigned short)(maxY - minY);
+    glyph->advance = (short)advance;
+    
+    if ((fontData->fontType & DX_FONTTYPE_EDGE) != 0) {
+        glyph->advance = (short)(glyph->advance + (fontData->edgeSize * 2));
+    }
+    
+    if (maxX == minX && maxY == minY) {
+        return -1;
+    }
+    
+    return 0;
+}
+
 static GlyphData *s_CacheGlyph(FontData *fontData, unsigned int glyphID) {
     /* - Check to see if the font has a glyph. */
-    GlyphTexture *glyphTexture = &fontData->glyphTexture;
     int minX, maxX, minY, maxY, advance;
     int retval;
     GlyphData *glyph;
@@ -674,32 +692,12 @@ static GlyphData *s_CacheGlyph(FontData *fontData, unsigned int glyphID) {
     if (glyph == NULL) {
         return NULL;
     }
-
-    glyph->rect.x = 0;
-    glyph->rect.y = 0;
-    glyph->rect.w = (unsigned short)(maxX - minX);
-    glyph->rect.h = (unsigned short)(maxY - minY);
-    glyph->edgeRect.x = 0;
-    glyph->edgeRect.y = 0;
-    glyph->edgeRect.w = (unsigned short)(maxX - minX);
-    glyph->edgeRect.h = (unsigned short)(maxY - minY);
-    glyph->advance = (short)advance;
-    
-    if ((fontData->fontType & DX_FONTTYPE_EDGE) != 0) {
-        glyph->advance = (short)(glyph->advance + (fontData->edgeSize * 2));
-    }
     
-    if (maxX == minX && maxY == minY) {
+    if (s_SetGlyphMetrics(fontData, glyph, minX, maxX, minY, maxY, advance) < 0) {
         /* Probably a blank space. */
         return NULL;
     }
     
-    /* - Create default texture if needed. */
-    if (glyphTexture->textureID < 0) {
-        s_GrowGlyphTexture(fontData);
-        return glyph;
-    }
-    
     s_AddGlyphToTexture(fontData, glyph);
     
     if (minX < 0) {
@@ -709,41 +707,767 @@ static GlyphData *s_CacheGlyph(FontData *fontData, unsigned int glyphID) {
     return glyph;
 }
 
-/* ---------------------------------------- DRAWING AND PUBLIC FUNCTIONS */
+/* --------------------------------------------------------- GLYPH PREWARM */
+
+/* Pre-warming caches a set of glyphs in the background.
+ *
+ * The glyphs are split between a few jobs. Each job renders into its own
+ * surfaces with its own TTF_Font, opened and closed on the main thread,
+ * as FreeType's shared library object is not safe to use elsewhere. The
+ * font the main thread draws with is never touched from a worker.
+ *
+ * Finishing a job places its glyphs on fresh shelves, so that everything
+ * it adds to a page is one band of rows nobody else has drawn to. Each
+ * band is then assembled in memory and uploaded once, instead of once
+ * per glyph.
+ *
+ * Glyphs that were cached by drawing while a job ran are skipped.
+ */
 
-int Dx_Font_DrawStringA(int x, int y, double exRateX, double exRateY,
-                        const char *string, DXCOLOR color, int fontHandle,
-                        DXCOLOR edgeColor, int VerticalFlag
-) {
-    wchar_t buf[4096];
-    FontData *fontData;
+#define PREWARM_MIN_JOB_GLYPHS  64
+
+typedef struct PrewarmGlyph {
+    unsigned int glyphID;
+    int provided;
+    int minX, maxX, minY, maxY, advance;
     
-    fontData = s_GetFontData(fontHandle);
-    if (fontData == NULL) {
+    SDL_Surface *surface;
+    SDL_Surface *edgeSurface;
+} PrewarmGlyph;
+
+typedef struct PrewarmJob {
+    int fontHandle;
+    int slot;
+    
+    TTF_Font *font;
+    int fontType;
+    int edgeSize;
+    int applyPMA;
+    
+    PrewarmGlyph *glyphs;
+    int glyphCount;
+} PrewarmJob;
+
+typedef struct PrewarmUpload {
+    SDL_Surface *surface;
+    GlyphRect rect;
+    unsigned char page;
+} PrewarmUpload;
+
+/* Opens another instance of the font, for use on a worker thread. */
+static TTF_Font *s_OpenFontCopy(FontData *fontData) {
+    SDL_RWops *rwops;
+    TTF_Font *font;
+    
+    if (fontData->fontFileData != NULL) {
+        rwops = SDL_RWFromConstMem(fontData->fontFileData, (int)fontData->fontFileSize);
+    } else if (fontData->filename == NULL) {
+        return NULL;
+    } else if (fontData->directFileAccessOnly) {
+        rwops = PLSDL2_FileOpenReadDirect(fontData->filename);
+    } else {
+        rwops = PLSDL2_FileToRWops(PL_File_OpenRead(fontData->filename));
+    }
+    if (rwops == NULL) {
+        return NULL;
+    }
+    
+    font = TTF_OpenFontRW(rwops, 1, fontData->ptSize);
+    if (font != NULL) {
+        TTF_SetFontHinting(font, TTF_GetFontHinting(fontData->font));
+        TTF_SetFontStyle(font, TTF_GetFontStyle(fontData->font));
+    }
+    
+    return font;
+}
+
+static int s_PrewarmWork(void *userdata) {
+    PrewarmJob *job = (PrewarmJob *)userdata;
+    int i;
+    
+    for (i = 0; i < job->glyphCount; ++i) {
+        PrewarmGlyph *pg = &job->glyphs[i];
+        
+        if (TTF_GlyphIsProvided(job->font, (Uint16)pg->glyphID) == FALSE
+            || TTF_GlyphMetrics(job->font, (Uint16)pg->glyphID,
+                                &pg->minX, &pg->maxX, &pg->minY, &pg->maxY,
+                                &pg->advance) < 0
+        ) {
+            continue;
+        }
+        pg->provided = DXTRUE;
+        
+        if (pg->maxX == pg->minX && pg->maxY == pg->minY) {
+            continue;
+        }
+        
+        pg->surface = s_RenderGlyphSurface(job->font, job->fontType, pg->glyphID);
+        if (pg->surface == NULL) {
+            continue;
+        }
+        
+        if (job->applyPMA) {
+            PL_Surface_ApplyPMAToSDLSurface(pg->surface);
+        }
+        
+        if ((job->fontType & DX_FONTTYPE_EDGE) != 0) {
+            pg->edgeSurface = s_DrawEdge(job->edgeSize, pg->surface);
+        }
+    }
+    
+    return 0;
+}
+
+static int s_PrewarmPlace(FontData *fontData, SDL_Surface *surface,
+                          GlyphRect *rect, unsigned char *dPage,
+                          PrewarmUpload *uploads, int *uploadCount) {
+    PrewarmUpload *upload;
+    
+    if (s_PlaceGlyph(fontData, surface->w, surface->h, rect, dPage) < 0) {
         return -1;
     }
     
-    PL_Text_StringToWideChar(buf, string, fontData->charset, 4096);
+    upload = &uploads[*uploadCount];
+    upload->surface = surface;
+    upload->rect = *rect;
+    upload->page = *dPage;
+    *uploadCount += 1;
     
-    return Dx_Font_DrawStringW(x, y, exRateX, exRateY,
-                               buf, color, fontHandle,
-                               edgeColor, VerticalFlag);
+    return 0;
 }
-int Dx_Font_DrawStringW(int x, int y, double exRateX, double exRateY,
-                        const wchar_t *string, DXCOLOR color, int fontHandle,
-                        DXCOLOR edgeColor, int VerticalFlag
-) {
-    FontData *fontData;
-    const wchar_t *s;
-    unsigned int ch;
+
+/* Uploads the band of rows a job added to one page, in one go. */
+static void s_PrewarmUploadPage(FontData *fontData, int pageIndex,
+                                const PrewarmUpload *uploads, int uploadCount) {
+    GlyphTexture *page = &fontData->glyphPages[pageIndex];
+    SDL_Surface *band;
+    PLRect bandRect;
+    int minY = page->height;
+    int maxY = 0;
+    int i;
+    
+    for (i = 0; i < uploadCount; ++i) {
+        const PrewarmUpload *upload = &uploads[i];
+        if (upload->page == pageIndex) {
+            if (upload->rect.y < minY) {
+                minY = upload->rect.y;
+            }
+            if ((upload->rect.y + upload->rect.h) > maxY) {
+                maxY = upload->rect.y + upload->rect.h;
+            }
+        }
+    }
+    if (maxY <= minY) {
+        return;
+    }
+    
+    band = SDL_CreateRGBSurface(SDL_SWSURFACE, page->width, maxY - minY, 32,
+                                0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+    if (band == NULL) {
+        return;
+    }
+    
+    for (i = 0; i < uploadCount; ++i) {
+        const PrewarmUpload *upload = &uploads[i];
+        if (upload->page == pageIndex) {
+            SDL_Rect destRect;
+            destRect.x = upload->rect.x;
+            destRect.y = upload->rect.y - minY;
+            destRect.w = upload->rect.w;
+            destRect.h = upload->rect.h;
+            
+            SDL_SetSurfaceBlendMode(upload->surface, SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(upload->surface, NULL, band, &destRect);
+        }
+    }
+    
+    bandRect.x = 0;
+    bandRect.y = minY;
+    bandRect.w = page->width;
+    bandRect.h = maxY - minY;
+    PLG.Texture_BlitSurface(page->textureID, band, &bandRect);
+    
+    SDL_FreeSurface(band);
+}
+
+static void s_PrewarmFinish(void *userdata, int workResult) {
+    PrewarmJob *job = (PrewarmJob *)userdata;
+    FontData *fontData = (FontData *)PL_Handle_GetData(job->fontHandle, DXHANDLE_FONT);
+    PrewarmUpload *uploads = NULL;
+    int uploadCount = 0;
+    int firstPage;
+    int i;
+    
+    if (fontData != NULL) {
+        fontData->prewarmJobs[job->slot] = -1;
+        uploads = (PrewarmUpload *)DXALLOC(sizeof(PrewarmUpload) * job->glyphCount * 2);
+    }
+    
+    if (uploads != NULL) {
+        /* Start on a fresh shelf, so the rows this job uploads are
+         * entirely its own. */
+        firstPage = fontData->glyphPageCount - 1;
+        if (firstPage >= 0) {
+            GlyphTexture *page = &fontData->glyphPages[firstPage];
+            page->X = 0;
+            page->Y = page->NextY;
+        } else {
+            firstPage = 0;
+        }
+        
+        for (i = 0; i < job->glyphCount; ++i) {
+            PrewarmGlyph *pg = &job->glyphs[i];
+            GlyphData *glyph;
+            
+            if (pg->provided == DXFALSE || s_GetGlyph(fontData, pg->glyphID) != NULL) {
+                continue;
+            }
+            
+            glyph = s_AllocateGlyph(fontData, pg->glyphID);
+            if (glyph == NULL) {
+                break;
+            }
+            
+            if (s_SetGlyphMetrics(fontData, glyph, pg->minX, pg->maxX,
+                                  pg->minY, pg->maxY, pg->advance) < 0
+                || pg->surface == NULL
+            ) {
+                continue;
+            }
+            
+            if (s_PrewarmPlace(fontData, pg->surface, &glyph->rect, &glyph->page,
+                               uploads, &uploadCount) >= 0) {
+                glyph->edgeRect = glyph->rect;
+                glyph->edgePage = glyph->page;
+                if (pg->edgeSurface != NULL) {
+                    s_PrewarmPlace(fontData, pg->edgeSurface, &glyph->edgeRect, &glyph->edgePage,
+                                   uploads, &uploadCount);
+                }
+            }
+            
+            if (pg->minX < 0) {
+                glyph->xOffset = (short)pg->minX;
+            }
+        }
+        
+        for (i = firstPage; i < fontData->glyphPageCount; ++i) {
+            s_PrewarmUploadPage(fontData, i, uploads, uploadCount);
+        }
+        
+        DXFREE(uploads);
+    }
+    
+    for (i = 0; i < job->glyphCount; ++i) {
+        if (job->glyphs[i].surface != NULL) {
+            SDL_FreeSurface(job->glyphs[i].surface);
+        }
+        if (job->glyphs[i].edgeSurface != NULL) {
+            SDL_FreeSurface(job->glyphs[i].edgeSurface);
+        }
+    }
+    
+    TTF_CloseFont(job->font);
+    DXFREE(job->glyphs);
+    DXFREE(job);
+}
+
+/* Waits for a font's pre-warm jobs to finish. */
+static void s_WaitPrewarm(FontData *fontData) {
+    int i;
+    
+    for (i = 0; i < PREWARM_MAX_JOBS; ++i) {
+        if (fontData->prewarmJobs[i] >= 0) {
+            PL_Async_Wait(fontData->prewarmJobs[i]);
+            fontData->prewarmJobs[i] = -1;
+        }
+    }
+}
+
+/* Pre-warms every glyph marked in the bitmap that isn't cached yet. */
+static int s_Prewarm(FontData *fontData, int fontHandle, const unsigned char *bitmap) {
+    unsigned int *wanted;
+    int wantedCount = 0;
+    int jobCount;
+    int first;
+    int i;
+    unsigned int glyphID;
+    
+    if (fontData->font == NULL) {
+        return -1;
+    }
+    
+    /* One round of pre-warming at a time. */
+    s_WaitPrewarm(fontData);
+    
+    wanted = (unsigned int *)DXALLOC(sizeof(unsigned int) * 65536);
+    if (wanted == NULL) {
+        return -1;
+    }
+    for (glyphID = 0; glyphID < 65536; ++glyphID) {
+        if ((bitmap[glyphID >> 3] & (1 << (glyphID & 7))) != 0
+            && s_GetGlyph(fontData, glyphID) == NULL
+        ) {
+            wanted[wantedCount] = glyphID;
+            wantedCount += 1;
+        }
+    }
+    
+    jobCount = (wantedCount + PREWARM_MIN_JOB_GLYPHS - 1) / PREWARM_MIN_JOB_GLYPHS;
+    if (jobCount > PREWARM_MAX_JOBS) {
+        jobCount = PREWARM_MAX_JOBS;
+    }
+    
+    first = 0;
+    for (i = 0; i < jobCount; ++i) {
+        int last = (wantedCount * (i + 1)) / jobCount;
+        PrewarmJob *job;
+        int jobID;
+        int n;
+        
+        job = (PrewarmJob *)DXALLOC(sizeof(PrewarmJob));
+        if (job == NULL) {
+            break;
+        }
+        job->font = s_OpenFontCopy(fontData);
+        job->glyphs = (PrewarmGlyph *)DXCALLOC(sizeof(PrewarmGlyph) * (last - first));
+        if (job->font == NULL || job->glyphs == NULL) {
+            if (job->font != NULL) {
+                TTF_CloseFont(job->font);
+            }
+            DXFREE(job->glyphs);
+            DXFREE(job);
+            break;
+        }
+        
+        job->fontHandle = fontHandle;
+        job->slot = i;
+        job->fontType = fontData->fontType;
+        job->edgeSize = fontData->edgeSize;
+        job->applyPMA = s_applyPMA;
+        job->glyphCount = last - first;
+        for (n = 0; n < job->glyphCount; ++n) {
+            job->glyphs[n].glyphID = wanted[first + n];
+        }
+        first = last;
+        
+        jobID = PL_Async_Submit(s_PrewarmWork, s_PrewarmFinish, job);
+        if (jobID >= 0) {
+            fontData->prewarmJobs[i] = jobID;
+        }
+    }
+    
+    DXFREE(wanted);
+    
+    return 0;
+}
+
+/* ---------------------------------------------------------- TEXT LAYOUTS */
+
+/* A text layout is a string that has already been through the glyph
+ * cache and turned into quads, grouped into runs that share a glyph
+ * page. Drawing one copies its quads into the vertex cache, with no
+ * text conversion or glyph lookups.
+ *
+ * Quads are relative to the origin and colors are applied when drawing,
+ * so the same layout can be drawn anywhere in any color. Glyphs never
+ * move once they are on a page, so a layout stays good for as long as
+ * its font keeps the same serial.
+ *
+ * DrawString goes through layouts too, keeping the most recently used
+ * ones in a cache keyed by font serial, scale and the string as given.
+ * A line of dialogue drawn every frame is only laid out once.
+ */
+
+#define LAYOUTCACHE_BUCKETS         256
+#define LAYOUTCACHE_DEFAULT_SIZE    128
+/* Strings longer than this (in bytes) are laid out every time. */
+#define LAYOUTCACHE_MAX_KEY_BYTES   8192
+
+typedef struct TextLayoutRun {
     int graphID;
-    int spacing;
-    int edgeSize;
-    int loop;
+    int firstQuad;
+    int quadCount;
+} TextLayoutRun;
+
+typedef struct TextLayout {
+    int fontHandle;
+    unsigned int fontGeneration;
+    unsigned int fontSerial;
     float scaleX;
     float scaleY;
+    
+    DxRectQuad *quads;
+    TextLayoutRun *runs;
+    int runCount;
+    /* The first edgeRunCount runs are drawn in the edge color. */
+    int edgeRunCount;
+    
+    /* Layout handles keep their string, to lay it out again if the
+     * font changes. */
+    wchar_t *string;
+    
+    /* Cached layouts are keyed by the string as it was passed in. */
+    unsigned int hash;
+    int keyWide;
+    int keyBytes;
+    unsigned char *key;
+    struct TextLayout *hashNext;
+    struct TextLayout *prev;
+    struct TextLayout *next;
+} TextLayout;
+
+static TextLayout *s_layoutBuckets[LAYOUTCACHE_BUCKETS];
+static TextLayout *s_layoutHead = NULL;
+static TextLayout *s_layoutTail = NULL;
+static int s_layoutCount = 0;
+static int s_layoutCacheSize = LAYOUTCACHE_DEFAULT_SIZE;
+
+static void s_FreeLayoutData(TextLayout *layout) {
+    DXFREE(layout->quads);
+    DXFREE(layout->runs);
+    layout->quads = NULL;
+    layout->runs = NULL;
+    layout->runCount = 0;
+    layout->edgeRunCount = 0;
+}
+
+static void s_AddLayoutQuad(TextLayout *layout, int *quadCount, int graphID,
+                            float x, float y, float w, float h,
+                            const GlyphRect *gRect) {
+    DxRectQuad *q = &layout->quads[*quadCount];
+    TextLayoutRun *run = NULL;
+    
+    if (layout->runCount > 0) {
+        run = &layout->runs[layout->runCount - 1];
+    }
+    if (run == NULL || run->graphID != graphID) {
+        run = &layout->runs[layout->runCount];
+        layout->runCount += 1;
+        run->graphID = graphID;
+        run->firstQuad = *quadCount;
+        run->quadCount = 0;
+    }
+    
+    q->x1 = x;
+    q->y1 = y;
+    q->x2 = x + w;
+    q->y2 = y + h;
+    q->sx1 = (float)gRect->x;
+    q->sy1 = (float)gRect->y;
+    q->sx2 = (float)(gRect->x + gRect->w);
+    q->sy2 = (float)(gRect->y + gRect->h);
+    
+    run->quadCount += 1;
+    *quadCount += 1;
+}
+
+static int s_BuildLayout(TextLayout *layout, FontData *fontData, int fontHandle,
+                         const wchar_t *string, float scaleX, float scaleY) {
+    const wchar_t *s;
+    unsigned int ch;
+    int glyphCount = 0;
+    int quadCount = 0;
+    int loop;
+    
+    layout->fontHandle = fontHandle;
+    layout->fontGeneration = fontData->generation;
+    layout->fontSerial = fontData->serial;
+    layout->scaleX = scaleX;
+    layout->scaleY = scaleY;
+    layout->quads = NULL;
+    layout->runs = NULL;
+    layout->runCount = 0;
+    layout->edgeRunCount = 0;
+    
+    /* - Cache all glyphs beforehand, so as not to thrash the texture. */
+    s = string;
+    while ((ch = *s++) != 0) {
+        if (s_CacheGlyph(fontData, ch) != NULL) {
+            glyphCount += 1;
+        }
+    }
+    
+    if (glyphCount == 0 || fontData->glyphPageCount == 0) {
+        /* Nothing to draw. */
+        return 0;
+    }
+    
+    layout->quads = (DxRectQuad *)DXALLOC(sizeof(DxRectQuad) * glyphCount * 2);
+    layout->runs = (TextLayoutRun *)DXALLOC(sizeof(TextLayoutRun) * glyphCount * 2);
+    if (layout->quads == NULL || layout->runs == NULL) {
+        s_FreeLayoutData(layout);
+        return -1;
+    }
+    
+    /* - Loop twice: First for 'edge' textures, then for 'front' textures. */
+    for (loop = 0; loop < 2; ++loop) {
+        float cx, cy;
+        int plus;
+        
+        if (loop == 0) {
+            /* edge pass */
+            if ((fontData->fontType & DX_FONTTYPE_EDGE) == 0) {
+                continue;
+            }
+            plus = 0;
+        } else {
+            /* solid pass */
+            layout->edgeRunCount = layout->runCount;
+            plus = fontData->edgeSize;
+        }
+        
+        s = string;
+        cx = (float)plus * scaleX;
+        cy = (float)plus * scaleY;
+        
+        while ((ch = *s++) != 0) {
+            if (ch == '\n') {
+                cy += (float)fontData->ptSize;
+                cx = (float)plus * scaleX;
+            } else {
+                GlyphData *glyph = s_GetGlyph(fontData, ch);
+                if (glyph != NULL) {
+                    GlyphRect *gRect;
+                    int graphID;
+                    if (loop == 0) {
+                        gRect = &glyph->edgeRect;
+                        graphID = fontData->glyphPages[glyph->edgePage].graphID;
+                    } else {
+                        gRect = &glyph->rect;
+                        graphID = fontData->glyphPages[glyph->page].graphID;
+                    }
+                    
+                    /* Blank glyphs only move the pen. */
+                    if (gRect->w > 0 && gRect->h > 0) {
+                        s_AddLayoutQuad(layout, &quadCount, graphID,
+                                        cx + (glyph->xOffset * scaleX), cy,
+                                        gRect->w * scaleX, gRect->h * scaleY,
+                                        gRect);
+                    }
+                    
+                    cx = cx + ((float)(glyph->advance + fontData->spacing) * scaleX);
+                }
+            }
+        }
+    }
+    
+    return 0;
+}
+
+static int s_DrawLayout(const TextLayout *layout, int x, int y,
+                        DXCOLOR color, DXCOLOR edgeColor) {
     int redBright, greenBright, blueBright;
     int origDrawMode;
+    int i;
+    
+    if (layout->runCount == 0) {
+        return 0;
+    }
+    
+    origDrawMode = Dx_Draw_GetDrawMode();
+    Dx_Draw_SetDrawMode(DX_DRAWMODE_BILINEAR);
+    
+    Dx_Draw_GetBright(&redBright, &greenBright, &blueBright);
+    
+    if (layout->edgeRunCount > 0) {
+        Dx_Draw_SetBright(edgeColor & 0xff, (edgeColor >> 8) & 0xff, (edgeColor >> 16) & 0xff);
+    }
+    for (i = 0; i < layout->runCount; ++i) {
+        const TextLayoutRun *run = &layout->runs[i];
+        
+        if (i == layout->edgeRunCount) {
+            Dx_Draw_SetBright(color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff);
+        }
+        
+        Dx_Draw_RectQuadRunF((float)x, (float)y,
+                             layout->quads + run->firstQuad, run->quadCount,
+                             run->graphID, DXTRUE);
+    }
+    
+    Dx_Draw_SetBright(redBright, greenBright, blueBright);
+    Dx_Draw_SetDrawMode(origDrawMode);
+    
+    return 0;
+}
+
+/* FNV-1a over the key, seeded with everything else that selects a layout. */
+static unsigned int s_HashLayoutKey(unsigned int fontSerial, float scaleX, float scaleY,
+                                    int keyWide, const void *key, int keyBytes) {
+    const unsigned char *p = (const unsigned char *)key;
+    unsigned int hash = 2166136261u;
+    int i;
+    
+    hash = (hash ^ fontSerial) * 16777619u;
+    hash = (hash ^ (unsigned int)(int)(scaleX * 4096.0f)) * 16777619u;
+    hash = (hash ^ (unsigned int)(int)(scaleY * 4096.0f)) * 16777619u;
+    hash = (hash ^ (unsigned int)keyWide) * 16777619u;
+    for (i = 0; i < keyBytes; ++i) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    
+    return hash;
+}
+
+static void s_UnlinkCachedLayout(TextLayout *layout) {
+    if (layout->prev != NULL) {
+        layout->prev->next = layout->next;
+    } else {
+        s_layoutHead = layout->next;
+    }
+    if (layout->next != NULL) {
+        layout->next->prev = layout->prev;
+    } else {
+        s_layoutTail = layout->prev;
+    }
+    layout->prev = NULL;
+    layout->next = NULL;
+}
+
+static void s_PushCachedLayout(TextLayout *layout) {
+    layout->prev = NULL;
+    layout->next = s_layoutHead;
+    if (s_layoutHead != NULL) {
+        s_layoutHead->prev = layout;
+    } else {
+        s_layoutTail = layout;
+    }
+    s_layoutHead = layout;
+}
+
+static void s_RemoveCachedLayout(TextLayout *layout) {
+    TextLayout **bucket = &s_layoutBuckets[layout->hash % LAYOUTCACHE_BUCKETS];
+    
+    while (*bucket != layout) {
+        bucket = &(*bucket)->hashNext;
+    }
+    *bucket = layout->hashNext;
+    
+    s_UnlinkCachedLayout(layout);
+    s_layoutCount -= 1;
+    
+    s_FreeLayoutData(layout);
+    DXFREE(layout->key);
+    DXFREE(layout);
+}
+
+static void s_TrimLayoutCache(int size) {
+    while (s_layoutCount > size && s_layoutTail != NULL) {
+        s_RemoveCachedLayout(s_layoutTail);
+    }
+}
+
+/* Drops every cached layout for a font, when it goes away. */
+static void s_PurgeLayoutCache(int fontHandle) {
+    TextLayout *layout = s_layoutHead;
+    
+    while (layout != NULL) {
+        TextLayout *next = layout->next;
+        if (layout->fontHandle == fontHandle) {
+            s_RemoveCachedLayout(layout);
+        }
+        layout = next;
+    }
+}
+
+static TextLayout *s_FindCachedLayout(FontData *fontData, float scaleX, float scaleY,
+                                      int keyWide, const void *key, int keyBytes) {
+    unsigned int hash;
+    TextLayout *layout;
+    
+    if (s_layoutCount == 0) {
+        return NULL;
+    }
+    
+    hash = s_HashLayoutKey(fontData->serial, scaleX, scaleY, keyWide, key, keyBytes);
+    
+    for (layout = s_layoutBuckets[hash % LAYOUTCACHE_BUCKETS];
+         layout != NULL; layout = layout->hashNext) {
+        if (layout->hash == hash
+            && layout->fontSerial == fontData->serial
+            && layout->scaleX == scaleX && layout->scaleY == scaleY
+            && layout->keyWide == keyWide && layout->keyBytes == keyBytes
+            && memcmp(layout->key, key, (size_t)keyBytes) == 0
+        ) {
+            if (layout != s_layoutHead) {
+                s_UnlinkCachedLayout(layout);
+                s_PushCachedLayout(layout);
+            }
+            return layout;
+        }
+    }
+    
+    return NULL;
+}
+
+/* Lays out a string that was not in the cache and draws it, then keeps
+ * the layout if it is small enough. */
+static int s_LayoutAndDraw(int x, int y, float scaleX, float scaleY,
+                           FontData *fontData, int fontHandle, const wchar_t *string,
+                           int keyWide, const void *key, int keyBytes,
+                           DXCOLOR color, DXCOLOR edgeColor) {
+    TextLayout *layout;
+    unsigned int hash;
+    TextLayout **bucket;
+    
+    if (s_layoutCacheSize <= 0 || keyBytes > LAYOUTCACHE_MAX_KEY_BYTES) {
+        TextLayout tempLayout;
+        int retval = s_BuildLayout(&tempLayout, fontData, fontHandle, string, scaleX, scaleY);
+        if (retval >= 0) {
+            retval = s_DrawLayout(&tempLayout, x, y, color, edgeColor);
+            s_FreeLayoutData(&tempLayout);
+        }
+        return retval;
+    }
+    
+    layout = (TextLayout *)DXALLOC(sizeof(TextLayout));
+    if (layout == NULL) {
+        return -1;
+    }
+    if (s_BuildLayout(layout, fontData, fontHandle, string, scaleX, scaleY) < 0) {
+        DXFREE(layout);
+        return -1;
+    }
+    
+    layout->string = NULL;
+    layout->keyWide = keyWide;
+    layout->keyBytes = keyBytes;
+    layout->key = (unsigned char *)DXALLOC((size_t)keyBytes + 1);
+    if (layout->key == NULL) {
+        s_DrawLayout(layout, x, y, color, edgeColor);
+        s_FreeLayoutData(layout);
+        DXFREE(layout);
+        return 0;
+    }
+    memcpy(layout->key, key, (size_t)keyBytes);
+    
+    hash = s_HashLayoutKey(fontData->serial, scaleX, scaleY, keyWide, key, keyBytes);
+    bucket = &s_layoutBuckets[hash % LAYOUTCACHE_BUCKETS];
+    layout->hash = hash;
+    layout->hashNext = *bucket;
+    *bucket = layout;
+    
+    s_PushCachedLayout(layout);
+    s_layoutCount += 1;
+    s_TrimLayoutCache(s_layoutCacheSize);
+    
+    return s_DrawLayout(layout, x, y, color, edgeColor);
+}
+
+/* ---------------------------------------- DRAWING AND PUBLIC FUNCTIONS */
+
+int Dx_Font_DrawStringA(int x, int y, double exRateX, double exRateY,
+                        const char *string, DXCOLOR color, int fontHandle,
+                        DXCOLOR edgeColor, int VerticalFlag
+) {
+    wchar_t buf[4096];
+    wchar_t *wideString = buf;
+    int wideLength = 4096;
+    int byteLength;
+    FontData *fontData;
+    TextLayout *layout;
+    float scaleX;
+    float scaleY;
+    int retval;
     
     if (string == NULL || *string == 0) {
         return -1;
@@ -757,81 +1481,64 @@ int Dx_Font_DrawStringW(int x, int y, double exRateX, double exRateY,
     scaleX = (float)(exRateX * fontData->exRateX);
     scaleY = (float)(exRateY * fontData->exRateY);
     
-    /* - Cache all glyphs beforehand, so as not to thrash the texture. */
-    s = string;
+    /* Look the string up before doing any conversion. */
+    byteLength = PL_Text_Strlen(string);
+    layout = s_FindCachedLayout(fontData, scaleX, scaleY, DXFALSE, string, byteLength);
+    if (layout != NULL) {
+        return s_DrawLayout(layout, x, y, color, edgeColor);
+    }
     
-    while ((ch = *s++) != 0) {
-        s_CacheGlyph(fontData, ch);
+    /* Every character takes at least one byte, so this always fits. */
+    if (byteLength >= wideLength) {
+        wideLength = byteLength + 1;
+        wideString = (wchar_t *)DXALLOC(sizeof(wchar_t) * wideLength);
     }
     
-    /* - Calculate draw position and get basic information */
-    spacing = fontData->spacing;
-    edgeSize = fontData->edgeSize;
+    PL_Text_StringToWideChar(wideString, string, fontData->charset, wideLength);
     
-    graphID = fontData->glyphTexture.graphID;
-    if (graphID < 0) {
-        /* Nothing to do. */
-        return 0;
+    retval = s_LayoutAndDraw(x, y, scaleX, scaleY,
+                             fontData, fontHandle, wideString,
+                             DXFALSE, string, byteLength,
+                             color, edgeColor);
+    
+    if (wideString != buf) {
+        DXFREE(wideString);
+    }
+    
+    return retval;
+}
+int Dx_Font_DrawStringW(int x, int y, double exRateX, double exRateY,
+                        const wchar_t *string, DXCOLOR color, int fontHandle,
+                        DXCOLOR edgeColor, int VerticalFlag
+) {
+    FontData *fontData;
+    TextLayout *layout;
+    int keyBytes;
+    float scaleX;
+    float scaleY;
+    
+    if (string == NULL || *string == 0) {
+        return -1;
     }
     
-    origDrawMode = Dx_Draw_GetDrawMode();
-    Dx_Draw_SetDrawMode(DX_DRAWMODE_BILINEAR);
+    fontData = s_GetFontData(fontHandle);
+    if (fontData == NULL) {
+        return -1;
+    }
     
-    Dx_Draw_GetBright(&redBright, &greenBright, &blueBright);
+    scaleX = (float)(exRateX * fontData->exRateX);
+    scaleY = (float)(exRateY * fontData->exRateY);
     
-    /* - Loop twice: First for 'edge' textures, then for 'front' textures. */
-    for (loop = 0; loop < 2; ++loop) {
-        float cx, cy;
-        int plus;
-        
-        if (loop == 0) {
-            /* edge pass */
-            if ((fontData->fontType & DX_FONTTYPE_EDGE) == 0) {
-                continue;
-            }
-            Dx_Draw_SetBright(edgeColor & 0xff, (edgeColor >> 8) & 0xff, (edgeColor >> 16) & 0xff);
-            plus = 0;
-        } else if (loop == 1) {
-            /* solid pass */
-            Dx_Draw_SetBright(color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff);
-            plus = edgeSize;
-        }
-        
-        s = string;
-        cx = (float)x + ((float)plus * scaleX);
-        cy = (float)y + ((float)plus * scaleY);
-        
-        while ((ch = *s++) != 0) {
-            if (ch == '\n') {
-                cy += (float)fontData->ptSize;
-                cx = (float)(x + plus) * scaleY;
-            } else {
-                GlyphData *glyph = s_GetGlyph(fontData, ch);
-                if (glyph != NULL) {
-                    GlyphRect *gRect;
-                    if (loop == 0) {
-                        gRect = &glyph->edgeRect;
-                    } else {
-                        gRect = &glyph->rect;
-                    }
-                    
-                    Dx_EXT_Draw_RectGraphFastF(
-                        cx + (glyph->xOffset * scaleX), cy, gRect->w * scaleX, gRect->h * scaleY,
-                        gRect->x, gRect->y, gRect->w, gRect->h,
-                        graphID,
-                        DXTRUE
-                    );
-                    
-                    cx = cx + ((float)(glyph->advance + spacing) * scaleX);
-                }
-            }
-        }
+    keyBytes = PL_Text_StrlenW(string) * (int)sizeof(wchar_t);
+    layout = s_FindCachedLayout(fontData, scaleX, scaleY, DXTRUE, string, keyBytes);
+    if (layout != NULL) {
+        return s_DrawLayout(layout, x, y, color, edgeColor);
     }
     
-    Dx_Draw_SetBright(redBright, greenBright, blueBright);
-    Dx_Draw_SetDrawMode(origDrawMode);
-    
-    return 0;
+    return s_LayoutAndDraw(x, y, scaleX, scaleY,
+                           fontData, fontHandle, string,
+                           DXTRUE, string, keyBytes,
+                           color, edgeColor);
 }
 int Dx_Font_DrawVStringFA(int x, int y, double exRateX, double exRateY,
                           DXCOLOR color, int fontHandle,
@@ -1032,7 +1739,12 @@ int Dx_Font_SetFontSpaceToHandle(int fontSpacing, int fontHandle) {
         return -1;
     }
     
-    fontData->spacing = fontSpacing;
+    /* Laid out text depends on the spacing, so a new serial is
+     * needed to tell old layouts apart. */
+    if (fontData->spacing != fontSpacing) {
+        fontData->spacing = fontSpacing;
+        fontData->serial = ++s_fontSerial;
+    }
     
     return 0;
 }
@@ -1137,6 +1849,119 @@ int Dx_Font_GetDefaultFontHandle() {
 
 /* ----------------------------------------------- FONT HANDLE MANAGEMENT */
 
+static void s_ApplyFontStyle(FontData *fontData, int boldFlag, int italic) {
+    int fontStyle = 0;
+    
+    if ((fontData->fontType & DX_FONTTYPE_ANTIALIASING) == 0) {
+        TTF_SetFontHinting(fontData->font, TTF_HINTING_MONO);
+    }
+    if (boldFlag != 0) {
+        fontStyle |= TTF_STYLE_BOLD;
+    }
+    if (italic) {
+        fontStyle |= TTF_STYLE_ITALIC;
+    }
+    TTF_SetFontStyle(fontData->font, fontStyle);
+}
+
+/* Background font loading only reads the file into memory. Opening the
+ * face goes through FreeType's shared library object, which isn't safe
+ * to use from more than one thread, so that is left for the main thread.
+ * The face reads from the buffer for as long as it is open. */
+typedef struct FontLoadJob {
+    int fontID;
+    char *filename;
+    int directFileAccessOnly;
+    int boldFlag;
+    int italic;
+    
+    void *fileData;
+    size_t fileSize;
+} FontLoadJob;
+
+static int s_FontLoadWork(void *userdata) {
+    FontLoadJob *job = (FontLoadJob *)userdata;
+    SDL_RWops *rwops;
+    Sint64 size;
+    
+    if (job->directFileAccessOnly) {
+        rwops = PLSDL2_FileOpenReadDirect(job->filename);
+    } else {
+        rwops = PLSDL2_FileToRWops(PL_File_OpenRead(job->filename));
+    }
+    if (rwops == NULL) {
+        return -1;
+    }
+    
+    size = SDL_RWsize(rwops);
+    if (size > 0) {
+        job->fileData = DXALLOC((size_t)size);
+        if (SDL_RWread(rwops, job->fileData, (size_t)size, 1) == 1) {
+            job->fileSize = (size_t)size;
+        }
+    }
+    SDL_RWclose(rwops);
+    
+    return (job->fileSize > 0) ? 0 : -1;
+}
+
+static void s_FontLoadFinish(void *userdata, int workResult) {
+    FontLoadJob *job = (FontLoadJob *)userdata;
+    FontData *fontData = (FontData *)PL_Handle_GetData(job->fontID, DXHANDLE_FONT);
+    TTF_Font *font = NULL;
+    
+    PL_Handle_SetASyncJob(job->fontID, -1);
+    
+    if (workResult >= 0 && fontData != NULL) {
+        font = TTF_OpenFontRW(SDL_RWFromConstMem(job->fileData, (int)job->fileSize),
+                              1, fontData->ptSize);
+    }
+    
+    if (font != NULL) {
+        fontData->font = font;
+        fontData->fontFileData = job->fileData;
+        fontData->fontFileSize = job->fileSize;
+        s_ApplyFontStyle(fontData, job->boldFlag, job->italic);
+    } else {
+        if (job->fileData != NULL) {
+            DXFREE(job->fileData);
+        }
+        Dx_Font_DeleteFontToHandle(job->fontID);
+    }
+    
+    DXFREE(job->filename);
+    DXFREE(job);
+}
+
+static int s_LoadFontASync(FontMapping *mapping, int size, int fontType, int italic) {
+    FontLoadJob *job;
+    int fontID;
+    int jobID;
+    
+    fontID = s_AllocateFontDataID(NULL, mapping, size);
+    if (fontID < 0) {
+        return -1;
+    }
+    
+    ((FontData *)PL_Handle_GetData(fontID, DXHANDLE_FONT))->fontType = fontType;
+    
+    job = (FontLoadJob *)DXALLOC(sizeof(FontLoadJob));
+    job->fontID = fontID;
+    job->filename = PL_Text_Strdup(mapping->filename);
+    job->directFileAccessOnly = mapping->directFileAccessOnly;
+    job->boldFlag = mapping->boldFlag;
+    job->italic = italic;
+    job->fileData = NULL;
+    job->fileSize = 0;
+    
+    jobID = PL_Async_Submit(s_FontLoadWork, s_FontLoadFinish, job);
+    if (jobID >= 0) {
+        PL_Handle_SetASyncJob(fontID, jobID);
+    }
+    
+    return fontID;
+}
+
 int Dx_Font_CreateFontToHandle(const char *fontname,
             int size, int thickness, int fontType, int charset,
             int edgeSize, int italic
@@ -1179,7 +2004,9 @@ int Dx_Font_CreateFontToHandle(const char *fontname,
         return -1;
     }
     
-    if (bestMapping->directFileAccessOnly) {
+    if (PL_Async_GetUseASyncLoadFlag() != DXFALSE) {
+        fontID = s_LoadFontASync(bestMapping, size, fontType, italic);
+    } else if (bestMapping->directFileAccessOnly) {
         fontID = s_LoadFontFileDirect(bestMapping->filename, bestMapping, size);
     } else {
         fontID = s_LoadFontFile(bestMapping->filename, bestMapping, size);
@@ -1187,24 +2014,20 @@ int Dx_Font_CreateFontToHandle(const char *fontname,
     
     if (fontID >= 0) {
         FontData *fontData = (FontData *)PL_Handle_GetData(fontID, DXHANDLE_FONT);
-        int fontStyle = 0;
+        if (fontData == NULL) {
+            /* Loaded immediately, and failed. */
+            return -1;
+        }
         
         fontData->fontType = fontType;
         
         fontData->edgeSize = edgeSize;
         
-        if ((fontType & DX_FONTTYPE_ANTIALIASING) == 0) {
-            TTF_SetFontHinting(fontData->font, TTF_HINTING_MONO);
-        }
-        if (bestMapping->boldFlag != 0) {
-            fontStyle |= TTF_STYLE_BOLD;
-        }
-        if (italic) {
-            fontStyle |= TTF_STYLE_ITALIC;
-        }
-        TTF_SetFontStyle(fontData->font, fontStyle);
-        
         fontData->charset = charset;
+        
+        if (fontData->font != NULL) {
+            s_ApplyFontStyle(fontData, bestMapping->boldFlag, italic);
+        }
     }
     
     return fontID;
@@ -1212,23 +2035,48 @@ int Dx_Font_CreateFontToHandle(const char *fontname,
 
 int Dx_Font_DeleteFontToHandle(int handle) {
     FontData *fontData = s_GetFontData(handle);
+    int i;
+    
     if (fontData == NULL) {
         return -1;
     }
     
-    if (fontData->glyphTexture.graphID >= 0) {
-        Dx_Graph_Delete(fontData->glyphTexture.graphID);
+    s_WaitPrewarm(fontData);
+    s_PurgeLayoutCache(handle);
+    
+    for (i = 0; i < fontData->glyphPageCount; ++i) {
+        GlyphTexture *page = &fontData->glyphPages[i];
+        if (page->graphID >= 0) {
+            Dx_Graph_Delete(page->graphID);
+        }
+        if (page->textureID >= 0) {
+            PLG.Texture_Release(page->textureID);
+        }
     }
-    if (fontData->glyphTexture.textureID >= 0) {
-        PLG.Texture_Release(fontData->glyphTexture.textureID);
+    if (fontData->glyphPages != NULL) {
+        DXFREE(fontData->glyphPages);
+        fontData->glyphPages = NULL;
     }
+    fontData->glyphPageCount = 0;
     
     if (fontData->glyphData != NULL) {
         DXFREE(fontData->glyphData);
         fontData->glyphData = 0;
     }
+    for (i = 0; i < GLYPHINDEX_PAGE_COUNT; ++i) {
+        if (fontData->glyphIndex[i] != NULL) {
+            DXFREE(fontData->glyphIndex[i]);
+            fontData->glyphIndex[i] = NULL;
+        }
+    }
     
-    TTF_CloseFont(fontData->font);
+    if (fontData->font != NULL) {
+        TTF_CloseFont(fontData->font);
+    }
+    if (fontData->fontFileData != NULL) {
+        DXFREE(fontData->fontFileData);
+    }
+    DXFREE(fontData->filename);
     
     PL_Handle_ReleaseID(handle, DXTRUE);
     
@@ -1240,12 +2088,277 @@ int Dx_Font_DeleteFontToHandle(int handle) {
     return 0;
 }
 
+/* Reports how the glyph cache of a font handle is doing: how many
+ * texture pages it has, how many glyphs are cached, what fraction of
+ * the page area they cover, and how many times it has had to add a
+ * page. Any of the pointers may be NULL. */
+int Dx_Font_EXTGetFontCacheStatsToHandle(int fontHandle, int *pageCount, int *glyphCount,
+                                         double *occupancy, int *growCount) {
+    FontData *fontData = s_GetFontData(fontHandle);
+    int64_t usedPixels = 0;
+    int64_t totalPixels = 0;
+    int i;
+    
+    if (fontData == NULL) {
+        return -1;
+    }
+    
+    for (i = 0; i < fontData->glyphPageCount; ++i) {
+        GlyphTexture *page = &fontData->glyphPages[i];
+        usedPixels += page->usedPixels;
+        totalPixels += (int64_t)page->width * page->height;
+    }
+    
+    if (pageCount != NULL) {
+        *pageCount = fontData->glyphPageCount;
+    }
+    if (glyphCount != NULL) {
+        *glyphCount = (int)fontData->glyphTotal;
+    }
+    if (occupancy != NULL) {
+        *occupancy = (totalPixels > 0) ? ((double)usedPixels / (double)totalPixels) : 0.0;
+    }
+    if (growCount != NULL) {
+        *growCount = fontData->glyphGrowCount;
+    }
+    
+    return 0;
+}
+
+/* Starts caching the given characters in the background. */
+int Dx_Font_EXTPrewarmFontW(const wchar_t *characters, int fontHandle) {
+    FontData *fontData = s_GetFontData(fontHandle);
+    unsigned char *bitmap;
+    unsigned int ch;
+    int retval;
+    
+    if (fontData == NULL || characters == NULL) {
+        return -1;
+    }
+    
+    bitmap = (unsigned char *)DXCALLOC(65536 / 8);
+    if (bitmap == NULL) {
+        return -1;
+    }
+    while ((ch = (unsigned int)*characters++) != 0) {
+        if (ch < 65536 && ch != '\n') {
+            bitmap[ch >> 3] |= (unsigned char)(1 << (ch & 7));
+        }
+    }
+    
+    retval = s_Prewarm(fontData, fontHandle, bitmap);
+    
+    DXFREE(bitmap);
+    
+    return retval;
+}
+
+int Dx_Font_EXTPrewarmFontA(const char *characters, int fontHandle) {
+    FontData *fontData = s_GetFontData(fontHandle);
+    wchar_t *wideString;
+    int wideLength;
+    int retval;
+    
+    if (fontData == NULL || characters == NULL) {
+        return -1;
+    }
+    
+    wideLength = PL_Text_Strlen(characters) + 1;
+    wideString = (wchar_t *)DXALLOC(sizeof(wchar_t) * wideLength);
+    if (wideString == NULL) {
+        return -1;
+    }
+    
+    PL_Text_StringToWideChar(wideString, characters, fontData->charset, wideLength);
+    
+    retval = Dx_Font_EXTPrewarmFontW(wideString, fontHandle);
+    
+    DXFREE(wideString);
+    
+    return retval;
+}
+
+/* Starts caching a range of codepoints in the background. */
+int Dx_Font_EXTPrewarmFontRange(int firstCodepoint, int lastCodepoint, int fontHandle) {
+    FontData *fontData = s_GetFontData(fontHandle);
+    unsigned char *bitmap;
+    int ch;
+    int retval;
+    
+    if (fontData == NULL) {
+        return -1;
+    }
+    if (firstCodepoint < 0) {
+        firstCodepoint = 0;
+    }
+    if (lastCodepoint > 65535) {
+        lastCodepoint = 65535;
+    }
+    
+    bitmap = (unsigned char *)DXCALLOC(65536 / 8);
+    if (bitmap == NULL) {
+        return -1;
+    }
+    for (ch = firstCodepoint; ch <= lastCodepoint; ++ch) {
+        bitmap[ch >> 3] |= (unsigned char)(1 << (ch & 7));
+    }
+    
+    retval = s_Prewarm(fontData, fontHandle, bitmap);
+    
+    DXFREE(bitmap);
+    
+    return retval;
+}
+
+/* TRUE while pre-warming is still going on for a font. */
+int Dx_Font_EXTCheckFontPrewarm(int fontHandle) {
+    FontData *fontData = s_GetFontData(fontHandle);
+    int i;
+    
+    if (fontData == NULL) {
+        return -1;
+    }
+    
+    for (i = 0; i < PREWARM_MAX_JOBS; ++i) {
+        if (fontData->prewarmJobs[i] >= 0) {
+            return DXTRUE;
+        }
+    }
+    
+    return DXFALSE;
+}
+
+/* Text layout handles. */
+static TextLayout *s_GetLayoutData(int layoutHandle) {
+    return (TextLayout *)PL_Handle_GetData(layoutHandle, DXHANDLE_TEXTLAYOUT);
+}
+
+int Dx_Font_EXTCreateTextLayoutW(const wchar_t *string, int fontHandle,
+                                 double exRateX, double exRateY) {
+    FontData *fontData = s_GetFontData(fontHandle);
+    TextLayout *layout;
+    int layoutHandle;
+    int length;
+    
+    if (fontData == NULL || string == NULL) {
+        return -1;
+    }
+    
+    layoutHandle = PL_Handle_AcquireID(DXHANDLE_TEXTLAYOUT);
+    if (layoutHandle < 0) {
+        return -1;
+    }
+    
+    layout = (TextLayout *)PL_Handle_AllocateData(layoutHandle, sizeof(TextLayout));
+    
+    length = PL_Text_StrlenW(string);
+    layout->string = (wchar_t *)DXALLOC(sizeof(wchar_t) * (length + 1));
+    if (layout->string == NULL) {
+        PL_Handle_ReleaseID(layoutHandle, DXTRUE);
+        return -1;
+    }
+    memcpy(layout->string, string, sizeof(wchar_t) * (length + 1));
+    layout->key = NULL;
+    
+    if (s_BuildLayout(layout, fontData, fontHandle, layout->string,
+                      (float)(exRateX * fontData->exRateX),
+                      (float)(exRateY * fontData->exRateY)) < 0
+    ) {
+        DXFREE(layout->string);
+        PL_Handle_ReleaseID(layoutHandle, DXTRUE);
+        return -1;
+    }
+    
+    return layoutHandle;
+}
+
+int Dx_Font_EXTCreateTextLayoutA(const char *string, int fontHandle,
+                                 double exRateX, double exRateY) {
+    FontData *fontData = s_GetFontData(fontHandle);
+    wchar_t *wideString;
+    int wideLength;
+    int retval;
+    
+    if (fontData == NULL || string == NULL) {
+        return -1;
+    }
+    
+    wideLength = PL_Text_Strlen(string) + 1;
+    wideString = (wchar_t *)DXALLOC(sizeof(wchar_t) * wideLength);
+    if (wideString == NULL) {
+        return -1;
+    }
+    
+    PL_Text_StringToWideChar(wideString, string, fontData->charset, wideLength);
+    
+    retval = Dx_Font_EXTCreateTextLayoutW(wideString, fontHandle, exRateX, exRateY);
+    
+    DXFREE(wideString);
+    
+    return retval;
+}
+
+/* Draws a layout handle. If its font has changed since, the layout is
+ * redone first. If the font was deleted, it fails, even when a new font
+ * has been given the same handle. */
+int Dx_Font_EXTDrawTextLayout(int x, int y, int layoutHandle,
+                              DXCOLOR color, DXCOLOR edgeColor) {
+    TextLayout *layout = s_GetLayoutData(layoutHandle);
+    FontData *fontData;
+    
+    if (layout == NULL) {
+        return -1;
+    }
+    
+    fontData = s_GetFontData(layout->fontHandle);
+    if (fontData == NULL || fontData->generation != layout->fontGeneration) {
+        return -1;
+    }
+    
+    if (fontData->serial != layout->fontSerial) {
+        s_FreeLayoutData(layout);
+        if (s_BuildLayout(layout, fontData, layout->fontHandle, layout->string,
+                          layout->scaleX, layout->scaleY) < 0
+        ) {
+            return -1;
+        }
+    }
+    
+    return s_DrawLayout(layout, x, y, color, edgeColor);
+}
+
+int Dx_Font_EXTDeleteTextLayout(int layoutHandle) {
+    TextLayout *layout = s_GetLayoutData(layoutHandle);
+    if (layout == NULL) {
+        return -1;
+    }
+    
+    s_FreeLayoutData(layout);
+    DXFREE(layout->string);
+    
+    PL_Handle_ReleaseID(layoutHandle, DXTRUE);
+    
+    return 0;
+}
+
+/* Sets how many layouts DrawString keeps around. 0 turns it off. */
+int Dx_Font_EXTSetTextLayoutCacheSize(int layoutCount) {
+    if (layoutCount < 0) {
+        layoutCount = 0;
+    }
+    
+    s_layoutCacheSize = layoutCount;
+    s_TrimLayoutCache(layoutCount);
+    
+    return 0;
+}
+
 int Dx_Font_SetFontLostFlag(int fontHandle, int *lostFlag) {
     return PL_Handle_SetDeleteFlag(fontHandle, lostFlag);
 }
 
 int Dx_Font_CheckFontHandleValid(int fontHandle) {
-    FontData *fontData = s_GetFontData(fontHandle);
+    FontData *fontData = (FontData *)PL_Handle_GetData(fontHandle, DXHANDLE_FONT);
     if (fontData == NULL) {
         return -1;
     }
@@ -1275,11 +2388,20 @@ int Dx_Font_GetFontCacheUsePremulAlphaFlag() {
 }
 
 void Dx_Font_Init() {
-    /* Do nothing */
+    /* Glyphs can be drawn on worker threads, so pick the edge kernels
+     * now rather than on first use. */
+    FontEdge_Kernel_SetLevel(-1);
 }
 
 void Dx_Font_End() {
+    int handle;
+    
+    while ((handle = PL_Handle_GetFirstIDOf(DXHANDLE_TEXTLAYOUT)) >= 0) {
+        Dx_Font_EXTDeleteTextLayout(handle);
+    }
+    
     Dx_Font_InitFontToHandle();
+    s_TrimLayoutCache(0);
     
     PLEXT_Font_InitFontMappings();
     
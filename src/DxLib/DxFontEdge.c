@@ -0,0 +1,417 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+    
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "DPLBuildConfig.h"
+#include "DxDefines.h"
+
+#ifdef DXPORTLIB_DXLIB_INTERFACE
+#ifndef DX_NON_FONT
+
+#include "PL/PLInternal.h"
+#include "DxInternal.h"
+
+#include "SDL.h"
+
+/* Font edges are a max filter over the glyph's pixels.
+ *
+ * Edges used to be drawn by stamping a small round pattern around every
+ * opaque pixel. Each pattern is symmetric, and each of its rows is one
+ * run centered on the middle column, so the same result comes from a
+ * horizontal max over each row (of a width that depends on the row)
+ * followed by a vertical max over those.
+ *
+ * The stamping had one quirk that is kept: an opaque pixel was first
+ * overwritten with its own value, so it only kept what was stamped on
+ * it by pixels after it, in reading order. For edge size 1 it was
+ * set to solid white instead.
+ *
+ * Only pixels with some alpha count, and values are compared whole,
+ * exactly as before.
+ *
+ * The row operations have plain C, SSE2, AVX2 and NEON versions, picked
+ * at runtime where that is needed. All of them give identical output.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define FONTEDGE_KERNELS_X86
+#  define FONTEDGE_TARGET(x) __attribute__((target(x)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  define FONTEDGE_KERNELS_X86
+#  define FONTEDGE_TARGET(x)
+#endif
+
+#ifdef FONTEDGE_KERNELS_X86
+#  include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define FONTEDGE_KERNELS_NEON
+#  include <arm_neon.h>
+#endif
+
+/* Half the run length of each pattern row, from the middle row out. */
+static const int s_edgeRowRadius[FONTEDGE_MAX_SIZE][FONTEDGE_MAX_SIZE + 1] = {
+    { 1, 0 },
+    { 2, 2, 1 },
+    { 3, 2, 2, 0 },
+    { 4, 4, 4, 3, 2 }
+};
+
+/* dest[i] = max(src[i - 1], src[i], src[i + 1]) */
+typedef void (*FontEdgeMax3Function)(const unsigned int *src, unsigned int *dest, int count);
+/* dest[i] = max(dest[i], src[i]) */
+typedef void (*FontEdgeMaxFunction)(const unsigned int *src, unsigned int *dest, int count);
+/* dest[i] = (key[i] == 0) ? a[i] : b[i] */
+typedef void (*FontEdgeSelectFunction)(const unsigned int *key, const unsigned int *a,
+                                       const unsigned int *b, unsigned int *dest, int count);
+
+static FontEdgeMax3Function s_max3Function = NULL;
+static FontEdgeMaxFunction s_maxFunction = NULL;
+static FontEdgeSelectFunction s_selectFunction = NULL;
+
+/* ------------------------------------------------------------ SCALAR */
+
+static DXINLINE unsigned int FontEdge_Max(unsigned int a, unsigned int b) {
+    return (a > b) ? a : b;
+}
+
+static void FontEdge_Max3_Scalar(const unsigned int *src, unsigned int *dest, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        dest[i] = FontEdge_Max(FontEdge_Max(src[i - 1], src[i]), src[i + 1]);
+    }
+}
+
+static void FontEdge_Max_Scalar(const unsigned int *src, unsigned int *dest, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        dest[i] = FontEdge_Max(dest[i], src[i]);
+    }
+}
+
+static void FontEdge_Select_Scalar(const unsigned int *key, const unsigned int *a,
+                                   const unsigned int *b, unsigned int *dest, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        dest[i] = (key[i] == 0) ? a[i] : b[i];
+    }
+}
+
+#ifdef FONTEDGE_KERNELS_X86
+/* ------------------------------------------------------------ SSE2 */
+
+/* SSE2 only has signed compares, so flip the top bit first. */
+FONTEDGE_TARGET("sse2")
+static DXINLINE __m128i FontEdge_MaxU32_SSE2(__m128i a, __m128i b) {
+    const __m128i bias = _mm_set1_epi32((int)0x80000000);
+    __m128i gt = _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+    return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+FONTEDGE_TARGET("sse2")
+static void FontEdge_Max3_SSE2(const unsigned int *src, unsigned int *dest, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i l = _mm_loadu_si128((const __m128i *)(src + i - 1));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i r = _mm_loadu_si128((const __m128i *)(src + i + 1));
+        _mm_storeu_si128((__m128i *)(dest + i),
+                         FontEdge_MaxU32_SSE2(FontEdge_MaxU32_SSE2(l, c), r));
+    }
+    FontEdge_Max3_Scalar(src + i, dest + i, count - i);
+}
+
+FONTEDGE_TARGET("sse2")
+static void FontEdge_Max_SSE2(const unsigned int *src, unsigned int *dest, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(dest + i));
+        _mm_storeu_si128((__m128i *)(dest + i), FontEdge_MaxU32_SSE2(a, b));
+    }
+    FontEdge_Max_Scalar(src + i, dest + i, count - i);
+}
+
+FONTEDGE_TARGET("sse2")
+static void FontEdge_Select_SSE2(const unsigned int *key, const unsigned int *a,
+                                 const unsigned int *b, unsigned int *dest, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i k = _mm_loadu_si128((const __m128i *)(key + i));
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128i isZero = _mm_cmpeq_epi32(k, zero);
+        _mm_storeu_si128((__m128i *)(dest + i),
+                         _mm_or_si128(_mm_and_si128(isZero, va), _mm_andnot_si128(isZero, vb)));
+    }
+    FontEdge_Select_Scalar(key + i, a + i, b + i, dest + i, count - i);
+}
+
+/* ------------------------------------------------------------ AVX2 */
+
+FONTEDGE_TARGET("avx2")
+static void FontEdge_Max3_AVX2(const unsigned int *src, unsigned int *dest, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i l = _mm256_loadu_si256((const __m256i *)(src + i - 1));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i r = _mm256_loadu_si256((const __m256i *)(src + i + 1));
+        _mm256_storeu_si256((__m256i *)(dest + i),
+                            _mm256_max_epu32(_mm256_max_epu32(l, c), r));
+    }
+    FontEdge_Max3_Scalar(src + i, dest + i, count - i);
+}
+
+FONTEDGE_TARGET("avx2")
+static void FontEdge_Max_AVX2(const unsigned int *src, unsigned int *dest, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(dest + i));
+        _mm256_storeu_si256((__m256i *)(dest + i), _mm256_max_epu32(a, b));
+    }
+    FontEdge_Max_Scalar(src + i, dest + i, count - i);
+}
+
+FONTEDGE_TARGET("avx2")
+static void FontEdge_Select_AVX2(const unsigned int *key, const unsigned int *a,
+                                 const unsigned int *b, unsigned int *dest, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i k = _mm256_loadu_si256((const __m256i *)(key + i));
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i isZero = _mm256_cmpeq_epi32(k, zero);
+        _mm256_storeu_si256((__m256i *)(dest + i), _mm256_blendv_epi8(vb, va, isZero));
+    }
+    FontEdge_Select_Scalar(key + i, a + i, b + i, dest + i, count - i);
+}
+#endif /* #ifdef FONTEDGE_KERNELS_X86 */
+
+#ifdef FONTEDGE_KERNELS_NEON
+/* ------------------------------------------------------------ NEON */
+
+static void FontEdge_Max3_NEON(const unsigned int *src, unsigned int *dest, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32x4_t l = vld1q_u32(src + i - 1);
+        uint32x4_t c = vld1q_u32(src + i);
+        uint32x4_t r = vld1q_u32(src + i + 1);
+        vst1q_u32(dest + i, vmaxq_u32(vmaxq_u32(l, c), r));
+    }
+    FontEdge_Max3_Scalar(src + i, dest + i, count - i);
+}
+
+static void FontEdge_Max_NEON(const unsigned int *src, unsigned int *dest, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_u32(dest + i, vmaxq_u32(vld1q_u32(src + i), vld1q_u32(dest + i)));
+    }
+    FontEdge_Max_Scalar(src + i, dest + i, count - i);
+}
+
+static void FontEdge_Select_NEON(const unsigned int *key, const unsigned int *a,
+                                 const unsigned int *b, unsigned int *dest, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32x4_t isZero = vceqq_u32(vld1q_u32(key + i), vdupq_n_u32(0));
+        vst1q_u32(dest + i, vbslq_u32(isZero, vld1q_u32(a + i), vld1q_u32(b + i)));
+    }
+    FontEdge_Select_Scalar(key + i, a + i, b + i, dest + i, count - i);
+}
+#endif /* #ifdef FONTEDGE_KERNELS_NEON */
+
+/* ------------------------------------------------------------ DISPATCH */
+
+static int FontEdge_GetBestKernelLevel() {
+#ifdef FONTEDGE_KERNELS_X86
+#  if SDL_VERSION_ATLEAST(2, 0, 4)
+    if (SDL_HasAVX2()) {
+        return FONTEDGE_KERNEL_AVX2;
+    }
+#  endif
+    if (SDL_HasSSE2()) {
+        return FONTEDGE_KERNEL_SSE2;
+    }
+#endif
+#ifdef FONTEDGE_KERNELS_NEON
+    return FONTEDGE_KERNEL_NEON;
+#endif
+    return FONTEDGE_KERNEL_SCALAR;
+}
+
+/* Picks which versions to use. level is one of the FONTEDGE_KERNEL_
+ * values, or -1 for the best available; anything the CPU can't run is
+ * lowered. Returns the level in use.
+ *
+ * Edges are drawn on worker threads as well, so call this from the main
+ * thread before any are drawn.
+ */
+int FontEdge_Kernel_SetLevel(int level) {
+    int bestLevel = FontEdge_GetBestKernelLevel();
+    
+    if (level < 0 || level > bestLevel) {
+        level = bestLevel;
+    }
+    
+    switch(level) {
+#ifdef FONTEDGE_KERNELS_NEON
+        case FONTEDGE_KERNEL_NEON:
+            s_max3Function = FontEdge_Max3_NEON;
+            s_maxFunction = FontEdge_Max_NEON;
+            s_selectFunction = FontEdge_Select_NEON;
+            break;
+#endif
+#ifdef FONTEDGE_KERNELS_X86
+        case FONTEDGE_KERNEL_AVX2:
+            s_max3Function = FontEdge_Max3_AVX2;
+            s_maxFunction = FontEdge_Max_AVX2;
+            s_selectFunction = FontEdge_Select_AVX2;
+            break;
+        case FONTEDGE_KERNEL_SSE2:
+            s_max3Function = FontEdge_Max3_SSE2;
+            s_maxFunction = FontEdge_Max_SSE2;
+            s_selectFunction = FontEdge_Select_SSE2;
+            break;
+#endif
+        default:
+            level = FONTEDGE_KERNEL_SCALAR;
+            s_max3Function = FontEdge_Max3_Scalar;
+            s_maxFunction = FontEdge_Max_Scalar;
+            s_selectFunction = FontEdge_Select_Scalar;
+            break;
+    }
+    
+    return level;
+}
+
+/* ------------------------------------------------------------ FILTER */
+
+/* Draws the edge mask of a w*h glyph into dest, which is edgeSize
+ * larger on every side and must start out cleared. Edge sizes outside
+ * 1 to FONTEDGE_MAX_SIZE leave dest as it is.
+ *
+ * Returns -1 if there was no memory for it.
+ */
+int FontEdge_Draw(const unsigned int *src, int srcPitch, int w, int h,
+                  int edgeSize, unsigned int *dest, int destPitch) {
+    const int *rowRadius;
+    unsigned int *block;
+    unsigned int *rowMax[FONTEDGE_MAX_SIZE + 1];
+    unsigned int *rightMax, *fullMax, *halfMax;
+    int width, height, stride;
+    int x, y, r, dy;
+    
+    if (edgeSize < 1 || edgeSize > FONTEDGE_MAX_SIZE || w <= 0 || h <= 0) {
+        return 0;
+    }
+    
+    rowRadius = s_edgeRowRadius[edgeSize - 1];
+    width = w + edgeSize + edgeSize;
+    height = h + edgeSize + edgeSize;
+    
+    /* Each row has edgeSize columns of zeroes on either side, so the
+     * horizontal passes never need to check their bounds. */
+    stride = width + edgeSize + edgeSize;
+    
+    block = (unsigned int *)DXCALLOC(sizeof(unsigned int) *
+                                     ((size_t)stride * height * (edgeSize + 1) + (size_t)width * 3));
+    if (block == NULL) {
+        return -1;
+    }
+    for (r = 0; r <= edgeSize; ++r) {
+        rowMax[r] = block + ((size_t)stride * height * r) + edgeSize;
+    }
+    rightMax = block + ((size_t)stride * height * (edgeSize + 1));
+    fullMax = rightMax + width;
+    halfMax = fullMax + width;
+    
+    /* - rowMax[0] is the glyph itself, with transparent pixels zeroed. */
+    for (y = 0; y < h; ++y) {
+        const unsigned int *srcRow = src + ((size_t)srcPitch * y);
+        unsigned int *row = rowMax[0] + ((size_t)stride * (y + edgeSize)) + edgeSize;
+        for (x = 0; x < w; ++x) {
+            unsigned int value = srcRow[x];
+            row[x] = (value > 0xffffff) ? value : 0;
+        }
+    }
+    
+    /* - rowMax[r] is the max over 2r+1 columns, built up one column on
+     *   each side at a time. The zero columns take care of the edges. */
+    for (r = 1; r <= edgeSize; ++r) {
+        for (y = 0; y < height; ++y) {
+            size_t offset = (size_t)stride * y;
+            s_max3Function(rowMax[r - 1] + offset - (edgeSize - r),
+                           rowMax[r] + offset - (edgeSize - r),
+                           width + ((edgeSize - r) * 2));
+        }
+    }
+    
+    /* - Each output row is the max of the pattern's rows around it. */
+    for (y = 0; y < height; ++y) {
+        const unsigned int *center = rowMax[0] + ((size_t)stride * y);
+        unsigned int *destRow = dest + ((size_t)destPitch * y);
+        
+        /* Rows below first, as they count for both kinds of pixel. */
+        SDL_memset(halfMax, 0, sizeof(unsigned int) * width);
+        for (dy = 1; dy <= edgeSize; ++dy) {
+            if ((y + dy) < height) {
+                s_maxFunction(rowMax[rowRadius[dy]] + ((size_t)stride * (y + dy)),
+                              halfMax, width);
+            }
+        }
+        
+        /* Transparent pixels take everything around them. */
+        SDL_memcpy(fullMax, halfMax, sizeof(unsigned int) * width);
+        s_maxFunction(rowMax[rowRadius[0]] + ((size_t)stride * y), fullMax, width);
+        for (dy = 1; dy <= edgeSize; ++dy) {
+            if ((y - dy) >= 0) {
+                s_maxFunction(rowMax[rowRadius[dy]] + ((size_t)stride * (y - dy)),
+                              fullMax, width);
+            }
+        }
+        
+        /* Opaque pixels keep themselves, and only what comes after. */
+        if (edgeSize == 1) {
+            for (x = 0; x < width; ++x) {
+                halfMax[x] = 0xffffffff;
+            }
+        } else {
+            s_maxFunction(center, halfMax, width);
+            SDL_memcpy(rightMax, center + 1, sizeof(unsigned int) * width);
+            for (r = 2; r <= rowRadius[0]; ++r) {
+                s_maxFunction(center + r, rightMax, width);
+            }
+            s_maxFunction(rightMax, halfMax, width);
+        }
+        
+        s_selectFunction(center, fullMax, halfMax, destRow, width);
+    }
+    
+    DXFREE(block);
+    
+    return 0;
+}
+
+#endif /* #ifndef DX_NON_FONT */
+#endif /* #ifdef DXPORTLIB_DXLIB_INTERFACE */
@@ -41,6 +41,7 @@ typedef struct Graph {
     PLRect rect;
     
     int textureRefID;
+    int atlasSlotID;
     
     int prevLinkedGraphID;
     int nextLinkedGraphID;
@@ -50,6 +51,13 @@ static Graph *s_GetGraph(int graphID) {
     return (Graph *)PL_Handle_GetData(graphID, DXHANDLE_GRAPH);
 }
 
+/* For anything that needs the image itself. If the graph is still
+ * being loaded in the background, this finishes loading it first. */
+static Graph *s_GetLoadedGraph(int graphID) {
+    PL_Async_WaitHandle(graphID);
+    return s_GetGraph(graphID);
+}
+
 static int s_AllocateGraphID(int textureRefID, PLRect rect, int linkToGraphID) {
     int graphID;
     Graph *graph, *linkedGraph;
@@ -63,6 +71,7 @@ static int s_AllocateGraphID(int textureRefID, PLRect rect, int linkToGraphID) {
     
     graph = (Graph *)PL_Handle_AllocateData(graphID, sizeof(Graph));
     graph->textureRefID = textureRefID;
+    graph->atlasSlotID = -1;
     graph->rect = rect;
     
     if (linkToGraphID < 0 || (linkedGraph = s_GetGraph(linkToGraphID)) == NULL) {
@@ -83,15 +92,48 @@ static int s_AllocateGraphID(int textureRefID, PLRect rect, int linkToGraphID) {
     return graphID;
 }
 
-int Dx_Graph_CreateFromSurface(int surfaceID) {
+/* Places rect of the surface (or all of it) into the graph atlas.
+ * Fails if the atlas is disabled or the image is too large for it. */
+static int s_CreateAtlasGraph(int surfaceID, const PLRect *srcRect, int linkToGraphID) {
     int textureRefID;
+    int slotID;
     int graphID;
     PLRect rect;
-    int hasAlphaChannel = PL_Surface_HasTransparency(surfaceID);
     
-    if (hasAlphaChannel != DXFALSE && s_applyPMA != DXFALSE) {
+    slotID = Dx_Atlas_Insert(surfaceID, srcRect, &textureRefID, &rect);
+    if (slotID < 0) {
+        return -1;
+    }
+    
+    graphID = s_AllocateGraphID(textureRefID, rect, linkToGraphID);
+    if (graphID < 0) {
+        Dx_Atlas_Release(slotID);
+        return -1;
+    }
+    
+    s_GetGraph(graphID)->atlasSlotID = slotID;
+    
+    return graphID;
+}
+
+static void s_ApplyPMA(int surfaceID) {
+    if (s_applyPMA != DXFALSE && PL_Surface_HasTransparency(surfaceID) != DXFALSE) {
         PL_Surface_ApplyPMAToSurface(surfaceID);
     }
+}
+
+int Dx_Graph_CreateFromSurface(int surfaceID) {
+    int textureRefID;
+    int graphID;
+    PLRect rect;
+    
+    s_ApplyPMA(surfaceID);
+    
+    /* Small images share a texture, if the atlas is enabled. */
+    graphID = s_CreateAtlasGraph(surfaceID, NULL, -1);
+    if (graphID >= 0) {
+        return graphID;
+    }
     
     textureRefID = PL_Surface_ToTexture(surfaceID);
     if (textureRefID < 0) {
@@ -159,27 +201,243 @@ int Dx_Graph_MakeScreen(int width, int height, int hasAlphaChannel) {
     return graphID;
 }
 
-int Dx_Graph_Load(const char *filename, int flipFlag) {
-    int surfaceID = PL_Surface_Load(filename);
-    int graphID;
+/* ------------------------------------------------------------ LOADING */
+/* Loading is split in two. The first half reads and decodes the file
+ * into a surface, and can run on a loader thread. The second half
+ * uploads the surface and fills in the graphs, and always runs on the
+ * main thread.
+ *
+ * The graph handles are created up front with no texture, so they can
+ * be handed back right away when loading asynchronously.
+ */
+typedef struct GraphLoadJob {
+    char *filename;
+    int flipFlag;
+    int useTransparency;
+    unsigned int transparentColor;
+    int applyPMA;
+    
+    int surfaceID;
+    
+    int xCount, xSize, ySize;
+    int graphCount;
+    int graphIDs[1];
+} GraphLoadJob;
+
+static int s_GraphLoadWork(void *userdata) {
+    GraphLoadJob *job = (GraphLoadJob *)userdata;
+    int surfaceID = PL_Surface_Load(job->filename);
     
     if (surfaceID < 0) {
         return -1;
     }
     
-    PL_Surface_HasTransparency(surfaceID);
-    
-    if (s_useTransparency) {
-        PL_Surface_ApplyTransparentColor(surfaceID, s_transparentColor);
+    if (job->useTransparency) {
+        PL_Surface_ApplyTransparentColor(surfaceID, job->transparentColor);
     }
     
-    if (flipFlag) {
+    if (job->flipFlag) {
         PL_Surface_FlipSurface(surfaceID);
     }
     
-    graphID = Dx_Graph_CreateFromSurface(surfaceID);
+    if (job->applyPMA != DXFALSE && PL_Surface_HasTransparency(surfaceID) != DXFALSE) {
+        PL_Surface_ApplyPMAToSurface(surfaceID);
+    }
+    
+    job->surfaceID = surfaceID;
+    
+    return 0;
+}
+
+/* Cells are laid out the same as DerivationGraph would, clipped to
+ * the edges of the image. */
+static void s_GetCellRect(GraphLoadJob *job, int n, PLRect *rect) {
+    int w, h;
+    
+    PL_Surface_GetSize(job->surfaceID, &w, &h);
+    
+    if (job->xCount <= 0) {
+        rect->x = 0;
+        rect->y = 0;
+        rect->w = w;
+        rect->h = h;
+        return;
+    }
+    
+    rect->x = (n % job->xCount) * job->xSize;
+    rect->y = (n / job->xCount) * job->ySize;
+    rect->w = job->xSize;
+    rect->h = job->ySize;
+    if ((rect->x + rect->w) > w) {
+        rect->w = w - rect->x;
+    }
+    if ((rect->y + rect->h) > h) {
+        rect->h = h - rect->y;
+    }
+}
+
+static void s_AttachTexture(Graph *graph, int textureRefID, const PLRect *rect) {
+    PLG.Texture_AddRef(textureRefID);
+    graph->textureRefID = textureRefID;
+    graph->rect = *rect;
+}
+
+static void s_DetachTexture(Graph *graph) {
+    PLG.Texture_Release(graph->textureRefID);
+    if (graph->atlasSlotID >= 0) {
+        Dx_Atlas_Release(graph->atlasSlotID);
+    }
+    graph->textureRefID = -1;
+    graph->atlasSlotID = -1;
+}
+
+/* Each cell goes into the atlas separately, so every one gets its own
+ * border. Gives up and cleans up if any of them doesn't fit. */
+static int s_FinishGraphsToAtlas(GraphLoadJob *job) {
+    int n, i;
+    
+    for (n = 0; n < job->graphCount; ++n) {
+        Graph *graph = s_GetGraph(job->graphIDs[n]);
+        int textureRefID;
+        PLRect srcRect, rect;
+        int slotID;
+        
+        s_GetCellRect(job, n, &srcRect);
+        slotID = Dx_Atlas_Insert(job->surfaceID, &srcRect, &textureRefID, &rect);
+        if (slotID < 0) {
+            for (i = 0; i < n; ++i) {
+                s_DetachTexture(s_GetGraph(job->graphIDs[i]));
+            }
+            return -1;
+        }
+        
+        s_AttachTexture(graph, textureRefID, &rect);
+        graph->atlasSlotID = slotID;
+    }
+    
+    return 0;
+}
+
+static int s_FinishGraphs(GraphLoadJob *job) {
+    int textureRefID;
+    PLRect rect;
+    int n;
+    
+    s_GetCellRect(job, 0, &rect);
+    if (Dx_Atlas_CanInsert(rect.w, rect.h) != DXFALSE
+        && s_FinishGraphsToAtlas(job) == 0
+    ) {
+        return 0;
+    }
+    
+    textureRefID = PL_Surface_ToTexture(job->surfaceID);
+    if (textureRefID < 0) {
+        return -1;
+    }
+    
+    for (n = 0; n < job->graphCount; ++n) {
+        s_GetCellRect(job, n, &rect);
+        s_AttachTexture(s_GetGraph(job->graphIDs[n]), textureRefID, &rect);
+    }
+    
+    return 0;
+}
+
+static void s_GraphLoadFinish(void *userdata, int workResult) {
+    GraphLoadJob *job = (GraphLoadJob *)userdata;
+    int n;
+    
+    for (n = 0; n < job->graphCount; ++n) {
+        PL_Handle_SetASyncJob(job->graphIDs[n], -1);
+    }
     
-    PL_Surface_Delete(surfaceID);
+    if (workResult < 0 || s_FinishGraphs(job) < 0) {
+        for (n = 0; n < job->graphCount; ++n) {
+            Dx_Graph_Delete(job->graphIDs[n]);
+        }
+    }
+    
+    if (job->surfaceID >= 0) {
+        PL_Surface_Delete(job->surfaceID);
+    }
+    DXFREE(job->filename);
+    DXFREE(job);
+}
+
+/* Creates graphCount linked, empty graphs and loads the file into them,
+ * on a loader thread if SetUseASyncLoadFlag is set.
+ * An xCount of 0 means a single graph covering the whole image. */
+static int s_LoadGraphs(const char *filename, int flipFlag, int graphCount,
+                        int xCount, int xSize, int ySize, int *handleBuf) {
+    GraphLoadJob *job;
+    PLRect emptyRect = { 0, 0, 0, 0 };
+    int graphID = -1;
+    int jobID;
+    int n;
+    
+    if (filename == NULL || graphCount <= 0) {
+        return -1;
+    }
+    
+    job = (GraphLoadJob *)DXALLOC(sizeof(GraphLoadJob) + (sizeof(int) * (graphCount - 1)));
+    job->filename = PL_Text_Strdup(filename);
+    job->flipFlag = flipFlag;
+    job->useTransparency = s_useTransparency;
+    job->transparentColor = s_transparentColor;
+    job->applyPMA = s_applyPMA;
+    job->surfaceID = -1;
+    job->xCount = xCount;
+    job->xSize = xSize;
+    job->ySize = ySize;
+    job->graphCount = 0;
+    
+    for (n = 0; n < graphCount; ++n) {
+        graphID = s_AllocateGraphID(-1, emptyRect, graphID);
+        if (graphID < 0) {
+            break;
+        }
+        job->graphIDs[n] = graphID;
+        handleBuf[n] = graphID;
+        job->graphCount += 1;
+    }
+    
+    if (graphID < 0) {
+        s_GraphLoadFinish(job, -1);
+        return -1;
+    }
+    
+    if (PL_Async_GetUseASyncLoadFlag() == DXFALSE) {
+        s_GraphLoadFinish(job, s_GraphLoadWork(job));
+    } else {
+        PL_Surface_PrepareThreadedLoad();
+        
+        /* Nothing can finish the job before we return, unless it was
+         * run immediately. */
+        jobID = PL_Async_Submit(s_GraphLoadWork, s_GraphLoadFinish, job);
+        if (jobID >= 0) {
+            for (n = 0; n < graphCount; ++n) {
+                PL_Handle_SetASyncJob(handleBuf[n], jobID);
+            }
+        }
+    }
+    
+    /* On failure, the graphs have already been deleted. */
+    if (s_GetGraph(handleBuf[0]) == NULL) {
+        for (n = 0; n < graphCount; ++n) {
+            handleBuf[n] = -1;
+        }
+        return -1;
+    }
+    
+    return 0;
+}
+
+int Dx_Graph_Load(const char *filename, int flipFlag) {
+    int graphID;
+    
+    if (s_LoadGraphs(filename, flipFlag, 1, 0, 0, 0, &graphID) < 0) {
+        return -1;
+    }
     
     return graphID;
 }
@@ -192,7 +450,7 @@ int Dx_Graph_FromTexture(int textureRefID, PLRect rect) {
 
 int Dx_Graph_Delete(int graphID) {
     /* Fetch the graph entry, if available. */
-    Graph *graph = s_GetGraph(graphID);
+    Graph *graph = s_GetLoadedGraph(graphID);
     Graph *relGraph;
     if (graph == NULL) {
         return -1;
@@ -209,6 +467,9 @@ int Dx_Graph_Delete(int graphID) {
     }
     
     PLG.Texture_Release(graph->textureRefID);
+    if (graph->atlasSlotID >= 0) {
+        Dx_Atlas_Release(graph->atlasSlotID);
+    }
     
     PL_Handle_ReleaseID(graphID, DXTRUE);
     
@@ -218,7 +479,7 @@ int Dx_Graph_Delete(int graphID) {
 }
 
 int Dx_Graph_DeleteSharingGraph(int graphID) {
-    Graph *graph = s_GetGraph(graphID);
+    Graph *graph = s_GetLoadedGraph(graphID);
     int prevID, nextID, tempID;
     if (graph == NULL) {
         return -1;
@@ -246,7 +507,7 @@ int Dx_Graph_GetNum() {
 }
 
 int Dx_Graph_GetSize(int graphID, int *w, int *h) {
-    Graph *graph = s_GetGraph(graphID);
+    Graph *graph = s_GetLoadedGraph(graphID);
     if (graph == NULL) {
         return -1;
     }
@@ -260,8 +521,9 @@ int Dx_Graph_GetSize(int graphID, int *w, int *h) {
 int Dx_Graph_Derivation(int x, int y, int w, int h, int srcGraphID) {
     Graph *srcGraph;
     PLRect rect;
+    int graphID;
     
-    srcGraph = s_GetGraph(srcGraphID);
+    srcGraph = s_GetLoadedGraph(srcGraphID);
     if (srcGraph == NULL) {
         return -1;
     }
@@ -281,34 +543,39 @@ int Dx_Graph_Derivation(int x, int y, int w, int h, int srcGraphID) {
         rect.h = h;
     }
     
-    return s_AllocateGraphID(srcGraph->textureRefID, rect, srcGraphID);
+    graphID = s_AllocateGraphID(srcGraph->textureRefID, rect, srcGraphID);
+    if (graphID >= 0 && srcGraph->atlasSlotID >= 0) {
+        s_GetGraph(graphID)->atlasSlotID = srcGraph->atlasSlotID;
+        Dx_Atlas_AddRef(srcGraph->atlasSlotID);
+    }
+    
+    return graphID;
 }
 
 int Dx_Graph_LoadDiv(const char *filename, int graphCount,
                      int xCount, int yCount, int xSize, int ySize,
                      int *handleBuf, int textureFlag, int flipFlag) {
-    int graphID = Dx_Graph_Load(filename, flipFlag);
-    int x, y, n;
-    
-    if (graphID < 0) {
+    if (xCount <= 0 || yCount <= 0) {
         return -1;
     }
-    
-    n = 0;
-    for (y = 0; y < yCount; ++y) {
-        for (x = 0; x < xCount && n < graphCount; ++x, ++n) {
-            handleBuf[n] = Dx_Graph_Derivation(x * xSize, y * ySize,
-                                               xSize, ySize, graphID);
-        }
+    if (graphCount > (xCount * yCount)) {
+        graphCount = xCount * yCount;
     }
     
-    Dx_Graph_Delete(graphID);
-    
-    return 0;
+    return s_LoadGraphs(filename, flipFlag, graphCount,
+                        xCount, xSize, ySize, handleBuf);
 }
 
 int Dx_Graph_SetWrap(int graphID, int wrapState) {
-    int textureID = Dx_Graph_GetTextureID(graphID, NULL);
+    Graph *graph = s_GetLoadedGraph(graphID);
+    int textureID;
+    
+    /* Other graphs share the same texture. */
+    if (graph == NULL || graph->atlasSlotID >= 0) {
+        return -1;
+    }
+    
+    textureID = graph->textureRefID;
     
     PLG.Texture_SetWrap(textureID, wrapState);
     
@@ -345,22 +612,29 @@ int Dx_Graph_SetUsePremulAlphaConvertLoad(int flag) {
     return 0;
 }
 
+int Dx_Graph_SetUseAtlas(int flag, int maxGraphSize, int pageSize) {
+    return Dx_Atlas_SetParams(flag, maxGraphSize, pageSize);
+}
+
 int Dx_Graph_ResetSettings() {
     s_transparentColor = 0x000000;
     s_useTransparency = DXTRUE;
     s_applyPMA = DXFALSE;
     
+    Dx_Atlas_ResetSettings();
+    
     return 0;
 }
 
 void Dx_Graph_End() {
     Dx_Graph_InitGraph();
+    Dx_Atlas_End();
     
     /* That should clear all texture refs. If they're not 0, we have a bug. */
 }
 
 int Dx_Graph_GetTextureID(int graphID, PLRect *rect) {
-    Graph *graph = s_GetGraph(graphID);
+    Graph *graph = s_GetLoadedGraph(graphID);
     if (graph == NULL) {
         return -1;
     }
@@ -373,7 +647,7 @@ int Dx_Graph_GetTextureID(int graphID, PLRect *rect) {
 }
 
 int Dx_Graph_GetTextureInfo(int graphID, int *dTextureRefID, PLRect *rect, float *xMult, float *yMult) {
-    Graph *graph = s_GetGraph(graphID);
+    Graph *graph = s_GetLoadedGraph(graphID);
     if (graph == NULL) {
         return -1;
     }
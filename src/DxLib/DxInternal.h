@@ -52,6 +52,8 @@ extern int Dx_File_SetDXArchiveExtension(const char *extension);
 extern int Dx_File_SetUseDXArchiveFlag(int flag);
 extern int Dx_File_GetUseDXArchiveFlag();
 extern int Dx_File_SetDXArchivePriority(int flag);
+extern int Dx_File_EXTSetDXArchiveMapFlag(int flag);
+extern int Dx_File_EXTSetDXArchiveStreamCompressedFlag(int flag);
 
 extern int Dx_File_DXArchivePreLoad(const char *dxaFilename, int async);
 extern int Dx_File_DXArchiveCheckIdle(const char *dxaFilename);
@@ -59,6 +61,7 @@ extern int Dx_File_DXArchiveRelease(const char *dxaFilename);
 extern int Dx_File_DXArchiveCheckFile(const char *dxaFilename, const char *filename);
 
 extern int PLEXT_FileRead_SetCharSet(int charset);
+extern int PLEXT_FileRead_SetBufferSize(int bufferSize);
 
 extern int Dx_FileRead_open(const char *filename);
 extern int64_t Dx_FileRead_size(const char *filename);
@@ -95,6 +98,7 @@ typedef struct DXArchive DXArchive;
 extern void DXA_CloseArchive(DXArchive *archive);
 extern DXArchive *DXA_OpenArchive(const char *filename, const char *keyString);
 extern int DXA_PreloadArchive(DXArchive *archive);
+extern int DXA_MapArchive(DXArchive *archive);
 
 extern void DXA_SetArchiveKey(DXArchive *archive, const char *keystring);
 extern void DXA_SetArchiveKeyRaw(DXArchive *archive, const unsigned char *key);
@@ -102,7 +106,7 @@ extern void DXA_SetArchiveKeyRaw(DXArchive *archive, const unsigned char *key);
 extern int DXA_ReadFile(DXArchive *archive, const char *filename, unsigned char **dDest, unsigned int *dSize);
 extern int DXA_TestFile(DXArchive *archive, const char *filename);
 
-extern SDL_RWops *DXA_OpenStream(DXArchive *archive, const char *filename);
+extern SDL_RWops *DXA_OpenStream(DXArchive *archive, const char *filename, int streamCompressed);
 
 struct DXAFindData;
 typedef struct DXAFindData DXAFindData;
@@ -111,6 +115,16 @@ DXAFindData *DXA_findFirst(DXArchive *archive, const char *filePath, FILEINFOA *
 int DXA_findNext(DXAFindData *dxaData, FILEINFOA *fileInfo);
 int DXA_findClose(DXAFindData *dxaData);
 
+/* ------------------------------------------------------ DxDXAKernels.c */
+#define DXA_KERNEL_SCALAR   0
+#define DXA_KERNEL_SSE2     1
+#define DXA_KERNEL_AVX2     2
+
+extern int DXA_Kernel_SetLevel(int level);
+extern void DXA_Kernel_Xor(const unsigned char *src, unsigned char *dest,
+                           size_t length, const unsigned char *key);
+extern void DXA_Kernel_CopyMatch(unsigned char *dest, size_t distance, size_t count);
+
 #else /* #ifndef DX_NOT_DXA */
 
 typedef int DXArchive;
@@ -124,6 +138,15 @@ extern int Dx_EXT_Draw_RectGraphFastF(
                             int sx, int sy, int sw, int sh,
                             int graphID, int blendFlag);
 
+/* A quad for Dx_Draw_RectQuadRunF: destination corners, then the
+ * source corners in pixels within the graph. */
+typedef struct DxRectQuad {
+    float x1, y1, x2, y2;
+    float sx1, sy1, sx2, sy2;
+} DxRectQuad;
+extern int Dx_Draw_RectQuadRunF(float x, float y, const DxRectQuad *quads, int quadCount,
+                                int graphID, int blendFlag);
+
 extern int Dx_Draw_Pixel(int x, int y, DXCOLOR color);
 
 extern int Dx_Draw_Line(int x1, int y1, int x2, int y2, DXCOLOR color, int thickness);
@@ -227,6 +250,7 @@ extern int Dx_Draw_SetDrawArea(int x1, int y1, int x2, int y2);
 
 extern int Dx_Draw_SetDrawMode(int drawMode);
 extern int Dx_Draw_GetDrawMode();
+extern int Dx_Draw_SetUseDrawSorting(int flag);
 extern int Dx_Draw_SetDrawBlendMode(int blendMode, int alpha);
 extern int Dx_Draw_GetDrawBlendMode(int *blendMode, int *alpha);
 extern int Dx_Draw_SetBright(int redBright, int greenBright, int blueBright);
@@ -312,6 +336,34 @@ extern void Dx_Font_End();
 
 extern int Dx_Font_SetFontCacheUsePremulAlphaFlag(int flag);
 extern int Dx_Font_GetFontCacheUsePremulAlphaFlag();
+extern int Dx_Font_EXTGetFontCacheStatsToHandle(int fontHandle, int *pageCount, int *glyphCount,
+                                                double *occupancy, int *growCount);
+
+extern int Dx_Font_EXTCreateTextLayoutA(const char *string, int fontHandle,
+                                        double exRateX, double exRateY);
+extern int Dx_Font_EXTCreateTextLayoutW(const wchar_t *string, int fontHandle,
+                                        double exRateX, double exRateY);
+extern int Dx_Font_EXTDrawTextLayout(int x, int y, int layoutHandle,
+                                     DXCOLOR color, DXCOLOR edgeColor);
+extern int Dx_Font_EXTDeleteTextLayout(int layoutHandle);
+extern int Dx_Font_EXTSetTextLayoutCacheSize(int layoutCount);
+
+extern int Dx_Font_EXTPrewarmFontA(const char *characters, int fontHandle);
+extern int Dx_Font_EXTPrewarmFontW(const wchar_t *characters, int fontHandle);
+extern int Dx_Font_EXTPrewarmFontRange(int firstCodepoint, int lastCodepoint, int fontHandle);
+extern int Dx_Font_EXTCheckFontPrewarm(int fontHandle);
+
+/* -------------------------------------------------------- DxFontEdge.c */
+#define FONTEDGE_KERNEL_SCALAR  0
+#define FONTEDGE_KERNEL_SSE2    1
+#define FONTEDGE_KERNEL_AVX2    2
+#define FONTEDGE_KERNEL_NEON    3
+
+#define FONTEDGE_MAX_SIZE       4
+
+extern int FontEdge_Kernel_SetLevel(int level);
+extern int FontEdge_Draw(const unsigned int *src, int srcPitch, int w, int h,
+                         int edgeSize, unsigned int *dest, int destPitch);
 
 /* ------------------------------------------------------------- Graph.c */
 extern int Dx_Graph_MakeGraph(int width, int height, int hasAlphaChannel);
@@ -333,6 +385,7 @@ extern int Dx_Graph_GetTransColor(int *r, int *g, int *b);
 extern int Dx_Graph_SetUseTransColor(int flag);
 
 extern int Dx_Graph_SetUsePremulAlphaConvertLoad(int flag);
+extern int Dx_Graph_SetUseAtlas(int flag, int maxGraphSize, int pageSize);
 
 extern int Dx_Graph_SetWrap(int graphID, int wrapFlag);
 
@@ -345,6 +398,17 @@ extern int Dx_Graph_GetTextureID(int graphID, PLRect *rect);
 extern int Dx_Graph_GetTextureInfo(int graphID, int *dTextureRefID,
                                    PLRect *rect, float *xMult, float *yMult);
 
+/* ------------------------------------------------------------- Atlas.c */
+extern int Dx_Atlas_CanInsert(int w, int h);
+extern int Dx_Atlas_Insert(int surfaceID, const PLRect *rect,
+                           int *dTextureRefID, PLRect *dRect);
+extern int Dx_Atlas_AddRef(int slotID);
+extern int Dx_Atlas_Release(int slotID);
+
+extern int Dx_Atlas_SetParams(int flag, int maxGraphSize, int pageSize);
+extern int Dx_Atlas_ResetSettings();
+extern void Dx_Atlas_End();
+
 #ifdef __cplusplus
 }
 #endif
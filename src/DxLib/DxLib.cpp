@@ -54,6 +54,18 @@ int ProcessMessage(void) {
 int WaitTimer(int msTime) {
     return ::DxLib_WaitTimer(msTime);
 }
+int EXT_SetFrameRate(int framesPerSecond) {
+    return ::DxLib_EXT_SetFrameRate(framesPerSecond);
+}
+int EXT_SyncFrame() {
+    return ::DxLib_EXT_SyncFrame();
+}
+int EXT_GetFrameStats(int *averageTime, int *minTime,
+                      int *maxTime, int *p99Time,
+                      int *missedCount) {
+    return ::DxLib_EXT_GetFrameStats(averageTime, minTime, maxTime,
+                                     p99Time, missedCount);
+}
 
 int WaitKey() {
     return ::DxLib_WaitKey();
@@ -97,6 +109,9 @@ void EXT_SetOnlyWindowSize(int width, int height,
 int EXT_FileRead_SetCharSet(int charset) {
     return ::DxLib_EXT_FileRead_SetCharSet(charset);
 }
+int EXT_FileRead_SetBufferSize(int bufferSize) {
+    return ::DxLib_EXT_FileRead_SetBufferSize(bufferSize);
+}
 
 int FileRead_openA(const char *filename, int ASync) {
     return ::DxLib_FileRead_openA(filename, ASync);
@@ -196,6 +211,12 @@ int SetDXArchiveExtensionA(const char *extension) {
 int SetDXArchivePriority(int priority) {
     return ::DxLib_SetDXArchivePriority(priority);
 }
+int EXT_SetDXArchiveMapFlag(int flag) {
+    return ::DxLib_EXT_SetDXArchiveMapFlag(flag);
+}
+int EXT_SetDXArchiveStreamCompressedFlag(int flag) {
+    return ::DxLib_EXT_SetDXArchiveStreamCompressedFlag(flag);
+}
 int DXArchivePreLoadA(const char *dxaFilename, int async) {
     return ::DxLib_DXArchivePreLoadA(dxaFilename, async);
 }
@@ -487,6 +508,22 @@ int SetUseTransColor(int flag) {
 int SetUsePremulAlphaConvertLoad(int flag) {
     return ::DxLib_SetUsePremulAlphaConvertLoad(flag);
 }
+int EXT_SetUseGraphAtlas(int flag, int maxGraphSize, int pageSize) {
+    return ::DxLib_EXT_SetUseGraphAtlas(flag, maxGraphSize, pageSize);
+}
+
+int SetUseASyncLoadFlag(int flag) {
+    return ::DxLib_SetUseASyncLoadFlag(flag);
+}
+int GetUseASyncLoadFlag() {
+    return ::DxLib_GetUseASyncLoadFlag();
+}
+int CheckHandleASyncLoad(int handle) {
+    return ::DxLib_CheckHandleASyncLoad(handle);
+}
+int GetASyncLoadNum() {
+    return ::DxLib_GetASyncLoadNum();
+}
 
 int DrawPixel(int x, int y, DXCOLOR color) {
     return ::DxLib_DrawPixel(x, y, color);
@@ -723,6 +760,9 @@ int SetDrawMode(int drawMode) {
 int GetDrawMode() {
     return ::DxLib_GetDrawMode();
 }
+int EXT_SetUseDrawSorting(int flag) {
+    return ::DxLib_EXT_SetUseDrawSorting(flag);
+}
 int SetDrawBlendMode(int blendMode, int alpha) {
     return ::DxLib_SetDrawBlendMode(blendMode, alpha);
 }
@@ -1000,6 +1040,42 @@ int SetFontCacheUsePremulAlphaFlag(int flag) {
 int GetFontCacheUsePremulAlphaFlag() {
     return ::DxLib_GetFontCacheUsePremulAlphaFlag();
 }
+int EXT_GetFontCacheStatsToHandle(int fontHandle, int *pageCount, int *glyphCount,
+                                  double *occupancy, int *growCount) {
+    return ::DxLib_EXT_GetFontCacheStatsToHandle(fontHandle, pageCount, glyphCount,
+                                                 occupancy, growCount);
+}
+
+int EXT_CreateTextLayoutToHandleA(const char *string, int fontHandle,
+                                  double exRateX, double exRateY) {
+    return ::DxLib_EXT_CreateTextLayoutToHandleA(string, fontHandle, exRateX, exRateY);
+}
+int EXT_CreateTextLayoutToHandleW(const wchar_t *string, int fontHandle,
+                                  double exRateX, double exRateY) {
+    return ::DxLib_EXT_CreateTextLayoutToHandleW(string, fontHandle, exRateX, exRateY);
+}
+int EXT_DrawTextLayout(int x, int y, int layoutHandle,
+                       DXCOLOR color, DXCOLOR edgeColor) {
+    return ::DxLib_EXT_DrawTextLayout(x, y, layoutHandle, color, edgeColor);
+}
+int EXT_DeleteTextLayout(int layoutHandle) {
+    return ::DxLib_EXT_DeleteTextLayout(layoutHandle);
+}
+int EXT_SetTextLayoutCacheSize(int layoutCount) {
+    return ::DxLib_EXT_SetTextLayoutCacheSize(layoutCount);
+}
+int EXT_PrewarmFontToHandleA(const char *characters, int fontHandle) {
+    return ::DxLib_EXT_PrewarmFontToHandleA(characters, fontHandle);
+}
+int EXT_PrewarmFontToHandleW(const wchar_t *characters, int fontHandle) {
+    return ::DxLib_EXT_PrewarmFontToHandleW(characters, fontHandle);
+}
+int EXT_PrewarmFontRangeToHandle(int firstCodepoint, int lastCodepoint, int fontHandle) {
+    return ::DxLib_EXT_PrewarmFontRangeToHandle(firstCodepoint, lastCodepoint, fontHandle);
+}
+int EXT_CheckFontPrewarmToHandle(int fontHandle) {
+    return ::DxLib_EXT_CheckFontPrewarmToHandle(fontHandle);
+}
 
 #endif /* #ifndef DX_NON_FONT */
 
@@ -1026,6 +1102,26 @@ int SetUseOldVolumeCalcFlag(int volumeFlag) {
     return ::DxLib_SetUseOldVolumeCalcFlag(volumeFlag);
 }
 
+int SetPanSoundMem(int pan, int soundID) {
+    return ::DxLib_SetPanSoundMem(pan, soundID);
+}
+int ChangePanSoundMem(int pan, int soundID) {
+    return ::DxLib_ChangePanSoundMem(pan, soundID);
+}
+int GetPanSoundMem(int soundID) {
+    return ::DxLib_GetPanSoundMem(soundID);
+}
+
+int SetFrequencySoundMem(int frequency, int soundID) {
+    return ::DxLib_SetFrequencySoundMem(frequency, soundID);
+}
+int GetFrequencySoundMem(int soundID) {
+    return ::DxLib_GetFrequencySoundMem(soundID);
+}
+int ResetFrequencySoundMem(int soundID) {
+    return ::DxLib_ResetFrequencySoundMem(soundID);
+}
+
 int LoadSoundMemA(const char *filename, int bufferNum, int unionHandle) {
     return ::DxLib_LoadSoundMemA(filename, bufferNum, unionHandle);
 }
@@ -1038,6 +1134,9 @@ int LoadSoundMem2A(const char *filename, const char *filename2) {
 int LoadSoundMem2W(const wchar_t *filename, const wchar_t *filename2) {
     return ::DxLib_LoadSoundMem2W(filename, filename2);
 }
+int DuplicateSoundMem(int srcSoundHandle, int bufferNum) {
+    return ::DxLib_DuplicateSoundMem(srcSoundHandle, bufferNum);
+}
 int DeleteSoundMem(int soundID, int LogOutFlag) {
     return ::DxLib_DeleteSoundMem(soundID, LogOutFlag);
 }
@@ -1056,6 +1155,32 @@ int GetCurrentPositionSoundMem(int soundID) {
     return ::DxLib_GetCurrentPositionSoundMem(soundID);
 }
 
+int EXT_SetStreamSoundBufferTime(int milliseconds) {
+    return ::DxLib_EXT_SetStreamSoundBufferTime(milliseconds);
+}
+int EXT_GetStreamSoundUnderrunCount(int soundID) {
+    return ::DxLib_EXT_GetStreamSoundUnderrunCount(soundID);
+}
+int EXT_SetSoundVoiceStealMode(int mode) {
+    return ::DxLib_EXT_SetSoundVoiceStealMode(mode);
+}
+
+int EXT_SetSoundDeviceBufferSize(int frames) {
+    return ::DxLib_EXT_SetSoundDeviceBufferSize(frames);
+}
+int EXT_SetSoundDeviceFrequency(int frequency) {
+    return ::DxLib_EXT_SetSoundDeviceFrequency(frequency);
+}
+int EXT_SetSoundDeviceFormat(int format) {
+    return ::DxLib_EXT_SetSoundDeviceFormat(format);
+}
+int EXT_GetSoundDeviceState(int *frequency, int *bufferFrames, int *format) {
+    return ::DxLib_EXT_GetSoundDeviceState(frequency, bufferFrames, format);
+}
+int EXT_GetSoundDeviceLatency(int *latency, int *jitter) {
+    return ::DxLib_EXT_GetSoundDeviceLatency(latency, jitter);
+}
+
 #endif /* #ifndef DX_NON_SOUND */
 
 // ---------------------------------------------------- DxMemory.cpp
@@ -98,13 +98,17 @@ int DxLib_DxLib_End(void) {
         return 0;
     }
     
+    PL_Async_End();
+    
 #ifndef DX_NON_FONT
     Dx_Font_End();
 #endif /* #ifndef DX_NON_FONT */
 #ifndef DX_NON_SOUND
     PL_Audio_End();
 #endif /* #ifndef DX_NON_SOUND */
+    Dx_Draw_DestroyCache();
     PL_Window_End();
+    PL_ShaderCache_End();
 #ifndef DX_NON_INPUT
     PL_Input_End();
 #endif /* #ifndef DX_NON_INPUT */
@@ -127,6 +131,7 @@ int DxLib_GlobalStructInitialize(void) {
     PL_Window_ResetSettings();
     Dx_Draw_ResetSettings();
     Dx_Graph_ResetSettings();
+    PL_Async_SetUseASyncLoadFlag(DXFALSE);
 #ifndef DX_NON_SOUND
     PL_Audio_ResetSettings();
 #endif
@@ -138,6 +143,8 @@ int DxLib_IsInit(void) {
 }
 
 int DxLib_ProcessMessage(void) {
+    PL_Async_ProcessFinished();
+    
     return PL_Window_ProcessMessages();
 }
 
@@ -147,6 +154,39 @@ int DxLib_WaitTimer(int msTime) {
     return 0;
 }
 
+int DxLib_EXT_SetFrameRate(int framesPerSecond) {
+    PL_FramePacer_SetFrameRate(framesPerSecond);
+    
+    return 0;
+}
+int DxLib_EXT_SyncFrame() {
+    return PL_FramePacer_Sync();
+}
+int DxLib_EXT_GetFrameStats(int *averageTime, int *minTime,
+                            int *maxTime, int *p99Time,
+                            int *missedCount) {
+    PLFramePacerStats stats;
+    PL_FramePacer_GetStats(&stats);
+    
+    if (averageTime != NULL) {
+        *averageTime = stats.averageTime;
+    }
+    if (minTime != NULL) {
+        *minTime = stats.minTime;
+    }
+    if (maxTime != NULL) {
+        *maxTime = stats.maxTime;
+    }
+    if (p99Time != NULL) {
+        *p99Time = stats.p99Time;
+    }
+    if (missedCount != NULL) {
+        *missedCount = stats.missedCount;
+    }
+    
+    return 0;
+}
+
 int DxLib_WaitKey() {
 #ifdef DX_NON_INPUT
     return 0;
@@ -233,6 +273,9 @@ void DxLib_EXT_SetOnlyWindowSize(int width, int height, int isFullscreen, int is
 int DxLib_EXT_FileRead_SetCharSet(int charset) {
     return PLEXT_FileRead_SetCharSet(charset);
 }
+int DxLib_EXT_FileRead_SetBufferSize(int bufferSize) {
+    return PLEXT_FileRead_SetBufferSize(bufferSize);
+}
 
 int DxLib_FileRead_openA(const char *filename, int ASync) {
     /* FIXME: ASync not supported */
@@ -409,6 +452,12 @@ int DxLib_SetDXArchiveExtensionW(const wchar_t *extension) {
 int DxLib_SetDXArchivePriority(int priority) {
     return Dx_File_SetDXArchivePriority(priority);
 }
+int DxLib_EXT_SetDXArchiveMapFlag(int flag) {
+    return Dx_File_EXTSetDXArchiveMapFlag(flag);
+}
+int DxLib_EXT_SetDXArchiveStreamCompressedFlag(int flag) {
+    return Dx_File_EXTSetDXArchiveStreamCompressedFlag(flag);
+}
 int DxLib_DXArchivePreLoadA(const char *dxaFilename, int async) {
     /* FIXME: async is unsupported */
     char buf[DX_STRMAXLEN];
@@ -572,6 +621,9 @@ int DxLib_ScreenFlip() {
     
     PL_Window_SwapBuffers();
     
+    /* Upload anything that finished loading during the frame. */
+    PL_Async_ProcessFinished();
+    
     Dx_Draw_ResetDrawScreen();
     return 0;
 }
@@ -839,6 +891,24 @@ int DxLib_SetUseTransColor(int flag) {
 int DxLib_SetUsePremulAlphaConvertLoad(int flag) {
     return Dx_Graph_SetUsePremulAlphaConvertLoad(flag);
 }
+int DxLib_EXT_SetUseGraphAtlas(int flag, int maxGraphSize, int pageSize) {
+    return Dx_Graph_SetUseAtlas(flag, maxGraphSize, pageSize);
+}
+
+int DxLib_SetUseASyncLoadFlag(int flag) {
+    return PL_Async_SetUseASyncLoadFlag(flag);
+}
+int DxLib_GetUseASyncLoadFlag() {
+    return PL_Async_GetUseASyncLoadFlag();
+}
+int DxLib_CheckHandleASyncLoad(int handle) {
+    PL_Async_ProcessFinished();
+    return PL_Async_IsHandleLoading(handle);
+}
+int DxLib_GetASyncLoadNum() {
+    PL_Async_ProcessFinished();
+    return PL_Async_GetPendingCount();
+}
 
 int DxLib_DrawPixel(int x, int y, DXCOLOR color) {
     return Dx_Draw_Pixel(x, y, color);
@@ -1075,6 +1145,9 @@ int DxLib_SetDrawMode(int drawMode) {
 int DxLib_GetDrawMode() {
     return Dx_Draw_GetDrawMode();
 }
+int DxLib_EXT_SetUseDrawSorting(int flag) {
+    return Dx_Draw_SetUseDrawSorting(flag);
+}
 int DxLib_SetDrawBlendMode(int blendMode, int alpha) {
     return Dx_Draw_SetDrawBlendMode(blendMode, alpha);
 }
@@ -1450,6 +1523,42 @@ int DxLib_SetFontCacheUsePremulAlphaFlag(int flag) {
 int DxLib_GetFontCacheUsePremulAlphaFlag() {
     return Dx_Font_GetFontCacheUsePremulAlphaFlag();
 }
+int DxLib_EXT_GetFontCacheStatsToHandle(int fontHandle, int *pageCount, int *glyphCount,
+                                        double *occupancy, int *growCount) {
+    return Dx_Font_EXTGetFontCacheStatsToHandle(fontHandle, pageCount, glyphCount,
+                                                occupancy, growCount);
+}
+
+int DxLib_EXT_CreateTextLayoutToHandleA(const char *string, int fontHandle,
+                                        double exRateX, double exRateY) {
+    return Dx_Font_EXTCreateTextLayoutA(string, fontHandle, exRateX, exRateY);
+}
+int DxLib_EXT_CreateTextLayoutToHandleW(const wchar_t *string, int fontHandle,
+                                        double exRateX, double exRateY) {
+    return Dx_Font_EXTCreateTextLayoutW(string, fontHandle, exRateX, exRateY);
+}
+int DxLib_EXT_DrawTextLayout(int x, int y, int layoutHandle,
+                             DXCOLOR color, DXCOLOR edgeColor) {
+    return Dx_Font_EXTDrawTextLayout(x, y, layoutHandle, color, edgeColor);
+}
+int DxLib_EXT_DeleteTextLayout(int layoutHandle) {
+    return Dx_Font_EXTDeleteTextLayout(layoutHandle);
+}
+int DxLib_EXT_SetTextLayoutCacheSize(int layoutCount) {
+    return Dx_Font_EXTSetTextLayoutCacheSize(layoutCount);
+}
+int DxLib_EXT_PrewarmFontToHandleA(const char *characters, int fontHandle) {
+    return Dx_Font_EXTPrewarmFontA(characters, fontHandle);
+}
+int DxLib_EXT_PrewarmFontToHandleW(const wchar_t *characters, int fontHandle) {
+    return Dx_Font_EXTPrewarmFontW(characters, fontHandle);
+}
+int DxLib_EXT_PrewarmFontRangeToHandle(int firstCodepoint, int lastCodepoint, int fontHandle) {
+    return Dx_Font_EXTPrewarmFontRange(firstCodepoint, lastCodepoint, fontHandle);
+}
+int DxLib_EXT_CheckFontPrewarmToHandle(int fontHandle) {
+    return Dx_Font_EXTCheckFontPrewarm(fontHandle);
+}
 
 #endif /* #ifndef DX_NON_FONT */
 
@@ -1476,19 +1585,40 @@ int DxLib_SetUseOldVolumeCalcFlag(int volumeFlag) {
     return PL_SetUseOldVolumeCalcFlag(volumeFlag);
 }
 
+int DxLib_SetPanSoundMem(int pan, int soundID) {
+    return PL_SetPanSoundMem(pan, soundID);
+}
+int DxLib_ChangePanSoundMem(int pan, int soundID) {
+    return PL_ChangePanSoundMem(pan, soundID);
+}
+int DxLib_GetPanSoundMem(int soundID) {
+    return PL_GetPanSoundMem(soundID);
+}
+
+int DxLib_SetFrequencySoundMem(int frequency, int soundID) {
+    return PL_SetFrequencySoundMem(frequency, soundID);
+}
+int DxLib_GetFrequencySoundMem(int soundID) {
+    return PL_GetFrequencySoundMem(soundID);
+}
+int DxLib_ResetFrequencySoundMem(int soundID) {
+    return PL_SetFrequencySoundMem(-1, soundID);
+}
+
 int DxLib_LoadSoundMemA(const char *filename, int bufferNum, int unionHandle) {
-    /* FIXME: bufferNum and unionHandle are unsupported */
+    /* FIXME: unionHandle is unsupported */
     char filebuf[DX_STRMAXLEN];
     return PL_LoadSoundMem(
         PL_Text_ConvertStrncpyIfNecessary(filebuf, -1,
-                filename, g_DxUseCharSet, DX_STRMAXLEN)
+                filename, g_DxUseCharSet, DX_STRMAXLEN),
+        bufferNum
     );
 }
 int DxLib_LoadSoundMemW(const wchar_t *filename, int bufferNum, int unionHandle) {
-    /* FIXME: bufferNum and unionHandle are unsupported */
+    /* FIXME: unionHandle is unsupported */
     char filebuf[DX_STRMAXLEN];
     PL_Text_WideCharToString(filebuf, -1, filename, DX_STRMAXLEN);
-    return PL_LoadSoundMem(filebuf);
+    return PL_LoadSoundMem(filebuf, bufferNum);
 }
 
 int DxLib_LoadSoundMem2A(const char *filename, const char *filename2) {
@@ -1509,6 +1639,10 @@ int DxLib_LoadSoundMem2W(const wchar_t *filename, const wchar_t *filename2) {
     return PL_LoadSoundMem2(filebuf, file2buf);
 }
 
+int DxLib_DuplicateSoundMem(int srcSoundHandle, int bufferNum) {
+    return PL_DuplicateSoundMem(srcSoundHandle, bufferNum);
+}
+
 int DxLib_DeleteSoundMem(int soundID, int LogOutFlag) {
     /* FIXME: LogOutFlag is unsupported */
     return PL_DeleteSoundMem(soundID);
@@ -1529,6 +1663,32 @@ int DxLib_GetCurrentPositionSoundMem(int soundID) {
     return PL_Audio_GetCurrentPositionSoundMem(soundID);
 }
 
+int DxLib_EXT_SetStreamSoundBufferTime(int milliseconds) {
+    return PL_Audio_SetStreamBufferTime(milliseconds);
+}
+int DxLib_EXT_GetStreamSoundUnderrunCount(int soundID) {
+    return PL_Audio_GetStreamUnderrunCount(soundID);
+}
+int DxLib_EXT_SetSoundVoiceStealMode(int mode) {
+    return PL_Audio_SetVoiceStealMode(mode);
+}
+
+int DxLib_EXT_SetSoundDeviceBufferSize(int frames) {
+    return PL_Audio_SetDeviceBufferSize(frames);
+}
+int DxLib_EXT_SetSoundDeviceFrequency(int frequency) {
+    return PL_Audio_SetDeviceFrequency(frequency);
+}
+int DxLib_EXT_SetSoundDeviceFormat(int format) {
+    return PL_Audio_SetDeviceFormat(format);
+}
+int DxLib_EXT_GetSoundDeviceState(int *frequency, int *bufferFrames, int *format) {
+    return PL_Audio_GetDeviceState(frequency, bufferFrames, format);
+}
+int DxLib_EXT_GetSoundDeviceLatency(int *latency, int *jitter) {
+    return PL_Audio_GetDeviceLatency(latency, jitter);
+}
+
 #endif /* #ifndef DX_NON_SOUND */
 
 /* ---------------------------------------------------- DxMemory.cpp */
@@ -40,9 +40,6 @@
 static int s_initialized = DXFALSE;
 static int s_forcequit = DXFALSE;
 
-static int s_frameRate = 0;
-static Sint32 s_timerLastTicks = 0;
-static int s_timer = 0;
 static int s_drawTitleInfo = 0;
 static int s_lunaUseFlags = 0;
 
@@ -90,6 +87,7 @@ int Luna::BootMain(Sint32 argc, char **argv,
     
     Luna::End();
     LunaFile_End();
+    PL_ShaderCache_End();
     PL_File_End();
     PL_Handle_End();
     
@@ -190,47 +188,14 @@ Bool Luna::WaitForMsgLoop(Bool isFullActive) {
 
 void Luna::SyncFrame() {
     /* Luna's original timing loop runs on a higher precision
-     * than SDL2 allows, so we have to be a little more perceptive
-     * of this than normal, or we end up with 62.5 FPS or some
-     * other such silliness. */
-    static bool firstFrame = true;
-    int targetTime = 1000000 / s_frameRate;
-    int timer = s_timer;
-    if (firstFrame) {
-        timer = targetTime;
-        s_timerLastTicks = PL_Platform_GetTicks();
-        firstFrame = false;
-    } else {
-        int ticks = PL_Platform_GetTicks();
-        timer += (ticks - s_timerLastTicks) * 1000;
-        s_timerLastTicks = ticks + g_lunaSyncOffset;
+     * than SDL2's millisecond ticks, so this goes through the frame
+     * pacer, or we end up with 62.5 FPS or some other such silliness. */
+    if (g_lunaSyncOffset > 0) {
+        PL_FramePacer_Delay(g_lunaSyncOffset * 1000);
         g_lunaSyncOffset = 0;
     }
     
-#ifndef EMSCRIPTEN
-    if (s_frameRate > 0) {
-        int lastTicks = s_timerLastTicks;
-        if (targetTime > timer) {
-            while (targetTime > timer) {
-                int amount = (targetTime - timer) / 1000;
-                PL_Platform_Wait(amount);
-                
-                int ticks = PL_Platform_GetTicks();
-                timer += (ticks - lastTicks) * 1000;
-                lastTicks = ticks;
-            }
-            s_timerLastTicks = lastTicks;
-            // Don't allow frames to stack up.
-        }
-        timer -= (timer / targetTime) * targetTime;
-    }
-#endif
-    
-    if (timer < 0) {
-        timer = 0;
-    }
-    
-    s_timer = timer;
+    PL_FramePacer_Sync();
     
     /* WRITEME: Update FPS */
 }
@@ -317,7 +282,11 @@ void Luna::SetFrameRate(Sint32 frameRate) {
     if (frameRate == 0) {
         frameRate = 60;
     }
-    s_frameRate = frameRate;
+#ifdef EMSCRIPTEN
+    /* The browser paces frames itself. */
+    frameRate = 0;
+#endif
+    PL_FramePacer_SetFrameRate(frameRate);
 }
 void Luna::SetDrawTitleInfo(void) {
     s_drawTitleInfo = DXTRUE;
@@ -345,6 +314,29 @@ void Luna::GetScreenData(Sint32 *width, Sint32 *height, bool *isWindowed) {
     }
 }
 
+void Luna::EXTGetFrameStats(Sint32 *averageTime, Sint32 *minTime,
+                            Sint32 *maxTime, Sint32 *p99Time,
+                            Sint32 *missedCount) {
+    PLFramePacerStats stats;
+    PL_FramePacer_GetStats(&stats);
+    
+    if (averageTime != NULL) {
+        *averageTime = stats.averageTime;
+    }
+    if (minTime != NULL) {
+        *minTime = stats.minTime;
+    }
+    if (maxTime != NULL) {
+        *maxTime = stats.maxTime;
+    }
+    if (p99Time != NULL) {
+        *p99Time = stats.p99Time;
+    }
+    if (missedCount != NULL) {
+        *missedCount = stats.missedCount;
+    }
+}
+
 void Luna::EXTGetSaveFolder(char *buffer, int bufferLength,
                             const char *org, const char *app,
                             int destEncoding) {
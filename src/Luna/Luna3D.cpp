@@ -79,10 +79,9 @@ static void s_UpdateRenderTexture() {
 }
 
 Bool Luna3D::BeginScene(void) {
-    if (PL_Window_GetWaitVSyncFlag() == DXTRUE) {
-        int ticks = PL_Platform_GetTicks();
-        PLG.Finish();
-        ticks = PL_Platform_GetTicks() - ticks;
+    if (PL_Window_GetWaitVSyncFlag() == DXTRUE && PLG.LimitFrameLatency != NULL) {
+        /* Only waits when the GPU is more than a frame behind. */
+        int ticks = PLG.LimitFrameLatency() / 1000;
         
         if (ticks > 4) {
             g_lunaSyncOffset = ticks - 4;
@@ -34,7 +34,8 @@ LSOUND LunaSound::CreateFromFile(const char *filename, bool IsNoStop,
     char buf[2048];
     return PL_LoadSoundMem(
         PL_Text_ConvertStrncpyIfNecessary(
-            buf, -1, filename, g_lunaUseCharSet, 2048)
+            buf, -1, filename, g_lunaUseCharSet, 2048),
+        1
     );
 }
 Bool LunaSound::IsPlay(LSOUND lSnd, Uint32 Layer) {
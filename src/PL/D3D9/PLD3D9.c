@@ -84,6 +84,7 @@ int PLD3D9_Init() {
     PLG.DrawVertexIndexArray = PLD3D9_DrawVertexIndexArray;
     PLG.DrawVertexBuffer = PLD3D9_DrawVertexBuffer;
     PLG.DrawVertexIndexBuffer = PLD3D9_DrawVertexIndexBuffer;
+    PLG.DrawVertexArrayIndexBuffer = PLD3D9_DrawVertexArrayIndexBuffer;
     PLG.SetViewport = PLD3D9_SetViewport;
     PLG.SetZRange = PLD3D9_SetZRange;
     PLG.ClearColor = PLD3D9_ClearColor;
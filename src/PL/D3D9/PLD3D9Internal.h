@@ -112,6 +112,10 @@ extern int PLD3D9_DrawVertexIndexBuffer(const VertexDefinition *def,
                int vertexBufferHandle, int vertexStart, int vertexCount,
                int indexBufferHandle,
                int primitiveType, int indexStart, int indexCount);
+extern int PLD3D9_DrawVertexArrayIndexBuffer(const VertexDefinition *def,
+               const char *vertexData, int vertexStart, int vertexCount,
+               int indexBufferHandle,
+               int primitiveType, int indexStart, int indexCount);
 
 extern int PLD3D9_SetViewport(int x, int y, int w, int h);
 extern int PLD3D9_SetZRange(float nearZ, float farZ);
@@ -168,6 +168,15 @@ int PLD3D9_DrawVertexIndexBuffer(const VertexDefinition *def,
     return 0;
 }
 
+int PLD3D9_DrawVertexArrayIndexBuffer(const VertexDefinition *def,
+                                      const char *vertexData,
+                                      int vertexStart, int vertexCount,
+                                      int indexBufferHandle,
+                                      int primitiveType, int indexStart, int indexCount
+                                      ) {
+    return 0;
+}
+
 /* ------------------------------------------------- INIT/FINISH/GENERAL */
 
 int PLD3D9_ClearColor(float r, float g, float b, float a) {
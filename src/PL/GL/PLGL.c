@@ -58,6 +58,7 @@ int PLGL_Init(PLGLGetGLFunction GetGLFunction,
 #endif
     
     PL_GL.glGetError = GetGLFunction("glGetError");
+    PL_GL.glGetString = GetGLFunction("glGetString");
     PL_GL.glPixelStorei = GetGLFunction("glPixelStorei");
     PL_GL.glFinish = GetGLFunction("glFinish");
     PL_GL.glGetIntegerv = GetGLFunction("glGetIntegerv");
@@ -149,6 +150,63 @@ int PLGL_Init(PLGLGetGLFunction GetGLFunction,
     }
 #endif
 
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    if (PL_GL.hasVBOSupport == DXTRUE && PL_GL.glUnmapBuffer != NULL) {
+        if (majorVersion >= 3 || IsGLExtSupported("GL_ARB_map_buffer_range")) {
+            PL_GL.glMapBufferRange = GetGLFunction("glMapBufferRange");
+            if (PL_GL.glMapBufferRange != NULL) {
+                PL_GL.hasMapBufferRangeSupport = DXTRUE;
+                s_debugPrint("s_LoadGL: has glMapBufferRange support");
+            }
+        }
+        if (majorVersion > 3 || (majorVersion == 3 && minorVersion >= 2)
+            || IsGLExtSupported("GL_ARB_sync")) {
+            PL_GL.glFenceSync = GetGLFunction("glFenceSync");
+            PL_GL.glClientWaitSync = GetGLFunction("glClientWaitSync");
+            PL_GL.glDeleteSync = GetGLFunction("glDeleteSync");
+            if (PL_GL.glFenceSync != NULL && PL_GL.glClientWaitSync != NULL
+                && PL_GL.glDeleteSync != NULL) {
+                PL_GL.hasSyncSupport = DXTRUE;
+                s_debugPrint("s_LoadGL: has sync object support");
+            }
+        }
+        if (PL_GL.hasMapBufferRangeSupport == DXTRUE
+            && (majorVersion > 4 || (majorVersion == 4 && minorVersion >= 4)
+                || IsGLExtSupported("GL_ARB_buffer_storage"))) {
+            PL_GL.glBufferStorage = GetGLFunction("glBufferStorage");
+            if (PL_GL.glBufferStorage != NULL) {
+                PL_GL.hasBufferStorageSupport = DXTRUE;
+                s_debugPrint("s_LoadGL: has GL_ARB_buffer_storage");
+            }
+        }
+    }
+#endif
+
+    if (PL_GL.hasVBOSupport == DXTRUE) {
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+        if (majorVersion >= 3 || IsGLExtSupported("GL_ARB_vertex_array_object")) {
+            PL_GL.glGenVertexArrays = GetGLFunction("glGenVertexArrays");
+            PL_GL.glDeleteVertexArrays = GetGLFunction("glDeleteVertexArrays");
+            PL_GL.glBindVertexArray = GetGLFunction("glBindVertexArray");
+        }
+#else
+        if (majorVersion >= 3) {
+            PL_GL.glGenVertexArrays = GetGLFunction("glGenVertexArrays");
+            PL_GL.glDeleteVertexArrays = GetGLFunction("glDeleteVertexArrays");
+            PL_GL.glBindVertexArray = GetGLFunction("glBindVertexArray");
+        } else if (IsGLExtSupported("GL_OES_vertex_array_object")) {
+            PL_GL.glGenVertexArrays = GetGLFunction("glGenVertexArraysOES");
+            PL_GL.glDeleteVertexArrays = GetGLFunction("glDeleteVertexArraysOES");
+            PL_GL.glBindVertexArray = GetGLFunction("glBindVertexArrayOES");
+        }
+#endif
+        if (PL_GL.glGenVertexArrays != NULL && PL_GL.glDeleteVertexArrays != NULL
+            && PL_GL.glBindVertexArray != NULL) {
+            PL_GL.hasVertexArraySupport = DXTRUE;
+            s_debugPrint("s_LoadGL: has vertex array object support");
+        }
+    }
+
     if (majorVersion >= 3) {
         PL_GL.hasFramebufferSupport = DXTRUE;
         PL_GL.glFramebufferTexture2D = GetGLFunction("glFramebufferTexture2D");
@@ -236,6 +294,7 @@ int PLGL_Init(PLGLGetGLFunction GetGLFunction,
     PL_GL.glUseProgram = GetGLFunction("glUseProgram");
     PL_GL.glLinkProgram = GetGLFunction("glLinkProgram");
     PL_GL.glAttachShader = GetGLFunction("glAttachShader");
+    PL_GL.glGetProgramiv = GetGLFunction("glGetProgramiv");
     
     PL_GL.glEnableVertexAttribArray = GetGLFunction("glEnableVertexAttribArray");
     PL_GL.glDisableVertexAttribArray = GetGLFunction("glDisableVertexAttribArray");
@@ -260,6 +319,35 @@ int PLGL_Init(PLGLGetGLFunction GetGLFunction,
         PL_GL.hasShaderSupport = DXTRUE;
     }
     
+    if (PL_GL.hasShaderSupport == DXTRUE && PL_GL.glGetProgramiv != NULL) {
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+        if (majorVersion > 4 || (majorVersion == 4 && minorVersion >= 1)
+            || IsGLExtSupported("GL_ARB_get_program_binary")) {
+            PL_GL.glGetProgramBinary = GetGLFunction("glGetProgramBinary");
+            PL_GL.glProgramBinary = GetGLFunction("glProgramBinary");
+            PL_GL.glProgramParameteri = GetGLFunction("glProgramParameteri");
+        }
+#else
+        if (majorVersion >= 3) {
+            PL_GL.glGetProgramBinary = GetGLFunction("glGetProgramBinary");
+            PL_GL.glProgramBinary = GetGLFunction("glProgramBinary");
+            PL_GL.glProgramParameteri = GetGLFunction("glProgramParameteri");
+        } else if (IsGLExtSupported("GL_OES_get_program_binary")) {
+            PL_GL.glGetProgramBinary = GetGLFunction("glGetProgramBinaryOES");
+            PL_GL.glProgramBinary = GetGLFunction("glProgramBinaryOES");
+        }
+#endif
+        if (PL_GL.glGetProgramBinary != NULL && PL_GL.glProgramBinary != NULL) {
+            /* Some drivers have the functions, but no formats to use. */
+            GLint formatCount = 0;
+            PL_GL.glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+            if (formatCount > 0) {
+                PL_GL.hasProgramBinarySupport = DXTRUE;
+                s_debugPrint("s_LoadGL: has program binary support");
+            }
+        }
+    }
+    
     /* ES2 stuff */
 #ifdef DXPORTLIB_DRAW_OPENGL_ES2
     if (IsGLExtSupported("GL_EXT_unpack_subimage")) {
@@ -325,14 +413,18 @@ int PLGL_Init(PLGLGetGLFunction GetGLFunction,
     PLG.DrawVertexIndexArray = PLGL_DrawVertexIndexArray;
     PLG.DrawVertexBuffer = PLGL_DrawVertexBuffer;
     PLG.DrawVertexIndexBuffer = PLGL_DrawVertexIndexBuffer;
+    PLG.DrawVertexArrayIndexBuffer = PLGL_DrawVertexArrayIndexBuffer;
     PLG.SetViewport = PLGL_SetViewport;
     PLG.SetZRange = PLGL_SetZRange;
     PLG.ClearDepth = PLGL_ClearDepth;
     PLG.ClearColor = PLGL_ClearColor;
     PLG.Clear = PLGL_Clear;
     PLG.Finish = PLGL_Finish;
+    PLG.LimitFrameLatency = PLGL_LimitFrameLatency;
+    PLG.PrecompileShaders = PLGL_Shaders_PrecompileStock;
     PLG.StartFrame = PLGL_StartFrame;
     PLG.EndFrame = PLGL_EndFrame;
+    PLG.GetRenderStats = PLGL_GetRenderStats;
     
     PLG.End = PLGL_End;
     
@@ -73,7 +73,7 @@ int PLGL_VertexBuffer_CreateBytes(int vertexByteSize,
     
     if (PL_GL.hasVBOSupport == DXTRUE) {
         PL_GL.glGenBuffers(1, &vboID);
-        PL_GL.glBindBuffer(GL_ARRAY_BUFFER, vboID);
+        PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vboID);
         PL_GL.glBufferData(GL_ARRAY_BUFFER,
                         vb->bufferSize,
                         vertexData, bufferUsage);
@@ -99,7 +99,7 @@ int PLGL_VertexBuffer_ResetBuffer(int vboHandle) {
     vb = (VBufferData *)PL_Handle_GetData(vboHandle, DXHANDLE_VERTEXBUFFER);
     if (vb != NULL) {
         if (vb->vboID > 0) {
-            PL_GL.glBindBuffer(GL_ARRAY_BUFFER, vb->vboID);
+            PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vb->vboID);
             PL_GL.glBufferData(GL_ARRAY_BUFFER, vb->bufferSize, NULL, vb->bufferUsage);
         }
     }
@@ -114,7 +114,7 @@ int PLGL_VertexBuffer_SetDataBytes(int vboHandle, const char *vertices, int star
     vb = (VBufferData *)PL_Handle_GetData(vboHandle, DXHANDLE_VERTEXBUFFER);
     if (vb != NULL) {
         if (vb->vboID > 0) {
-            PL_GL.glBindBuffer(GL_ARRAY_BUFFER, vb->vboID);
+            PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vb->vboID);
             if (resetBufferFlag == DXTRUE) {
                 PL_GL.glBufferData(GL_ARRAY_BUFFER, vb->bufferSize, NULL, vb->bufferUsage);
             }
@@ -136,7 +136,7 @@ int PLGL_VertexBuffer_SetData(int vboHandle, const char *vertices, int start, in
     vb = (VBufferData *)PL_Handle_GetData(vboHandle, DXHANDLE_VERTEXBUFFER);
     if (vb != NULL) {
         if (vb->vboID > 0) {
-            PL_GL.glBindBuffer(GL_ARRAY_BUFFER, vb->vboID);
+            PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vb->vboID);
             if (resetBufferFlag == DXTRUE) {
                 PL_GL.glBufferData(GL_ARRAY_BUFFER, vb->bufferSize, NULL, vb->bufferUsage);
             }
@@ -164,7 +164,7 @@ char *PLGL_VertexBuffer_Lock(int vboHandle) {
     vb = (VBufferData *)PL_Handle_GetData(vboHandle, DXHANDLE_VERTEXBUFFER);
     if (vb != NULL) {
         if (PL_GL.hasVBOSupport == DXTRUE && PL_GL.glMapBuffer != NULL) {
-            PL_GL.glBindBuffer(GL_ARRAY_BUFFER, vb->vboID);
+            PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vb->vboID);
             return (char *)PL_GL.glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
         } else if (vb->fallbackData != NULL) {
             return vb->fallbackData;
@@ -203,7 +203,7 @@ int PLGL_VertexBuffer_Delete(int vboHandle) {
     vb = (VBufferData *)PL_Handle_GetData(vboHandle, DXHANDLE_VERTEXBUFFER);
     if (vb != NULL) {
         if (vb->vboID > 0 && PL_GL.hasVBOSupport == DXTRUE) {
-            PL_GL.glDeleteBuffers(1, &vb->vboID);
+            PLGL_State_DeleteBuffer(vb->vboID);
         }
         if (vb->fallbackData != NULL) {
             DXFREE(vb->fallbackData);
@@ -266,7 +266,7 @@ int PLGL_IndexBuffer_Create(const unsigned short *indexData, int indexCount,
     
     if (PL_GL.hasVBOSupport == DXTRUE) {
         PL_GL.glGenBuffers(1, &iboID);
-        PL_GL.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
+        PLGL_State_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
         PL_GL.glBufferData(GL_ELEMENT_ARRAY_BUFFER,
                         ib->bufferSize,
                         indexData, bufferUsage);
@@ -285,7 +285,7 @@ int PLGL_IndexBuffer_ResetBuffer(int iboHandle) {
     ib = (IBufferData *)PL_Handle_GetData(iboHandle, DXHANDLE_INDEXBUFFER);
     if (ib != NULL) {
         if (ib->iboID > 0) {
-            PL_GL.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib->iboID);
+            PLGL_State_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib->iboID);
             PL_GL.glBufferData(GL_ELEMENT_ARRAY_BUFFER, ib->bufferSize, NULL, ib->bufferUsage);
         }
     }
@@ -299,7 +299,7 @@ int PLGL_IndexBuffer_SetData(int iboHandle, const unsigned short *indices, int s
     ib = (IBufferData *)PL_Handle_GetData(iboHandle, DXHANDLE_INDEXBUFFER);
     if (ib != NULL) {
         if (ib->iboID > 0) {
-            PL_GL.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib->iboID);
+            PLGL_State_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib->iboID);
             if (resetBufferFlag == DXTRUE) {
                 PL_GL.glBufferData(GL_ELEMENT_ARRAY_BUFFER, ib->bufferSize, NULL, ib->bufferUsage);
             }
@@ -326,7 +326,7 @@ unsigned short *PLGL_IndexBuffer_Lock(int iboHandle) {
     ib = (IBufferData *)PL_Handle_GetData(iboHandle, DXHANDLE_INDEXBUFFER);
     if (ib != NULL) { 
         if (PL_GL.hasVBOSupport == DXTRUE && PL_GL.glMapBuffer != NULL) {
-            PL_GL.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib->iboID);
+            PLGL_State_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib->iboID);
             return (unsigned short *)PL_GL.glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
         } else if (ib->fallbackData != NULL) {
             return (unsigned short *)ib->fallbackData;
@@ -369,7 +369,7 @@ int PLGL_IndexBuffer_Delete(int iboHandle) {
     ib = (IBufferData *)PL_Handle_GetData(iboHandle, DXHANDLE_INDEXBUFFER);
     if (ib != NULL) {
         if (PL_GL.hasVBOSupport == DXTRUE && ib->iboID > 0) {
-            PL_GL.glDeleteBuffers(1, &ib->iboID);
+            PLGL_State_DeleteBuffer(ib->iboID);
         }
         if (ib->fallbackData != NULL) {
             DXFREE(ib->fallbackData);
@@ -397,4 +397,295 @@ char *PLGL_IndexBuffer_GetFallback(int iboHandle) {
     return 0;
 }
 
+/* --------------------------------------------------- Streaming Buffers */
+
+/* Client-side vertex and index data (DrawVertexArray and friends) is
+ * appended back-to-back into a pair of ring buffers, instead of orphaning
+ * a buffer on every draw.
+ *
+ * Each frame's span of the ring gets a fence at EndFrame, and we only
+ * wait on the GPU when the write position catches up with a span that
+ * is still in flight. Depending on what the driver offers, uploads are:
+ *
+ * - Persistent: GL_ARB_buffer_storage, mapped once and written directly.
+ * - Mapped: glMapBufferRange with UNSYNCHRONIZED, protected by fences.
+ * - SubData: glBufferSubData, orphaning the buffer only when wrapping.
+ */
+
+#define STREAM_VERTEX_BUFFER_SIZE   (4 * 1024 * 1024)
+#define STREAM_INDEX_BUFFER_SIZE    (1 * 1024 * 1024)
+#define STREAM_MAX_SPANS            16
+
+typedef enum {
+    STREAMMODE_SUBDATA = 0,
+    STREAMMODE_MAPPED,
+    STREAMMODE_PERSISTENT
+} StreamMode;
+
+typedef struct _StreamSpan {
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    GLsync sync;
+#endif
+    int start;
+    int end;
+} StreamSpan;
+
+typedef struct _StreamBuffer {
+    GLenum target;
+    GLuint glID;
+    StreamMode mode;
+    
+    int bufferSize;
+    int head;
+    int spanStart;
+    
+    char *persistentData;
+    
+    /* Fenced spans still in flight, oldest first. */
+    StreamSpan spans[STREAM_MAX_SPANS];
+    int spanFirst;
+    int spanCount;
+} StreamBuffer;
+
+static StreamBuffer s_streamBuffers[PLGL_STREAM_END];
+
+static void s_StreamRetireSpan(StreamBuffer *sb, int waitFlag) {
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    StreamSpan *span = &sb->spans[sb->spanFirst];
+    
+    if (span->sync != 0) {
+        if (waitFlag == DXTRUE) {
+            GLenum result = PL_GL.glClientWaitSync(span->sync, 0, 0);
+            if (result == GL_TIMEOUT_EXPIRED) {
+                PLGL_frameStats.streamStallCount += 1;
+                do {
+                    result = PL_GL.glClientWaitSync(span->sync,
+                                                    GL_SYNC_FLUSH_COMMANDS_BIT,
+                                                    1000000000);
+                } while (result == GL_TIMEOUT_EXPIRED);
+            }
+        }
+        PL_GL.glDeleteSync(span->sync);
+        span->sync = 0;
+    }
+#endif
+    
+    sb->spanFirst = (sb->spanFirst + 1) % STREAM_MAX_SPANS;
+    sb->spanCount -= 1;
+}
+
+/* Closes off everything written since the last fence. */
+static void s_StreamFenceSpan(StreamBuffer *sb) {
+    StreamSpan *span;
+    
+    if (sb->mode == STREAMMODE_SUBDATA || sb->head == sb->spanStart) {
+        sb->spanStart = sb->head;
+        return;
+    }
+    
+    if (sb->spanCount >= STREAM_MAX_SPANS) {
+        s_StreamRetireSpan(sb, DXTRUE);
+    }
+    
+    span = &sb->spans[(sb->spanFirst + sb->spanCount) % STREAM_MAX_SPANS];
+    span->start = sb->spanStart;
+    span->end = sb->head;
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    span->sync = PL_GL.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+    sb->spanCount += 1;
+    
+    sb->spanStart = sb->head;
+}
+
+/* Returns the offset of byteCount contiguous bytes that are safe to
+ * write, waiting on the GPU only if they are still in use.
+ */
+static int s_StreamReserve(StreamBuffer *sb, int byteCount, int alignment) {
+    int offset;
+    
+    if (byteCount > sb->bufferSize) {
+        return -1;
+    }
+    
+    offset = ((sb->head + alignment - 1) / alignment) * alignment;
+    if ((offset + byteCount) > sb->bufferSize) {
+        PLGL_frameStats.streamWrapCount += 1;
+        
+        if (sb->mode == STREAMMODE_SUBDATA) {
+            PLGL_State_BindBuffer(sb->target, sb->glID);
+            PL_GL.glBufferData(sb->target, sb->bufferSize, NULL, GL_STREAM_DRAW);
+            PLGL_frameStats.streamOrphanCount += 1;
+        } else {
+            s_StreamFenceSpan(sb);
+            
+            /* Anything past the old head is from the previous pass, and
+             * is older than what we're about to overwrite. */
+            while (sb->spanCount > 0
+                   && sb->spans[sb->spanFirst].start >= sb->head) {
+                s_StreamRetireSpan(sb, DXTRUE);
+            }
+        }
+        
+        sb->head = 0;
+        sb->spanStart = 0;
+        offset = 0;
+    }
+    
+    /* Wait for any spans from the previous pass that we overlap. */
+    while (sb->spanCount > 0
+           && sb->spans[sb->spanFirst].start >= sb->head
+           && sb->spans[sb->spanFirst].start < (offset + byteCount)) {
+        s_StreamRetireSpan(sb, DXTRUE);
+    }
+    
+    sb->head = offset + byteCount;
+    
+    return offset;
+}
+
+int PLGL_StreamBuffer_Upload(PLGLStreamType streamType,
+                             const void *data, int byteCount,
+                             int alignment) {
+    StreamBuffer *sb;
+    int offset;
+    
+    if (streamType < 0 || streamType >= PLGL_STREAM_END) {
+        return -1;
+    }
+    
+    sb = &s_streamBuffers[streamType];
+    if (sb->glID == 0) {
+        return -1;
+    }
+    
+    offset = s_StreamReserve(sb, byteCount, alignment);
+    if (offset < 0) {
+        return -1;
+    }
+    
+    switch(sb->mode) {
+        case STREAMMODE_PERSISTENT:
+            memcpy(sb->persistentData + offset, data, byteCount);
+            break;
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+        case STREAMMODE_MAPPED: {
+                char *dest;
+                PLGL_State_BindBuffer(sb->target, sb->glID);
+                dest = (char *)PL_GL.glMapBufferRange(sb->target, offset, byteCount,
+                                                      GL_MAP_WRITE_BIT
+                                                      | GL_MAP_INVALIDATE_RANGE_BIT
+                                                      | GL_MAP_UNSYNCHRONIZED_BIT);
+                if (dest != NULL) {
+                    memcpy(dest, data, byteCount);
+                    PL_GL.glUnmapBuffer(sb->target);
+                } else {
+                    PL_GL.glBufferSubData(sb->target, offset, byteCount, data);
+                }
+                break;
+            }
+#endif
+        default:
+            PLGL_State_BindBuffer(sb->target, sb->glID);
+            PL_GL.glBufferSubData(sb->target, offset, byteCount, data);
+            break;
+    }
+    
+    PLGL_frameStats.streamBytesUploaded += byteCount;
+    PLGL_frameStats.streamUploadCount += 1;
+    
+    return offset;
+}
+
+GLuint PLGL_StreamBuffer_GetGLID(PLGLStreamType streamType) {
+    if (streamType < 0 || streamType >= PLGL_STREAM_END) {
+        return 0;
+    }
+    return s_streamBuffers[streamType].glID;
+}
+
+int PLGL_StreamBuffer_EndFrame() {
+    int i;
+    for (i = 0; i < PLGL_STREAM_END; ++i) {
+        if (s_streamBuffers[i].glID != 0) {
+            s_StreamFenceSpan(&s_streamBuffers[i]);
+        }
+    }
+    return 0;
+}
+
+static void s_StreamCreate(StreamBuffer *sb, GLenum target, int bufferSize) {
+    memset(sb, 0, sizeof(StreamBuffer));
+    sb->target = target;
+    sb->bufferSize = bufferSize;
+    
+    if (PL_GL.hasVBOSupport == DXFALSE) {
+        return;
+    }
+    
+    PL_GL.glGenBuffers(1, &sb->glID);
+    PLGL_State_BindBuffer(target, sb->glID);
+    
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    if (PL_GL.hasBufferStorageSupport == DXTRUE && PL_GL.hasSyncSupport == DXTRUE) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        
+        PL_GL.glBufferStorage(target, bufferSize, NULL, flags);
+        sb->persistentData = (char *)PL_GL.glMapBufferRange(target, 0, bufferSize, flags);
+        if (sb->persistentData != NULL) {
+            sb->mode = STREAMMODE_PERSISTENT;
+            return;
+        }
+        
+        /* Storage is immutable, so start over with a fresh buffer. */
+        PLGL_State_DeleteBuffer(sb->glID);
+        PL_GL.glGenBuffers(1, &sb->glID);
+        PLGL_State_BindBuffer(target, sb->glID);
+    }
+#endif
+    
+    PL_GL.glBufferData(target, bufferSize, NULL, GL_STREAM_DRAW);
+    
+    sb->mode = STREAMMODE_SUBDATA;
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    if (PL_GL.hasMapBufferRangeSupport == DXTRUE && PL_GL.hasSyncSupport == DXTRUE) {
+        sb->mode = STREAMMODE_MAPPED;
+    }
+#endif
+}
+
+static void s_StreamDelete(StreamBuffer *sb) {
+    while (sb->spanCount > 0) {
+        s_StreamRetireSpan(sb, DXFALSE);
+    }
+    
+    if (sb->glID != 0) {
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+        if (sb->persistentData != NULL) {
+            PLGL_State_BindBuffer(sb->target, sb->glID);
+            PL_GL.glUnmapBuffer(sb->target);
+        }
+#endif
+        PLGL_State_DeleteBuffer(sb->glID);
+    }
+    
+    memset(sb, 0, sizeof(StreamBuffer));
+}
+
+int PLGL_StreamBuffer_Init() {
+    s_StreamCreate(&s_streamBuffers[PLGL_STREAM_VERTEX],
+                   GL_ARRAY_BUFFER, STREAM_VERTEX_BUFFER_SIZE);
+    s_StreamCreate(&s_streamBuffers[PLGL_STREAM_INDEX],
+                   GL_ELEMENT_ARRAY_BUFFER, STREAM_INDEX_BUFFER_SIZE);
+    return 0;
+}
+
+int PLGL_StreamBuffer_Cleanup() {
+    int i;
+    for (i = 0; i < PLGL_STREAM_END; ++i) {
+        s_StreamDelete(&s_streamBuffers[i]);
+    }
+    return 0;
+}
+
 #endif
@@ -80,7 +80,7 @@ int PLGL_FixedFunction_SetPresetProgram(int preset, int flags,
     PL_GL.glLoadMatrixf((const float *)viewMatrix);
     
     if ((flags & PL_PRESETFLAG_ALPHATEST_MASK) != 0) {
-        PL_GL.glEnable(GL_ALPHA_TEST);
+        PLGL_State_Enable(GL_ALPHA_TEST);
         switch(flags & PL_PRESETFLAG_ALPHATEST_MASK) {
             case PL_PRESETFLAG_ALPHATEST_EQUAL:
                 PL_GL.glAlphaFunc(GL_EQUAL, alphaTestValue);
@@ -105,14 +105,14 @@ int PLGL_FixedFunction_SetPresetProgram(int preset, int flags,
                 break;
             default:
                 /* Never mind. */
-                PL_GL.glDisable(GL_ALPHA_TEST);
+                PLGL_State_Disable(GL_ALPHA_TEST);
                 break;
         }
     } else {
-        PL_GL.glDisable(GL_ALPHA_TEST);
+        PLGL_State_Disable(GL_ALPHA_TEST);
     }
     
-    PL_GL.glActiveTexture(GL_TEXTURE0);
+    PLGL_State_ActiveTexture(0);
     
     switch(preset) {
         case TEX_PRESET_DX_MULA:
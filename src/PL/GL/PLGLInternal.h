@@ -41,6 +41,25 @@
 #define M_PI    3.14159265358979323846
 #endif
 
+/* GL_ARB_buffer_storage, which older headers may not have. */
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT   0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT     0x0080
+#endif
+
+/* GL_ARB_get_program_binary and GL_OES_get_program_binary. */
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT  0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH            0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS       0x87FE
+#endif
+
 typedef struct GLInfo_t {
     int isInitialized;
     
@@ -58,6 +77,7 @@ typedef struct GLInfo_t {
 #endif
     
     GLenum (APIENTRY *glGetError)(void);
+    const GLubyte *(APIENTRY *glGetString)( GLenum name );
     void (APIENTRY *glPixelStorei)( GLenum pname, GLint param );
     void (APIENTRY *glFinish)(void);
     void (APIENTRY *glGetIntegerv)( GLenum pname, GLint *params );
@@ -149,8 +169,28 @@ typedef struct GLInfo_t {
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
     GLvoid *(APIENTRY *glMapBuffer)( GLenum target, GLenum access );
     GLboolean (APIENTRY *glUnmapBuffer)( GLenum target );
+    
+    /* Streaming buffer functions */
+    int hasMapBufferRangeSupport;
+    int hasBufferStorageSupport;
+    int hasSyncSupport;
+    GLvoid *(APIENTRY *glMapBufferRange)( GLenum target, GLintptr offset,
+                                          GLsizeiptr length, GLbitfield access );
+    void (APIENTRY *glBufferStorage)( GLenum target, GLsizeiptr size,
+                                      const GLvoid *data, GLbitfield flags );
+    GLsync (APIENTRY *glFenceSync)( GLenum condition, GLbitfield flags );
+    GLenum (APIENTRY *glClientWaitSync)( GLsync sync, GLbitfield flags,
+                                         GLuint64 timeout );
+    void (APIENTRY *glDeleteSync)( GLsync sync );
 #endif
     
+    /* Vertex array objects */
+    int hasVertexArraySupport;
+    
+    void (APIENTRY *glGenVertexArrays)(GLsizei n, GLuint *arrays);
+    void (APIENTRY *glDeleteVertexArrays)(GLsizei n, const GLuint *arrays);
+    void (APIENTRY *glBindVertexArray)(GLuint array);
+    
     /* Framebuffer functions */
     int hasFramebufferSupport;
     
@@ -187,6 +227,7 @@ typedef struct GLInfo_t {
     void (APIENTRY *glUseProgram)(GLuint program);
     void (APIENTRY *glLinkProgram)(GLuint program);
     void (APIENTRY *glAttachShader)(GLuint program, GLuint shader);
+    void (APIENTRY *glGetProgramiv)(GLuint program, GLenum pname, GLint *params);
     
     void (APIENTRY *glEnableVertexAttribArray)(GLuint index);
     void (APIENTRY *glDisableVertexAttribArray)(GLuint index);
@@ -199,6 +240,16 @@ typedef struct GLInfo_t {
     void (APIENTRY *glUniformMatrix4fv)(GLint location, GLsizei count,
                                         GLboolean transpose, const GLfloat *value);
     
+    /* Program binary functions, for the shader cache */
+    int hasProgramBinarySupport;
+    
+    void (APIENTRY *glGetProgramBinary)(GLuint program, GLsizei bufSize,
+                                        GLsizei *length, GLenum *binaryFormat,
+                                        void *binary);
+    void (APIENTRY *glProgramBinary)(GLuint program, GLenum binaryFormat,
+                                     const void *binary, GLsizei length);
+    void (APIENTRY *glProgramParameteri)(GLuint program, GLenum pname, GLint value);
+    
     /* ES2 stuff */
 #ifdef DXPORTLIB_DRAW_OPENGL_ES2
     int hasEXTUnpackSubimage;
@@ -236,6 +287,23 @@ typedef struct _PLGLShaderDefinition {
     int hasColor;
 } PLGLShaderDefinition;
 
+/* A vertex array object, set up for one vertex definition and pair of
+ * buffers with one program's attribute locations. Vertex definitions
+ * are always static, so the pointer is enough to tell them apart. */
+typedef struct _PLGLVertexArray {
+    GLuint glVertexArrayID;
+    const VertexDefinition *definition;
+    GLuint vertexBufferID;
+    GLuint indexBufferID;
+    
+    /* Where the attributes point in the vertex buffer right now. */
+    const char *vertexData;
+    
+    unsigned int lastUsed;
+} PLGLVertexArray;
+
+#define PLGL_MAX_VERTEX_ARRAYS 16
+
 typedef struct _PLGLShaderInfo {
     PLGLShaderDefinition definition;
     GLuint glVertexShaderID;
@@ -251,8 +319,23 @@ typedef struct _PLGLShaderInfo {
     GLuint glProjectionUniformID;
     
     GLuint glAlphaTestUniformID;
+    
+    /* Last values given to each uniform, so redundant updates can be
+     * skipped. Only valid where the matching PLGL_UNIFORMSET_ bit is set. */
+    int uniformSetFlags;
+    PLMatrix projectionValue;
+    PLMatrix modelViewValue;
+    float alphaTestValue;
+    
+    PLGLVertexArray vertexArrays[PLGL_MAX_VERTEX_ARRAYS];
+    int vertexArrayCount;
+    unsigned int vertexArrayClock;
 } PLGLShaderInfo;
 
+#define PLGL_UNIFORMSET_PROJECTION  0x01
+#define PLGL_UNIFORMSET_MODELVIEW   0x02
+#define PLGL_UNIFORMSET_ALPHATEST   0x04
+
 extern int PL_drawScreenWidth;
 extern int PL_drawScreenHeight;
 
@@ -305,6 +388,10 @@ extern int PLGL_DrawVertexIndexBuffer(const VertexDefinition *def,
                int vertexBufferHandle, int vertexStart, int vertexCount,
                int indexBufferHandle,
                int primitiveType, int indexStart, int indexCount);
+extern int PLGL_DrawVertexArrayIndexBuffer(const VertexDefinition *def,
+               const char *vertexData, int vertexStart, int vertexCount,
+               int indexBufferHandle,
+               int primitiveType, int indexStart, int indexCount);
 
 extern int PLGL_SetViewport(int x, int y, int w, int h);
 extern int PLGL_SetZRange(float nearZ, float farZ);
@@ -316,6 +403,7 @@ extern int PLGL_StartFrame();
 extern int PLGL_EndFrame();
 
 extern int PLGL_Finish();
+extern int PLGL_LimitFrameLatency();
 
 extern int PLGL_VertexBuffer_CreateBytes(int vertexByteSize,
                                        const char *vertexData, int bufferSize,
@@ -379,6 +467,44 @@ extern char *PLGL_VertexBuffer_GetFallback(int vboHandle);
 extern GLuint PLGL_IndexBuffer_GetGLID(int vertexBufferID);
 extern char *PLGL_IndexBuffer_GetFallback(int vboHandle);
 
+typedef enum {
+    PLGL_STREAM_VERTEX = 0,
+    PLGL_STREAM_INDEX,
+    PLGL_STREAM_END
+} PLGLStreamType;
+
+extern int PLGL_StreamBuffer_Upload(PLGLStreamType streamType,
+                                    const void *data, int byteCount,
+                                    int alignment);
+extern GLuint PLGL_StreamBuffer_GetGLID(PLGLStreamType streamType);
+extern int PLGL_StreamBuffer_EndFrame();
+extern int PLGL_StreamBuffer_Init();
+extern int PLGL_StreamBuffer_Cleanup();
+
+extern void PLGL_State_Reset();
+extern int PLGL_State_Enable(GLenum cap);
+extern int PLGL_State_Disable(GLenum cap);
+extern int PLGL_State_BlendFunc(GLenum src, GLenum dest);
+extern int PLGL_State_BlendFuncSeparate(GLenum srcRGB, GLenum destRGB,
+                                        GLenum srcAlpha, GLenum destAlpha);
+extern int PLGL_State_BlendEquation(GLenum equation);
+extern int PLGL_State_Scissor(GLint x, GLint y, GLsizei w, GLsizei h);
+extern int PLGL_State_DepthFunc(GLenum func);
+extern int PLGL_State_DepthMask(GLboolean flag);
+extern int PLGL_State_UseProgram(GLuint programID);
+extern int PLGL_State_DeleteProgram(GLuint programID);
+extern int PLGL_State_ActiveTexture(unsigned int unit);
+extern int PLGL_State_BindTexture(GLenum target, GLuint textureID);
+extern int PLGL_State_DeleteTexture(GLuint textureID);
+extern int PLGL_State_BindBuffer(GLenum target, GLuint bufferID);
+extern int PLGL_State_DeleteBuffer(GLuint bufferID);
+extern int PLGL_State_BindVertexArray(GLuint vertexArrayID, GLuint indexBufferID);
+extern int PLGL_State_BindVertexArrayIndexBuffer(GLuint bufferID);
+extern int PLGL_State_DeleteVertexArray(GLuint vertexArrayID);
+
+extern PLRenderStats PLGL_frameStats;
+extern int PLGL_GetRenderStats(PLRenderStats *frameStats, PLRenderStats *totalStats);
+
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
 typedef enum _PresetProgramFlags {
     PL_PRESETFLAG_ALPHATEST_NONE = 0,
@@ -426,9 +552,15 @@ extern void PLGL_Shaders_ApplyProgramVertexData(int shaderHandle,
                                     const VertexDefinition *definition);
 extern void PLGL_Shaders_ClearProgramVertexData(int shaderHandle,
                                     const VertexDefinition *definition);
+extern void PLGL_Shaders_BindVertexBuffers(int shaderHandle,
+                                    const VertexDefinition *definition,
+                                    GLuint vertexBufferID, GLuint indexBufferID,
+                                    const char *vertexData);
+extern void PLGL_Shaders_ForgetBuffer(GLuint bufferID);
 extern int PLGL_Shaders_GetStockProgramForID(
                     PLGLShaderPresetType shaderType,
                     PLAlphaFunc alphaFunc);
+extern int PLGL_Shaders_PrecompileStock();
 extern void PLGL_Shaders_Init();
 extern void PLGL_Shaders_Cleanup();
 
@@ -87,12 +87,12 @@ void PLGL_SetBlendMode(
     int srcBlend, int destBlend
 ) {
     if (blendEquation == PL_BLENDFUNC_DISABLE) {
-        PL_GL.glDisable(GL_BLEND);
+        PLGL_State_Disable(GL_BLEND);
         return;
     }
-    PL_GL.glBlendFunc(BlendTypeToGL(srcBlend), BlendTypeToGL(destBlend));
-    PL_GL.glBlendEquation(BlendFuncToGL(blendEquation));
-    PL_GL.glEnable(GL_BLEND);
+    PLGL_State_BlendFunc(BlendTypeToGL(srcBlend), BlendTypeToGL(destBlend));
+    PLGL_State_BlendEquation(BlendFuncToGL(blendEquation));
+    PLGL_State_Enable(GL_BLEND);
 }
 void PLGL_SetBlendModeSeparate(
     int blendEquation,
@@ -100,29 +100,29 @@ void PLGL_SetBlendModeSeparate(
     int srcAlphaBlend, int destAlphaBlend
 ) {
     if (blendEquation == PL_BLENDFUNC_DISABLE) {
-        PL_GL.glDisable(GL_BLEND);
+        PLGL_State_Disable(GL_BLEND);
         return;
     }
-    PL_GL.glBlendFuncSeparate(
+    PLGL_State_BlendFuncSeparate(
         BlendTypeToGL(srcRGBBlend), BlendTypeToGL(destRGBBlend),
         BlendTypeToGL(srcAlphaBlend), BlendTypeToGL(destAlphaBlend));
-    PL_GL.glBlendEquation(BlendFuncToGL(blendEquation));
-    PL_GL.glEnable(GL_BLEND);
+    PLGL_State_BlendEquation(BlendFuncToGL(blendEquation));
+    PLGL_State_Enable(GL_BLEND);
 }
 void PLGL_DisableBlend() {
-    PL_GL.glDisable(GL_BLEND);
+    PLGL_State_Disable(GL_BLEND);
 }
 
 /* ----------------------------------------------------- SCISSOR/CULLING */
 
 int PLGL_SetScissor(int x, int y, int w, int h) {
-    PL_GL.glEnable(GL_SCISSOR_TEST);
-    PL_GL.glScissor(x, y, w, h);
+    PLGL_State_Enable(GL_SCISSOR_TEST);
+    PLGL_State_Scissor(x, y, w, h);
     return 0;
 }
 
 int PLGL_DisableScissor() {
-    PL_GL.glDisable(GL_SCISSOR_TEST);
+    PLGL_State_Disable(GL_SCISSOR_TEST);
     return 0;
 }
 
@@ -136,7 +136,7 @@ int PLGL_SetScissorRect(const RECT *rect) {
 }
 
 int PLGL_DisableCulling() {
-    PL_GL.glDisable(GL_CULL_FACE);
+    PLGL_State_Disable(GL_CULL_FACE);
     return 0;
 }
 
@@ -154,27 +154,27 @@ int PLGL_SetDepthFunc(PLDepthFunc depthFunc) {
         default: return -1;
     }
     
-    PL_GL.glDepthFunc(func);
+    PLGL_State_DepthFunc(func);
     
     return 0;
 }
 
 int PLGL_EnableDepthTest() {
-    PL_GL.glEnable(GL_DEPTH_TEST);
+    PLGL_State_Enable(GL_DEPTH_TEST);
     return 0;
 }
 
 int PLGL_DisableDepthTest() {
-    PL_GL.glDisable(GL_DEPTH_TEST);
+    PLGL_State_Disable(GL_DEPTH_TEST);
     return 0;
 }
 
 int PLGL_EnableDepthWrite() {
-    PL_GL.glDepthMask(GL_TRUE);
+    PLGL_State_DepthMask(GL_TRUE);
     return 0;
 }
 int PLGL_DisableDepthWrite() {
-    PL_GL.glDepthMask(GL_FALSE);
+    PLGL_State_DepthMask(GL_FALSE);
     return 0;
 }
 
@@ -194,7 +194,7 @@ int PLGL_SetTextureStage(unsigned int stage, int textureRefID, int textureDrawMo
         return -1;
     }
     
-    PL_GL.glActiveTexture(GL_TEXTURE0 + stage);
+    PLGL_State_ActiveTexture(stage);
     PLGL_Texture_Bind(textureRefID, textureDrawMode);
     
     s_boundTextures[stage] = textureRefID;
@@ -209,7 +209,7 @@ int PLGL_SetTextureStage(unsigned int stage, int textureRefID, int textureDrawMo
 int PLGL_ClearTextures() {
     unsigned int i;
     for (i = 0; i < s_boundTextureCount; ++i) {
-        PL_GL.glActiveTexture(GL_TEXTURE0 + i);
+        PLGL_State_ActiveTexture(i);
         PLGL_Texture_Unbind(s_boundTextures[i]);
         s_boundTextures[i] = -1;
     }
@@ -294,6 +294,12 @@ int PLGL_SetPresetProgram(int preset,
                 break;
         }
         s_useFixedFunction = DXTRUE;
+        
+        /* The fixed function arrays must not end up in a vertex array
+         * that belongs to a program. */
+        if (PL_GL.hasVertexArraySupport == DXTRUE) {
+            PLGL_State_BindVertexArray(0, 0);
+        }
         return PLGL_FixedFunction_SetPresetProgram(preset, flags,
                                                    projectionMatrix, viewMatrix,
                                                    textureRefID, textureDrawMode,
@@ -319,6 +325,9 @@ int PLGL_ClearPresetProgram() {
 /* -------------------------------------------------- FULL ES2 EMULATION */
 /* OpenGL, as of 3.0 core, requires a bound vbo/ibo for calls to
  * glDrawArrays/glDrawElements.
+ *
+ * Client-side data normally goes through the streaming buffers. These
+ * are only used for draws too large to fit in them.
  */
 #define MAX_EMULATED_BUFFERS    24
 static int s_emulatedVBOs[MAX_EMULATED_BUFFERS];
@@ -414,6 +423,65 @@ static GLuint PrimitiveToDrawType(int primitiveType) {
     }
 }
 
+/* The alignment to upload streamed vertices at. Where the vertex size
+ * allows, whole vertices are kept aligned, so that draws without indices
+ * can start at a vertex number instead of moving the attributes, which
+ * a vertex array would otherwise need re-pointed every time. */
+static int s_StreamVertexAlignment(const VertexDefinition *def) {
+    if ((def->vertexByteSize % 4) == 0) {
+        return def->vertexByteSize;
+    }
+    return 4;
+}
+
+/* Draws from the streaming vertex buffer, at the byte offset given,
+ * with indices from indexBufferID at indexOffset.
+ * If indexBufferID is 0, draws without indices.
+ */
+static int s_DrawStreamed(const VertexDefinition *def, int vertexOffset,
+                          GLuint indexBufferID, int indexOffset,
+                          int primitiveType, int count) {
+    GLuint vertexBufferID = PLGL_StreamBuffer_GetGLID(PLGL_STREAM_VERTEX);
+    const char *vertexBase = (const char *)(size_t)vertexOffset;
+    int vertexFirst = 0;
+    
+    if (indexBufferID == 0 && (vertexOffset % def->vertexByteSize) == 0) {
+        vertexFirst = vertexOffset / def->vertexByteSize;
+        vertexBase = 0;
+    }
+    
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    if (s_useFixedFunction == DXTRUE) {
+        PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+        if (indexBufferID != 0) {
+            PLGL_State_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+        }
+        PLGL_FixedFunction_ApplyVertexArrayData(def, vertexBase);
+    } else
+#endif
+    {
+        PLGL_Shaders_BindVertexBuffers(
+            s_activeShaderProgram, def,
+            vertexBufferID, indexBufferID, vertexBase);
+    }
+    
+    if (indexBufferID != 0) {
+        PL_GL.glDrawElements(PrimitiveToDrawType(primitiveType),
+                             count, GL_UNSIGNED_SHORT,
+                             (void *)(size_t)indexOffset);
+    } else {
+        PL_GL.glDrawArrays(PrimitiveToDrawType(primitiveType), vertexFirst, count);
+    }
+    
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    if (s_useFixedFunction == DXTRUE) {
+        PLGL_FixedFunction_ClearVertexArrayData(def);
+    }
+#endif
+    
+    return 0;
+}
+
 int PLGL_DrawVertexArray(const VertexDefinition *def,
                               const char *vertexData,
                               int primitiveType, int vertexStart, int vertexCount
@@ -421,6 +489,16 @@ int PLGL_DrawVertexArray(const VertexDefinition *def,
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
     if (PL_GL.hasVBOSupport == DXTRUE) {
 #endif
+        int vertexOffset = PLGL_StreamBuffer_Upload(
+                PLGL_STREAM_VERTEX,
+                vertexData + (vertexStart * def->vertexByteSize),
+                vertexCount * def->vertexByteSize, s_StreamVertexAlignment(def));
+        if (vertexOffset >= 0) {
+            return s_DrawStreamed(def, vertexOffset, 0, 0,
+                                  primitiveType, vertexCount);
+        }
+        
+        PLGL_frameStats.streamFallbackCount += 1;
         return PLGL_DrawVertexBuffer(
                 def,
                 s_emulateVertexBuffer(def, vertexData + (vertexStart * def->vertexByteSize),
@@ -430,8 +508,8 @@ int PLGL_DrawVertexArray(const VertexDefinition *def,
     }
 
     if (PL_GL.hasVBOSupport == DXTRUE) {
-        PL_GL.glBindBuffer(GL_ARRAY_BUFFER, 0);
-        PL_GL.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        PLGL_State_BindBuffer(GL_ARRAY_BUFFER, 0);
+        PLGL_State_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
     
     if (s_useFixedFunction == DXTRUE) {
@@ -465,6 +543,23 @@ int PLGL_DrawVertexIndexArray(const VertexDefinition *def,
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
     if (PL_GL.hasVBOSupport == DXTRUE) {
 #endif
+        /* Indices are relative to the start of vertexData. */
+        int indexOffset = -1;
+        int vertexOffset = PLGL_StreamBuffer_Upload(
+                PLGL_STREAM_VERTEX, vertexData,
+                (vertexStart + vertexCount) * def->vertexByteSize, s_StreamVertexAlignment(def));
+        if (vertexOffset >= 0) {
+            indexOffset = PLGL_StreamBuffer_Upload(
+                PLGL_STREAM_INDEX, indexData + indexStart,
+                indexCount * (int)sizeof(unsigned short), 4);
+        }
+        if (indexOffset >= 0) {
+            return s_DrawStreamed(def, vertexOffset,
+                                  PLGL_StreamBuffer_GetGLID(PLGL_STREAM_INDEX), indexOffset,
+                                  primitiveType, indexCount);
+        }
+        
+        PLGL_frameStats.streamFallbackCount += 1;
         PLGL_DrawVertexIndexBuffer(
             def,
             s_emulateVertexBuffer(def, vertexData, vertexStart, vertexCount), vertexStart, vertexCount,
@@ -476,8 +571,8 @@ int PLGL_DrawVertexIndexArray(const VertexDefinition *def,
     }
     
     if (PL_GL.hasVBOSupport == DXTRUE) {
-        PL_GL.glBindBuffer(GL_ARRAY_BUFFER, 0);
-        PL_GL.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        PLGL_State_BindBuffer(GL_ARRAY_BUFFER, 0);
+        PLGL_State_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
     
     if (s_useFixedFunction == DXTRUE) {
@@ -521,10 +616,9 @@ int PLGL_DrawVertexBuffer(const VertexDefinition *def,
     
     vertexBufferID = PLGL_VertexBuffer_GetGLID(vertexBufferHandle);
     
-    PL_GL.glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-    
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
     if (s_useFixedFunction == DXTRUE) {
+        PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
         PLGL_FixedFunction_ApplyVertexBufferData(def);
         
         PL_GL.glDrawArrays(PrimitiveToDrawType(primitiveType), vertexStart, vertexCount);
@@ -533,9 +627,9 @@ int PLGL_DrawVertexBuffer(const VertexDefinition *def,
     } else
 #endif
     {
-        PLGL_Shaders_ApplyProgramVertexData(
-            s_activeShaderProgram,
-            0, def);
+        PLGL_Shaders_BindVertexBuffers(
+            s_activeShaderProgram, def,
+            vertexBufferID, 0, 0);
         
         PL_GL.glDrawArrays(PrimitiveToDrawType(primitiveType), vertexStart, vertexCount);
     }
@@ -564,12 +658,11 @@ int PLGL_DrawVertexIndexBuffer(const VertexDefinition *def,
     
     vertexBufferID = PLGL_VertexBuffer_GetGLID(vertexBufferHandle);
     indexBufferID = PLGL_IndexBuffer_GetGLID(indexBufferHandle);
-    
-    PL_GL.glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-    PL_GL.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
 
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
     if (s_useFixedFunction == DXTRUE) {
+        PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+        PLGL_State_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
         PLGL_FixedFunction_ApplyVertexBufferData(def);
         
         PL_GL.glDrawElements(PrimitiveToDrawType(primitiveType),
@@ -580,9 +673,9 @@ int PLGL_DrawVertexIndexBuffer(const VertexDefinition *def,
     } else
 #endif
     {
-        PLGL_Shaders_ApplyProgramVertexData(
-            s_activeShaderProgram,
-            0, def);
+        PLGL_Shaders_BindVertexBuffers(
+            s_activeShaderProgram, def,
+            vertexBufferID, indexBufferID, 0);
         
         PL_GL.glDrawElements(PrimitiveToDrawType(primitiveType),
                             indexCount, GL_UNSIGNED_SHORT,
@@ -592,6 +685,74 @@ int PLGL_DrawVertexIndexBuffer(const VertexDefinition *def,
     return 0;
 }
 
+/* Draws vertices from memory with indices that are already in a buffer,
+ * such as the same quad indices used for every batch. The vertices go
+ * through the streaming buffer, so the index buffer is the only one
+ * that has to stay around. */
+int PLGL_DrawVertexArrayIndexBuffer(const VertexDefinition *def,
+                                    const char *vertexData,
+                                    int vertexStart, int vertexCount,
+                                    int indexBufferHandle,
+                                    int primitiveType, int indexStart, int indexCount
+                                    ) {
+    int vertexOffset;
+    
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    if (PL_GL.hasVBOSupport == DXFALSE) {
+        return PLGL_DrawVertexIndexArray(
+                    def, vertexData, vertexStart, vertexCount,
+                    (const unsigned short *)PLGL_IndexBuffer_GetFallback(indexBufferHandle),
+                    primitiveType, indexStart, indexCount);
+    }
+#endif
+    
+    /* Indices are relative to the start of vertexData. */
+    vertexOffset = PLGL_StreamBuffer_Upload(
+            PLGL_STREAM_VERTEX, vertexData,
+            (vertexStart + vertexCount) * def->vertexByteSize, s_StreamVertexAlignment(def));
+    if (vertexOffset >= 0) {
+        return s_DrawStreamed(def, vertexOffset,
+                              PLGL_IndexBuffer_GetGLID(indexBufferHandle),
+                              indexStart * (int)sizeof(unsigned short),
+                              primitiveType, indexCount);
+    }
+    
+    PLGL_frameStats.streamFallbackCount += 1;
+    return PLGL_DrawVertexIndexBuffer(
+        def,
+        s_emulateVertexBuffer(def, vertexData, vertexStart, vertexCount), vertexStart, vertexCount,
+        indexBufferHandle,
+        primitiveType, indexStart, indexCount);
+}
+
+/* ---------------------------------------------------------- STATISTICS */
+
+PLRenderStats PLGL_frameStats;
+static PLRenderStats s_lastFrameStats;
+static PLRenderStats s_totalStats;
+
+static void s_AddRenderStats(PLRenderStats *dest, const PLRenderStats *src) {
+    dest->frameCount += src->frameCount;
+    dest->streamBytesUploaded += src->streamBytesUploaded;
+    dest->streamUploadCount += src->streamUploadCount;
+    dest->streamWrapCount += src->streamWrapCount;
+    dest->streamStallCount += src->streamStallCount;
+    dest->streamOrphanCount += src->streamOrphanCount;
+    dest->streamFallbackCount += src->streamFallbackCount;
+    dest->stateChangeCount += src->stateChangeCount;
+    dest->stateElidedCount += src->stateElidedCount;
+}
+
+int PLGL_GetRenderStats(PLRenderStats *frameStats, PLRenderStats *totalStats) {
+    if (frameStats != NULL) {
+        memcpy(frameStats, &s_lastFrameStats, sizeof(PLRenderStats));
+    }
+    if (totalStats != NULL) {
+        memcpy(totalStats, &s_totalStats, sizeof(PLRenderStats));
+    }
+    return 0;
+}
+
 /* ------------------------------------------------- INIT/FINISH/GENERAL */
 
 int PLGL_ClearDepth(float d) {
@@ -622,6 +783,14 @@ int PLGL_StartFrame() {
     return 0;
 }
 int PLGL_EndFrame() {
+    PLGL_StreamBuffer_EndFrame();
+    PL_FrameLatency_EndFrame();
+    
+    PLGL_frameStats.frameCount = 1;
+    s_AddRenderStats(&s_totalStats, &PLGL_frameStats);
+    memcpy(&s_lastFrameStats, &PLGL_frameStats, sizeof(PLRenderStats));
+    memset(&PLGL_frameStats, 0, sizeof(PLRenderStats));
+    
     return 0;
 }
 
@@ -631,7 +800,57 @@ int PLGL_Finish() {
     return 0;
 }
 
+/* Frame latency fences, see PLFrameLatency.c. */
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+static void *s_FenceInsert(void *userdata) {
+    return (void *)PL_GL.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+static int s_FenceWait(void *userdata, void *fence, int blockFlag) {
+    GLenum result;
+    
+    if (blockFlag == DXFALSE) {
+        result = PL_GL.glClientWaitSync((GLsync)fence, 0, 0);
+    } else {
+        do {
+            result = PL_GL.glClientWaitSync((GLsync)fence,
+                                            GL_SYNC_FLUSH_COMMANDS_BIT,
+                                            1000000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    
+    return (result == GL_TIMEOUT_EXPIRED) ? DXFALSE : DXTRUE;
+}
+static void s_FenceDelete(void *userdata, void *fence) {
+    PL_GL.glDeleteSync((GLsync)fence);
+}
+#endif
+static void s_FenceFinish(void *userdata) {
+    PL_GL.glFinish();
+}
+
+static void s_FrameLatencyInit() {
+    PLFrameLatencyFunctions funcs;
+    
+    memset(&funcs, 0, sizeof(funcs));
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    if (PL_GL.hasSyncSupport == DXTRUE) {
+        funcs.fenceInsert = s_FenceInsert;
+        funcs.fenceWait = s_FenceWait;
+        funcs.fenceDelete = s_FenceDelete;
+    }
+#endif
+    funcs.finish = s_FenceFinish;
+    
+    PL_FrameLatency_SetFunctions(&funcs);
+}
+
+int PLGL_LimitFrameLatency() {
+    return PL_FrameLatency_Wait();
+}
+
 int PLGL_Render_Init() {
+    PLGL_State_Reset();
+    
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
     PLGL_FixedFunction_Init();
 #endif
@@ -643,11 +862,19 @@ int PLGL_Render_Init() {
                           -1, 0, PL_ALPHAFUNC_ALWAYS, 0.0f);
     
     s_emulateBuffersInit();
+    PLGL_StreamBuffer_Init();
+    s_FrameLatencyInit();
+    
+    memset(&PLGL_frameStats, 0, sizeof(PLRenderStats));
+    memset(&s_lastFrameStats, 0, sizeof(PLRenderStats));
+    memset(&s_totalStats, 0, sizeof(PLRenderStats));
     
     return 0;
 }
 
 int PLGL_Render_End() {
+    PL_FrameLatency_SetFunctions(NULL);
+    PLGL_StreamBuffer_Cleanup();
     s_emulateBuffersCleanup();
     
     PLGL_Shaders_Cleanup();
@@ -314,92 +314,259 @@ static const PLGLShaderDefinition s_stockShaderDefinitions[PLGL_SHADER_END] = {
     }
 };
 
+/* Debug builds check for GL errors after every step of building a
+ * program, to pin down which one failed. Release builds only check once
+ * the program is linked, as every glGetError is a round trip to the
+ * driver, and may wait on compiles it would otherwise overlap. */
+#ifdef DXPORTLIB_GL_DEBUG
+#  define CHECK_GL_STEP() if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
+#else
+#  define CHECK_GL_STEP()
+#endif
+
+#define PROGRAMCACHE_CLOSED 0
+#define PROGRAMCACHE_OPEN 1
+#define PROGRAMCACHE_OFF 2
+
+static PLShaderCache s_programCache;
+static int s_programCacheState = PROGRAMCACHE_CLOSED;
+
+/* The cache is opened at the first compile, so the filename can be set
+ * any time before then. */
+static int s_ProgramCacheOpen() {
+    const char *filename;
+    
+    if (s_programCacheState != PROGRAMCACHE_CLOSED) {
+        return (s_programCacheState == PROGRAMCACHE_OPEN) ? DXTRUE : DXFALSE;
+    }
+    
+    s_programCacheState = PROGRAMCACHE_OFF;
+    
+    filename = PL_ShaderCache_GetFilename();
+    if (PL_GL.hasProgramBinarySupport == DXFALSE || filename == NULL) {
+        return DXFALSE;
+    }
+    
+    PL_ShaderCache_Init(&s_programCache, PL_ShaderCache_MakeDriverKey(
+        (const char *)PL_GL.glGetString(GL_VENDOR),
+        (const char *)PL_GL.glGetString(GL_RENDERER),
+        (const char *)PL_GL.glGetString(GL_VERSION)));
+    
+    /* A missing or stale file only means starting over empty. */
+    PL_ShaderCache_LoadFile(&s_programCache, filename);
+    
+    s_programCacheState = PROGRAMCACHE_OPEN;
+    return DXTRUE;
+}
+
+static void s_ProgramCacheSave() {
+    const char *filename = PL_ShaderCache_GetFilename();
+    
+    if (s_programCacheState == PROGRAMCACHE_OPEN
+        && s_programCache.dirtyFlag == DXTRUE && filename != NULL
+    ) {
+        PL_ShaderCache_SaveFile(&s_programCache, filename);
+    }
+}
+
+static void s_ProgramCacheClose() {
+    s_ProgramCacheSave();
+    
+    if (s_programCacheState == PROGRAMCACHE_OPEN) {
+        PL_ShaderCache_Clear(&s_programCache);
+    }
+    s_programCacheState = PROGRAMCACHE_CLOSED;
+}
+
+/* Returns a linked program from the cache, or 0 if there isn't one the
+ * driver will take. Rejected binaries are dropped, to be replaced by
+ * a fresh one once the program is compiled again. */
+static GLuint s_LoadProgramBinary(Uint64 sourceKey) {
+    const PLShaderCacheEntry *entry = PL_ShaderCache_Find(&s_programCache, sourceKey);
+    GLuint glProgramID;
+    GLint status = GL_FALSE;
+    
+    if (entry == NULL) {
+        return 0;
+    }
+    
+    glProgramID = PL_GL.glCreateProgram();
+    if (glProgramID != 0) {
+        PL_GL.glProgramBinary(glProgramID, (GLenum)entry->binaryFormat,
+                              entry->data, (GLsizei)entry->length);
+        PL_GL.glGetProgramiv(glProgramID, GL_LINK_STATUS, &status);
+    }
+    
+    if (status != GL_TRUE) {
+        PL_ShaderCache_Remove(&s_programCache, sourceKey);
+        if (glProgramID != 0) {
+            PLGL_State_DeleteProgram(glProgramID);
+        }
+        PL_GL.glGetError();
+        return 0;
+    }
+    
+    return glProgramID;
+}
+
+static void s_StoreProgramBinary(GLuint glProgramID, Uint64 sourceKey) {
+    GLint length = 0;
+    GLsizei written = 0;
+    GLenum binaryFormat = 0;
+    void *data;
+    
+    PL_GL.glGetProgramiv(glProgramID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    
+    data = DXALLOC((size_t)length);
+    if (data == NULL) {
+        return;
+    }
+    
+    PL_GL.glGetProgramBinary(glProgramID, length, &written, &binaryFormat, data);
+    if (written > 0 && written <= length) {
+        PL_ShaderCache_Store(&s_programCache, sourceKey, binaryFormat, data, written);
+    }
+    
+    DXFREE(data);
+}
+
+static int s_CreateShaderInfo(const PLGLShaderDefinition *definition,
+                              GLuint glVertexShaderID, GLuint glFragmentShaderID,
+                              GLuint glProgramID) {
+    int shaderHandle;
+    PLGLShaderInfo *info;
+    int i;
+    
+    shaderHandle = PL_Handle_AcquireID(DXHANDLE_SHADER);
+    info = (PLGLShaderInfo *)PL_Handle_AllocateData(shaderHandle, sizeof(PLGLShaderInfo));
+    memset(info, 0, sizeof(PLGLShaderInfo));
+    
+    memcpy(&info->definition, definition, sizeof(PLGLShaderDefinition));
+    info->definition.vertexShader = NULL;
+    info->definition.fragmentShaderPreAlpha = NULL;
+    info->definition.fragmentShaderPostAlpha = NULL;
+    
+    info->glVertexShaderID = glVertexShaderID;
+    info->glFragmentShaderID = glFragmentShaderID;
+    info->glProgramID = glProgramID;
+    
+    info->glProjectionUniformID = PL_GL.glGetUniformLocation(glProgramID, "projection");
+    info->glModelViewUniformID = PL_GL.glGetUniformLocation(glProgramID, "modelView");
+    
+    info->glVertexAttribID = PL_GL.glGetAttribLocation(glProgramID, "position");
+    info->glTextureUniformID[0] = PL_GL.glGetUniformLocation(glProgramID, "texture");
+    info->glTextureUniformID[1] = PL_GL.glGetUniformLocation(glProgramID, "texture1");
+    info->glTextureUniformID[2] = PL_GL.glGetUniformLocation(glProgramID, "texture2");
+    info->glTextureUniformID[3] = PL_GL.glGetUniformLocation(glProgramID, "texture3");
+    info->glTexcoordAttribID[0] = PL_GL.glGetAttribLocation(glProgramID, "texcoord");
+    info->glTexcoordAttribID[1] = PL_GL.glGetAttribLocation(glProgramID, "texcoord2");
+    info->glTexcoordAttribID[2] = PL_GL.glGetAttribLocation(glProgramID, "texcoord3");
+    info->glTexcoordAttribID[3] = PL_GL.glGetAttribLocation(glProgramID, "texcoord4");
+    info->glColorAttribID = PL_GL.glGetAttribLocation(glProgramID, "color");
+    
+    info->glAlphaTestUniformID = PL_GL.glGetUniformLocation(glProgramID, "alphaTest");
+    
+    info->uniformSetFlags = 0;
+    
+    /* Samplers never change, so they are set once here, rather than
+     * checked on every draw. */
+    PLGL_State_UseProgram(glProgramID);
+    for (i = 0; i < 4; ++i) {
+        if ((GLint)info->glTextureUniformID[i] >= 0) {
+            PL_GL.glUniform1i(info->glTextureUniformID[i], i);
+        }
+    }
+    
+    return shaderHandle;
+}
+
 int PLGL_Shaders_CompileDefinition(const PLGLShaderDefinition *definition, PLAlphaFunc alphaFunc) {
     GLuint glVertexShaderID = 0;
     GLuint glFragmentShaderID = 0;
     GLuint glProgramID = 0;
-    int shaderHandle;
-    PLGLShaderInfo *info;
+    const char *sources[4];
+    Uint64 sourceKey = 0;
+    int useCache;
     
     if (PL_GL.hasShaderSupport == DXFALSE) {
         return -1;
     }
     
+    sources[0] = definition->vertexShader;
+    sources[1] = definition->fragmentShaderPreAlpha;
+    sources[2] = s_alphaTestCode[(int)alphaFunc];
+    sources[3] = definition->fragmentShaderPostAlpha;
+    
+    useCache = s_ProgramCacheOpen();
+    if (useCache == DXTRUE) {
+        sourceKey = PL_ShaderCache_MakeSourceKey(sources, 4);
+        glProgramID = s_LoadProgramBinary(sourceKey);
+        if (glProgramID != 0) {
+            return s_CreateShaderInfo(definition, 0, 0, glProgramID);
+        }
+    }
+    
     do {
         GLint status;
         /* Clear any GL errors out before we do anything. */
         PL_GL.glGetError();
 
         glProgramID = PL_GL.glCreateProgram();
-        if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
+        CHECK_GL_STEP();
         
         if (definition->vertexShader != NULL) {
             glVertexShaderID = PL_GL.glCreateShader(GL_VERTEX_SHADER);
-            if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
-            PL_GL.glShaderSource(glVertexShaderID, 1, &definition->vertexShader, NULL);
-            if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
+            CHECK_GL_STEP();
+            PL_GL.glShaderSource(glVertexShaderID, 1, &sources[0], NULL);
+            CHECK_GL_STEP();
             PL_GL.glCompileShader(glVertexShaderID);
-            if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
+            CHECK_GL_STEP();
+#ifdef DXPORTLIB_GL_DEBUG
             PL_GL.glGetShaderiv(glVertexShaderID, GL_COMPILE_STATUS, &status);
             if (status != GL_TRUE) { break; }
+#endif
             
             PL_GL.glAttachShader(glProgramID, glVertexShaderID);
-            if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
+            CHECK_GL_STEP();
         }
         
         if (definition->fragmentShaderPreAlpha != NULL) {
-            const char *buffers[3];
-            
-            buffers[0] = definition->fragmentShaderPreAlpha;
-            buffers[1] = s_alphaTestCode[(int)alphaFunc];
-            buffers[2] = definition->fragmentShaderPostAlpha;
-                
             glFragmentShaderID = PL_GL.glCreateShader(GL_FRAGMENT_SHADER);
-            if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
-            PL_GL.glShaderSource(glFragmentShaderID, 3, buffers, NULL);
-            if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
+            CHECK_GL_STEP();
+            PL_GL.glShaderSource(glFragmentShaderID, 3, &sources[1], NULL);
+            CHECK_GL_STEP();
             PL_GL.glCompileShader(glFragmentShaderID);
-            if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
+            CHECK_GL_STEP();
+#ifdef DXPORTLIB_GL_DEBUG
             PL_GL.glGetShaderiv(glFragmentShaderID, GL_COMPILE_STATUS, &status);
             if (status != GL_TRUE) { break; }
+#endif
             
             PL_GL.glAttachShader(glProgramID, glFragmentShaderID);
-            if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
+            CHECK_GL_STEP();
+        }
+        
+        if (useCache == DXTRUE && PL_GL.glProgramParameteri != NULL) {
+            PL_GL.glProgramParameteri(glProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         }
         
         PL_GL.glLinkProgram(glProgramID);
         if (PL_GL.glGetError() != GL_NO_ERROR) { break; }
         
-        shaderHandle = PL_Handle_AcquireID(DXHANDLE_SHADER);
-        info = (PLGLShaderInfo *)PL_Handle_AllocateData(shaderHandle, sizeof(PLGLShaderInfo));
-        memset(info, 0, sizeof(PLGLShaderInfo));
-        
-        memcpy(&info->definition, definition, sizeof(PLGLShaderDefinition));
-        info->definition.vertexShader = NULL;
-        info->definition.fragmentShaderPreAlpha = NULL;
-        info->definition.fragmentShaderPostAlpha = NULL;
-        
-        info->glVertexShaderID = glVertexShaderID;
-        info->glFragmentShaderID = glFragmentShaderID;
-        info->glProgramID = glProgramID;
-        
-        info->glProjectionUniformID = PL_GL.glGetUniformLocation(glProgramID, "projection");
-        info->glModelViewUniformID = PL_GL.glGetUniformLocation(glProgramID, "modelView");
-        
-        info->glVertexAttribID = PL_GL.glGetAttribLocation(glProgramID, "position");
-        info->glTextureUniformID[0] = PL_GL.glGetUniformLocation(glProgramID, "texture");
-        info->glTextureUniformID[1] = PL_GL.glGetUniformLocation(glProgramID, "texture1");
-        info->glTextureUniformID[2] = PL_GL.glGetUniformLocation(glProgramID, "texture2");
-        info->glTextureUniformID[3] = PL_GL.glGetUniformLocation(glProgramID, "texture3");
-        info->glTexcoordAttribID[0] = PL_GL.glGetAttribLocation(glProgramID, "texcoord");
-        info->glTexcoordAttribID[1] = PL_GL.glGetAttribLocation(glProgramID, "texcoord2");
-        info->glTexcoordAttribID[2] = PL_GL.glGetAttribLocation(glProgramID, "texcoord3");
-        info->glTexcoordAttribID[3] = PL_GL.glGetAttribLocation(glProgramID, "texcoord4");
-        info->glColorAttribID = PL_GL.glGetAttribLocation(glProgramID, "color");
+        /* A shader that failed to compile fails the link as well. */
+        if (PL_GL.glGetProgramiv != NULL) {
+            PL_GL.glGetProgramiv(glProgramID, GL_LINK_STATUS, &status);
+            if (status != GL_TRUE) { break; }
+        }
         
-        info->glAlphaTestUniformID = PL_GL.glGetUniformLocation(glProgramID, "alphaTest");
+        if (useCache == DXTRUE) {
+            s_StoreProgramBinary(glProgramID, sourceKey);
+        }
         
-        return shaderHandle;
+        return s_CreateShaderInfo(definition, glVertexShaderID, glFragmentShaderID, glProgramID);
     } while(0);
     
     if (glVertexShaderID != 0) {
@@ -409,12 +576,27 @@ int PLGL_Shaders_CompileDefinition(const PLGLShaderDefinition *definition, PLAlp
         PL_GL.glDeleteShader(glFragmentShaderID);
     }
     if (glProgramID != 0) {
-        PL_GL.glDeleteProgram(glProgramID);
+        PLGL_State_DeleteProgram(glProgramID);
     }
     
     return -1;
 }
 
+static void s_DeleteVertexArray(PLGLShaderInfo *info, int index) {
+    PLGL_State_DeleteVertexArray(info->vertexArrays[index].glVertexArrayID);
+    
+    info->vertexArrayCount -= 1;
+    if (index < info->vertexArrayCount) {
+        info->vertexArrays[index] = info->vertexArrays[info->vertexArrayCount];
+    }
+}
+
+static void s_DeleteAllVertexArrays(PLGLShaderInfo *info) {
+    while (info->vertexArrayCount > 0) {
+        s_DeleteVertexArray(info, info->vertexArrayCount - 1);
+    }
+}
+
 void PLGL_Shaders_DeleteShader(int shaderHandle) {
     PLGLShaderInfo *info = (PLGLShaderInfo *)PL_Handle_GetData(shaderHandle, DXHANDLE_SHADER);
     
@@ -425,7 +607,8 @@ void PLGL_Shaders_DeleteShader(int shaderHandle) {
         if (info->glFragmentShaderID != 0) {
             PL_GL.glDeleteShader(info->glFragmentShaderID);
         }
-        PL_GL.glDeleteProgram(info->glProgramID);
+        s_DeleteAllVertexArrays(info);
+        PLGL_State_DeleteProgram(info->glProgramID);
         
         PL_Handle_ReleaseID(shaderHandle, DXTRUE);
     }
@@ -446,16 +629,16 @@ void PLGL_Shaders_UseProgram(int shaderHandle) {
     }
     
     if (shaderHandle < 0) {
-        PL_GL.glUseProgram(0);
+        PLGL_State_UseProgram(0);
     } else {
         PLGLShaderInfo *info = (PLGLShaderInfo *)PL_Handle_GetData(shaderHandle, DXHANDLE_SHADER);
         
         if (info == NULL) {
-            PL_GL.glUseProgram(0);
+            PLGL_State_UseProgram(0);
             return;
         }
         
-        PL_GL.glUseProgram(info->glProgramID);
+        PLGL_State_UseProgram(info->glProgramID);
     }
 }
 
@@ -467,8 +650,27 @@ void PLGL_Shaders_ApplyProgramMatrices(int shaderHandle,
         return;
     }
     
-    PL_GL.glUniformMatrix4fv(info->glProjectionUniformID, 1, GL_FALSE, (GLfloat *)projectionMatrix);
-    PL_GL.glUniformMatrix4fv(info->glModelViewUniformID, 1, GL_FALSE, (GLfloat *)viewMatrix);
+    if ((info->uniformSetFlags & PLGL_UNIFORMSET_PROJECTION) != 0
+        && memcmp(&info->projectionValue, projectionMatrix, sizeof(PLMatrix)) == 0
+    ) {
+        PLGL_frameStats.stateElidedCount += 1;
+    } else {
+        PL_GL.glUniformMatrix4fv(info->glProjectionUniformID, 1, GL_FALSE, (GLfloat *)projectionMatrix);
+        memcpy(&info->projectionValue, projectionMatrix, sizeof(PLMatrix));
+        info->uniformSetFlags |= PLGL_UNIFORMSET_PROJECTION;
+        PLGL_frameStats.stateChangeCount += 1;
+    }
+    
+    if ((info->uniformSetFlags & PLGL_UNIFORMSET_MODELVIEW) != 0
+        && memcmp(&info->modelViewValue, viewMatrix, sizeof(PLMatrix)) == 0
+    ) {
+        PLGL_frameStats.stateElidedCount += 1;
+    } else {
+        PL_GL.glUniformMatrix4fv(info->glModelViewUniformID, 1, GL_FALSE, (GLfloat *)viewMatrix);
+        memcpy(&info->modelViewValue, viewMatrix, sizeof(PLMatrix));
+        info->uniformSetFlags |= PLGL_UNIFORMSET_MODELVIEW;
+        PLGL_frameStats.stateChangeCount += 1;
+    }
 }
 
 void PLGL_Shaders_ApplyProgramAlphaTestValue(int shaderHandle, float alphaTestValue) {
@@ -478,58 +680,75 @@ void PLGL_Shaders_ApplyProgramAlphaTestValue(int shaderHandle, float alphaTestVa
         return;
     }
     
+    if ((info->uniformSetFlags & PLGL_UNIFORMSET_ALPHATEST) != 0
+        && info->alphaTestValue == alphaTestValue
+    ) {
+        PLGL_frameStats.stateElidedCount += 1;
+        return;
+    }
+    
     PL_GL.glUniform1f(info->glAlphaTestUniformID, alphaTestValue);
+    info->alphaTestValue = alphaTestValue;
+    info->uniformSetFlags |= PLGL_UNIFORMSET_ALPHATEST;
+    PLGL_frameStats.stateChangeCount += 1;
+}
+
+/* Points the program's attributes at vertexData, which is an offset
+ * into the bound vertex buffer, if there is one. enableFlag also
+ * enables them, which a vertex array only needs the first time. */
+static void s_PointAttributes(PLGLShaderInfo *info, const char *vertexData,
+                              const VertexDefinition *definition, int enableFlag) {
+    const VertexElement *e = definition->elements;
+    int elementCount = definition->elementCount;
+    int vertexDataSize = definition->vertexByteSize;
+    int i;
+    
+    for (i = 0; i < elementCount; ++i, ++e) {
+        GLenum vertexType = VertexElementSizeToGL(e->vertexElementSize);
+        GLint attribID;
+        GLboolean normalized = GL_FALSE;
+    
+        switch (e->vertexType) {
+            case VERTEX_POSITION:
+                attribID = info->glVertexAttribID;
+                break;
+            case VERTEX_TEXCOORD0:
+            case VERTEX_TEXCOORD1:
+            case VERTEX_TEXCOORD2:
+            case VERTEX_TEXCOORD3:
+                attribID = info->glTexcoordAttribID[e->vertexType - VERTEX_TEXCOORD0];
+                break;
+            case VERTEX_COLOR:
+                attribID = info->glColorAttribID;
+                normalized = GL_TRUE;
+                break;
+            default:
+                attribID = -1;
+                break;
+        }
+    
+        if (attribID >= 0) {
+            PL_GL.glVertexAttribPointer(attribID,
+                                        e->size, vertexType, normalized,
+                                        vertexDataSize, vertexData + e->offset);
+            if (enableFlag == DXTRUE) {
+                PL_GL.glEnableVertexAttribArray(attribID);
+            }
+        }
+    }
 }
 
 void PLGL_Shaders_ApplyProgramVertexData(int shaderHandle,
                              const char *vertexData, const VertexDefinition *definition)
 {
     PLGLShaderInfo *info = (PLGLShaderInfo *)PL_Handle_GetData(shaderHandle, DXHANDLE_SHADER);
-    int i;
     
     if (info == NULL) {
         return;
     }
     
     if (definition != NULL) {
-        const VertexElement *e = definition->elements;
-        int elementCount = definition->elementCount;
-        int vertexDataSize = definition->vertexByteSize;
-        
-        for (i = 0; i < elementCount; ++i, ++e) {
-            GLenum vertexType = VertexElementSizeToGL(e->vertexElementSize);
-            switch (e->vertexType) {
-                case VERTEX_POSITION:
-                    PL_GL.glVertexAttribPointer(info->glVertexAttribID,
-                                                e->size, vertexType, GL_FALSE,
-                                                vertexDataSize, vertexData + e->offset);
-                    PL_GL.glEnableVertexAttribArray(info->glVertexAttribID);
-                    break;
-                case VERTEX_TEXCOORD0:
-                case VERTEX_TEXCOORD1:
-                case VERTEX_TEXCOORD2:
-                case VERTEX_TEXCOORD3: {
-                        int slot = e->vertexType - VERTEX_TEXCOORD0;
-                        GLint attribID = info->glTexcoordAttribID[slot];
-                        if (attribID >= 0) {
-                            PL_GL.glVertexAttribPointer(attribID,
-                                                        e->size, vertexType, GL_FALSE,
-                                                        vertexDataSize, vertexData + e->offset);
-                            PL_GL.glUniform1i(info->glTextureUniformID[slot], slot);
-                            PL_GL.glEnableVertexAttribArray(attribID);
-                        }
-                        break;
-                    }
-                case VERTEX_COLOR:
-                    if (info->glColorAttribID >= 0) {
-                        PL_GL.glVertexAttribPointer(info->glColorAttribID,
-                                                    e->size, vertexType, GL_TRUE,
-                                                    vertexDataSize, vertexData + e->offset);
-                        PL_GL.glEnableVertexAttribArray(info->glColorAttribID);
-                    }
-                    break;
-            }
-        }
+        s_PointAttributes(info, vertexData, definition, DXTRUE);
     }
 }
 
@@ -561,7 +780,7 @@ void PLGL_Shaders_ClearProgramVertexData(int shaderHandle, const VertexDefinitio
                         break;
                     }
                 case VERTEX_COLOR:
-                    if (info->glColorAttribID >= 0) {
+                    if ((GLint)info->glColorAttribID >= 0) {
                         PL_GL.glDisableVertexAttribArray(info->glColorAttribID);
                     }
                     break;
@@ -570,6 +789,113 @@ void PLGL_Shaders_ClearProgramVertexData(int shaderHandle, const VertexDefinitio
     }
 }
 
+/* ------------------------------------------------------- Vertex Arrays */
+
+/* Vertex arrays are cached per program, for each vertex definition and
+ * pair of buffers it is drawn with. Once one is set up, drawing with it
+ * again only needs it bound. The streaming buffers are the exception,
+ * as their data moves around; there only the attribute pointers are
+ * moved to the new offset, as the rest stays the same. */
+
+/* Finds the vertex array for this combination, or sets up a new one,
+ * replacing the least recently used if the cache is full. */
+static void s_BindVertexArray(PLGLShaderInfo *info, const VertexDefinition *definition,
+                              GLuint vertexBufferID, GLuint indexBufferID,
+                              const char *vertexData) {
+    PLGLVertexArray *vertexArray;
+    int oldest = 0;
+    int i;
+    
+    info->vertexArrayClock += 1;
+    
+    for (i = 0; i < info->vertexArrayCount; ++i) {
+        vertexArray = &info->vertexArrays[i];
+        if (vertexArray->definition == definition
+            && vertexArray->vertexBufferID == vertexBufferID
+            && vertexArray->indexBufferID == indexBufferID
+        ) {
+            vertexArray->lastUsed = info->vertexArrayClock;
+            PLGL_State_BindVertexArray(vertexArray->glVertexArrayID, indexBufferID);
+    
+            if (vertexArray->vertexData != vertexData) {
+                PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+                s_PointAttributes(info, vertexData, definition, DXFALSE);
+                vertexArray->vertexData = vertexData;
+            }
+            return;
+        }
+        if (vertexArray->lastUsed < info->vertexArrays[oldest].lastUsed) {
+            oldest = i;
+        }
+    }
+    
+    if (info->vertexArrayCount >= PLGL_MAX_VERTEX_ARRAYS) {
+        s_DeleteVertexArray(info, oldest);
+    }
+    
+    vertexArray = &info->vertexArrays[info->vertexArrayCount];
+    PL_GL.glGenVertexArrays(1, &vertexArray->glVertexArrayID);
+    vertexArray->definition = definition;
+    vertexArray->vertexBufferID = vertexBufferID;
+    vertexArray->indexBufferID = indexBufferID;
+    vertexArray->vertexData = vertexData;
+    vertexArray->lastUsed = info->vertexArrayClock;
+    info->vertexArrayCount += 1;
+    
+    /* A new vertex array starts out with no element buffer. */
+    PLGL_State_BindVertexArray(vertexArray->glVertexArrayID, 0);
+    PLGL_State_BindVertexArrayIndexBuffer(indexBufferID);
+    PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    s_PointAttributes(info, vertexData, definition, DXTRUE);
+}
+
+/* Sets up everything needed to draw from vertexBufferID, at the offset
+ * vertexData, and indexBufferID, if not 0. Where vertex arrays are
+ * supported, this is usually a single bind. */
+void PLGL_Shaders_BindVertexBuffers(int shaderHandle, const VertexDefinition *definition,
+                                    GLuint vertexBufferID, GLuint indexBufferID,
+                                    const char *vertexData) {
+    PLGLShaderInfo *info = (PLGLShaderInfo *)PL_Handle_GetData(shaderHandle, DXHANDLE_SHADER);
+    
+    if (info == NULL || definition == NULL) {
+        return;
+    }
+    
+    if (PL_GL.hasVertexArraySupport == DXTRUE) {
+        s_BindVertexArray(info, definition, vertexBufferID, indexBufferID, vertexData);
+        return;
+    }
+    
+    PLGL_State_BindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    if (indexBufferID != 0) {
+        PLGL_State_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+    }
+    s_PointAttributes(info, vertexData, definition, DXTRUE);
+}
+
+/* Drops every vertex array that uses a buffer about to be deleted. */
+void PLGL_Shaders_ForgetBuffer(GLuint bufferID) {
+    int shaderHandle = PL_Handle_GetFirstIDOf(DXHANDLE_SHADER);
+    
+    while (shaderHandle >= 0) {
+        PLGLShaderInfo *info = (PLGLShaderInfo *)PL_Handle_GetData(shaderHandle, DXHANDLE_SHADER);
+        if (info != NULL) {
+            int i = 0;
+            while (i < info->vertexArrayCount) {
+                if (info->vertexArrays[i].vertexBufferID == bufferID
+                    || info->vertexArrays[i].indexBufferID == bufferID
+                ) {
+                    s_DeleteVertexArray(info, i);
+                } else {
+                    i += 1;
+                }
+            }
+        }
+        
+        shaderHandle = PL_Handle_GetNextID(shaderHandle);
+    }
+}
+
 static int s_stockShaderIDs[PLGL_SHADER_END][PL_ALPHAFUNC_END];
 
 int PLGL_Shaders_GetStockProgramForID(PLGLShaderPresetType shaderType, PLAlphaFunc alphaFunc) {
@@ -584,34 +910,58 @@ int PLGL_Shaders_GetStockProgramForID(PLGLShaderPresetType shaderType, PLAlphaFu
     return id;
 }
 
-void PLGL_Shaders_Init() {
+/* Builds every stock program variant now, so that none of them has to
+ * be compiled in the middle of a frame the first time a blend or alpha
+ * test combination turns up. Returns how many are ready to use. */
+int PLGL_Shaders_PrecompileStock() {
+    int count = 0;
     int i, j;
-
+    
     if (PL_GL.hasShaderSupport == DXFALSE) {
-        return;
+        return -1;
     }
     
     for (i = 0; i < PLGL_SHADER_END; ++i) {
         for (j = 0; j < PL_ALPHAFUNC_END; ++j) {
-            s_stockShaderIDs[i][j] = -2;
+            if (PLGL_Shaders_GetStockProgramForID((PLGLShaderPresetType)i, (PLAlphaFunc)j) > 0) {
+                count += 1;
+            }
         }
     }
-    /* s_stockShaderIDs[i] = PLGL_Shaders_CompileDefinition(&s_stockShaderDefinitions[i]); */
+    
+    s_ProgramCacheSave();
+    
+    return count;
 }
 
-void PLGL_Shaders_Cleanup() {
+void PLGL_Shaders_Init() {
     int i, j;
-    
+
     if (PL_GL.hasShaderSupport == DXFALSE) {
         return;
     }
     
     for (i = 0; i < PLGL_SHADER_END; ++i) {
         for (j = 0; j < PL_ALPHAFUNC_END; ++j) {
-            PLGL_Shaders_DeleteShader(s_stockShaderIDs[i][j]);
             s_stockShaderIDs[i][j] = -2;
         }
     }
+    /* s_stockShaderIDs[i] = PLGL_Shaders_CompileDefinition(&s_stockShaderDefinitions[i]); */
+}
+
+void PLGL_Shaders_Cleanup() {
+    int i, j;
+    
+    if (PL_GL.hasShaderSupport == DXTRUE) {
+        for (i = 0; i < PLGL_SHADER_END; ++i) {
+            for (j = 0; j < PL_ALPHAFUNC_END; ++j) {
+                PLGL_Shaders_DeleteShader(s_stockShaderIDs[i][j]);
+                s_stockShaderIDs[i][j] = -2;
+            }
+        }
+    
+        s_ProgramCacheClose();
+    }
 }
 
 #endif
@@ -0,0 +1,458 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+    
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+ */
+
+/* Shadow copy of the GL state we touch while drawing.
+ *
+ * Every state change in the GL backend goes through here, so that
+ * setting something to the value it already has never reaches the
+ * driver. Anything we have not set yet since PLGL_State_Reset is
+ * treated as unknown and always sent.
+ *
+ * Deleting an object that is bound must go through here as well, as
+ * GL silently unbinds it.
+ *
+ * The element array buffer binding belongs to the bound vertex array
+ * object. Binding one through PLGL_State_BindBuffer always goes to the
+ * default vertex array, so uploading index data can never change what
+ * a cached vertex array draws with.
+ */
+
+#include "DPLBuildConfig.h"
+
+#ifdef DXPORTLIB_DRAW_OPENGL
+
+#include "PL/PLInternal.h"
+
+#include "PLGLInternal.h"
+
+#define STATE_UNKNOWN   (-1)
+
+#define MAX_TEXTURE_UNITS 4
+
+typedef enum {
+    CAP_BLEND = 0,
+    CAP_SCISSOR_TEST,
+    CAP_DEPTH_TEST,
+    CAP_CULL_FACE,
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    CAP_ALPHA_TEST,
+#endif
+    CAP_END
+} StateCap;
+
+typedef struct _TextureUnitState {
+    GLenum boundTarget;
+    GLint boundTextureID;
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+    int enabled2D;
+    int enabledRectangle;
+#endif
+} TextureUnitState;
+
+typedef struct _GLState {
+    int caps[CAP_END];
+    
+    GLint blendSrcRGB, blendDestRGB;
+    GLint blendSrcAlpha, blendDestAlpha;
+    GLint blendEquation;
+    
+    GLint scissorX, scissorY, scissorW, scissorH;
+    
+    GLint depthFunc;
+    GLint depthMask;
+    
+    GLint program;
+    
+    GLint activeTexture;
+    TextureUnitState textureUnits[MAX_TEXTURE_UNITS];
+    
+    GLint arrayBuffer;
+    GLint elementArrayBuffer;
+    
+    GLint vertexArray;
+    
+    /* The default vertex array's element buffer, while another is bound. */
+    GLint defaultElementArrayBuffer;
+} GLState;
+
+static GLState s_state;
+
+static DXINLINE void s_Issued() {
+    PLGL_frameStats.stateChangeCount += 1;
+}
+static DXINLINE int s_Elided() {
+    PLGL_frameStats.stateElidedCount += 1;
+    return 0;
+}
+
+void PLGL_State_Reset() {
+    int i;
+    
+    for (i = 0; i < CAP_END; ++i) {
+        s_state.caps[i] = STATE_UNKNOWN;
+    }
+    
+    s_state.blendSrcRGB = STATE_UNKNOWN;
+    s_state.blendDestRGB = STATE_UNKNOWN;
+    s_state.blendSrcAlpha = STATE_UNKNOWN;
+    s_state.blendDestAlpha = STATE_UNKNOWN;
+    s_state.blendEquation = STATE_UNKNOWN;
+    
+    s_state.scissorX = STATE_UNKNOWN;
+    s_state.scissorY = STATE_UNKNOWN;
+    s_state.scissorW = STATE_UNKNOWN;
+    s_state.scissorH = STATE_UNKNOWN;
+    
+    s_state.depthFunc = STATE_UNKNOWN;
+    s_state.depthMask = STATE_UNKNOWN;
+    
+    s_state.program = STATE_UNKNOWN;
+    
+    s_state.activeTexture = STATE_UNKNOWN;
+    for (i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+        TextureUnitState *unit = &s_state.textureUnits[i];
+        unit->boundTarget = 0;
+        unit->boundTextureID = STATE_UNKNOWN;
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+        unit->enabled2D = STATE_UNKNOWN;
+        unit->enabledRectangle = STATE_UNKNOWN;
+#endif
+    }
+    
+    s_state.arrayBuffer = STATE_UNKNOWN;
+    s_state.elementArrayBuffer = STATE_UNKNOWN;
+    
+    s_state.vertexArray = STATE_UNKNOWN;
+    s_state.defaultElementArrayBuffer = STATE_UNKNOWN;
+}
+
+/* ------------------------------------------------------- Capabilities */
+
+static int *s_GetCapState(GLenum cap) {
+    TextureUnitState *unit = NULL;
+    
+    switch(cap) {
+        case GL_BLEND: return &s_state.caps[CAP_BLEND];
+        case GL_SCISSOR_TEST: return &s_state.caps[CAP_SCISSOR_TEST];
+        case GL_DEPTH_TEST: return &s_state.caps[CAP_DEPTH_TEST];
+        case GL_CULL_FACE: return &s_state.caps[CAP_CULL_FACE];
+#ifndef DXPORTLIB_DRAW_OPENGL_ES2
+        case GL_ALPHA_TEST: return &s_state.caps[CAP_ALPHA_TEST];
+        case GL_TEXTURE_2D:
+        case GL_TEXTURE_RECTANGLE_ARB:
+            if (s_state.activeTexture < 0 || s_state.activeTexture >= MAX_TEXTURE_UNITS) {
+                return NULL;
+            }
+            unit = &s_state.textureUnits[s_state.activeTexture];
+            if (cap == GL_TEXTURE_2D) {
+                return &unit->enabled2D;
+            }
+            return &unit->enabledRectangle;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+int PLGL_State_Enable(GLenum cap) {
+    int *capState = s_GetCapState(cap);
+    if (capState != NULL) {
+        if (*capState == DXTRUE) {
+            return s_Elided();
+        }
+        *capState = DXTRUE;
+    }
+    
+    PL_GL.glEnable(cap);
+    s_Issued();
+    return 0;
+}
+
+int PLGL_State_Disable(GLenum cap) {
+    int *capState = s_GetCapState(cap);
+    if (capState != NULL) {
+        if (*capState == DXFALSE) {
+            return s_Elided();
+        }
+        *capState = DXFALSE;
+    }
+    
+    PL_GL.glDisable(cap);
+    s_Issued();
+    return 0;
+}
+
+/* ----------------------------------------------------------- Blending */
+
+int PLGL_State_BlendFunc(GLenum src, GLenum dest) {
+    if (s_state.blendSrcRGB == (GLint)src && s_state.blendDestRGB == (GLint)dest
+        && s_state.blendSrcAlpha == (GLint)src && s_state.blendDestAlpha == (GLint)dest
+    ) {
+        return s_Elided();
+    }
+    
+    s_state.blendSrcRGB = src;
+    s_state.blendDestRGB = dest;
+    s_state.blendSrcAlpha = src;
+    s_state.blendDestAlpha = dest;
+    
+    PL_GL.glBlendFunc(src, dest);
+    s_Issued();
+    return 0;
+}
+
+int PLGL_State_BlendFuncSeparate(GLenum srcRGB, GLenum destRGB,
+                                 GLenum srcAlpha, GLenum destAlpha) {
+    if (s_state.blendSrcRGB == (GLint)srcRGB && s_state.blendDestRGB == (GLint)destRGB
+        && s_state.blendSrcAlpha == (GLint)srcAlpha && s_state.blendDestAlpha == (GLint)destAlpha
+    ) {
+        return s_Elided();
+    }
+    
+    s_state.blendSrcRGB = srcRGB;
+    s_state.blendDestRGB = destRGB;
+    s_state.blendSrcAlpha = srcAlpha;
+    s_state.blendDestAlpha = destAlpha;
+    
+    PL_GL.glBlendFuncSeparate(srcRGB, destRGB, srcAlpha, destAlpha);
+    s_Issued();
+    return 0;
+}
+
+int PLGL_State_BlendEquation(GLenum equation) {
+    if (s_state.blendEquation == (GLint)equation) {
+        return s_Elided();
+    }
+    s_state.blendEquation = equation;
+    
+    PL_GL.glBlendEquation(equation);
+    s_Issued();
+    return 0;
+}
+
+/* ---------------------------------------------------- Scissor/Depth */
+
+int PLGL_State_Scissor(GLint x, GLint y, GLsizei w, GLsizei h) {
+    if (s_state.scissorX == x && s_state.scissorY == y
+        && s_state.scissorW == w && s_state.scissorH == h
+    ) {
+        return s_Elided();
+    }
+    
+    s_state.scissorX = x;
+    s_state.scissorY = y;
+    s_state.scissorW = w;
+    s_state.scissorH = h;
+    
+    PL_GL.glScissor(x, y, w, h);
+    s_Issued();
+    return 0;
+}
+
+int PLGL_State_DepthFunc(GLenum func) {
+    if (s_state.depthFunc == (GLint)func) {
+        return s_Elided();
+    }
+    s_state.depthFunc = func;
+    
+    PL_GL.glDepthFunc(func);
+    s_Issued();
+    return 0;
+}
+
+int PLGL_State_DepthMask(GLboolean flag) {
+    if (s_state.depthMask == (GLint)flag) {
+        return s_Elided();
+    }
+    s_state.depthMask = flag;
+    
+    PL_GL.glDepthMask(flag);
+    s_Issued();
+    return 0;
+}
+
+/* ------------------------------------------------------------ Program */
+
+int PLGL_State_UseProgram(GLuint programID) {
+    if (s_state.program == (GLint)programID) {
+        return s_Elided();
+    }
+    s_state.program = programID;
+    
+    PL_GL.glUseProgram(programID);
+    s_Issued();
+    return 0;
+}
+
+int PLGL_State_DeleteProgram(GLuint programID) {
+    if (s_state.program == (GLint)programID) {
+        s_state.program = STATE_UNKNOWN;
+    }
+    
+    PL_GL.glDeleteProgram(programID);
+    return 0;
+}
+
+/* ----------------------------------------------------------- Textures */
+
+int PLGL_State_ActiveTexture(unsigned int unit) {
+    if (s_state.activeTexture == (GLint)unit) {
+        return s_Elided();
+    }
+    s_state.activeTexture = unit;
+    
+    PL_GL.glActiveTexture(GL_TEXTURE0 + unit);
+    s_Issued();
+    return 0;
+}
+
+int PLGL_State_BindTexture(GLenum target, GLuint textureID) {
+    TextureUnitState *unit = NULL;
+    
+    if (s_state.activeTexture >= 0 && s_state.activeTexture < MAX_TEXTURE_UNITS) {
+        unit = &s_state.textureUnits[s_state.activeTexture];
+        if (unit->boundTarget == target && unit->boundTextureID == (GLint)textureID) {
+            return s_Elided();
+        }
+        unit->boundTarget = target;
+        unit->boundTextureID = textureID;
+    }
+    
+    PL_GL.glBindTexture(target, textureID);
+    s_Issued();
+    return 0;
+}
+
+int PLGL_State_DeleteTexture(GLuint textureID) {
+    int i;
+    
+    for (i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+        TextureUnitState *unit = &s_state.textureUnits[i];
+        if (unit->boundTextureID == (GLint)textureID) {
+            unit->boundTextureID = 0;
+        }
+    }
+    
+    PL_GL.glDeleteTextures(1, &textureID);
+    return 0;
+}
+
+/* ------------------------------------------------------------ Buffers */
+
+static GLint *s_GetBufferState(GLenum target) {
+    switch(target) {
+        case GL_ARRAY_BUFFER: return &s_state.arrayBuffer;
+        case GL_ELEMENT_ARRAY_BUFFER: return &s_state.elementArrayBuffer;
+        default: return NULL;
+    }
+}
+
+int PLGL_State_BindBuffer(GLenum target, GLuint bufferID) {
+    GLint *bufferState = s_GetBufferState(target);
+    
+    if (target == GL_ELEMENT_ARRAY_BUFFER && s_state.vertexArray != 0
+        && s_state.elementArrayBuffer != (GLint)bufferID
+        && PL_GL.hasVertexArraySupport == DXTRUE
+    ) {
+        PLGL_State_BindVertexArray(0, 0);
+    }
+    
+    if (bufferState != NULL) {
+        if (*bufferState == (GLint)bufferID) {
+            return s_Elided();
+        }
+        *bufferState = bufferID;
+    }
+    
+    PL_GL.glBindBuffer(target, bufferID);
+    s_Issued();
+    return 0;
+}
+
+int PLGL_State_DeleteBuffer(GLuint bufferID) {
+    if (s_state.arrayBuffer == (GLint)bufferID) {
+        s_state.arrayBuffer = 0;
+    }
+    if (s_state.elementArrayBuffer == (GLint)bufferID) {
+        s_state.elementArrayBuffer = 0;
+    }
+    if (s_state.defaultElementArrayBuffer == (GLint)bufferID) {
+        s_state.defaultElementArrayBuffer = STATE_UNKNOWN;
+    }
+    
+    /* Vertex arrays hold on to the buffers they were set up with. */
+    if (PL_GL.hasVertexArraySupport == DXTRUE) {
+        PLGL_Shaders_ForgetBuffer(bufferID);
+    }
+    
+    PL_GL.glDeleteBuffers(1, &bufferID);
+    return 0;
+}
+
+/* ------------------------------------------------------ Vertex arrays */
+
+/* indexBufferID is the element buffer the vertex array already has, so
+ * that it can be tracked along with it. It is ignored for the default
+ * vertex array, whose binding is remembered here. */
+int PLGL_State_BindVertexArray(GLuint vertexArrayID, GLuint indexBufferID) {
+    if (s_state.vertexArray == (GLint)vertexArrayID) {
+        return s_Elided();
+    }
+    
+    if (s_state.vertexArray == 0) {
+        s_state.defaultElementArrayBuffer = s_state.elementArrayBuffer;
+    }
+    if (vertexArrayID == 0) {
+        s_state.elementArrayBuffer = s_state.defaultElementArrayBuffer;
+    } else {
+        s_state.elementArrayBuffer = indexBufferID;
+    }
+    s_state.vertexArray = vertexArrayID;
+    
+    PL_GL.glBindVertexArray(vertexArrayID);
+    s_Issued();
+    return 0;
+}
+
+/* Sets the element buffer of the bound vertex array itself, when it is
+ * first set up. */
+int PLGL_State_BindVertexArrayIndexBuffer(GLuint bufferID) {
+    if (s_state.elementArrayBuffer == (GLint)bufferID) {
+        return s_Elided();
+    }
+    s_state.elementArrayBuffer = bufferID;
+    
+    PL_GL.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferID);
+    s_Issued();
+    return 0;
+}
+
+int PLGL_State_DeleteVertexArray(GLuint vertexArrayID) {
+    if (s_state.vertexArray == (GLint)vertexArrayID) {
+        s_state.vertexArray = 0;
+        s_state.elementArrayBuffer = s_state.defaultElementArrayBuffer;
+    }
+    
+    PL_GL.glDeleteVertexArrays(1, &vertexArrayID);
+    return 0;
+}
+
+#endif /* #ifdef DXPORTLIB_DRAW_OPENGL */
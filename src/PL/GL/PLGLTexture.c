@@ -276,9 +276,9 @@ static void s_blitSurface(TextureRef *textureRef, SDL_Surface *surface, const PL
     GLuint textureTarget = textureRef->glTarget;
     
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
-    PL_GL.glEnable(textureTarget);
+    PLGL_State_Enable(textureTarget);
 #endif
-    PL_GL.glBindTexture(textureTarget, textureRef->textureID);
+    PLGL_State_BindTexture(textureTarget, textureRef->textureID);
     PL_GL.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
     PL_GL.glPixelStorei(GL_UNPACK_ROW_LENGTH, (surface->pitch / surface->format->BytesPerPixel));
@@ -297,7 +297,7 @@ static void s_blitSurface(TextureRef *textureRef, SDL_Surface *surface, const PL
     );
     
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
-    PL_GL.glDisable(textureTarget);
+    PLGL_State_Disable(textureTarget);
 #endif
 }
 
@@ -310,9 +310,9 @@ int PLGL_Texture_Bind(int textureRefID, int drawMode) {
     
     textureTarget = textureref->glTarget;
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
-    PL_GL.glEnable(textureTarget);
+    PLGL_State_Enable(textureTarget);
 #endif
-    PL_GL.glBindTexture(textureTarget, textureref->textureID);
+    PLGL_State_BindTexture(textureTarget, textureref->textureID);
     
     if (drawMode != textureref->drawMode) {
         textureref->drawMode = drawMode;
@@ -339,7 +339,7 @@ int PLGL_Texture_Unbind(int textureRefID) {
     }
     
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
-    PL_GL.glDisable(textureref->glTarget);
+    PLGL_State_Disable(textureref->glTarget);
 #endif
     return 0;
 }
@@ -463,9 +463,9 @@ int PLGL_Texture_CreateFromDimensions(int width, int height, int hasAlphaChannel
     
     PL_GL.glGetError();
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
-    PL_GL.glEnable(textureTarget);
+    PLGL_State_Enable(textureTarget);
 #endif
-    PL_GL.glBindTexture(textureTarget, textureID);
+    PLGL_State_BindTexture(textureTarget, textureID);
     PL_GL.glTexParameteri(textureTarget, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     PL_GL.glTexParameteri(textureTarget, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     
@@ -484,17 +484,17 @@ int PLGL_Texture_CreateFromDimensions(int width, int height, int hasAlphaChannel
         );
     
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
-    PL_GL.glDisable(textureTarget);
+    PLGL_State_Disable(textureTarget);
 #endif
     if (PL_GL.glGetError() != GL_NO_ERROR) {
-        PL_GL.glDeleteTextures(1, &textureID);
+        PLGL_State_DeleteTexture(textureID);
         return -1;
     }
 
     /* - Assign to texture reference. */
     textureRefID = s_AllocateTextureRefID(textureID);
     if (textureRefID < 0) {
-        PL_GL.glDeleteTextures(1, &textureID);
+        PLGL_State_DeleteTexture(textureID);
         return -1;
     }
     
@@ -570,15 +570,15 @@ int PLGL_Texture_SetWrap(int textureRefID, int wrapState) {
     }
     
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
-    PL_GL.glEnable(textureTarget);
+    PLGL_State_Enable(textureTarget);
 #endif
-    PL_GL.glBindTexture(textureTarget, textureref->textureID);
+    PLGL_State_BindTexture(textureTarget, textureref->textureID);
     
     PL_GL.glTexParameteri(textureTarget, GL_TEXTURE_WRAP_S, wrapMode);
     PL_GL.glTexParameteri(textureTarget, GL_TEXTURE_WRAP_T, wrapMode);
     
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
-    PL_GL.glDisable(textureTarget);
+    PLGL_State_Disable(textureTarget);
 #endif
     
     return 0;
@@ -594,15 +594,15 @@ int s_glSetFilter(int textureRefID, GLint minFilter, GLint magFilter) {
     textureTarget = textureref->glTarget;
     
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
-    PL_GL.glEnable(textureTarget);
+    PLGL_State_Enable(textureTarget);
 #endif
-    PL_GL.glBindTexture(textureTarget, textureref->textureID);
+    PLGL_State_BindTexture(textureTarget, textureref->textureID);
     
     PL_GL.glTexParameteri(textureTarget, GL_TEXTURE_MIN_FILTER, minFilter);
     PL_GL.glTexParameteri(textureTarget, GL_TEXTURE_MAG_FILTER, magFilter);
     
 #ifndef DXPORTLIB_DRAW_OPENGL_ES2
-    PL_GL.glDisable(textureTarget);
+    PLGL_State_Disable(textureTarget);
 #endif
     
     return 0;
@@ -630,7 +630,7 @@ int PLGL_Texture_Release(int textureRefID) {
             textureref->base.releaseFunc(textureRefID);
         }
         if (textureref->textureID > 0) {
-            PL_GL.glDeleteTextures(1, &textureref->textureID);
+            PLGL_State_DeleteTexture(textureref->textureID);
             textureref->textureID = 0;
         }
         if (textureref->framebufferID >= 0) {
@@ -757,7 +757,7 @@ int PLGL_Texture_ClearAllData() {
         
         if (textureref != NULL) {
             if (textureref->textureID > 0) {
-                PL_GL.glDeleteTextures(1, &textureref->textureID);
+                PLGL_State_DeleteTexture(textureref->textureID);
                 textureref->textureID = 0;
             }
             
@@ -0,0 +1,370 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+    
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "PLInternal.h"
+
+/* Background loading.
+ *
+ * A job comes in two halves. The work function runs on a worker thread
+ * and does everything that is safe there: opening and reading files,
+ * decoding, converting pixel and sample formats. The finish function
+ * runs later on the main thread, from PL_Async_ProcessFinished, and
+ * does whatever is left, such as uploading textures.
+ *
+ * Handles that are still loading have their job recorded with
+ * PL_Handle_SetASyncJob. Anything that needs the result early calls
+ * PL_Async_WaitHandle, which completes the job right away. If no worker
+ * has started on it yet, it is simply run on the calling thread.
+ *
+ * Work functions may only use the file layer, surfaces that nothing
+ * else can see yet, and the handle table, which is locked internally.
+ */
+
+#define JOBSTATE_QUEUED 0
+#define JOBSTATE_RUNNING 1
+#define JOBSTATE_DONE 2
+
+#define MAX_WORKERS 4
+
+typedef struct AsyncJob {
+    int jobID;
+    int state;
+    
+    PLAsyncWorkFunction workFunc;
+    PLAsyncFinishFunction finishFunc;
+    void *userdata;
+    int workResult;
+    
+    struct AsyncJob *next;
+} AsyncJob;
+
+typedef struct JobList {
+    AsyncJob *head;
+    AsyncJob *tail;
+} JobList;
+
+static SDL_mutex *s_mutex = NULL;
+static SDL_cond *s_workCond = NULL;
+static SDL_cond *s_doneCond = NULL;
+
+static SDL_Thread *s_workers[MAX_WORKERS];
+static int s_workerCount = 0;
+static int s_quitFlag = DXFALSE;
+static int s_startFailed = DXFALSE;
+
+static JobList s_queued = { NULL, NULL };
+static JobList s_done = { NULL, NULL };
+
+/* Submitted, but not finished yet. Main thread only. */
+static int s_pendingCount = 0;
+
+static int s_useASyncLoadFlag = DXFALSE;
+
+/* ------------------------------------------------------------ Job lists */
+
+static void s_ListPush(JobList *list, AsyncJob *job) {
+    job->next = NULL;
+    if (list->tail != NULL) {
+        list->tail->next = job;
+    } else {
+        list->head = job;
+    }
+    list->tail = job;
+}
+
+static AsyncJob *s_ListPop(JobList *list) {
+    AsyncJob *job = list->head;
+    if (job != NULL) {
+        list->head = job->next;
+        if (list->head == NULL) {
+            list->tail = NULL;
+        }
+        job->next = NULL;
+    }
+    return job;
+}
+
+static void s_ListRemove(JobList *list, AsyncJob *job) {
+    AsyncJob *prev = NULL;
+    AsyncJob *cur = list->head;
+    
+    while (cur != NULL && cur != job) {
+        prev = cur;
+        cur = cur->next;
+    }
+    if (cur == NULL) {
+        return;
+    }
+    
+    if (prev != NULL) {
+        prev->next = job->next;
+    } else {
+        list->head = job->next;
+    }
+    if (list->tail == job) {
+        list->tail = prev;
+    }
+    job->next = NULL;
+}
+
+/* -------------------------------------------------------------- Workers */
+
+static int SDLCALL s_WorkerThread(void *unused) {
+    SDL_LockMutex(s_mutex);
+    while (s_quitFlag == DXFALSE) {
+        AsyncJob *job = s_ListPop(&s_queued);
+        int result;
+    
+        if (job == NULL) {
+            SDL_CondWait(s_workCond, s_mutex);
+            continue;
+        }
+    
+        job->state = JOBSTATE_RUNNING;
+        SDL_UnlockMutex(s_mutex);
+    
+        result = job->workFunc(job->userdata);
+    
+        SDL_LockMutex(s_mutex);
+        job->workResult = result;
+        job->state = JOBSTATE_DONE;
+        s_ListPush(&s_done, job);
+        SDL_CondBroadcast(s_doneCond);
+    }
+    SDL_UnlockMutex(s_mutex);
+    
+    return 0;
+}
+
+static int s_Start() {
+    int count;
+    
+    if (s_workerCount > 0) {
+        return 0;
+    }
+    if (s_startFailed == DXTRUE) {
+        return -1;
+    }
+    
+    s_mutex = SDL_CreateMutex();
+    s_workCond = SDL_CreateCond();
+    s_doneCond = SDL_CreateCond();
+    if (s_mutex == NULL || s_workCond == NULL || s_doneCond == NULL) {
+        PL_Async_End();
+        s_startFailed = DXTRUE;
+        return -1;
+    }
+    
+    /* Leave a core for the main thread. */
+    count = SDL_GetCPUCount() - 1;
+    if (count < 1) {
+        count = 1;
+    } else if (count > MAX_WORKERS) {
+        count = MAX_WORKERS;
+    }
+    
+    s_quitFlag = DXFALSE;
+    while (s_workerCount < count) {
+        SDL_Thread *thread = SDL_CreateThread(s_WorkerThread, "DPLLoader", NULL);
+        if (thread == NULL) {
+            break;
+        }
+        s_workers[s_workerCount] = thread;
+        s_workerCount += 1;
+    }
+    
+    if (s_workerCount == 0) {
+        PL_Async_End();
+        s_startFailed = DXTRUE;
+        return -1;
+    }
+    
+    return 0;
+}
+
+/* ------------------------------------------------------------ Finishing */
+
+static void s_FinishJob(AsyncJob *job) {
+    job->finishFunc(job->userdata, job->workResult);
+    
+    s_pendingCount -= 1;
+    PL_Handle_ReleaseID(job->jobID, DXTRUE);
+}
+
+/* Submits a job, returning its ID. If no worker threads can be started,
+ * the job is run to completion before returning, and -1 is returned. */
+int PL_Async_Submit(PLAsyncWorkFunction workFunc,
+                    PLAsyncFinishFunction finishFunc,
+                    void *userdata) {
+    int jobID;
+    AsyncJob *job;
+    
+    if (s_Start() < 0
+        || (jobID = PL_Handle_AcquireID(DXHANDLE_ASYNCJOB)) < 0
+    ) {
+        finishFunc(userdata, workFunc(userdata));
+        return -1;
+    }
+    
+    job = (AsyncJob *)PL_Handle_AllocateData(jobID, sizeof(AsyncJob));
+    job->jobID = jobID;
+    job->state = JOBSTATE_QUEUED;
+    job->workFunc = workFunc;
+    job->finishFunc = finishFunc;
+    job->userdata = userdata;
+    job->workResult = 0;
+    
+    s_pendingCount += 1;
+    
+    SDL_LockMutex(s_mutex);
+    s_ListPush(&s_queued, job);
+    SDL_CondSignal(s_workCond);
+    SDL_UnlockMutex(s_mutex);
+    
+    return jobID;
+}
+
+/* Completes the job now, including its finish function. */
+int PL_Async_Wait(int jobID) {
+    AsyncJob *job = (AsyncJob *)PL_Handle_GetData(jobID, DXHANDLE_ASYNCJOB);
+    if (job == NULL) {
+        return -1;
+    }
+    
+    SDL_LockMutex(s_mutex);
+    if (job->state == JOBSTATE_QUEUED) {
+        s_ListRemove(&s_queued, job);
+        job->state = JOBSTATE_RUNNING;
+        SDL_UnlockMutex(s_mutex);
+    
+        job->workResult = job->workFunc(job->userdata);
+        job->state = JOBSTATE_DONE;
+    } else {
+        while (job->state != JOBSTATE_DONE) {
+            SDL_CondWait(s_doneCond, s_mutex);
+        }
+        s_ListRemove(&s_done, job);
+        SDL_UnlockMutex(s_mutex);
+    }
+    
+    s_FinishJob(job);
+    
+    return 0;
+}
+
+int PL_Async_WaitHandle(int handleID) {
+    int jobID = PL_Handle_GetASyncJob(handleID);
+    if (jobID < 0) {
+        return 0;
+    }
+    
+    return PL_Async_Wait(jobID);
+}
+
+/* TRUE if the handle is still loading, FALSE if it is ready,
+ * and -1 if it isn't a handle at all (or failed to load). */
+int PL_Async_IsHandleLoading(int handleID) {
+    if (PL_Handle_GetType(handleID) == DXHANDLE_NONE) {
+        return -1;
+    }
+    
+    return (PL_Handle_GetASyncJob(handleID) >= 0) ? DXTRUE : DXFALSE;
+}
+
+/* Runs the finish function of every job whose work is done.
+ * Returns how many were finished. */
+int PL_Async_ProcessFinished() {
+    int count = 0;
+    
+    if (s_workerCount == 0) {
+        return 0;
+    }
+    
+    for (;;) {
+        AsyncJob *job;
+    
+        SDL_LockMutex(s_mutex);
+        job = s_ListPop(&s_done);
+        SDL_UnlockMutex(s_mutex);
+    
+        if (job == NULL) {
+            break;
+        }
+    
+        s_FinishJob(job);
+        count += 1;
+    }
+    
+    return count;
+}
+
+int PL_Async_GetPendingCount() {
+    return s_pendingCount;
+}
+
+int PL_Async_SetUseASyncLoadFlag(int flag) {
+    s_useASyncLoadFlag = (flag == DXFALSE) ? DXFALSE : DXTRUE;
+    return 0;
+}
+int PL_Async_GetUseASyncLoadFlag() {
+    return s_useASyncLoadFlag;
+}
+
+/* Completes every outstanding job and stops the worker threads. */
+void PL_Async_End() {
+    int i;
+    
+    if (s_mutex != NULL) {
+        int jobID;
+        while ((jobID = PL_Handle_GetFirstIDOf(DXHANDLE_ASYNCJOB)) >= 0) {
+            PL_Async_Wait(jobID);
+        }
+    
+        SDL_LockMutex(s_mutex);
+        s_quitFlag = DXTRUE;
+        SDL_CondBroadcast(s_workCond);
+        SDL_UnlockMutex(s_mutex);
+    }
+    
+    for (i = 0; i < s_workerCount; ++i) {
+        SDL_WaitThread(s_workers[i], NULL);
+        s_workers[i] = NULL;
+    }
+    s_workerCount = 0;
+    
+    if (s_doneCond != NULL) {
+        SDL_DestroyCond(s_doneCond);
+        s_doneCond = NULL;
+    }
+    if (s_workCond != NULL) {
+        SDL_DestroyCond(s_workCond);
+        s_workCond = NULL;
+    }
+    if (s_mutex != NULL) {
+        SDL_DestroyMutex(s_mutex);
+        s_mutex = NULL;
+    }
+    
+    s_queued.head = s_queued.tail = NULL;
+    s_done.head = s_done.tail = NULL;
+    s_pendingCount = 0;
+    s_startFailed = DXFALSE;
+}
@@ -1,7 +1,7 @@
 /*
   DxPortLib - A portability library for DxLib-based software.
-  Copyright (C) 2013-2015 Patrick McCarthy <mauve@sandwich.net>
-  
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
   This software is provided 'as-is', without any express or implied
   warranty.  In no event will the authors be held liable for any damages
   arising from the use of this software.
@@ -46,50 +46,81 @@
  * So we need three parts:
  * - The main mixer and playlist manager.
  * - AudioStream to manage streamed audio.
- * - AudioBuffer to manage whole sound buffers.
+ * - SampleData to hold whole sound buffers, shared between handles.
  *
  * Unsurprisingly I'm using much of the same methodology as
  * SDL_mixer did, as its method of conversion just makes sense.
  */
 
-/* This is the code I am least satisfied with in all of DxPortLib.
+/* Decoded PCM in the device format, waiting to be mixed.
  *
- * Namely, I do not like the list structure for buffers.
+ * There is exactly one writer, the decoder thread, and one reader, the
+ * mixer, so the two positions are all the synchronization needed. The
+ * main thread writes to it in place of the decoder while holding the
+ * decoder lock, and never moves the read position; rewinding is done by
+ * having the mixer skip ahead, see s_AudioStreamRewind.
  *
- * Other things to do include:
- *   We need to separate the actual buffering information from
- *   the sound instances, as well, to properly implement
- *   DuplicateSoundMem.
- */
+ * One frame is always left empty, so that a full ring can be told
+ * apart from an empty one. */
+typedef struct AudioRing {
+    unsigned char *data;
+    unsigned int capacity;
+    
+    SDL_atomic_t readPos;
+    SDL_atomic_t writePos;
+} AudioRing;
 
 typedef struct AudioStream {
     SDL_RWops *streamFile;
     
 #ifndef DXPORTLIB_NO_OGGVORBIS
     OggVorbis_File ovfile;
-
+    
     int hasLoopPoint;
     ogg_int64_t loopPoint;
     int hasLoopTarget;
     ogg_int64_t loopTarget;
 #endif /* #ifndef DXPORTLIB_NO_OGGVORBIS */
     
-    int active;
-    
     SDL_AudioCVT convert;
     
     int section;
+    
+    AudioRing ring;
+    unsigned int fillLimit;
+    
+    /* The last decoded chunk, and how much of it is still to go
+     * into the ring. */
+    unsigned char *pending;
+    unsigned int pendingSize;
+    unsigned int pendingPos;
+    unsigned int pendingLength;
+    
+    /* Set when the decoder has jumped back to a loop point since the
+     * last restart. Only used to estimate the play position. */
+    int hasWrapped;
+    
+    SDL_atomic_t loopWhole;
+    SDL_atomic_t ended;
+    SDL_atomic_t fresh;
+    SDL_atomic_t underrunCount;
+    
+    struct Sound *nextStream;
 } AudioStream;
 
-typedef struct AudioBuffer {
-    unsigned char *buffer;
-
-    unsigned int bufferSize;
+/* A whole decoded sound, in the device format. It never changes once
+ * loaded, so any number of handles and voices can play it at once. The
+ * handles that share it hold a reference each. */
+typedef struct SampleData {
+    SDL_atomic_t refCount;
     
+    unsigned char *buffer;
     unsigned int length;
+    unsigned int frames;
     
-    unsigned int currentPos;
-} AudioBuffer;
+    /* The rate it was recorded at, before it was converted. */
+    int frequency;
+} SampleData;
 
 #define SOUNDTYPE_NONE 0
 #define SOUNDTYPE_STREAM 1
@@ -98,109 +129,890 @@ typedef struct AudioBuffer {
 typedef struct Sound {
     int soundType;
     
-    int playing;
+    /* How many voices may play the sound at once. Streams only ever
+     * have the one. */
+    int maxVoices;
+    
+    /* As last set, for GetPanSoundMem and GetFrequencySoundMem. */
+    int pan;
+    int frequency;
     
+    /* Owned by the mixer. Pan is a gain for each side, and step is how
+     * far to move through the sound per output frame, both in 65536ths. */
     int volume;
+    int panLeft;
+    int panRight;
+    unsigned int step;
+    int voiceCount;
+    unsigned int resumePos;
+    
+    /* Where the mixer last was in the sound, for
+     * GetCurrentPositionSoundMem. */
+    SDL_atomic_t position;
+    
+    /* Published by the mixer. The main thread goes by requestedPlaying
+     * instead while it still has commands for the sound in flight. */
+    SDL_atomic_t playing;
+    SDL_atomic_t pendingCommands;
+    int requestedPlaying;
     
-    int playMode;
     int nextSoundIDInSequence;
     
     AudioStream stream;
-    AudioBuffer buffer;
-    
-    struct Sound *nextPlayingSound;
+    SampleData *sample;
 } Sound;
 
+#define DEFAULT_VOICE_STEAL_MODE DX_VOICESTEAL_EXT_OLDEST
+static SDL_atomic_t s_voiceStealMode = { DEFAULT_VOICE_STEAL_MODE };
+
 static int s_audioOpened = DXFALSE;
 static int s_audioCannotOpen = DXFALSE;
 static int s_audioOldVolumeCalcFlag = DXFALSE;
 static int s_audioDataType = DX_SOUNDDATATYPE_MEMNOPRESS;
 
+/* Sounds are decoded to 16-bit stereo at the device's rate, whatever
+ * the device's own format is. s_frameSize is the size of one frame of
+ * that, and s_deviceFrameSize one frame of what the device takes. */
+#define MIX_FORMAT AUDIO_S16SYS
+#define MIX_CHANNELS 2
+
+static SDL_AudioDeviceID s_audioDevice = 0;
 static SDL_AudioSpec s_audioSpec;
+static unsigned int s_frameSize = 4;
+static unsigned int s_deviceFrameSize = 4;
+
+/* What to ask for when the device is opened. */
+#define DEFAULT_DEVICE_FREQUENCY 44100
+#define DEFAULT_DEVICE_BUFFER_FRAMES 1024
+#define DEFAULT_DEVICE_FORMAT DX_SOUNDFORMAT_EXT_S16
+static int s_deviceFrequency = DEFAULT_DEVICE_FREQUENCY;
+static int s_deviceBufferFrames = DEFAULT_DEVICE_BUFFER_FRAMES;
+static int s_deviceFormat = DEFAULT_DEVICE_FORMAT;
+
+/* Everything is mixed into this first, see PLAudioMix.c. */
+static float *s_mixBus = NULL;
+static unsigned int s_mixBusFrames = 0;
+
+/* How far ahead of the mixer streams are decoded. */
+#define DEFAULT_STREAM_BUFFER_TIME 250
+static int s_streamBufferTime = DEFAULT_STREAM_BUFFER_TIME;
 
 static int s_AudioStreamOpen(Sound *sound, SDL_RWops *rwops);
 static void s_AudioStreamRestart(Sound *sound);
 static void s_AudioStreamClose(Sound *sound);
-static unsigned int s_AudioStreamPlay(Sound *sound, Uint8 *snd, unsigned int len);
+static void s_AudioStreamRewind(Sound *sound, unsigned int mark);
+static unsigned int s_AudioStreamPlay(Sound *sound, float *bus, unsigned int frames,
+                                      float gainLeft, float gainRight, int *endedFlag);
+static int s_AudioStreamGetPosition(Sound *sound);
+
+static int s_DecoderStart();
+static void s_DecoderStop();
 
 static int s_AudioBufferOpen(Sound *sound, SDL_RWops *rwops);
-static void s_AudioBufferRestart(Sound *sound);
 static void s_AudioBufferClose(Sound *sound);
-static unsigned int s_AudioBufferPlay(Sound *sound, Uint8 *snd, unsigned int len);
 
-/* -------------------------------------------------- PLAYLIST MANAGEMENT */
-static Sound *s_audioPlayingList = NULL;
+static void s_DestroySound(Sound *sound);
+
+/* ------------------------------------------------------- COMMAND QUEUE */
+
+/* The main thread never touches what the mixer is playing directly.
+ * Instead it queues commands, which the mixer works through at the start
+ * of each callback, so neither side ever waits on the other.
+ *
+ * Both queues have a single writer and a single reader: commands go from
+ * the main thread to the mixer, and sounds the mixer has let go of come
+ * back the other way to be freed.
+ *
+ * If the command queue fills up, or the device is not running, the main
+ * thread takes the audio lock and runs the commands itself.
+ */
+
+#define AUDIOCMD_PLAY   0
+#define AUDIOCMD_STOP   1
+#define AUDIOCMD_VOLUME 2
+#define AUDIOCMD_REWIND 3
+#define AUDIOCMD_FREE   4
+#define AUDIOCMD_PAN    5
+#define AUDIOCMD_PITCH  6
+
+typedef struct AudioCommand {
+    int command;
+    Sound *sound;
+    int param;
+    int param2;
+    Uint64 sendTime;
+} AudioCommand;
+
+#define COMMAND_QUEUE_SIZE 1024
+#define COMMAND_QUEUE_MASK (COMMAND_QUEUE_SIZE - 1)
+
+static AudioCommand s_commandQueue[COMMAND_QUEUE_SIZE];
+static SDL_atomic_t s_commandRead = { 0 };
+static SDL_atomic_t s_commandWrite = { 0 };
+
+static Sound *s_retiredQueue[COMMAND_QUEUE_SIZE];
+static SDL_atomic_t s_retiredRead = { 0 };
+static SDL_atomic_t s_retiredWrite = { 0 };
+
+/* -------------------------------------------------------- Statistics */
+
+/* The mixer keeps running averages of how long a play command waits to
+ * be picked up, and of how far apart callbacks are from where they
+ * should be. Both are published in microseconds.
+ *
+ * The rest belongs to the mixer. */
+#define STATS_AVERAGE_WEIGHT (1.0 / 16.0)
+
+static SDL_atomic_t s_statLatency = { 0 };
+static SDL_atomic_t s_statJitter = { 0 };
+
+static Uint64 s_counterFrequency = 1;
+static Uint64 s_lastCallbackTime = 0;
+static double s_playDelayAverage = 0.0;
+static double s_jitterAverage = 0.0;
+
+static void s_StatsReset() {
+    s_counterFrequency = SDL_GetPerformanceFrequency();
+    s_lastCallbackTime = 0;
+    s_playDelayAverage = 0.0;
+    s_jitterAverage = 0.0;
+    SDL_AtomicSet(&s_statLatency, 0);
+    SDL_AtomicSet(&s_statJitter, 0);
+}
+
+/* What is queued after a play command has to wait for one whole
+ * buffer to go out as well, so that counts towards the latency. */
+static void s_StatsPlayCommand(Uint64 sendTime) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    double delay = (double)(now - sendTime) * 1e6 / (double)s_counterFrequency;
+    double bufferTime = (double)s_audioSpec.samples * 1e6 / s_audioSpec.freq;
+    
+    s_playDelayAverage += (delay - s_playDelayAverage) * STATS_AVERAGE_WEIGHT;
+    SDL_AtomicSet(&s_statLatency, (int)(s_playDelayAverage + bufferTime));
+}
+
+static void s_StatsCallback(unsigned int frames) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    
+    if (s_lastCallbackTime != 0) {
+        double interval = (double)(now - s_lastCallbackTime) * 1e6 / (double)s_counterFrequency;
+        double expected = (double)frames * 1e6 / s_audioSpec.freq;
+        double deviation = (interval > expected) ? (interval - expected) : (expected - interval);
+    
+        s_jitterAverage += (deviation - s_jitterAverage) * STATS_AVERAGE_WEIGHT;
+        SDL_AtomicSet(&s_statJitter, (int)s_jitterAverage);
+    }
+    s_lastCallbackTime = now;
+}
+
+/* ------------------------------------------------------------ Voices */
+
+/* A voice is one playback of a sound, with its own position and volume.
+ * A sound may have several at once, up to its maxVoices, all reading the
+ * same sample data.
+ *
+ * The pool is fixed in size. When it runs out, a voice is taken from
+ * another sound, following the steal mode. Streams are never taken.
+ *
+ * Everything here belongs to the mixer.
+ */
+#define MAX_VOICES 256
+
+typedef struct Voice {
+    Sound *sound;
+    
+    /* In frames, and 65536ths of a frame. */
+    unsigned int position;
+    unsigned int fraction;
+    unsigned int step;
+    
+    int volume;
+    float gainLeft;
+    float gainRight;
+    int playMode;
+    
+    unsigned int serial;
+} Voice;
+
+static Voice s_voices[MAX_VOICES];
+static int s_voiceCount = 0;
+static unsigned int s_voiceSerial = 0;
+
+static void s_VoiceSetPlayMode(Voice *voice, int playMode) {
+    Sound *sound = voice->sound;
+    
+    voice->playMode = playMode;
+    if (sound->soundType == SOUNDTYPE_STREAM) {
+        SDL_AtomicSet(&sound->stream.loopWhole,
+                      ((playMode & DX_PLAYTYPE_LOOP) == DX_PLAYTYPE_LOOP) ? 1 : 0);
+    }
+}
+
+/* Takes the volume, pan and pitch from the voice's sound. */
+static void s_VoiceUpdate(Voice *voice) {
+    Sound *sound = voice->sound;
+    float gain = (float)sound->volume / (SDL_MIX_MAXVOLUME * 65536.0f);
+    
+    voice->volume = sound->volume;
+    voice->gainLeft = gain * (float)sound->panLeft;
+    voice->gainRight = gain * (float)sound->panRight;
+    voice->step = sound->step;
+}
+
+static void s_VoiceAttach(Voice *voice, Sound *sound, int playMode, unsigned int position) {
+    voice->sound = sound;
+    voice->position = position;
+    voice->fraction = 0;
+    voice->serial = s_voiceSerial++;
+    s_VoiceUpdate(voice);
+    s_VoiceSetPlayMode(voice, playMode);
+    
+    sound->voiceCount += 1;
+    SDL_AtomicSet(&sound->playing, 1);
+}
+
+static void s_VoiceDetach(Voice *voice) {
+    Sound *sound = voice->sound;
+    
+    sound->voiceCount -= 1;
+    if (sound->voiceCount == 0) {
+        SDL_AtomicSet(&sound->playing, 0);
+    }
+    voice->sound = NULL;
+}
+
+/* Removes the voice from the pool. The last voice moves into its slot. */
+static void s_VoiceRemove(int index) {
+    s_VoiceDetach(&s_voices[index]);
+    
+    s_voiceCount -= 1;
+    if (index != s_voiceCount) {
+        s_voices[index] = s_voices[s_voiceCount];
+    }
+    s_voices[s_voiceCount].sound = NULL;
+}
+
+/* Picks a voice to give up for a new one, or returns -1. */
+static int s_VoiceFindSteal() {
+    int mode = SDL_AtomicGet(&s_voiceStealMode);
+    int best = -1;
+    int i;
+    
+    if (mode == DX_VOICESTEAL_EXT_NONE) {
+        return -1;
+    }
+    
+    for (i = 0; i < s_voiceCount; ++i) {
+        Voice *voice = &s_voices[i];
+        
+        if (voice->sound->soundType == SOUNDTYPE_STREAM) {
+            continue;
+        }
+        
+        if (best < 0) {
+            best = i;
+        } else if (mode == DX_VOICESTEAL_EXT_QUIETEST
+                   && voice->volume != s_voices[best].volume) {
+            if (voice->volume < s_voices[best].volume) {
+                best = i;
+            }
+        } else if ((int)(voice->serial - s_voices[best].serial) < 0) {
+            best = i;
+        }
+    }
+    
+    return best;
+}
+
+static Voice *s_VoiceAllocate() {
+    if (s_voiceCount >= MAX_VOICES) {
+        int index = s_VoiceFindSteal();
+        if (index < 0) {
+            return NULL;
+        }
+        s_VoiceRemove(index);
+    }
+    
+    s_voiceCount += 1;
+    return &s_voices[s_voiceCount - 1];
+}
+
+/* The sound's oldest voice, or -1. */
+static int s_VoiceFindOldest(Sound *sound) {
+    int best = -1;
+    int i;
+    
+    for (i = 0; i < s_voiceCount; ++i) {
+        Voice *voice = &s_voices[i];
+        if (voice->sound == sound
+            && (best < 0 || (int)(voice->serial - s_voices[best].serial) < 0)
+        ) {
+            best = i;
+        }
+    }
+    
+    return best;
+}
+
+static void s_SoundPlay(Sound *sound, int playMode, int fromStartFlag) {
+    Voice *voice;
+    
+    if (sound->voiceCount > 0
+        && (fromStartFlag == DXFALSE || sound->voiceCount >= sound->maxVoices)
+    ) {
+        /* Out of voices of its own, so the oldest one starts over. */
+        voice = &s_voices[s_VoiceFindOldest(sound)];
+        if (fromStartFlag) {
+            voice->position = 0;
+            voice->fraction = 0;
+            voice->serial = s_voiceSerial++;
+        }
+        s_VoiceSetPlayMode(voice, playMode);
+        return;
+    }
+    
+    voice = s_VoiceAllocate();
+    if (voice != NULL) {
+        s_VoiceAttach(voice, sound, playMode, fromStartFlag ? 0 : sound->resumePos);
+    }
+}
+
+static void s_SoundStop(Sound *sound) {
+    unsigned int newest = 0;
+    int i;
+    
+    for (i = s_voiceCount - 1; i >= 0 && sound->voiceCount > 0; --i) {
+        Voice *voice = &s_voices[i];
+        if (voice->sound == sound) {
+            if (newest == 0 || (int)(voice->serial - newest) > 0) {
+                newest = voice->serial;
+                sound->resumePos = voice->position;
+            }
+            s_VoiceRemove(i);
+        }
+    }
+}
+
+static void s_SoundUpdateVoices(Sound *sound) {
+    int i;
+    
+    for (i = 0; i < s_voiceCount; ++i) {
+        if (s_voices[i].sound == sound) {
+            s_VoiceUpdate(&s_voices[i]);
+        }
+    }
+}
+
+static void s_SoundRewind(Sound *sound) {
+    int i;
+    
+    sound->resumePos = 0;
+    for (i = 0; i < s_voiceCount; ++i) {
+        if (s_voices[i].sound == sound) {
+            s_voices[i].position = 0;
+            s_voices[i].fraction = 0;
+        }
+    }
+}
+
+/* Hands the voice over to the next sound in a sequence. The next sound
+ * is marked as playing before this one stops, so anything waiting on
+ * the sequence never sees a gap. Returns FALSE if the voice was removed
+ * instead. */
+static int s_VoiceChain(int index, Sound *nextSound) {
+    Voice *voice = &s_voices[index];
+    Sound *sound = voice->sound;
+    
+    if (nextSound->voiceCount >= nextSound->maxVoices) {
+        s_VoiceRemove(index);
+        return DXFALSE;
+    }
+    
+    s_VoiceAttach(voice, nextSound, voice->playMode, 0);
+    
+    sound->voiceCount -= 1;
+    if (sound->voiceCount == 0) {
+        SDL_AtomicSet(&sound->playing, 0);
+    }
+    
+    return DXTRUE;
+}
+
+static void s_ProcessCommands() {
+    unsigned int readPos = (unsigned int)SDL_AtomicGet(&s_commandRead);
+    unsigned int writePos = (unsigned int)SDL_AtomicGet(&s_commandWrite);
+    
+    while (readPos != writePos) {
+        AudioCommand *command = &s_commandQueue[readPos & COMMAND_QUEUE_MASK];
+        Sound *sound = command->sound;
+        
+        switch(command->command) {
+            case AUDIOCMD_PLAY:
+                s_SoundPlay(sound, command->param, command->param2);
+                s_StatsPlayCommand(command->sendTime);
+                break;
+            case AUDIOCMD_STOP:
+                s_SoundStop(sound);
+                break;
+            case AUDIOCMD_VOLUME:
+                sound->volume = command->param;
+                s_SoundUpdateVoices(sound);
+                break;
+            case AUDIOCMD_PAN:
+                sound->panLeft = command->param;
+                sound->panRight = command->param2;
+                s_SoundUpdateVoices(sound);
+                break;
+            case AUDIOCMD_PITCH:
+                sound->step = (unsigned int)command->param;
+                s_SoundUpdateVoices(sound);
+                break;
+            case AUDIOCMD_REWIND:
+                if (sound->soundType == SOUNDTYPE_STREAM) {
+                    s_AudioStreamRewind(sound, (unsigned int)command->param);
+                } else if (sound->soundType == SOUNDTYPE_BUFFER) {
+                    s_SoundRewind(sound);
+                }
+                break;
+            case AUDIOCMD_FREE:
+                s_SoundStop(sound);
+                break;
+        }
+        
+        SDL_AtomicAdd(&sound->pendingCommands, -1);
+        
+        if (command->command == AUDIOCMD_FREE) {
+            unsigned int retiredPos = (unsigned int)SDL_AtomicGet(&s_retiredWrite);
+            s_retiredQueue[retiredPos & COMMAND_QUEUE_MASK] = sound;
+            SDL_AtomicSet(&s_retiredWrite, (int)(retiredPos + 1));
+        }
+        
+        readPos += 1;
+        SDL_AtomicSet(&s_commandRead, (int)readPos);
+    }
+}
+
+/* ---------------------------------------------------------- Main thread */
+
+static void s_CollectRetired() {
+    unsigned int readPos = (unsigned int)SDL_AtomicGet(&s_retiredRead);
+    unsigned int writePos = (unsigned int)SDL_AtomicGet(&s_retiredWrite);
+    
+    while (readPos != writePos) {
+        s_DestroySound(s_retiredQueue[readPos & COMMAND_QUEUE_MASK]);
+        
+        readPos += 1;
+        SDL_AtomicSet(&s_retiredRead, (int)readPos);
+    }
+}
+
+/* Runs everything still queued right away. Blocks for up to a callback. */
+static void s_FlushCommands() {
+    SDL_LockAudioDevice(s_audioDevice);
+    s_ProcessCommands();
+    SDL_UnlockAudioDevice(s_audioDevice);
+    
+    s_CollectRetired();
+}
+
+static void s_SendCommand(int command, Sound *sound, int param, int param2) {
+    unsigned int writePos = (unsigned int)SDL_AtomicGet(&s_commandWrite);
+    AudioCommand *entry;
+    
+    s_CollectRetired();
+    
+    if (writePos - (unsigned int)SDL_AtomicGet(&s_commandRead) >= COMMAND_QUEUE_SIZE) {
+        s_FlushCommands();
+    }
+    
+    entry = &s_commandQueue[writePos & COMMAND_QUEUE_MASK];
+    entry->command = command;
+    entry->sound = sound;
+    entry->param = param;
+    entry->param2 = param2;
+    entry->sendTime = SDL_GetPerformanceCounter();
+    
+    SDL_AtomicIncRef(&sound->pendingCommands);
+    SDL_AtomicSet(&s_commandWrite, (int)(writePos + 1));
+    
+    /* No callback is coming to pick it up. */
+    if (SDL_GetAudioDeviceStatus(s_audioDevice) != SDL_AUDIO_PLAYING) {
+        s_FlushCommands();
+    }
+}
+
+/* Streams must already have been rewound with s_RestartSound. */
+static void s_StartSound(Sound *sound, int playMode, int fromStartFlag) {
+    sound->requestedPlaying = DXTRUE;
+    s_SendCommand(AUDIOCMD_PLAY, sound, playMode, fromStartFlag);
+}
 
 static void s_StopSound(Sound *sound) {
-    SDL_LockAudio();
+    sound->requestedPlaying = DXFALSE;
+    s_SendCommand(AUDIOCMD_STOP, sound, 0, 0);
+}
+
+static int s_IsSoundPlaying(Sound *sound) {
+    if (SDL_AtomicGet(&sound->pendingCommands) > 0) {
+        return sound->requestedPlaying;
+    }
+    return SDL_AtomicGet(&sound->playing);
+}
+
+/* ------------------------------------------------------ AUDIO STREAMING */
+
+/* Streams are decoded on their own thread, well ahead of the mixer, so
+ * that a slow disk or an expensive vorbis frame never holds up the audio
+ * callback. Each stream keeps a ring of converted PCM which the decoder
+ * thread tops up, and which the mixer only copies out of.
+ *
+ * Everything else in the stream belongs to whoever holds the decoder
+ * lock. The mixer never takes it.
+ */
+
+#ifndef DXPORTLIB_NO_OGGVORBIS
+
+#define STREAM_CHUNK_SIZE 4096
+
+static SDL_Thread *s_decoderThread = NULL;
+static SDL_mutex *s_decoderMutex = NULL;
+static SDL_cond *s_decoderCond = NULL;
+static int s_decoderQuit = DXFALSE;
+static Sound *s_decoderList = NULL;
+
+static void s_LockDecoder() {
+    if (s_decoderMutex != NULL) {
+        SDL_LockMutex(s_decoderMutex);
+    }
+}
+static void s_UnlockDecoder() {
+    if (s_decoderMutex != NULL) {
+        SDL_UnlockMutex(s_decoderMutex);
+    }
+}
+
+/* ---------------------------------------------------------- Ring buffer */
+
+static unsigned int s_RingUsed(AudioRing *ring) {
+    unsigned int readPos = (unsigned int)SDL_AtomicGet(&ring->readPos);
+    unsigned int writePos = (unsigned int)SDL_AtomicGet(&ring->writePos);
+    
+    return (writePos + ring->capacity - readPos) % ring->capacity;
+}
+
+static unsigned int s_RingWrite(AudioRing *ring, const unsigned char *src, unsigned int len) {
+    unsigned int readPos = (unsigned int)SDL_AtomicGet(&ring->readPos);
+    unsigned int writePos = (unsigned int)SDL_AtomicGet(&ring->writePos);
+    unsigned int space = (readPos + ring->capacity * 2 - writePos - s_frameSize) % ring->capacity;
+    unsigned int first;
+    
+    if (len > space) {
+        len = space;
+    }
+    
+    first = ring->capacity - writePos;
+    if (first > len) {
+        first = len;
+    }
+    SDL_memcpy(ring->data + writePos, src, first);
+    SDL_memcpy(ring->data, src + first, len - first);
+    
+    SDL_AtomicSet(&ring->writePos, (int)((writePos + len) % ring->capacity));
+    
+    return len;
+}
+
+/* Mixer side. Adds up to frames into the bus, returning how many. */
+static unsigned int s_RingMix(AudioRing *ring, float *bus, unsigned int frames,
+                              float gainLeft, float gainRight) {
+    unsigned int readPos = (unsigned int)SDL_AtomicGet(&ring->readPos);
+    unsigned int writePos = (unsigned int)SDL_AtomicGet(&ring->writePos);
+    unsigned int used = (writePos + ring->capacity - readPos) % ring->capacity;
+    unsigned int len = frames * s_frameSize;
+    unsigned int first;
+    
+    if (len > used) {
+        len = used;
+    }
+    
+    first = ring->capacity - readPos;
+    if (first > len) {
+        first = len;
+    }
+    PL_AudioMix_Add(bus, (const short *)(ring->data + readPos), (int)(first / s_frameSize),
+                    gainLeft, gainRight);
+    if (len > first) {
+        PL_AudioMix_Add(bus + (first / s_frameSize) * 2, (const short *)ring->data,
+                        (int)((len - first) / s_frameSize), gainLeft, gainRight);
+    }
+    
+    SDL_AtomicSet(&ring->readPos, (int)((readPos + len) % ring->capacity));
+    
+    return len / s_frameSize;
+}
+
+/* ------------------------------------------------------------- Decoding */
+
+/* Handles ogg streams via vorbisfile. */
+static size_t s_oggRead(void *ptr, size_t size, size_t num, void *datasource) {
+    SDL_RWops *rwops = (SDL_RWops *)datasource;
+    return SDL_RWread(rwops, ptr, size, num);
+}
+static int s_oggSeek(void *datasource, ogg_int64_t offset, int whence) {
+    SDL_RWops *rwops = (SDL_RWops *)datasource;
+    return (int)SDL_RWseek(rwops, offset, whence);
+}
+static long s_oggTell(void *datasource) {
+    SDL_RWops *rwops = (SDL_RWops *)datasource;
+    return (long)SDL_RWtell(rwops);
+}
+
+/* Decodes and converts the next chunk into the pending buffer.
+ * Returns the number of bytes decoded, 0 if the stream looped back
+ * instead, or -1 at the end of the stream. */
+static int s_AudioStreamDecode(AudioStream *stream) {
+    char inbuf[STREAM_CHUNK_SIZE];
+    int amount = 0, amount2;
+    int section;
+    SDL_AudioCVT *convert;
+    
+    if (stream->hasLoopPoint != DXFALSE) {
+        vorbis_info *info = ov_info(&stream->ovfile, -1);
+        ogg_int64_t bufpos = ov_pcm_tell(&stream->ovfile);
+        ogg_int64_t n = (stream->loopPoint - bufpos) * (2 * info->channels);
+        if (n > 0 && n < sizeof(inbuf)) {
+            amount = ov_read(&stream->ovfile, inbuf, (int)n, 0, 2, 1, &section);
+            ov_pcm_seek(&stream->ovfile, stream->loopTarget);
+            stream->hasWrapped = DXTRUE;
+    
+            if (amount < 0) {
+                amount = 0;
+            }
+        }
+    }
+    
+    amount2 = ov_read(&stream->ovfile, inbuf + amount, sizeof(inbuf) - amount, 0, 2, 1, &section);
+    if (amount2 <= 0) {
+        if (stream->hasLoopTarget != DXFALSE) {
+            if (ov_pcm_seek(&stream->ovfile, stream->loopTarget) == 0) {
+                stream->hasWrapped = DXTRUE;
+                return 0;
+            }
+        } else if (SDL_AtomicGet(&stream->loopWhole) != 0) {
+            if (ov_pcm_seek(&stream->ovfile, 0) == 0) {
+                stream->hasWrapped = DXTRUE;
+                return 0;
+            }
+        }
+    
+        return -1;
+    }
+    amount += amount2;
+    
+    convert = &stream->convert;
+    
+    if (stream->pending == NULL || section != stream->section) {
+        /* create conversion buffer */
+        vorbis_info *info;
+        unsigned int bufferSize;
+    
+        info = ov_info(&stream->ovfile, -1);
+        SDL_BuildAudioCVT(convert, AUDIO_S16,
+                          (Uint8)info->channels,
+                          info->rate,
+                          MIX_FORMAT,
+                          MIX_CHANNELS,
+                          s_audioSpec.freq);
+    
+        bufferSize = sizeof(inbuf) * (unsigned int)convert->len_mult;
+    
+        if (stream->pending != NULL && bufferSize > stream->pendingSize) {
+            DXFREE(stream->pending);
+            stream->pending = NULL;
+        }
+    
+        if (stream->pending == NULL) {
+            stream->pending = DXALLOC(bufferSize);
+            stream->pendingSize = bufferSize;
+        }
+    
+        convert->buf = stream->pending;
+    
+        stream->section = section;
+    }
+    
+    if (stream->pending == NULL) {
+        return -1;
+    }
+    
+    SDL_memcpy(stream->pending, inbuf, (unsigned int) amount);
+    
+    if (convert->needed) {
+        convert->len = amount;
+        SDL_ConvertAudio(convert);
+    } else {
+        convert->len_cvt = amount;
+    }
+    stream->pendingLength = (unsigned int)convert->len_cvt;
+    stream->pendingPos = 0;
+    
+    return amount;
+}
+
+/* Moves decoded audio into the ring until it holds limit bytes, or at
+ * least maxBytes have gone in, decoding more as needed. Returns how many
+ * bytes went in. Needs the decoder lock. */
+static unsigned int s_AudioStreamFill(AudioStream *stream, unsigned int limit, unsigned int maxBytes) {
+    unsigned int written = 0;
+    int emptyCount = 0;
+    
+    while (written < maxBytes) {
+        int result;
+        
+        if (stream->pendingPos < stream->pendingLength) {
+            unsigned int used = s_RingUsed(&stream->ring);
+            unsigned int amount = stream->pendingLength - stream->pendingPos;
+            
+            if (used >= limit) {
+                break;
+            }
+            if (amount > limit - used) {
+                amount = limit - used;
+            }
+            
+            amount = s_RingWrite(&stream->ring, stream->pending + stream->pendingPos, amount);
+            stream->pendingPos += amount;
+            written += amount;
+            
+            if (stream->pendingPos < stream->pendingLength) {
+                break;
+            }
+            continue;
+        }
+        
+        if (SDL_AtomicGet(&stream->ended) != 0) {
+            /* Looping may have been turned on after the end was reached. */
+            if (SDL_AtomicGet(&stream->loopWhole) == 0
+                || ov_pcm_seek(&stream->ovfile, 0) != 0
+            ) {
+                break;
+            }
+            stream->hasWrapped = DXTRUE;
+            SDL_AtomicSet(&stream->ended, 0);
+        }
+        
+        result = s_AudioStreamDecode(stream);
+        if (result > 0) {
+            emptyCount = 0;
+        } else if (result < 0 || ++emptyCount > 1) {
+            /* Either the end, or a loop that produces nothing. */
+            SDL_AtomicSet(&stream->ended, 1);
+            break;
+        }
+    }
+    
+    return written;
+}
+
+/* Forgets everything decoded so far. The mixer skips what it has not
+ * played yet once it gets the rewind command. */
+static void s_AudioStreamReset(AudioStream *stream) {
+    stream->pendingPos = 0;
+    stream->pendingLength = 0;
+    stream->hasWrapped = DXFALSE;
+    
+    SDL_AtomicSet(&stream->ended, 0);
+    SDL_AtomicSet(&stream->fresh, 1);
+}
+
+/* ------------------------------------------------------- Decoder thread */
+
+static int SDLCALL s_DecoderThread(void *unused) {
+    SDL_LockMutex(s_decoderMutex);
+    while (s_decoderQuit == DXFALSE) {
+        int waitTime;
+        int decoded;
+    
+        /* A chunk per stream at a time, letting go of the lock in
+         * between so the main thread is never kept waiting long. */
+        do {
+            Sound *sound;
+    
+            decoded = 0;
+            for (sound = s_decoderList; sound != NULL; sound = sound->stream.nextStream) {
+                AudioStream *stream = &sound->stream;
+                decoded += (int)s_AudioStreamFill(stream, stream->fillLimit, 1);
+            }
+    
+            SDL_UnlockMutex(s_decoderMutex);
+            SDL_LockMutex(s_decoderMutex);
+        } while (decoded > 0 && s_decoderQuit == DXFALSE);
+    
+        waitTime = s_streamBufferTime / 4;
+        if (waitTime < 2) {
+            waitTime = 2;
+        } else if (waitTime > 20) {
+            waitTime = 20;
+        }
+        SDL_CondWaitTimeout(s_decoderCond, s_decoderMutex, (Uint32)waitTime);
+    }
+    SDL_UnlockMutex(s_decoderMutex);
+    
+    return 0;
+}
+
+static int s_DecoderStart() {
+    if (s_decoderThread != NULL) {
+        return 0;
+    }
+    
+    s_decoderMutex = SDL_CreateMutex();
+    s_decoderCond = SDL_CreateCond();
+    if (s_decoderMutex != NULL && s_decoderCond != NULL) {
+        s_decoderQuit = DXFALSE;
+        s_decoderThread = SDL_CreateThread(s_DecoderThread, "DPLAudioDecode", NULL);
+    }
     
-    if (sound->playing == DXTRUE) {
-        Sound **listPtr = &s_audioPlayingList;
-        
-        while (*listPtr) {
-            if ((*listPtr) == sound) {
-                *listPtr = sound->nextPlayingSound;
-                
-                sound->nextPlayingSound = NULL;
-                sound->playing = DXFALSE;
-                break;
-            }
-            listPtr = &(*listPtr)->nextPlayingSound;
-        }
+    if (s_decoderThread == NULL) {
+        s_DecoderStop();
+        return -1;
     }
     
-    SDL_UnlockAudio();
+    return 0;
 }
 
-static void s_StartSound(Sound *sound, int playMode, int fromStartFlag) {
-    SDL_LockAudio();
+static void s_DecoderStop() {
+    if (s_decoderThread != NULL) {
+        SDL_LockMutex(s_decoderMutex);
+        s_decoderQuit = DXTRUE;
+        SDL_CondSignal(s_decoderCond);
+        SDL_UnlockMutex(s_decoderMutex);
     
-    if (fromStartFlag) {
-        if (sound->soundType == SOUNDTYPE_STREAM) {
-            s_AudioStreamRestart(sound);
-        } else if (sound->soundType == SOUNDTYPE_BUFFER) {
-            s_AudioBufferRestart(sound);
-        }
+        SDL_WaitThread(s_decoderThread, NULL);
+        s_decoderThread = NULL;
     }
     
-    sound->playMode = playMode;
-    
-    if (sound->playing == DXFALSE) {
-        sound->nextPlayingSound = s_audioPlayingList;
-        s_audioPlayingList = sound;
-        
-        sound->playing = DXTRUE;
+    if (s_decoderCond != NULL) {
+        SDL_DestroyCond(s_decoderCond);
+        s_decoderCond = NULL;
+    }
+    if (s_decoderMutex != NULL) {
+        SDL_DestroyMutex(s_decoderMutex);
+        s_decoderMutex = NULL;
     }
     
-    SDL_UnlockAudio();
+    s_decoderList = NULL;
 }
 
-/* ------------------------------------------------------ AUDIO STREAMING */
-
-#ifndef DXPORTLIB_NO_OGGVORBIS
-static int s_AudioStreamGet(Sound *sound);
-
-/* Handles ogg streams via vorbisfile. */
-static size_t s_oggRead(void *ptr, size_t size, size_t num, void *datasource) {
-    SDL_RWops *rwops = (SDL_RWops *)datasource;
-    return SDL_RWread(rwops, ptr, size, num);
-}
-static int s_oggSeek(void *datasource, ogg_int64_t offset, int whence) {
-    SDL_RWops *rwops = (SDL_RWops *)datasource;
-    return (int)SDL_RWseek(rwops, offset, whence);
-}
-static long s_oggTell(void *datasource) {
-    SDL_RWops *rwops = (SDL_RWops *)datasource;
-    return (long)SDL_RWtell(rwops);
-}
+/* -------------------------------------------------------------- Streams */
 
 static int s_AudioStreamOpen(Sound *sound, SDL_RWops *rwops) {
     AudioStream *stream = &sound->stream;
     ov_callbacks oggCallbacks;
+    unsigned int frames;
     
     stream->streamFile = rwops;
     stream->section = -1;
-    stream->active = 1;
     stream->hasLoopTarget = DXFALSE;
     stream->loopTarget = 0;
     stream->hasLoopPoint = DXFALSE;
@@ -217,151 +1029,184 @@ static int s_AudioStreamOpen(Sound *sound, SDL_RWops *rwops) {
         return -1;
     }
     
+    /* Never less than two callbacks' worth. The decoder leaves room for
+     * another callback on top, so there is always somewhere to put the
+     * start of the stream when it is rewound. */
+    frames = (unsigned int)((Sint64)s_streamBufferTime * s_audioSpec.freq / 1000);
+    if (frames < (unsigned int)s_audioSpec.samples * 2) {
+        frames = (unsigned int)s_audioSpec.samples * 2;
+    }
+    stream->fillLimit = frames * s_frameSize;
+    stream->ring.capacity = (frames + s_audioSpec.samples + 1) * s_frameSize;
+    stream->ring.data = (unsigned char *)DXALLOC(stream->ring.capacity);
+    if (stream->ring.data == NULL) {
+        ov_clear(&stream->ovfile);
+        return -1;
+    }
+    
+    SDL_AtomicSet(&stream->ring.readPos, 0);
+    SDL_AtomicSet(&stream->ring.writePos, 0);
+    s_AudioStreamReset(stream);
+    
     sound->soundType = SOUNDTYPE_STREAM;
     
+    s_LockDecoder();
+    stream->nextStream = s_decoderList;
+    s_decoderList = sound;
+    SDL_CondSignal(s_decoderCond);
+    s_UnlockDecoder();
+    
     return 0;
 }
 
+/* Main thread only. Everything decoded after this point starts from the
+ * beginning, and the rewind command tells the mixer where that is. */
 static void s_AudioStreamRestart(Sound *sound) {
     AudioStream *stream = &sound->stream;
-    AudioBuffer *buffer = &sound->buffer;
+    unsigned int mark;
+    
+    /* Nothing has been played since it was last rewound. */
+    if (SDL_AtomicGet(&stream->fresh) != 0) {
+        return;
+    }
+    
+    s_LockDecoder();
     
-    ov_time_seek(&stream->ovfile, 0.0f);
+    mark = (unsigned int)SDL_AtomicGet(&stream->ring.writePos);
+    ov_pcm_seek(&stream->ovfile, 0);
+    s_AudioStreamReset(stream);
     
-    buffer->currentPos = 0;
-    buffer->length = 0;
-    stream->active = 1;
+    /* Have enough for the first callback ready, rather than have it
+     * miss the decoder thread. */
+    s_AudioStreamFill(stream, stream->ring.capacity, s_audioSpec.samples * s_frameSize);
     
-    /* buffer now instead of in the audio thread */
-    s_AudioStreamGet(sound);
+    s_UnlockDecoder();
+    
+    s_SendCommand(AUDIOCMD_REWIND, sound, (int)mark, 0);
 }
 
-static void s_AudioStreamClose(Sound *sound) {
+/* Main thread only. Stops the decoder from touching the stream; the rest
+ * waits for s_AudioStreamClose, once the mixer has let go of it too. */
+static void s_AudioStreamDetach(Sound *sound) {
     AudioStream *stream = &sound->stream;
-    AudioBuffer *buffer = &sound->buffer;
+    Sound **listPtr;
     
-    if (buffer->buffer) {
-        DXFREE(buffer->buffer);
-        buffer->buffer = NULL;
+    s_LockDecoder();
+    
+    listPtr = &s_decoderList;
+    while (*listPtr != NULL) {
+        if (*listPtr == sound) {
+            *listPtr = stream->nextStream;
+            break;
+        }
+        listPtr = &(*listPtr)->stream.nextStream;
     }
+    stream->nextStream = NULL;
+    
+    s_UnlockDecoder();
+}
+
+static void s_AudioStreamClose(Sound *sound) {
+    AudioStream *stream = &sound->stream;
+    
+    DXFREE(stream->pending);
+    stream->pending = NULL;
+    DXFREE(stream->ring.data);
+    stream->ring.data = NULL;
     
     ov_clear(&stream->ovfile);
     
     SDL_RWclose(stream->streamFile);
 }
 
-static int s_AudioStreamGet(Sound *sound) {
-    AudioStream *stream = &sound->stream;
-    AudioBuffer *buffer = &sound->buffer;
-    char inbuf[4096];
-    int amount = 0, amount2;
-    int section;
-    SDL_AudioCVT *convert;
-    
-    if (stream->hasLoopPoint != DXFALSE) {
-        vorbis_info *info = ov_info(&stream->ovfile, -1);
-        ogg_int64_t bufpos = ov_pcm_tell(&stream->ovfile);
-        ogg_int64_t n = (stream->loopPoint - bufpos) * (2 * info->channels);
-        if (n > 0 && n < sizeof(inbuf)) {
-            amount = ov_read(&stream->ovfile, inbuf, (int)n, 0, 2, 1, &section);
-            ov_pcm_seek(&stream->ovfile, stream->loopTarget);
-            
-            if (amount < 0) {
-                amount = 0;
-            }
-        }
-    }
+/* Mixer side. Skips whatever was decoded before the rewind, unless it
+ * has already played past that point. */
+static void s_AudioStreamRewind(Sound *sound, unsigned int mark) {
+    AudioRing *ring = &sound->stream.ring;
+    unsigned int readPos = (unsigned int)SDL_AtomicGet(&ring->readPos);
+    unsigned int writePos = (unsigned int)SDL_AtomicGet(&ring->writePos);
+    unsigned int used = (writePos + ring->capacity - readPos) % ring->capacity;
     
-    amount2 = ov_read(&stream->ovfile, inbuf + amount, sizeof(inbuf) - amount, 0, 2, 1, &section);
-    if (amount2 <= 0) {
-        if (stream->hasLoopTarget != DXFALSE) {
-            if (ov_pcm_seek(&stream->ovfile, stream->loopTarget) == 0) {
-                return 0;
-            }
-        }
-        s_StopSound(sound);
-        
-        return -1;
+    if ((mark + ring->capacity - readPos) % ring->capacity <= used) {
+        SDL_AtomicSet(&ring->readPos, (int)mark);
     }
-    amount += amount2;
-    
-    convert = &stream->convert;
+}
+
+/* Mixer side. Streams play at their own pace, so pitch does not apply. */
+static unsigned int s_AudioStreamPlay(Sound *sound, float *bus, unsigned int frames,
+                                      float gainLeft, float gainRight, int *endedFlag) {
+    AudioStream *stream = &sound->stream;
+    int ended = SDL_AtomicGet(&stream->ended);
+    unsigned int amount;
     
-    if (buffer->buffer == NULL || section != stream->section) {
-        /* create conversion buffer */
-        vorbis_info *info;
-        unsigned int bufferSize;
-        
-        info = ov_info(&stream->ovfile, -1);
-        SDL_BuildAudioCVT(convert, AUDIO_S16,
-                          (Uint8)info->channels,
-                          info->rate,
-                          s_audioSpec.format,
-                          s_audioSpec.channels,
-                          s_audioSpec.freq);
-        
-        bufferSize = sizeof(inbuf) * (unsigned int)convert->len_mult;
-        
-        if (buffer->buffer != NULL && bufferSize > buffer->bufferSize) {
-            DXFREE(buffer->buffer);
-            buffer->buffer = NULL;
-        }
-        
-        if (buffer->buffer == NULL) {
-            buffer->buffer = DXALLOC(bufferSize);
-            buffer->bufferSize = bufferSize;
-        }
-        
-        convert->buf = buffer->buffer;
-        
-        stream->section = section;
+    amount = s_RingMix(&stream->ring, bus, frames, gainLeft, gainRight);
+    if (amount > 0) {
+        SDL_AtomicSet(&stream->fresh, 0);
     }
+    frames -= amount;
     
-    if (buffer->buffer) {
-        SDL_memcpy(buffer->buffer, inbuf, (unsigned int) amount);
-        
-        if (convert->needed) {
-            convert->len = amount;
-            SDL_ConvertAudio(convert);
+    if (frames > 0) {
+        if (ended != 0) {
+            *endedFlag = DXTRUE;
         } else {
-            convert->len_cvt = amount;
+            /* The decoder fell behind. Leave the rest silent. */
+            SDL_AtomicIncRef(&stream->underrunCount);
+            frames = 0;
         }
-        buffer->length = (unsigned int)convert->len_cvt;
-        buffer->currentPos = 0;
     }
     
-    return 0;
+    return frames;
 }
 
-static unsigned int s_AudioStreamPlay(Sound *sound, Uint8 *snd, unsigned int len) {
-    AudioBuffer *buffer = &sound->buffer;
+/* The decoder runs ahead of what is heard, so this works back from
+ * where it is by however much is still buffered. */
+static int s_AudioStreamGetPosition(Sound *sound) {
+    AudioStream *stream = &sound->stream;
+    vorbis_info *info;
+    ogg_int64_t position;
+    ogg_int64_t buffered;
     
-    while (len > 0 && sound->playing) {
-        unsigned int amount;
-        
-        if (buffer->currentPos >= buffer->length) {
-            if (s_AudioStreamGet(sound) < 0) {
-                break;
+    s_LockDecoder();
+    
+    info = ov_info(&stream->ovfile, -1);
+    buffered = s_RingUsed(&stream->ring) + (stream->pendingLength - stream->pendingPos);
+    buffered = (buffered / s_frameSize) * info->rate / s_audioSpec.freq;
+    position = ov_pcm_tell(&stream->ovfile) - buffered;
+    
+    if (stream->hasWrapped != DXFALSE) {
+        ogg_int64_t loopStart = 0;
+        ogg_int64_t loopEnd = ov_pcm_total(&stream->ovfile, -1);
+    
+        if (stream->hasLoopTarget != DXFALSE) {
+            loopStart = stream->loopTarget;
+            if (stream->hasLoopPoint != DXFALSE) {
+                loopEnd = stream->loopPoint;
             }
         }
-        
-        amount = buffer->length - buffer->currentPos;
-        if (amount > len) {
-            amount = len;
-        }
-        if (amount > 0) {
-            SDL_MixAudio(snd, buffer->buffer + buffer->currentPos, amount, sound->volume);
-            snd += amount;
-            len -= amount;
-            buffer->currentPos += amount;
+        if (position < loopStart) {
+            position += loopEnd - loopStart;
         }
     }
     
-    return len;
+    s_UnlockDecoder();
+    
+    return (position > 0) ? (int)position : 0;
 }
 
 #else /* #ifndef DXPORTLIB_NO_OGGVORBIS */
 
+static void s_LockDecoder() {
+}
+static void s_UnlockDecoder() {
+}
+
+static int s_DecoderStart() {
+    return 0;
+}
+
+static void s_DecoderStop() {
+}
+
 static int s_AudioStreamOpen(Sound *sound, SDL_RWops *rwops) {
     return -1;
 }
@@ -369,12 +1214,23 @@ static int s_AudioStreamOpen(Sound *sound, SDL_RWops *rwops) {
 static void s_AudioStreamRestart(Sound *sound) {
 }
 
+static void s_AudioStreamDetach(Sound *sound) {
+}
+
 static void s_AudioStreamClose(Sound *sound) {
 }
 
-static unsigned int s_AudioStreamPlay(Sound *sound, Uint8 *snd, unsigned int len) {
-    sound->playing = 0;
-    return len;
+static void s_AudioStreamRewind(Sound *sound, unsigned int mark) {
+}
+
+static unsigned int s_AudioStreamPlay(Sound *sound, float *bus, unsigned int frames,
+                                      float gainLeft, float gainRight, int *endedFlag) {
+    *endedFlag = DXTRUE;
+    return frames;
+}
+
+static int s_AudioStreamGetPosition(Sound *sound) {
+    return 0;
 }
 
 #endif /* #ifndef DXPORTLIB_NO_OGGVORBIS */
@@ -382,7 +1238,7 @@ static unsigned int s_AudioStreamPlay(Sound *sound, Uint8 *snd, unsigned int len
 /* ------------------------------------------------- STATIC AUDIO BUFFERS */
 
 static int s_AudioBufferOpenRIFF(Sound *sound, SDL_RWops *rwops, Uint32 riffSize) {
-    AudioBuffer *buffer = &sound->buffer;
+    SampleData *sample = NULL;
     SDL_AudioCVT convert;
     int readFormat = 0;
     Uint32 totalSize = riffSize;
@@ -392,12 +1248,12 @@ static int s_AudioBufferOpenRIFF(Sound *sound, SDL_RWops *rwops, Uint32 riffSize
         Uint32 ID = SDL_ReadLE32(rwops);
         Uint32 size = SDL_ReadLE32(rwops);
         riffSize -= 8;
-        
+    
         if (size > riffSize) {
             break;
         }
         riffSize -= size;
-        
+    
         if (ID == 0x20746D66 && size >= 0x10) { /* 'fmt ' */
             SDL_AudioFormat srcFormat;
             Uint16 encoding;
@@ -410,17 +1266,17 @@ static int s_AudioBufferOpenRIFF(Sound *sound, SDL_RWops *rwops, Uint32 riffSize
             /* Uint32 byterate = */ SDL_ReadLE32(rwops);
             /* Uint16 blockalign = */ SDL_ReadLE16(rwops);
             bitspersample = SDL_ReadLE16(rwops);
-            
+    
             size -= 0x10;
             if (size > 0) {
                 SDL_RWseek(rwops, size, RW_SEEK_CUR);
             }
-            
+    
             if (encoding != 1) {
                 /* We don't support other encodings. */
                 break;
             }
-            
+    
             if (bitspersample == 8) {
                 srcFormat = AUDIO_U8;
             } else if (bitspersample == 16) {
@@ -428,49 +1284,64 @@ static int s_AudioBufferOpenRIFF(Sound *sound, SDL_RWops *rwops, Uint32 riffSize
             } else {
                 break;
             }
-            
+    
             SDL_BuildAudioCVT(&convert,
                               srcFormat,
                               (Uint8)channels,
                               (int)frequency,
-                              s_audioSpec.format,
-                              (Uint8)s_audioSpec.channels,
+                              MIX_FORMAT,
+                              MIX_CHANNELS,
                               s_audioSpec.freq);
-            
-            buffer->bufferSize = totalSize * (unsigned int)convert.len_mult;
-            buffer->buffer = DXALLOC(buffer->bufferSize);
-            buffer->length = 0;
-            
-            convert.buf = buffer->buffer;
-            
+    
+            if (sample != NULL) {
+                /* Only the first format chunk counts. */
+                SDL_RWseek(rwops, size, RW_SEEK_CUR);
+                continue;
+            }
+    
+            sample = (SampleData *)DXALLOC(sizeof(SampleData));
+            SDL_AtomicSet(&sample->refCount, 1);
+            sample->buffer = DXALLOC(totalSize * (unsigned int)convert.len_mult);
+            sample->length = 0;
+            sample->frequency = (int)frequency;
+    
+            convert.buf = sample->buffer;
+    
             readFormat = 1;
         } else if (ID == 0x61746164) {/* 'data' */
             if (!readFormat) {
                 break;
             }
-            
-            SDL_RWread(rwops, buffer->buffer + buffer->length, size, 1);
-            buffer->length += size;
+    
+            SDL_RWread(rwops, sample->buffer + sample->length, size, 1);
+            sample->length += size;
         } else {
             SDL_RWseek(rwops, size, RW_SEEK_CUR);
         }
     }
     
     /* Finish up */
-    if (buffer->length == 0 || !readFormat) {
-        if (buffer->buffer != NULL) {
-            DXFREE(buffer->buffer);
-            buffer->buffer = NULL;
-        }
+    if (sample == NULL) {
         return -1;
     }
     
-    if (convert.needed) {
-        convert.len = (int)(buffer->length);
+    if (convert.needed && sample->length > 0) {
+        convert.len = (int)(sample->length);
         SDL_ConvertAudio(&convert);
-        buffer->length = (unsigned int)(convert.len_cvt);
+        sample->length = (unsigned int)(convert.len_cvt);
+    }
+    
+    /* Whole frames only, so a voice never stops partway into one. */
+    sample->length -= sample->length % s_frameSize;
+    sample->frames = sample->length / s_frameSize;
+    
+    if (sample->frames == 0) {
+        DXFREE(sample->buffer);
+        DXFREE(sample);
+        return -1;
     }
     
+    sound->sample = sample;
     sound->soundType = SOUNDTYPE_BUFFER;
     
     SDL_RWclose(rwops);
@@ -499,85 +1370,142 @@ static int s_AudioBufferOpen(Sound *sound, SDL_RWops *rwops) {
     return -1;
 }
 
-static void s_AudioBufferRestart(Sound *sound) {
-    AudioBuffer *buffer = &sound->buffer;
-    
-    buffer->currentPos = 0;
-}
-
 static void s_AudioBufferClose(Sound *sound) {
-    AudioBuffer *buffer = &sound->buffer;
+    SampleData *sample = sound->sample;
     
-    DXFREE(buffer->buffer);
-    buffer->buffer = NULL;
+    sound->sample = NULL;
+    if (sample != NULL && SDL_AtomicDecRef(&sample->refCount)) {
+        DXFREE(sample->buffer);
+        DXFREE(sample);
+    }
 }
 
-static unsigned int s_AudioBufferPlay(Sound *sound, Uint8 *snd, unsigned int len) {
-    AudioBuffer *buffer = &sound->buffer;
-    unsigned int amount = buffer->length - buffer->currentPos;
-    if (amount > len) {
-        amount = len;
-    }
+static unsigned int s_AudioBufferPlay(Voice *voice, float *bus, unsigned int frames, int *endedFlag) {
+    SampleData *sample = voice->sound->sample;
+    const short *src = (const short *)sample->buffer;
     
-    if (amount > 0) {
-        SDL_MixAudio(snd, buffer->buffer + buffer->currentPos, amount, sound->volume);
-        buffer->currentPos += amount;
+    if (voice->step == 0x10000) {
+        unsigned int amount = sample->frames - voice->position;
+        if (amount > frames) {
+            amount = frames;
+        }
         
-        len -= amount;
+        PL_AudioMix_Add(bus, src + voice->position * 2, (int)amount,
+                        voice->gainLeft, voice->gainRight);
+        voice->position += amount;
+        frames -= amount;
+    } else {
+        frames -= (unsigned int)PL_AudioMix_AddResampled(
+            bus, (int)frames, src, sample->frames,
+            &voice->position, &voice->fraction, voice->step,
+            voice->gainLeft, voice->gainRight);
     }
     
-    if (buffer->currentPos >= buffer->length) {
-        s_StopSound(sound);
+    if (voice->position >= sample->frames) {
+        *endedFlag = DXTRUE;
     }
     
-    return len;
+    return frames;
 }
 
 /* ----------------------------------------------------- MAIN AUDIO MIXER */
 
-static void s_Mixer(void *udata, Uint8 *stream, int len) {
-    Sound *sound;
-    unsigned int ulen = (unsigned int)len;
-
-    if (len <= 0) {
-        return;
-    }
+/* Adds every voice into the bus, which must hold frames. */
+static void s_MixVoices(float *bus, unsigned int frames) {
+    int i;
     
-    SDL_memset(stream, 0, (size_t)len);
+    SDL_memset(bus, 0, sizeof(float) * 2 * frames);
     
-    /* Iterate through all playing sounds. */
-    sound = s_audioPlayingList;
-    while (sound != NULL) {
-        Sound *nextSound = sound->nextPlayingSound;
-        unsigned int left = ulen;
+    /* Iterate through all voices. This goes backwards, so that voices
+     * that are removed or handed over are not visited twice. */
+    for (i = s_voiceCount - 1; i >= 0; --i) {
+        Voice *voice = &s_voices[i];
+        unsigned int left = frames;
+        int removed = DXFALSE;
         
-        while (left > 0 && sound->playing) {
+        while (left > 0) {
+            Sound *sound = voice->sound;
+            float *dest = bus + (frames - left) * 2;
+            unsigned int before = left;
+            int endedFlag = DXFALSE;
+            
             if (sound->soundType == SOUNDTYPE_STREAM) {
-                left = s_AudioStreamPlay(sound, stream + (ulen - left), left);
+                left = s_AudioStreamPlay(sound, dest, left,
+                                         voice->gainLeft, voice->gainRight, &endedFlag);
             } else if (sound->soundType == SOUNDTYPE_BUFFER) {
-                left = s_AudioBufferPlay(sound, stream + (ulen - left), left);
+                left = s_AudioBufferPlay(voice, dest, left, &endedFlag);
             } else {
-                break;
+                endedFlag = DXTRUE;
             }
             
-            if (!sound->playing) {
+            if (endedFlag) {
                 /* test for loops, sequences, etc here */
-                int playMode = sound->playMode;
+                int playMode = voice->playMode;
+                Sound *nextSound = NULL;
                 
                 if (sound->nextSoundIDInSequence >= 0) {
-                    sound = (Sound *)PL_Handle_GetData(sound->nextSoundIDInSequence, DXHANDLE_SOUND);
-                    if (sound == NULL) {
+                    nextSound = (Sound *)PL_Handle_GetData(sound->nextSoundIDInSequence, DXHANDLE_SOUND);
+                }
+                
+                if (nextSound != NULL) {
+                    sound->resumePos = 0;
+                    if (s_VoiceChain(i, nextSound) == DXFALSE) {
+                        removed = DXTRUE;
+                        break;
+                    }
+                } else if ((playMode & DX_PLAYTYPE_LOOP) == DX_PLAYTYPE_LOOP
+                           && sound->soundType == SOUNDTYPE_BUFFER) {
+                    voice->position = 0;
+                    if (left == before) {
+                        /* Nothing played this pass, so looping again
+                         * would spin forever. */
                         break;
                     }
-                    
-                    s_StartSound(sound, playMode, DXTRUE);
-                } else if ((playMode & DX_PLAYTYPE_LOOP) == DX_PLAYTYPE_LOOP) {
-                    s_StartSound(sound, DX_PLAYTYPE_LOOP, DXTRUE);
+                } else if ((playMode & DX_PLAYTYPE_LOOP) == DX_PLAYTYPE_LOOP
+                           && sound->soundType == SOUNDTYPE_STREAM) {
+                    /* The decoder loops streams itself. It has simply
+                     * not caught up yet. */
+                    break;
+                } else {
+                    sound->resumePos = 0;
+                    s_VoiceRemove(i);
+                    removed = DXTRUE;
+                    break;
                 }
             }
         }
         
-        sound = nextSound;
+        if (removed == DXFALSE && voice->sound->soundType == SOUNDTYPE_BUFFER) {
+            SDL_AtomicSet(&voice->sound->position, (int)(voice->position * s_frameSize));
+        }
+    }
+}
+
+static void s_Mixer(void *udata, Uint8 *stream, int len) {
+    unsigned int frames;
+    
+    if (len <= 0) {
+        s_ProcessCommands();
+        return;
+    }
+    
+    frames = (unsigned int)len / s_deviceFrameSize;
+    s_StatsCallback(frames);
+    
+    s_ProcessCommands();
+    
+    while (frames > 0) {
+        unsigned int amount = (frames < s_mixBusFrames) ? frames : s_mixBusFrames;
+        
+        s_MixVoices(s_mixBus, amount);
+        if (s_audioSpec.format == AUDIO_F32SYS) {
+            PL_AudioMix_ToF32(s_mixBus, (float *)stream, (int)(amount * MIX_CHANNELS));
+        } else {
+            PL_AudioMix_ToS16(s_mixBus, (short *)stream, (int)(amount * MIX_CHANNELS));
+        }
+        
+        stream += amount * s_deviceFrameSize;
+        frames -= amount;
     }
 }
 
@@ -595,40 +1523,48 @@ static int s_AllocateSound() {
     
     sound->volume = SDL_MIX_MAXVOLUME;
     sound->soundType = SOUNDTYPE_NONE;
+    sound->maxVoices = 1;
+    sound->panLeft = 0x10000;
+    sound->panRight = 0x10000;
+    sound->step = 0x10000;
+    sound->frequency = -1;
     sound->nextSoundIDInSequence = -1;
     
     return soundID;
 }
 
+/* The handle goes away now, but the mixer may still be playing the
+ * sound, so its memory is only freed once the mixer hands it back. */
 static int s_FreeSound(int soundID) {
-    Sound *sound;
+    Sound *sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     
-    SDL_LockAudio();
-    sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
-        if (sound->playing) {
-            s_StopSound(sound);
+        if (sound->soundType == SOUNDTYPE_STREAM) {
+            s_AudioStreamDetach(sound);
         }
         
-        if (sound->soundType == SOUNDTYPE_BUFFER) {
-            s_AudioBufferClose(sound);
-        } else if (sound->soundType == SOUNDTYPE_STREAM) {
-            s_AudioStreamClose(sound);
-        }
+        PL_Handle_ReleaseID(soundID, DXFALSE);
         
-        if (sound->buffer.buffer != NULL) {
-            DXFREE(sound->buffer.buffer);
-        }
-    
-        PL_Handle_ReleaseID(soundID, DXTRUE);
+        sound->requestedPlaying = DXFALSE;
+        s_SendCommand(AUDIOCMD_FREE, sound, 0, 0);
     }
-    SDL_UnlockAudio();
     
     return 0;
 }
 
+static void s_DestroySound(Sound *sound) {
+    if (sound->soundType == SOUNDTYPE_BUFFER) {
+        s_AudioBufferClose(sound);
+    } else if (sound->soundType == SOUNDTYPE_STREAM) {
+        s_AudioStreamClose(sound);
+    }
+    
+    DXFREE(sound);
+}
+
 static void s_AudioOpen() {
     SDL_AudioSpec audioSpec;
+    int allowedChanges;
     
     if (s_audioOpened == DXTRUE) {
         return;
@@ -639,19 +1575,43 @@ static void s_AudioOpen() {
     }
     
     SDL_memset(&audioSpec, 0, sizeof(audioSpec));
-    audioSpec.freq = 44100;
-    audioSpec.format = AUDIO_S16SYS;
-    audioSpec.channels = 2;
-    audioSpec.samples = 1024; /* latency... */
+    audioSpec.freq = s_deviceFrequency;
+    audioSpec.format = (s_deviceFormat == DX_SOUNDFORMAT_EXT_F32) ? AUDIO_F32SYS : AUDIO_S16SYS;
+    audioSpec.channels = MIX_CHANNELS;
+    audioSpec.samples = (Uint16)s_deviceBufferFrames;
     audioSpec.callback = s_Mixer;
     audioSpec.userdata = NULL;
     
-    if (SDL_OpenAudio(&audioSpec, &s_audioSpec) < 0) {
+    /* The mixer can work at any rate, but only writes 16-bit or float
+     * stereo, so SDL converts to anything else. */
+    allowedChanges = SDL_AUDIO_ALLOW_FREQUENCY_CHANGE;
+#ifdef SDL_AUDIO_ALLOW_SAMPLES_CHANGE
+    allowedChanges |= SDL_AUDIO_ALLOW_SAMPLES_CHANGE;
+#endif
+    
+    s_audioDevice = SDL_OpenAudioDevice(NULL, 0, &audioSpec, &s_audioSpec, allowedChanges);
+    if (s_audioDevice == 0) {
+        s_audioCannotOpen = DXTRUE;
+        return;
+    }
+    s_frameSize = (unsigned int)(SDL_AUDIO_BITSIZE(MIX_FORMAT) / 8 * MIX_CHANNELS);
+    s_deviceFrameSize = (unsigned int)(SDL_AUDIO_BITSIZE(s_audioSpec.format) / 8 * MIX_CHANNELS);
+    
+    s_StatsReset();
+    
+    s_mixBusFrames = s_audioSpec.samples;
+    s_mixBus = (float *)DXALLOC(sizeof(float) * 2 * s_mixBusFrames);
+    
+    if (s_DecoderStart() < 0) {
+        SDL_CloseAudioDevice(s_audioDevice);
+        s_audioDevice = 0;
+        DXFREE(s_mixBus);
+        s_mixBus = NULL;
         s_audioCannotOpen = DXTRUE;
         return;
     }
     
-    SDL_PauseAudio(0);
+    SDL_PauseAudioDevice(s_audioDevice, 0);
     
     s_audioOpened = DXTRUE;
 }
@@ -661,86 +1621,147 @@ static void s_AudioClose() {
         return;
     }
     
-    SDL_PauseAudio(1);
+    SDL_PauseAudioDevice(s_audioDevice, 1);
     
-    SDL_LockAudio();
-    
-    /* - Stop all playing sounds */
-    while (s_audioPlayingList != NULL) {
-        s_StopSound(s_audioPlayingList);
-    }
-    
-    /* - Free all sounds */
+    /* - Free all sounds. The mixer is no longer running, so this
+     *   also stops anything still playing. */
     PL_InitSoundMem();
-    
-    SDL_UnlockAudio();
+    s_FlushCommands();
     
     /* - Close up and finish. */
-    SDL_CloseAudio();
+    s_DecoderStop();
+    SDL_CloseAudioDevice(s_audioDevice);
+    s_audioDevice = 0;
+    
+    DXFREE(s_mixBus);
+    s_mixBus = NULL;
     
     s_audioOpened = DXFALSE;
 }
 
 /* ------------------------------------------------------ DXLIB INTERFACE */
 
-static int s_LoadSound(const char *filename) {
+/* Opens and decodes the file into an already allocated sound.
+ * This only reads s_audioSpec, so it is safe to run on a loader thread
+ * as long as nothing else touches the sound until it is done. */
+static int s_OpenSound(Sound *sound, const char *filename) {
     SDL_RWops *rwops;
     char buf[4];
+    
+    rwops = PLSDL2_FileToRWops(PL_File_OpenRead(filename));
+    if (rwops == NULL) {
+        return -1;
+    }
+    
+    if (SDL_RWread(rwops, buf, 4, 1) >= 0) {
+        SDL_RWseek(rwops, 0, RW_SEEK_SET);
+    
+        if (SDL_memcmp(buf, "RIFF", 4) == 0) {
+            /* buffer */
+            if (s_AudioBufferOpen(sound, rwops) == 0) {
+                return 0;
+            }
+        } else if (SDL_memcmp(buf, "OggS", 4) == 0) {
+            /* stream */
+            if (s_AudioStreamOpen(sound, rwops) == 0) {
+                sound->maxVoices = 1;
+                return 0;
+            }
+        }
+    }
+    
+    SDL_RWclose(rwops);
+    return -1;
+}
+
+typedef struct SoundLoadJob {
     int soundID;
-    Sound *sound;
+    char *filename;
+} SoundLoadJob;
+
+static int s_SoundLoadWork(void *userdata) {
+    SoundLoadJob *job = (SoundLoadJob *)userdata;
+    Sound *sound = (Sound *)PL_Handle_GetData(job->soundID, DXHANDLE_SOUND);
+    
+    return s_OpenSound(sound, job->filename);
+}
+
+static void s_SoundLoadFinish(void *userdata, int workResult) {
+    SoundLoadJob *job = (SoundLoadJob *)userdata;
+    
+    PL_Handle_SetASyncJob(job->soundID, -1);
+    if (workResult < 0) {
+        s_FreeSound(job->soundID);
+    }
+    
+    DXFREE(job->filename);
+    DXFREE(job);
+}
+
+static int s_LoadSound(const char *filename, int bufferNum) {
+    SoundLoadJob *job;
+    int soundID;
+    int jobID;
     
     s_AudioOpen();
     
-    if (s_audioOpened == DXFALSE) {
+    if (s_audioOpened == DXFALSE || filename == NULL) {
         return -1;
     }
     
-    rwops = PLSDL2_FileToRWops(PL_File_OpenRead(filename));
-    if (rwops == NULL) {
+    soundID = s_AllocateSound();
+    if (soundID < 0) {
         return -1;
     }
     
-    if (SDL_RWread(rwops, buf, 4, 1) >= 0) {
-        SDL_RWseek(rwops, 0, RW_SEEK_SET);
-        
-        do {
-            soundID = s_AllocateSound();
-            if (soundID < 0) {
-                break;
-            }
-            
-            sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
-            
-            if (SDL_memcmp(buf, "RIFF", 4) == 0) {
-                /* buffer */
-                if (s_AudioBufferOpen(sound, rwops) < 0) {
-                    break;
-                }
-            } else if (SDL_memcmp(buf, "OggS", 4) == 0) {
-                /* stream */
-                if (s_AudioStreamOpen(sound, rwops) < 0) {
-                    break;
-                }
-            } else {
-                break;
-            }
-            
-            return soundID;
-        } while (0);
+    if (bufferNum > 1) {
+        ((Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND))->maxVoices =
+            (bufferNum < MAX_VOICES) ? bufferNum : MAX_VOICES;
     }
     
-    SDL_RWclose(rwops);
-    if (soundID >= 0) {
-        s_FreeSound(soundID);
+    if (PL_Async_GetUseASyncLoadFlag() == DXFALSE) {
+        if (s_OpenSound((Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND), filename) < 0) {
+            s_FreeSound(soundID);
+            return -1;
+        }
+        return soundID;
+    }
+    
+    /* The sound is not on the playing list and nothing else will look
+     * at it until the load is finished, so it can be filled in place. */
+    job = (SoundLoadJob *)DXALLOC(sizeof(SoundLoadJob));
+    job->soundID = soundID;
+    job->filename = PL_Text_Strdup(filename);
+    
+    jobID = PL_Async_Submit(s_SoundLoadWork, s_SoundLoadFinish, job);
+    if (jobID >= 0) {
+        PL_Handle_SetASyncJob(soundID, jobID);
+    } else if (PL_Handle_GetData(soundID, DXHANDLE_SOUND) == NULL) {
+        return -1;
+    }
+    
+    return soundID;
+}
+
+/* Finishes loading the sound, and the one that follows it, if either
+ * is still loading. */
+static void s_WaitForLoad(int soundID) {
+    Sound *sound;
+    
+    PL_Async_WaitHandle(soundID);
+    
+    sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
+    if (sound != NULL && sound->nextSoundIDInSequence >= 0) {
+        PL_Async_WaitHandle(sound->nextSoundIDInSequence);
     }
-    return -1;
 }
 
+/* Main thread only. */
 static void s_RestartSound(Sound *sound) {
     if (sound->soundType == SOUNDTYPE_STREAM) {
         s_AudioStreamRestart(sound);
     } else if (sound->soundType == SOUNDTYPE_BUFFER) {
-        s_AudioBufferRestart(sound);
+        s_SendCommand(AUDIOCMD_REWIND, sound, 0, 0);
     }
 }
 
@@ -748,40 +1769,39 @@ static int s_WaitForSound(int soundID) {
     int playing = 1;
     while (playing > 0) {
         Sound *sound;
-        
-        SDL_LockAudio();
+    
         sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
         if (sound == NULL) {
             playing = -1;
         } else {
-            playing = sound->playing;
-            
+            playing = s_IsSoundPlaying(sound);
+    
             if (playing == 0 && sound->nextSoundIDInSequence >= 0) {
                 soundID = sound->nextSoundIDInSequence;
                 playing = 1;
             }
         }
-        SDL_UnlockAudio();
-        
+    
         if (PL_Window_ProcessMessages() < 0) {
             return -1;
         }
-        
+    
         PL_Platform_Wait(1);
     }
     
     return playing;
 }
 
-int PL_LoadSoundMem(const char *filename) {
-    return s_LoadSound(filename);
+/* bufferNum is how many times the sound may overlap itself. */
+int PL_LoadSoundMem(const char *filename, int bufferNum) {
+    return s_LoadSound(filename, bufferNum);
 }
 
 int PL_LoadSoundMem2(const char *filenameA, const char *filenameB) {
-    int soundIDA = s_LoadSound(filenameA);
+    int soundIDA = s_LoadSound(filenameA, 1);
     
     if (soundIDA >= 0) {
-        int soundIDB = s_LoadSound(filenameB);
+        int soundIDB = s_LoadSound(filenameB, 1);
         if (soundIDB >= 0) {
             Sound *sound = (Sound *)PL_Handle_GetData(soundIDA, DXHANDLE_SOUND);
             sound->nextSoundIDInSequence = soundIDB;
@@ -791,21 +1811,52 @@ int PL_LoadSoundMem2(const char *filenameA, const char *filenameB) {
     return soundIDA;
 }
 
+/* Makes a new handle that plays the same sample data as the old one,
+ * without copying it. Streams cannot be shared. */
+int PL_DuplicateSoundMem(int srcSoundID, int bufferNum) {
+    Sound *srcSound;
+    Sound *sound;
+    int soundID;
+    
+    s_WaitForLoad(srcSoundID);
+    
+    srcSound = (Sound *)PL_Handle_GetData(srcSoundID, DXHANDLE_SOUND);
+    if (srcSound == NULL || srcSound->soundType != SOUNDTYPE_BUFFER) {
+        return -1;
+    }
+    
+    soundID = s_AllocateSound();
+    if (soundID < 0) {
+        return -1;
+    }
+    
+    sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
+    if (bufferNum > 1) {
+        sound->maxVoices = (bufferNum < MAX_VOICES) ? bufferNum : MAX_VOICES;
+    }
+    
+    SDL_AtomicIncRef(&srcSound->sample->refCount);
+    sound->sample = srcSound->sample;
+    sound->soundType = SOUNDTYPE_BUFFER;
+    
+    return soundID;
+}
+
 int PL_DeleteSoundMem(int soundID) {
     Sound *sound;
     
-    SDL_LockAudio();
+    s_WaitForLoad(soundID);
+    
     sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
         int nextID = sound->nextSoundIDInSequence;
-        
+    
         s_FreeSound(soundID);
-        
+    
         if (nextID >= 0) {
             PL_DeleteSoundMem(nextID);
         }
     }
-    SDL_UnlockAudio();
     return 0;
 }
 
@@ -813,23 +1864,26 @@ int PL_PlaySoundMem(int soundID, int playType, int startPositionFlag) {
     Sound *sound;
     int retval = -1;
     
-    SDL_LockAudio();
+    s_WaitForLoad(soundID);
     
     sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
         retval = 0;
-        
-        s_StartSound(sound, playType, startPositionFlag);
-        
-        if (sound->nextSoundIDInSequence) {
+    
+        if (startPositionFlag && sound->soundType == SOUNDTYPE_STREAM) {
+            s_AudioStreamRestart(sound);
+        }
+    
+        if (sound->nextSoundIDInSequence >= 0) {
             Sound *nextSound = (Sound *)PL_Handle_GetData(sound->nextSoundIDInSequence, DXHANDLE_SOUND);
             if (nextSound != NULL) {
+                s_StopSound(nextSound);
                 s_RestartSound(nextSound);
             }
         }
-    }
     
-    SDL_UnlockAudio();
+        s_StartSound(sound, playType, startPositionFlag);
+    }
     
     if (playType == DX_PLAYTYPE_NORMAL) {
         s_WaitForSound(soundID);
@@ -842,20 +1896,18 @@ int PL_StopSoundMem(int soundID) {
     Sound *sound;
     int retval = -1;
     
-    SDL_LockAudio();
+    s_WaitForLoad(soundID);
     
     sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
         retval = 0;
-        if (sound->playing) {
+        if (s_IsSoundPlaying(sound)) {
             s_StopSound(sound);
         }
-        if (sound->nextSoundIDInSequence) {
+        if (sound->nextSoundIDInSequence >= 0) {
             PL_StopSoundMem(sound->nextSoundIDInSequence);
         }
     }
-   
-    SDL_UnlockAudio();
     
     return retval;
 }
@@ -864,14 +1916,12 @@ int PL_CheckSoundMem(int soundID) {
     Sound *sound;
     int retval = -1;
     
-    SDL_LockAudio();
+    s_WaitForLoad(soundID);
     
     sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
-        retval = sound->playing;
+        retval = s_IsSoundPlaying(sound);
     }
-   
-    SDL_UnlockAudio();
     
     return retval;
 }
@@ -882,7 +1932,9 @@ int PL_Audio_SetLoopSamples(int soundID,
     Sound *sound;
     int retval = -1;
     
-    SDL_LockAudio();
+    s_WaitForLoad(soundID);
+    
+    s_LockDecoder();
     
     sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
@@ -896,8 +1948,8 @@ int PL_Audio_SetLoopSamples(int soundID,
         }
         retval = 0;
     }
-   
-    SDL_UnlockAudio();
+    
+    s_UnlockDecoder();
     
     return retval;
 }
@@ -907,13 +1959,15 @@ int PL_Audio_SetLoopTimes(int soundID,
     Sound *sound;
     int retval = -1;
     
-    SDL_LockAudio();
+    s_WaitForLoad(soundID);
+    
+    s_LockDecoder();
     
     sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
 #ifndef DXPORTLIB_NO_OGGVORBIS
         vorbis_info *info = ov_info(&sound->stream.ovfile, -1);
-        
+    
         sound->stream.hasLoopTarget = DXTRUE;
         sound->stream.loopTarget = (ogg_int64_t)(loopTarget * info->rate);
         if (loopPoint > 0.0) {
@@ -928,8 +1982,8 @@ int PL_Audio_SetLoopTimes(int soundID,
 #endif
         retval = 0;
     }
-   
-    SDL_UnlockAudio();
+    
+    s_UnlockDecoder();
     
     return retval;
 }
@@ -938,7 +1992,9 @@ int PL_Audio_RemoveLoopPoints(int soundID) {
     Sound *sound;
     int retval = -1;
     
-    SDL_LockAudio();
+    s_WaitForLoad(soundID);
+    
+    s_LockDecoder();
     
     sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
@@ -946,8 +2002,8 @@ int PL_Audio_RemoveLoopPoints(int soundID) {
         sound->stream.hasLoopTarget = DXFALSE;
         retval = 0;
     }
-   
-    SDL_UnlockAudio();
+    
+    s_UnlockDecoder();
     
     return retval;
 }
@@ -956,17 +2012,16 @@ int PL_Audio_GetCurrentPositionSoundMem(int soundID) {
     Sound *sound;
     int retval = 0;
     
-    SDL_LockAudio();
+    s_WaitForLoad(soundID);
     
     sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
         if (sound->soundType == SOUNDTYPE_STREAM) {
-            retval = (int)ov_pcm_tell(&sound->stream.ovfile);
+            retval = s_AudioStreamGetPosition(sound);
         } else if (sound->soundType == SOUNDTYPE_BUFFER) {
-            retval = (int)sound->buffer.currentPos;
+            retval = SDL_AtomicGet(&sound->position);
         }
     }
-    SDL_UnlockAudio();
     
     return retval;
 }
@@ -975,36 +2030,34 @@ int PL_SetVolumeSoundMemDirect(int volume, int soundID) {
     Sound *sound;
     int retval = -1;
     
-    SDL_LockAudio();
+    s_WaitForLoad(soundID);
     
     sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
         int adjustedVol;
         retval = 0;
-        
+    
         if (volume < 0) {
             volume = 0;
         } else if (volume > 255) {
             volume = 255;
         }
-        
+    
         adjustedVol = (int)(volume * SDL_MIX_MAXVOLUME / 255);
-        
+    
         if (adjustedVol < 0) {
             adjustedVol = 0;
         } else if (adjustedVol > SDL_MIX_MAXVOLUME) {
             adjustedVol = SDL_MIX_MAXVOLUME;
         }
-        
-        sound->volume = adjustedVol;
-        
-        if (sound->nextSoundIDInSequence) {
+    
+        s_SendCommand(AUDIOCMD_VOLUME, sound, adjustedVol, 0);
+    
+        if (sound->nextSoundIDInSequence >= 0) {
             PL_SetVolumeSoundMem(volume, sound->nextSoundIDInSequence);
         }
     }
     
-    SDL_UnlockAudio();
-    
     return retval;
 }
 
@@ -1012,36 +2065,34 @@ int PL_SetVolumeSoundMem(int volume, int soundID) {
     Sound *sound;
     int retval = -1;
     
-    SDL_LockAudio();
+    s_WaitForLoad(soundID);
     
     sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
     if (sound != NULL) {
         int adjustedVol;
         retval = 0;
-        
+    
         if (volume < -10000) {
             volume = -10000;
         } else if (volume > 0) {
             volume = 0;
         }
-        
+    
         adjustedVol = (int)(SDL_pow(2, volume / 600.0) * SDL_MIX_MAXVOLUME);
-        
+    
         if (adjustedVol < 0) {
             adjustedVol = 0;
         } else if (adjustedVol > SDL_MIX_MAXVOLUME) {
             adjustedVol = SDL_MIX_MAXVOLUME;
         }
-        
-        sound->volume = adjustedVol;
-        
-        if (sound->nextSoundIDInSequence) {
+    
+        s_SendCommand(AUDIOCMD_VOLUME, sound, adjustedVol, 0);
+    
+        if (sound->nextSoundIDInSequence >= 0) {
             PL_SetVolumeSoundMem(volume, sound->nextSoundIDInSequence);
         }
     }
     
-    SDL_UnlockAudio();
-    
     return retval;
 }
 
@@ -1072,6 +2123,136 @@ int PL_ChangeVolumeSoundMem(int volume, int soundID) {
     return PL_SetVolumeSoundMem((int)(log10(volume / 255.0) * mul), soundID);
 }
 
+/* Pan is in hundredths of a decibel, from -10000 (left only) to 10000
+ * (right only). The far side is turned down; the near side is left as
+ * it is. */
+int PL_SetPanSoundMem(int pan, int soundID) {
+    Sound *sound;
+    int retval = -1;
+    
+    s_WaitForLoad(soundID);
+    
+    sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
+    if (sound != NULL) {
+        int gain;
+        retval = 0;
+    
+        if (pan < -10000) {
+            pan = -10000;
+        } else if (pan > 10000) {
+            pan = 10000;
+        }
+    
+        gain = (int)(SDL_pow(2, -SDL_abs(pan) / 600.0) * 0x10000);
+        if (pan == -10000 || pan == 10000) {
+            gain = 0;
+        }
+    
+        sound->pan = pan;
+        s_SendCommand(AUDIOCMD_PAN, sound,
+                      (pan > 0) ? gain : 0x10000,
+                      (pan < 0) ? gain : 0x10000);
+    
+        if (sound->nextSoundIDInSequence >= 0) {
+            PL_SetPanSoundMem(pan, sound->nextSoundIDInSequence);
+        }
+    }
+    
+    return retval;
+}
+
+/* Pan from -255 (left only) to 255 (right only), converted to
+ * decibels the same way as ChangeVolumeSoundMem. */
+int PL_ChangePanSoundMem(int pan, int soundID) {
+    double mul;
+    int db;
+    
+    if (pan > 255) {
+        pan = 255;
+    }
+    if (pan < -255) {
+        pan = -255;
+    }
+    
+    if (s_audioOldVolumeCalcFlag) {
+        mul = 1000.0;
+    } else {
+        mul = 5000.0;
+    }
+    
+    if (pan == 255 || pan == -255) {
+        db = -10000;
+    } else {
+        db = (int)(log10((255 - SDL_abs(pan)) / 255.0) * mul);
+    }
+    
+    return PL_SetPanSoundMem((pan < 0) ? db : -db, soundID);
+}
+
+int PL_GetPanSoundMem(int soundID) {
+    Sound *sound;
+    
+    s_WaitForLoad(soundID);
+    
+    sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
+    if (sound == NULL) {
+        return -1;
+    }
+    
+    return sound->pan;
+}
+
+/* Plays the sound as if it had been recorded at frequency, in Hz, or
+ * at its own rate for -1. Streamed sounds always play at their own. */
+int PL_SetFrequencySoundMem(int frequency, int soundID) {
+    Sound *sound;
+    int retval = -1;
+    
+    s_WaitForLoad(soundID);
+    
+    sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
+    if (sound != NULL && sound->soundType == SOUNDTYPE_BUFFER) {
+        double step = 0x10000;
+        retval = 0;
+    
+        if (frequency <= 0) {
+            frequency = -1;
+        } else {
+            step = (double)frequency * 0x10000 / sound->sample->frequency;
+            if (step < 0x100) {
+                step = 0x100;
+            } else if (step > 0x100000) {
+                step = 0x100000;
+            }
+        }
+    
+        sound->frequency = frequency;
+        s_SendCommand(AUDIOCMD_PITCH, sound, (int)step, 0);
+    
+        if (sound->nextSoundIDInSequence >= 0) {
+            PL_SetFrequencySoundMem(frequency, sound->nextSoundIDInSequence);
+        }
+    }
+    
+    return retval;
+}
+
+int PL_GetFrequencySoundMem(int soundID) {
+    Sound *sound;
+    
+    s_WaitForLoad(soundID);
+    
+    sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
+    if (sound == NULL || sound->soundType != SOUNDTYPE_BUFFER) {
+        return -1;
+    }
+    
+    if (sound->frequency > 0) {
+        return sound->frequency;
+    }
+    return sound->sample->frequency;
+}
+
 int PL_SetUseOldVolumeCalcFlag(int volumeFlag) {
     s_audioOldVolumeCalcFlag = volumeFlag;
     
@@ -1089,20 +2270,141 @@ int PL_GetCreateSoundDataType() {
     return 0;
 }
 
+/* Only affects streams loaded afterwards. */
+int PL_Audio_SetStreamBufferTime(int milliseconds) {
+    if (milliseconds <= 0) {
+        return -1;
+    }
+    if (milliseconds > 10000) {
+        milliseconds = 10000;
+    }
+    
+    s_streamBufferTime = milliseconds;
+    
+    return 0;
+}
+
+/* How many times the mixer has run out of decoded audio for the stream. */
+int PL_Audio_GetStreamUnderrunCount(int soundID) {
+    Sound *sound;
+    
+    s_WaitForLoad(soundID);
+    
+    sound = (Sound *)PL_Handle_GetData(soundID, DXHANDLE_SOUND);
+    if (sound == NULL) {
+        return -1;
+    }
+    if (sound->soundType != SOUNDTYPE_STREAM) {
+        return 0;
+    }
+    
+    return SDL_AtomicGet(&sound->stream.underrunCount);
+}
+
+/* The device settings only take effect when it is opened, which is
+ * when the first sound is loaded. Changing one lets a device that
+ * failed to open try again. */
+int PL_Audio_SetDeviceBufferSize(int frames) {
+    int size = 64;
+    
+    if (s_audioOpened == DXTRUE || frames <= 0) {
+        return -1;
+    }
+    
+    /* Some drivers only take powers of two. */
+    while (size < frames && size < 16384) {
+        size *= 2;
+    }
+    s_deviceBufferFrames = size;
+    s_audioCannotOpen = DXFALSE;
+    
+    return 0;
+}
+
+int PL_Audio_SetDeviceFrequency(int frequency) {
+    if (s_audioOpened == DXTRUE || frequency < 8000 || frequency > 192000) {
+        return -1;
+    }
+    
+    s_deviceFrequency = frequency;
+    s_audioCannotOpen = DXFALSE;
+    
+    return 0;
+}
+
+int PL_Audio_SetDeviceFormat(int format) {
+    if (s_audioOpened == DXTRUE
+        || (format != DX_SOUNDFORMAT_EXT_S16 && format != DX_SOUNDFORMAT_EXT_F32)
+    ) {
+        return -1;
+    }
+    
+    s_deviceFormat = format;
+    s_audioCannotOpen = DXFALSE;
+    
+    return 0;
+}
+
+/* What the device was actually opened with, opening it if need be. */
+int PL_Audio_GetDeviceState(int *frequency, int *bufferFrames, int *format) {
+    s_AudioOpen();
+    if (s_audioOpened == DXFALSE) {
+        return -1;
+    }
+    
+    if (frequency != NULL) {
+        *frequency = s_audioSpec.freq;
+    }
+    if (bufferFrames != NULL) {
+        *bufferFrames = s_audioSpec.samples;
+    }
+    if (format != NULL) {
+        *format = (s_audioSpec.format == AUDIO_F32SYS) ? DX_SOUNDFORMAT_EXT_F32 : DX_SOUNDFORMAT_EXT_S16;
+    }
+    
+    return 0;
+}
+
+/* Both in microseconds. The latency is from PlaySoundMem until the sound
+ * is on its way out of the device buffer, not counting the driver or
+ * hardware. The jitter is how far callbacks stray from their regular
+ * interval, on average. */
+int PL_Audio_GetDeviceLatency(int *latency, int *jitter) {
+    if (s_audioOpened == DXFALSE) {
+        return -1;
+    }
+    
+    if (latency != NULL) {
+        *latency = SDL_AtomicGet(&s_statLatency);
+    }
+    if (jitter != NULL) {
+        *jitter = SDL_AtomicGet(&s_statJitter);
+    }
+    
+    return 0;
+}
+
+/* What to do when every voice is in use and another sound starts. */
+int PL_Audio_SetVoiceStealMode(int mode) {
+    if (mode < DX_VOICESTEAL_EXT_NONE || mode > DX_VOICESTEAL_EXT_QUIETEST) {
+        return -1;
+    }
+    
+    SDL_AtomicSet(&s_voiceStealMode, mode);
+    
+    return 0;
+}
+
 int PL_InitSoundMem() {
     int handle;
     if (s_audioOpened == DXFALSE) {
         return 0;
     }
     
-    SDL_LockAudio();
-    
     while ((handle = PL_Handle_GetFirstIDOf(DXHANDLE_SOUND)) >= 0) {
         PL_DeleteSoundMem(handle);
     }
     
-    SDL_UnlockAudio();
-    
     return 0;
 }
 
@@ -1113,11 +2415,18 @@ int PL_Audio_ResetSettings() {
     
     s_audioOldVolumeCalcFlag = DXFALSE;
     s_audioDataType = DX_SOUNDDATATYPE_MEMNOPRESS;
+    s_streamBufferTime = DEFAULT_STREAM_BUFFER_TIME;
+    SDL_AtomicSet(&s_voiceStealMode, DEFAULT_VOICE_STEAL_MODE);
+    s_deviceFrequency = DEFAULT_DEVICE_FREQUENCY;
+    s_deviceBufferFrames = DEFAULT_DEVICE_BUFFER_FRAMES;
+    s_deviceFormat = DEFAULT_DEVICE_FORMAT;
     
     return 0;
 }
 
 int PL_Audio_Init() {
+    PL_AudioMix_SetKernelLevel(-1);
+    
     return 0;
 }
 
@@ -0,0 +1,409 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+    
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "DPLBuildConfig.h"
+
+#ifndef DXPORTLIB_NO_SOUND
+
+#include "PLInternal.h"
+
+#include "SDL.h"
+
+/* The mixing bus.
+ *
+ * Every voice is added into a buffer of floats, at the scale of 16-bit
+ * samples, and the result is only clamped once, when it is converted to
+ * the device format, either 16-bit or float. Sources are always
+ * interleaved 16-bit stereo, which is what sounds are decoded to.
+ *
+ * Adding and converting have plain C, SSE2, AVX2 and NEON versions,
+ * picked at runtime where that is needed. Conversion to 16-bit rounds
+ * halves away from zero in all of them, so they give the same output.
+ * Adding may differ in the last bit of a float where the compiler fuses
+ * the plain C multiply and add.
+ *
+ * Resampling for pitch is plain C only. Each output frame reads from
+ * its own place in the source, which leaves nothing for SIMD to do
+ * without gathers, and it is rare enough not to matter.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define AUDIOMIX_KERNELS_X86
+#  define AUDIOMIX_TARGET(x) __attribute__((target(x)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  define AUDIOMIX_KERNELS_X86
+#  define AUDIOMIX_TARGET(x)
+#endif
+
+#ifdef AUDIOMIX_KERNELS_X86
+#  include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define AUDIOMIX_KERNELS_NEON
+#  include <arm_neon.h>
+#endif
+
+/* bus[i] += src[i] * gain, with separate gains for left and right. */
+typedef void (*AudioMixAddFunction)(float *bus, const short *src, int frames,
+                                    float gainLeft, float gainRight);
+/* dest[i] = clamp(round(bus[i])) */
+typedef void (*AudioMixToS16Function)(const float *bus, short *dest, int count);
+/* dest[i] = clamp(bus[i] / 32768) */
+typedef void (*AudioMixToF32Function)(const float *bus, float *dest, int count);
+
+static AudioMixAddFunction s_addFunction = NULL;
+static AudioMixToS16Function s_toS16Function = NULL;
+static AudioMixToF32Function s_toF32Function = NULL;
+
+/* ------------------------------------------------------------ SCALAR */
+
+static DXINLINE short AudioMix_ToS16(float value) {
+    if (value > 32767.0f) {
+        value = 32767.0f;
+    } else if (value < -32768.0f) {
+        value = -32768.0f;
+    }
+    return (short)(int)(value + ((value < 0.0f) ? -0.5f : 0.5f));
+}
+
+static void AudioMix_Add_Scalar(float *bus, const short *src, int frames,
+                                float gainLeft, float gainRight) {
+    int i;
+    for (i = 0; i < frames; ++i) {
+        bus[i * 2 + 0] += (float)src[i * 2 + 0] * gainLeft;
+        bus[i * 2 + 1] += (float)src[i * 2 + 1] * gainRight;
+    }
+}
+
+static void AudioMix_ToS16_Scalar(const float *bus, short *dest, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        dest[i] = AudioMix_ToS16(bus[i]);
+    }
+}
+
+static void AudioMix_ToF32_Scalar(const float *bus, float *dest, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        float value = bus[i] * (1.0f / 32768.0f);
+        if (value > 1.0f) {
+            value = 1.0f;
+        } else if (value < -1.0f) {
+            value = -1.0f;
+        }
+        dest[i] = value;
+    }
+}
+
+#ifdef AUDIOMIX_KERNELS_X86
+/* ------------------------------------------------------------ SSE2 */
+
+AUDIOMIX_TARGET("sse2")
+static void AudioMix_Add_SSE2(float *bus, const short *src, int frames,
+                              float gainLeft, float gainRight) {
+    const __m128 gain = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i * 2));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        float *b = bus + i * 2;
+        _mm_storeu_ps(b, _mm_add_ps(_mm_loadu_ps(b), _mm_mul_ps(_mm_cvtepi32_ps(lo), gain)));
+        _mm_storeu_ps(b + 4, _mm_add_ps(_mm_loadu_ps(b + 4), _mm_mul_ps(_mm_cvtepi32_ps(hi), gain)));
+    }
+    AudioMix_Add_Scalar(bus + i * 2, src + i * 2, frames - i, gainLeft, gainRight);
+}
+
+/* Clamps, then adds a half with the sign of the value and truncates. */
+AUDIOMIX_TARGET("sse2")
+static DXINLINE __m128i AudioMix_ToS32_SSE2(__m128 value) {
+    const __m128 maxValue = _mm_set1_ps(32767.0f);
+    const __m128 minValue = _mm_set1_ps(-32768.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    
+    value = _mm_max_ps(_mm_min_ps(value, maxValue), minValue);
+    value = _mm_add_ps(value, _mm_or_ps(_mm_and_ps(value, signMask), half));
+    return _mm_cvttps_epi32(value);
+}
+
+AUDIOMIX_TARGET("sse2")
+static void AudioMix_ToS16_SSE2(const float *bus, short *dest, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = AudioMix_ToS32_SSE2(_mm_loadu_ps(bus + i));
+        __m128i hi = AudioMix_ToS32_SSE2(_mm_loadu_ps(bus + i + 4));
+        _mm_storeu_si128((__m128i *)(dest + i), _mm_packs_epi32(lo, hi));
+    }
+    AudioMix_ToS16_Scalar(bus + i, dest + i, count - i);
+}
+
+AUDIOMIX_TARGET("sse2")
+static void AudioMix_ToF32_SSE2(const float *bus, float *dest, int count) {
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    const __m128 maxValue = _mm_set1_ps(1.0f);
+    const __m128 minValue = _mm_set1_ps(-1.0f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 value = _mm_mul_ps(_mm_loadu_ps(bus + i), scale);
+        _mm_storeu_ps(dest + i, _mm_max_ps(_mm_min_ps(value, maxValue), minValue));
+    }
+    AudioMix_ToF32_Scalar(bus + i, dest + i, count - i);
+}
+
+/* ------------------------------------------------------------ AVX2 */
+
+AUDIOMIX_TARGET("avx2")
+static void AudioMix_Add_AVX2(float *bus, const short *src, int frames,
+                              float gainLeft, float gainRight) {
+    const __m256 gain = _mm256_setr_ps(gainLeft, gainRight, gainLeft, gainRight,
+                                       gainLeft, gainRight, gainLeft, gainRight);
+    int i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i * 2)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i * 2 + 8)));
+        float *b = bus + i * 2;
+        _mm256_storeu_ps(b, _mm256_add_ps(_mm256_loadu_ps(b),
+                                          _mm256_mul_ps(_mm256_cvtepi32_ps(lo), gain)));
+        _mm256_storeu_ps(b + 8, _mm256_add_ps(_mm256_loadu_ps(b + 8),
+                                              _mm256_mul_ps(_mm256_cvtepi32_ps(hi), gain)));
+    }
+    AudioMix_Add_Scalar(bus + i * 2, src + i * 2, frames - i, gainLeft, gainRight);
+}
+
+AUDIOMIX_TARGET("avx2")
+static DXINLINE __m256i AudioMix_ToS32_AVX2(__m256 value) {
+    const __m256 maxValue = _mm256_set1_ps(32767.0f);
+    const __m256 minValue = _mm256_set1_ps(-32768.0f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    
+    value = _mm256_max_ps(_mm256_min_ps(value, maxValue), minValue);
+    value = _mm256_add_ps(value, _mm256_or_ps(_mm256_and_ps(value, signMask), half));
+    return _mm256_cvttps_epi32(value);
+}
+
+AUDIOMIX_TARGET("avx2")
+static void AudioMix_ToS16_AVX2(const float *bus, short *dest, int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i lo = AudioMix_ToS32_AVX2(_mm256_loadu_ps(bus + i));
+        __m256i hi = AudioMix_ToS32_AVX2(_mm256_loadu_ps(bus + i + 8));
+        /* The pack works within each 128-bit half, so put them back
+         * in order afterwards. */
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xd8);
+        _mm256_storeu_si256((__m256i *)(dest + i), packed);
+    }
+    AudioMix_ToS16_Scalar(bus + i, dest + i, count - i);
+}
+
+AUDIOMIX_TARGET("avx2")
+static void AudioMix_ToF32_AVX2(const float *bus, float *dest, int count) {
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    const __m256 maxValue = _mm256_set1_ps(1.0f);
+    const __m256 minValue = _mm256_set1_ps(-1.0f);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 value = _mm256_mul_ps(_mm256_loadu_ps(bus + i), scale);
+        _mm256_storeu_ps(dest + i, _mm256_max_ps(_mm256_min_ps(value, maxValue), minValue));
+    }
+    AudioMix_ToF32_Scalar(bus + i, dest + i, count - i);
+}
+#endif /* #ifdef AUDIOMIX_KERNELS_X86 */
+
+#ifdef AUDIOMIX_KERNELS_NEON
+/* ------------------------------------------------------------ NEON */
+
+static void AudioMix_Add_NEON(float *bus, const short *src, int frames,
+                              float gainLeft, float gainRight) {
+    const float gainValues[4] = { gainLeft, gainRight, gainLeft, gainRight };
+    const float32x4_t gain = vld1q_f32(gainValues);
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        int16x8_t s = vld1q_s16(src + i * 2);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+        float *b = bus + i * 2;
+        vst1q_f32(b, vaddq_f32(vld1q_f32(b), vmulq_f32(lo, gain)));
+        vst1q_f32(b + 4, vaddq_f32(vld1q_f32(b + 4), vmulq_f32(hi, gain)));
+    }
+    AudioMix_Add_Scalar(bus + i * 2, src + i * 2, frames - i, gainLeft, gainRight);
+}
+
+static DXINLINE int32x4_t AudioMix_ToS32_NEON(float32x4_t value) {
+    const uint32x4_t signMask = vdupq_n_u32(0x80000000);
+    const uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+    uint32x4_t signedHalf;
+    
+    value = vmaxq_f32(vminq_f32(value, vdupq_n_f32(32767.0f)), vdupq_n_f32(-32768.0f));
+    signedHalf = vorrq_u32(vandq_u32(vreinterpretq_u32_f32(value), signMask), half);
+    return vcvtq_s32_f32(vaddq_f32(value, vreinterpretq_f32_u32(signedHalf)));
+}
+
+static void AudioMix_ToS16_NEON(const float *bus, short *dest, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x4_t lo = vqmovn_s32(AudioMix_ToS32_NEON(vld1q_f32(bus + i)));
+        int16x4_t hi = vqmovn_s32(AudioMix_ToS32_NEON(vld1q_f32(bus + i + 4)));
+        vst1q_s16(dest + i, vcombine_s16(lo, hi));
+    }
+    AudioMix_ToS16_Scalar(bus + i, dest + i, count - i);
+}
+
+static void AudioMix_ToF32_NEON(const float *bus, float *dest, int count) {
+    const float32x4_t scale = vdupq_n_f32(1.0f / 32768.0f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t value = vmulq_f32(vld1q_f32(bus + i), scale);
+        vst1q_f32(dest + i, vmaxq_f32(vminq_f32(value, vdupq_n_f32(1.0f)), vdupq_n_f32(-1.0f)));
+    }
+    AudioMix_ToF32_Scalar(bus + i, dest + i, count - i);
+}
+#endif /* #ifdef AUDIOMIX_KERNELS_NEON */
+
+/* ------------------------------------------------------------ DISPATCH */
+
+static int AudioMix_GetBestKernelLevel() {
+#ifdef AUDIOMIX_KERNELS_X86
+#  if SDL_VERSION_ATLEAST(2, 0, 4)
+    if (SDL_HasAVX2()) {
+        return PL_AUDIOMIX_KERNEL_AVX2;
+    }
+#  endif
+    if (SDL_HasSSE2()) {
+        return PL_AUDIOMIX_KERNEL_SSE2;
+    }
+#endif
+#ifdef AUDIOMIX_KERNELS_NEON
+    return PL_AUDIOMIX_KERNEL_NEON;
+#endif
+    return PL_AUDIOMIX_KERNEL_SCALAR;
+}
+
+/* Picks which versions to use. level is one of the PL_AUDIOMIX_KERNEL_
+ * values, or -1 for the best available; anything the CPU can't run is
+ * lowered. Returns the level in use.
+ *
+ * The mixer runs on the audio thread, so only call this while it is
+ * not running. PL_Audio_Init picks the best level before any device
+ * is opened.
+ */
+int PL_AudioMix_SetKernelLevel(int level) {
+    int bestLevel = AudioMix_GetBestKernelLevel();
+    
+    if (level < 0 || level > bestLevel) {
+        level = bestLevel;
+    }
+    
+    switch(level) {
+#ifdef AUDIOMIX_KERNELS_NEON
+        case PL_AUDIOMIX_KERNEL_NEON:
+            s_addFunction = AudioMix_Add_NEON;
+            s_toS16Function = AudioMix_ToS16_NEON;
+            s_toF32Function = AudioMix_ToF32_NEON;
+            break;
+#endif
+#ifdef AUDIOMIX_KERNELS_X86
+        case PL_AUDIOMIX_KERNEL_AVX2:
+            s_addFunction = AudioMix_Add_AVX2;
+            s_toS16Function = AudioMix_ToS16_AVX2;
+            s_toF32Function = AudioMix_ToF32_AVX2;
+            break;
+        case PL_AUDIOMIX_KERNEL_SSE2:
+            s_addFunction = AudioMix_Add_SSE2;
+            s_toS16Function = AudioMix_ToS16_SSE2;
+            s_toF32Function = AudioMix_ToF32_SSE2;
+            break;
+#endif
+        default:
+            level = PL_AUDIOMIX_KERNEL_SCALAR;
+            s_addFunction = AudioMix_Add_Scalar;
+            s_toS16Function = AudioMix_ToS16_Scalar;
+            s_toF32Function = AudioMix_ToF32_Scalar;
+            break;
+    }
+    
+    return level;
+}
+
+/* ---------------------------------------------------------------- MIX */
+
+/* Adds frames of 16-bit stereo from src into the bus. */
+void PL_AudioMix_Add(float *bus, const short *src, int frames,
+                     float gainLeft, float gainRight) {
+    if (frames > 0) {
+        s_addFunction(bus, src, frames, gainLeft, gainRight);
+    }
+}
+
+/* Adds up to frames of 16-bit stereo from src into the bus, stepping
+ * through src at step / 65536 frames per output frame, and blending
+ * linearly between neighbouring frames.
+ *
+ * *position and *fraction are where in src to start, in frames and
+ * 65536ths of a frame, and are moved on to where it stopped. Returns how
+ * many frames were added; fewer than asked means the end of src.
+ */
+int PL_AudioMix_AddResampled(float *bus, int frames,
+                             const short *src, unsigned int srcFrames,
+                             unsigned int *position, unsigned int *fraction,
+                             unsigned int step, float gainLeft, float gainRight) {
+    unsigned int pos = *position;
+    unsigned int frac = *fraction;
+    int i = 0;
+    
+    while (i < frames && pos < srcFrames) {
+        const short *a = src + pos * 2;
+        const short *b = (pos + 1 < srcFrames) ? (a + 2) : a;
+        float t = (float)frac * (1.0f / 65536.0f);
+        float left = (float)a[0] + (float)(b[0] - a[0]) * t;
+        float right = (float)a[1] + (float)(b[1] - a[1]) * t;
+    
+        bus[i * 2 + 0] += left * gainLeft;
+        bus[i * 2 + 1] += right * gainRight;
+    
+        frac += step;
+        pos += frac >> 16;
+        frac &= 0xffff;
+        i += 1;
+    }
+    
+    *position = pos;
+    *fraction = frac;
+    return i;
+}
+
+/* Converts count samples from the bus to 16-bit, clamping each. */
+void PL_AudioMix_ToS16(const float *bus, short *dest, int count) {
+    if (count > 0) {
+        s_toS16Function(bus, dest, count);
+    }
+}
+
+/* Converts count samples from the bus to floats from -1 to 1. */
+void PL_AudioMix_ToF32(const float *bus, float *dest, int count) {
+    if (count > 0) {
+        s_toF32Function(bus, dest, count);
+    }
+}
+
+#endif /* #ifndef DXPORTLIB_NO_SOUND */
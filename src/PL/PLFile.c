@@ -32,6 +32,11 @@ typedef struct _FileHandle {
 
 static PLFileOpenFileFunction s_openReadFunction = NULL;
 
+/* Opening a file may go through shared state, like the archive list,
+ * and may happen on background loading threads. Reads on an open
+ * handle only touch that handle, so they don't need it. */
+static SDL_mutex *s_openMutex = NULL;
+
 /* ------------------------------------------------------- Memory handle */
 typedef struct _MemoryHandleData {
     void *data;
@@ -258,12 +263,30 @@ void PL_File_SetOpenReadFunction(PLFileOpenFileFunction func) {
     s_openReadFunction = func;
 }
 
+void PL_File_Lock() {
+    if (s_openMutex != NULL) {
+        SDL_LockMutex(s_openMutex);
+    }
+}
+
+void PL_File_Unlock() {
+    if (s_openMutex != NULL) {
+        SDL_UnlockMutex(s_openMutex);
+    }
+}
+
 int PL_File_OpenRead(const char *filename) {
+    int fileHandle;
+    
+    PL_File_Lock();
     if (s_openReadFunction != NULL) {
-        return s_openReadFunction(filename);
+        fileHandle = s_openReadFunction(filename);
     } else {
-        return PL_Platform_FileOpenReadDirect(filename);
+        fileHandle = PL_Platform_FileOpenReadDirect(filename);
     }
+    PL_File_Unlock();
+    
+    return fileHandle;
 }
 
 int PL_File_OpenWrite(const char *filename) {
@@ -332,7 +355,9 @@ int PL_File_CopyDirect(const char *src, const char *dest, int dontCopyIfExists)
 }
 
 int PL_File_Init() {
-    /* nothing to do */
+    if (s_openMutex == NULL) {
+        s_openMutex = SDL_CreateMutex();
+    }
     return 0;
 }
 
@@ -347,5 +372,10 @@ int PL_File_End() {
     s_openReadFunction = NULL;
      */
     
+    if (s_openMutex != NULL) {
+        SDL_DestroyMutex(s_openMutex);
+        s_openMutex = NULL;
+    }
+    
     return 0;
 }
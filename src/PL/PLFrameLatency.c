@@ -0,0 +1,209 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+    
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "PLInternal.h"
+
+/* Frame latency limiting.
+ *
+ * The renderer drops a fence at the end of each frame. Before a new
+ * frame is started, Wait blocks until the oldest fences have passed,
+ * so that no more than maxFrames frames are ever queued up on the GPU,
+ * counting the one about to be drawn. The CPU only stalls when the GPU
+ * is really that far behind, rather than on the whole queue every
+ * frame, as glFinish does.
+ *
+ * Fences are handled through a set of functions, which the renderer
+ * supplies, so the logic here works the same on simulated ones. With
+ * no fence functions, Wait falls back on the finish function instead.
+ */
+
+#define MAX_FENCES 8
+#define DEFAULT_MAX_FRAMES 2
+
+static Uint64 s_DefaultNow(void *userdata) {
+    return SDL_GetPerformanceCounter();
+}
+
+static PLFrameLatencyFunctions s_funcs;
+static int s_hasFunctions = DXFALSE;
+static Uint64 s_frequency = 1;
+
+static void *s_fences[MAX_FENCES];
+static int s_fenceFirst = 0;
+static int s_fenceCount = 0;
+
+static int s_maxFrames = DEFAULT_MAX_FRAMES;
+
+static PLFrameLatencyStats s_stats;
+
+static Uint64 s_Now() {
+    return s_funcs.now(s_funcs.userdata);
+}
+
+static void s_PopFence() {
+    void *fence = s_fences[s_fenceFirst];
+    
+    s_funcs.fenceDelete(s_funcs.userdata, fence);
+    s_fences[s_fenceFirst] = NULL;
+    s_fenceFirst = (s_fenceFirst + 1) % MAX_FENCES;
+    s_fenceCount -= 1;
+}
+
+static void s_DeleteAllFences() {
+    while (s_fenceCount > 0) {
+        s_PopFence();
+    }
+    s_fenceFirst = 0;
+}
+
+/* Sets the fence, finish and clock functions. NULL disables limiting
+ * altogether. Any fences from the old functions are deleted with them. */
+void PL_FrameLatency_SetFunctions(const PLFrameLatencyFunctions *funcs) {
+    if (s_hasFunctions == DXTRUE) {
+        s_DeleteAllFences();
+    }
+    
+    if (funcs == NULL) {
+        SDL_memset(&s_funcs, 0, sizeof(s_funcs));
+        s_hasFunctions = DXFALSE;
+        return;
+    }
+    
+    s_funcs = *funcs;
+    if (s_funcs.fenceInsert == NULL || s_funcs.fenceWait == NULL
+        || s_funcs.fenceDelete == NULL
+    ) {
+        s_funcs.fenceInsert = NULL;
+        s_funcs.fenceWait = NULL;
+        s_funcs.fenceDelete = NULL;
+    }
+    if (s_funcs.now == NULL || s_funcs.frequency == 0) {
+        s_funcs.now = s_DefaultNow;
+        s_funcs.frequency = SDL_GetPerformanceFrequency();
+    }
+    s_frequency = s_funcs.frequency;
+    s_hasFunctions = DXTRUE;
+    
+    PL_FrameLatency_ResetStats();
+}
+
+/* How many frames may be in flight, counting the one being drawn. */
+int PL_FrameLatency_SetMaxFrames(int frames) {
+    if (frames < 1) {
+        frames = 1;
+    } else if (frames > MAX_FENCES) {
+        frames = MAX_FENCES;
+    }
+    
+    s_maxFrames = frames;
+    
+    return 0;
+}
+
+/* Marks the end of a frame's drawing commands. */
+int PL_FrameLatency_EndFrame() {
+    void *fence;
+    
+    if (s_hasFunctions == DXFALSE || s_funcs.fenceInsert == NULL) {
+        return 0;
+    }
+    
+    /* Nobody is waiting on these, so let the oldest go unchecked. */
+    if (s_fenceCount >= MAX_FENCES) {
+        s_PopFence();
+    }
+    
+    fence = s_funcs.fenceInsert(s_funcs.userdata);
+    if (fence == NULL) {
+        return -1;
+    }
+    
+    s_fences[(s_fenceFirst + s_fenceCount) % MAX_FENCES] = fence;
+    s_fenceCount += 1;
+    
+    return 0;
+}
+
+/* Blocks until a new frame may be started. Returns how long that took,
+ * in microseconds. */
+int PL_FrameLatency_Wait() {
+    Uint64 start;
+    Uint64 microseconds;
+    int blocked = DXFALSE;
+    
+    if (s_hasFunctions == DXFALSE) {
+        return 0;
+    }
+    
+    start = s_Now();
+    
+    if (s_funcs.fenceInsert != NULL) {
+        /* Let go of whatever is already done, then wait on the rest
+         * until there is room for another frame. */
+        while (s_fenceCount > 0
+               && s_funcs.fenceWait(s_funcs.userdata, s_fences[s_fenceFirst], DXFALSE) == DXTRUE
+        ) {
+            s_PopFence();
+        }
+        while (s_fenceCount >= s_maxFrames) {
+            s_funcs.fenceWait(s_funcs.userdata, s_fences[s_fenceFirst], DXTRUE);
+            s_PopFence();
+            blocked = DXTRUE;
+        }
+    } else if (s_funcs.finish != NULL) {
+        s_funcs.finish(s_funcs.userdata);
+        blocked = DXTRUE;
+    }
+    
+    microseconds = (s_Now() - start) * 1000000 / s_frequency;
+    if (microseconds > 0x7fffffff) {
+        microseconds = 0x7fffffff;
+    }
+    
+    s_stats.frameCount += 1;
+    s_stats.framesInFlight = s_fenceCount;
+    s_stats.lastWaitTime = (int)microseconds;
+    s_stats.totalWaitTime += (int64_t)microseconds;
+    if (s_stats.lastWaitTime > s_stats.maxWaitTime) {
+        s_stats.maxWaitTime = s_stats.lastWaitTime;
+    }
+    if (blocked == DXTRUE) {
+        s_stats.waitCount += 1;
+    }
+    
+    return (int)microseconds;
+}
+
+int PL_FrameLatency_GetStats(PLFrameLatencyStats *stats) {
+    if (stats == NULL) {
+        return -1;
+    }
+    
+    *stats = s_stats;
+    stats->maxFramesInFlight = s_maxFrames;
+    stats->usingFinish = (s_hasFunctions == DXTRUE && s_funcs.fenceInsert == NULL) ? DXTRUE : DXFALSE;
+    
+    return 0;
+}
+
+void PL_FrameLatency_ResetStats() {
+    SDL_memset(&s_stats, 0, sizeof(s_stats));
+}
@@ -0,0 +1,347 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+    
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "PLInternal.h"
+
+#include <stdlib.h>
+
+/* Frame pacing.
+ *
+ * Each frame has a deadline, one frame period after the last one. Sync
+ * sleeps until shortly before it, then spins on the clock for the rest,
+ * as sleeps are only good to a millisecond or so and often overshoot.
+ * How early to stop sleeping follows the worst overshoot out of the
+ * last few sleeps.
+ *
+ * Deadlines advance by exactly one period from the previous deadline,
+ * not from when the frame actually ended, so a frame that ends late is
+ * made up for by the next one and the rate does not drift. The period
+ * is kept as a whole number of clock ticks plus a remainder, so 60 FPS
+ * on a millisecond clock still comes out at 60 and not 62.5. Only when
+ * a frame is more than a whole period late does it start over from the
+ * current time, so that a long stall is not followed by a burst of
+ * frames trying to catch up.
+ *
+ * The clock and the sleep can be replaced, so that tests can run the
+ * pacer on simulated time.
+ */
+
+#define HISTORY_SIZE 256
+
+/* Limits on how early to stop sleeping, in microseconds. */
+#define SPIN_INITIAL 2000
+#define SPIN_MINIMUM 250
+#define SPIN_MAXIMUM 4000
+#define SPIN_MARGIN 200
+
+#define OVERSHOOT_HISTORY_SIZE 32
+
+static Uint64 s_DefaultNow(void *userdata) {
+    return SDL_GetPerformanceCounter();
+}
+static void s_DefaultSleep(void *userdata, int milliseconds) {
+    SDL_Delay((Uint32)milliseconds);
+}
+
+static PLFramePacerNowFunction s_nowFunc = s_DefaultNow;
+static PLFramePacerSleepFunction s_sleepFunc = s_DefaultSleep;
+static void *s_clockUserdata = NULL;
+static Uint64 s_frequency = 0;
+
+static int s_frameRate = 0;
+static Uint64 s_periodTicks = 0;
+static Uint64 s_periodRemainder = 0;
+static Uint64 s_remainderCount = 0;
+
+static int s_started = DXFALSE;
+static Uint64 s_deadline = 0;
+static Uint64 s_lastFrameTime = 0;
+static Uint64 s_spinTicks = 0;
+
+static Uint64 s_overshoots[OVERSHOOT_HISTORY_SIZE];
+static int s_overshootPos = 0;
+
+static int s_history[HISTORY_SIZE];
+static int s_historyPos = 0;
+static int s_historyCount = 0;
+static int s_missedCount = 0;
+
+static Uint64 s_FromMicroseconds(Uint64 microseconds) {
+    return microseconds * s_frequency / 1000000;
+}
+static Uint64 s_ToMicroseconds(Uint64 ticks) {
+    return ticks * 1000000 / s_frequency;
+}
+
+static void s_ResetSpin() {
+    int i;
+    
+    /* Until there have been enough sleeps to go on, assume they can
+     * overshoot by a couple of milliseconds, as they do on a 1 ms timer. */
+    s_spinTicks = s_FromMicroseconds(SPIN_INITIAL);
+    for (i = 0; i < OVERSHOOT_HISTORY_SIZE; ++i) {
+        s_overshoots[i] = s_FromMicroseconds(SPIN_INITIAL - SPIN_MARGIN);
+    }
+    s_overshootPos = 0;
+}
+
+static void s_CheckClock() {
+    if (s_frequency == 0) {
+        s_frequency = SDL_GetPerformanceFrequency();
+        s_ResetSpin();
+    }
+}
+
+/* ------------------------------------------------------------- Waiting */
+
+/* Stops sleeping far enough ahead to cover the worst recent overshoot.
+ * Overshoots tend to come in a pattern, so following only the latest
+ * one would be caught out by the next bad one. */
+static void s_Calibrate(Uint64 overshoot) {
+    Uint64 worst = 0;
+    Uint64 minimum = s_FromMicroseconds(SPIN_MINIMUM);
+    Uint64 maximum = s_FromMicroseconds(SPIN_MAXIMUM);
+    int i;
+    
+    s_overshoots[s_overshootPos] = overshoot;
+    s_overshootPos = (s_overshootPos + 1) % OVERSHOOT_HISTORY_SIZE;
+    
+    for (i = 0; i < OVERSHOOT_HISTORY_SIZE; ++i) {
+        if (s_overshoots[i] > worst) {
+            worst = s_overshoots[i];
+        }
+    }
+    
+    s_spinTicks = worst + s_FromMicroseconds(SPIN_MARGIN);
+    if (s_spinTicks < minimum) {
+        s_spinTicks = minimum;
+    } else if (s_spinTicks > maximum) {
+        s_spinTicks = maximum;
+    }
+}
+
+static Uint64 s_WaitUntil(Uint64 target) {
+    Uint64 now = s_nowFunc(s_clockUserdata);
+    
+    while (now < target && target - now > s_spinTicks) {
+        Uint64 sleepTicks = target - now - s_spinTicks;
+        Uint64 requested;
+        Uint64 before;
+        int milliseconds = (int)(sleepTicks * 1000 / s_frequency);
+    
+        if (milliseconds < 1) {
+            break;
+        }
+    
+        before = now;
+        s_sleepFunc(s_clockUserdata, milliseconds);
+        now = s_nowFunc(s_clockUserdata);
+    
+        requested = (Uint64)milliseconds * s_frequency / 1000;
+        s_Calibrate((now - before > requested) ? (now - before - requested) : 0);
+    }
+    
+    while (now < target) {
+        now = s_nowFunc(s_clockUserdata);
+    }
+    
+    return now;
+}
+
+static void s_AdvanceDeadline() {
+    s_deadline += s_periodTicks;
+    
+    s_remainderCount += s_periodRemainder;
+    if (s_remainderCount >= (Uint64)s_frameRate) {
+        s_remainderCount -= (Uint64)s_frameRate;
+        s_deadline += 1;
+    }
+}
+
+static void s_RecordFrame(Uint64 ticks) {
+    Uint64 microseconds = s_ToMicroseconds(ticks);
+    
+    s_history[s_historyPos] = (microseconds > 0x7fffffff) ? 0x7fffffff : (int)microseconds;
+    s_historyPos = (s_historyPos + 1) % HISTORY_SIZE;
+    if (s_historyCount < HISTORY_SIZE) {
+        s_historyCount += 1;
+    }
+}
+
+/* Waits for the end of the frame, returning DXTRUE if the frame was
+ * already late. With no frame rate set, this only keeps statistics. */
+int PL_FramePacer_Sync() {
+    Uint64 now;
+    int missed = DXFALSE;
+    
+    s_CheckClock();
+    
+    now = s_nowFunc(s_clockUserdata);
+    if (s_started == DXFALSE) {
+        s_started = DXTRUE;
+        s_lastFrameTime = now;
+        s_deadline = now;
+        s_remainderCount = 0;
+        if (s_frameRate > 0) {
+            s_AdvanceDeadline();
+        }
+        return DXFALSE;
+    }
+    
+    if (s_frameRate > 0) {
+        if (now <= s_deadline) {
+            now = s_WaitUntil(s_deadline);
+        } else {
+            missed = DXTRUE;
+            s_missedCount += 1;
+    
+            if (now - s_deadline >= s_periodTicks) {
+                s_deadline = now;
+                s_remainderCount = 0;
+            }
+        }
+        s_AdvanceDeadline();
+    } else {
+        s_deadline = now;
+    }
+    
+    s_RecordFrame(now - s_lastFrameTime);
+    s_lastFrameTime = now;
+    
+    return missed;
+}
+
+/* Pushes the next deadline back, for time the caller has already spent
+ * waiting on something else, such as vsync. */
+void PL_FramePacer_Delay(int microseconds) {
+    s_CheckClock();
+    
+    if (s_started == DXTRUE && microseconds > 0) {
+        s_deadline += s_FromMicroseconds((Uint64)microseconds);
+    }
+}
+
+/* ------------------------------------------------------------- Settings */
+
+/* Zero or less turns pacing off. The next frame starts from whenever
+ * Sync is next called. */
+void PL_FramePacer_SetFrameRate(int framesPerSecond) {
+    s_CheckClock();
+    
+    if (framesPerSecond < 0) {
+        framesPerSecond = 0;
+    }
+    
+    s_frameRate = framesPerSecond;
+    if (framesPerSecond > 0) {
+        s_periodTicks = s_frequency / (Uint64)framesPerSecond;
+        s_periodRemainder = s_frequency % (Uint64)framesPerSecond;
+    } else {
+        s_periodTicks = 0;
+        s_periodRemainder = 0;
+    }
+    s_remainderCount = 0;
+    
+    if (s_started == DXTRUE) {
+        s_deadline = s_nowFunc(s_clockUserdata);
+        if (framesPerSecond > 0) {
+            s_AdvanceDeadline();
+        }
+    }
+}
+
+int PL_FramePacer_GetFrameRate() {
+    return s_frameRate;
+}
+
+/* Replaces the clock, which counts frequency ticks per second, and the
+ * sleep. NULL functions put back the SDL ones. Starts over, as times
+ * from the old clock mean nothing to the new one. */
+void PL_FramePacer_SetClock(PLFramePacerNowFunction nowFunc,
+                            PLFramePacerSleepFunction sleepFunc,
+                            Uint64 frequency, void *userdata) {
+    if (nowFunc == NULL || sleepFunc == NULL || frequency == 0) {
+        s_nowFunc = s_DefaultNow;
+        s_sleepFunc = s_DefaultSleep;
+        s_clockUserdata = NULL;
+        s_frequency = SDL_GetPerformanceFrequency();
+    } else {
+        s_nowFunc = nowFunc;
+        s_sleepFunc = sleepFunc;
+        s_clockUserdata = userdata;
+        s_frequency = frequency;
+    }
+    
+    s_ResetSpin();
+    PL_FramePacer_SetFrameRate(s_frameRate);
+    PL_FramePacer_Reset();
+}
+
+/* Forgets the statistics, and starts timing over from the next Sync. */
+void PL_FramePacer_Reset() {
+    s_started = DXFALSE;
+    s_historyPos = 0;
+    s_historyCount = 0;
+    s_missedCount = 0;
+}
+
+/* ----------------------------------------------------------- Statistics */
+
+static int s_CompareInt(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Frame times over the last HISTORY_SIZE frames, in microseconds, and
+ * how many frames were late since the last reset. */
+int PL_FramePacer_GetStats(PLFramePacerStats *stats) {
+    int sorted[HISTORY_SIZE];
+    Uint64 total = 0;
+    int i;
+    
+    if (stats == NULL) {
+        return -1;
+    }
+    
+    stats->frameCount = s_historyCount;
+    stats->missedCount = s_missedCount;
+    if (s_historyCount == 0) {
+        stats->averageTime = 0;
+        stats->minTime = 0;
+        stats->maxTime = 0;
+        stats->p99Time = 0;
+        return 0;
+    }
+    
+    for (i = 0; i < s_historyCount; ++i) {
+        sorted[i] = s_history[i];
+        total += (Uint64)s_history[i];
+    }
+    qsort(sorted, (size_t)s_historyCount, sizeof(int), s_CompareInt);
+    
+    stats->averageTime = (int)(total / (Uint64)s_historyCount);
+    stats->minTime = sorted[0];
+    stats->maxTime = sorted[s_historyCount - 1];
+    stats->p99Time = sorted[(s_historyCount * 99 + 99) / 100 - 1];
+    
+    return 0;
+}
@@ -26,6 +26,9 @@
  *
  * Similar to it, we use a doubly-linked list, except
  * it is statically allocated to reduce page separation.
+ *
+ * Background loading threads acquire handles too, so the table
+ * itself is guarded by a spinlock. The data behind a handle is not.
  */
 
 typedef struct HandleData {
@@ -33,6 +36,8 @@ typedef struct HandleData {
     
     int *deleteFlag;
     
+    int asyncJobID;
+    
     HandleType handleType;
     
     int prevID;
@@ -43,6 +48,10 @@ static int s_initialized = DXFALSE;
 static HandleData *s_handleTable = NULL;
 static int s_handleCount = 0;
 static int s_handleLists[DXHANDLE_END];
+static SDL_SpinLock s_handleLock = 0;
+
+#define HANDLE_LOCK() SDL_AtomicLock(&s_handleLock)
+#define HANDLE_UNLOCK() SDL_AtomicUnlock(&s_handleLock)
 
 static void s_Enlarge() {
     int n = s_handleCount + 512;
@@ -58,6 +67,7 @@ static void s_Enlarge() {
         handle = s_handleTable;
         handle[0].data = NULL;
         handle[0].deleteFlag = 0;
+        handle[0].asyncJobID = -1;
         handle[0].handleType = DXHANDLE_NONE;
         handle[0].nextID = -1;
         handle[0].prevID = -1;
@@ -71,6 +81,7 @@ static void s_Enlarge() {
         handle = &s_handleTable[i];
         handle->data = NULL;
         handle->deleteFlag = 0;
+        handle->asyncJobID = -1;
         handle->handleType = DXHANDLE_NONE;
         handle->nextID = last;
         handle->prevID = i - 1;
@@ -110,7 +121,8 @@ static void s_Link(int id) {
     s_handleLists[handle->handleType] = id;
 }
 
-void PL_Handle_Init() {
+/* Must be called with the lock held. */
+static void s_Init() {
     int i;
     
     if (s_initialized == DXTRUE) {
@@ -126,10 +138,18 @@ void PL_Handle_Init() {
     s_initialized = DXTRUE;
 }
 
+void PL_Handle_Init() {
+    HANDLE_LOCK();
+    s_Init();
+    HANDLE_UNLOCK();
+}
+
 void PL_Handle_End() {
     int i;
     
+    HANDLE_LOCK();
     if (s_initialized == DXFALSE) {
+        HANDLE_UNLOCK();
         return;
     }
     
@@ -144,6 +164,7 @@ void PL_Handle_End() {
     }
     
     s_initialized = DXFALSE;
+    HANDLE_UNLOCK();
 }
 
 int PL_Handle_AcquireID(int handleType) {
@@ -153,9 +174,10 @@ int PL_Handle_AcquireID(int handleType) {
     if (handleType <= DXHANDLE_NONE || handleType >= DXHANDLE_END) {
         return -1;
     }
-    if (s_initialized == DXFALSE) {
-        PL_Handle_Init();
-    }
+    
+    HANDLE_LOCK();
+    /* Checked under the lock, so two threads cannot both set it up. */
+    s_Init();
     
     freeID = s_handleLists[DXHANDLE_NONE];
     if (freeID == -1) {
@@ -168,22 +190,28 @@ int PL_Handle_AcquireID(int handleType) {
     handle = &s_handleTable[freeID];
     handle->handleType = handleType;
     handle->deleteFlag = 0;
+    handle->asyncJobID = -1;
     
     s_Link(freeID);
+    HANDLE_UNLOCK();
     
     return freeID;
 }
 
 void PL_Handle_ReleaseID(int handleID, int freeData) {
     HandleData *handle;
+    void *data = NULL;
+    
+    HANDLE_LOCK();
     if (handleID < 0 || handleID >= s_handleCount) {
+        HANDLE_UNLOCK();
         return;
     }
     
     handle = &s_handleTable[handleID];
     
-    if (freeData != DXFALSE && handle->data != NULL) {
-        DXFREE(handle->data);
+    if (freeData != DXFALSE) {
+        data = handle->data;
         handle->data = NULL;
     }
     
@@ -191,47 +219,61 @@ void PL_Handle_ReleaseID(int handleID, int freeData) {
         *(handle->deleteFlag) = -1;
         handle->deleteFlag = 0;
     }
+    handle->asyncJobID = -1;
     
     s_Unlink(handleID);
     
     handle->handleType = DXHANDLE_NONE;
     
     s_Link(handleID);
+    HANDLE_UNLOCK();
+    
+    if (data != NULL) {
+        DXFREE(data);
+    }
 }
 
 void *PL_Handle_AllocateData(int handleID, size_t dataSize) {
-    HandleData *handle;
+    void *data = DXALLOC((size_t)dataSize);
     
+    HANDLE_LOCK();
     if (handleID < 0 || handleID >= s_handleCount) {
+        HANDLE_UNLOCK();
+        DXFREE(data);
         return NULL;
     }
     
-    handle = &s_handleTable[handleID];
-    handle->data = DXALLOC((size_t)dataSize);
+    s_handleTable[handleID].data = data;
+    HANDLE_UNLOCK();
     
-    return handle->data;
+    return data;
 }
 
 void *PL_Handle_GetData(int handleID, HandleType handleType) {
     HandleData *handle;
-    if (handleID < 0 || handleID >= s_handleCount) {
-        return NULL;
+    void *data = NULL;
+    
+    HANDLE_LOCK();
+    if (handleID >= 0 && handleID < s_handleCount) {
+        handle = &s_handleTable[handleID];
+        if (handle->handleType == handleType) {
+            data = handle->data;
+        }
     }
+    HANDLE_UNLOCK();
     
-    handle = &s_handleTable[handleID];
-    if (handle->handleType != handleType) {
-        return NULL;
-    }
-    return handle->data;
+    return data;
 }
 
 int PL_Handle_SwapHandleIDs(int handleAID, int handleBID) {
     HandleData *handleA, *handleB;
     HandleData tempHandle;
     
+    HANDLE_LOCK();
     if (handleAID < 0 || handleAID >= s_handleCount
         || handleBID < 0 || handleBID >= s_handleCount
     ) {
+        HANDLE_UNLOCK();
         return -1;
     }
     
@@ -241,50 +283,112 @@ int PL_Handle_SwapHandleIDs(int handleAID, int handleBID) {
     SDL_memcpy(&tempHandle, handleA, sizeof(HandleData));
     SDL_memcpy(handleA, handleB, sizeof(HandleData));
     SDL_memcpy(handleB, &tempHandle, sizeof(HandleData));
+    HANDLE_UNLOCK();
     
     return 0;
 }
 
 int PL_Handle_GetPrevID(int handleID) {
-    HandleData *handle;
-    if (handleID < 0 || handleID >= s_handleCount) {
-        return -1;
+    int prevID = -1;
+    
+    HANDLE_LOCK();
+    if (handleID >= 0 && handleID < s_handleCount) {
+        prevID = s_handleTable[handleID].prevID;
     }
+    HANDLE_UNLOCK();
     
-    handle = &s_handleTable[handleID];
-    return handle->prevID;
+    return prevID;
 }
 
 int PL_Handle_GetNextID(int handleID) {
-    HandleData *handle;
-    if (handleID < 0 || handleID >= s_handleCount) {
-        return -1;
+    int nextID = -1;
+    
+    HANDLE_LOCK();
+    if (handleID >= 0 && handleID < s_handleCount) {
+        nextID = s_handleTable[handleID].nextID;
     }
+    HANDLE_UNLOCK();
     
-    handle = &s_handleTable[handleID];
-    return handle->nextID;
+    return nextID;
 }
 
 int PL_Handle_GetFirstIDOf(HandleType handleType) {
+    int firstID;
+    
     if (handleType < 0 || handleType >= DXHANDLE_END) {
         return -1;
     }
     
-    return s_handleLists[handleType];
+    HANDLE_LOCK();
+    firstID = s_handleLists[handleType];
+    HANDLE_UNLOCK();
+    
+    return firstID;
 }
 
 int PL_Handle_SetDeleteFlag(int handleID, int *deleteFlag) {
     HandleData *handle;
+    
+    HANDLE_LOCK();
     if (handleID < 0 || handleID >= s_handleCount) {
+        HANDLE_UNLOCK();
         return -1;
     }
     
     handle = &s_handleTable[handleID];
     if (handle->handleType == DXHANDLE_NONE) {
+        HANDLE_UNLOCK();
         return -1;
     }
     
     handle->deleteFlag = deleteFlag;
+    HANDLE_UNLOCK();
     
     return 0;
 }
+
+/* Records the background load still pending on a handle, or -1. */
+int PL_Handle_SetASyncJob(int handleID, int asyncJobID) {
+    HandleData *handle;
+    
+    HANDLE_LOCK();
+    if (handleID < 0 || handleID >= s_handleCount) {
+        HANDLE_UNLOCK();
+        return -1;
+    }
+    
+    handle = &s_handleTable[handleID];
+    if (handle->handleType == DXHANDLE_NONE) {
+        HANDLE_UNLOCK();
+        return -1;
+    }
+    
+    handle->asyncJobID = asyncJobID;
+    HANDLE_UNLOCK();
+    
+    return 0;
+}
+
+HandleType PL_Handle_GetType(int handleID) {
+    HandleType handleType = DXHANDLE_NONE;
+    
+    HANDLE_LOCK();
+    if (handleID >= 0 && handleID < s_handleCount) {
+        handleType = s_handleTable[handleID].handleType;
+    }
+    HANDLE_UNLOCK();
+    
+    return handleType;
+}
+
+int PL_Handle_GetASyncJob(int handleID) {
+    int asyncJobID = -1;
+    
+    HANDLE_LOCK();
+    if (handleID >= 0 && handleID < s_handleCount) {
+        asyncJobID = s_handleTable[handleID].asyncJobID;
+    }
+    HANDLE_UNLOCK();
+    
+    return asyncJobID;
+}
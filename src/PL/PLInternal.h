@@ -24,6 +24,7 @@
 
 #include "DPLBuildConfig.h"
 #include "DxDefines.h"
+#include "DxPortLib_c.h"
 
 #include <stdlib.h>
 #include "SDL.h"
@@ -51,6 +52,9 @@ extern int PL_Platform_GetDateTime(DATEDATA *dateBuf);
 
 extern int PL_Platform_FileOpenReadDirect(const char *filename);
 extern int PL_Platform_FileOpenWriteDirect(const char *filename);
+extern void *PL_Platform_MapFile(const char *filename, int64_t *dSize,
+                                 void **dMapHandle);
+extern void PL_Platform_UnmapFile(void *data, int64_t size, void *mapHandle);
 extern int PL_Platform_GetSaveFolder(char *buffer, int bufferLength,
                                      const char *org, const char *app,
                                      int destEncoding);
@@ -151,9 +155,11 @@ typedef enum {
     DXHANDLE_VERTEXBUFFER,
     DXHANDLE_INDEXBUFFER,
     DXHANDLE_SHADER,
+    DXHANDLE_ASYNCJOB,
     
     /* dxlib handles */
 #ifdef DXPORTLIB_DXLIB_INTERFACE
+    DXHANDLE_TEXTLAYOUT,
 #endif
     
     /* luna handles */
@@ -181,6 +187,113 @@ extern int PL_Handle_GetFirstIDOf(HandleType handleType);
 extern int PL_Handle_GetPrevID(int handleID);
 extern int PL_Handle_GetNextID(int handleID);
 extern int PL_Handle_SetDeleteFlag(int handleID, int *deleteFlag);
+extern HandleType PL_Handle_GetType(int handleID);
+extern int PL_Handle_SetASyncJob(int handleID, int asyncJobID);
+extern int PL_Handle_GetASyncJob(int handleID);
+
+/* ----------------------------------------------------------- Async.c */
+typedef int (*PLAsyncWorkFunction)(void *userdata);
+typedef void (*PLAsyncFinishFunction)(void *userdata, int workResult);
+
+extern int PL_Async_Submit(PLAsyncWorkFunction workFunc,
+                           PLAsyncFinishFunction finishFunc,
+                           void *userdata);
+extern int PL_Async_Wait(int jobID);
+extern int PL_Async_WaitHandle(int handleID);
+extern int PL_Async_IsHandleLoading(int handleID);
+extern int PL_Async_ProcessFinished();
+extern int PL_Async_GetPendingCount();
+extern int PL_Async_SetUseASyncLoadFlag(int flag);
+extern int PL_Async_GetUseASyncLoadFlag();
+extern void PL_Async_End();
+
+/* ------------------------------------------------------ FramePacer.c */
+typedef Uint64 (*PLFramePacerNowFunction)(void *userdata);
+typedef void (*PLFramePacerSleepFunction)(void *userdata, int milliseconds);
+
+/* Frame times are in microseconds. */
+typedef struct _PLFramePacerStats {
+    int frameCount;
+    int averageTime;
+    int minTime;
+    int maxTime;
+    int p99Time;
+    int missedCount;
+} PLFramePacerStats;
+
+extern int PL_FramePacer_Sync();
+extern void PL_FramePacer_Delay(int microseconds);
+extern void PL_FramePacer_SetFrameRate(int framesPerSecond);
+extern int PL_FramePacer_GetFrameRate();
+extern void PL_FramePacer_SetClock(PLFramePacerNowFunction nowFunc,
+                                   PLFramePacerSleepFunction sleepFunc,
+                                   Uint64 frequency, void *userdata);
+extern void PL_FramePacer_Reset();
+extern int PL_FramePacer_GetStats(PLFramePacerStats *stats);
+
+/* ---------------------------------------------------- FrameLatency.c */
+typedef DPL_FrameLatencyStats PLFrameLatencyStats;
+
+/* fenceWait returns DXTRUE once the fence has passed, and only blocks
+ * if blockFlag is set. If the fence functions are NULL, finish is used
+ * instead, and if now is NULL, SDL's performance counter. */
+typedef struct _PLFrameLatencyFunctions {
+    void *(*fenceInsert)(void *userdata);
+    int (*fenceWait)(void *userdata, void *fence, int blockFlag);
+    void (*fenceDelete)(void *userdata, void *fence);
+    void (*finish)(void *userdata);
+    Uint64 (*now)(void *userdata);
+    Uint64 frequency;
+    void *userdata;
+} PLFrameLatencyFunctions;
+
+extern void PL_FrameLatency_SetFunctions(const PLFrameLatencyFunctions *funcs);
+extern int PL_FrameLatency_SetMaxFrames(int frames);
+extern int PL_FrameLatency_EndFrame();
+extern int PL_FrameLatency_Wait();
+extern int PL_FrameLatency_GetStats(PLFrameLatencyStats *stats);
+extern void PL_FrameLatency_ResetStats();
+
+/* ----------------------------------------------------- ShaderCache.c */
+typedef struct _PLShaderCacheEntry {
+    Uint64 sourceKey;
+    unsigned int binaryFormat;
+    int length;
+    unsigned char *data;
+} PLShaderCacheEntry;
+
+typedef struct _PLShaderCache {
+    Uint64 driverKey;
+    PLShaderCacheEntry *entries;
+    int entryCount;
+    int entryCapacity;
+    
+    /* Set when entries change, cleared once they are saved. */
+    int dirtyFlag;
+} PLShaderCache;
+
+extern Uint64 PL_ShaderCache_MakeDriverKey(const char *vendor,
+                                           const char *renderer,
+                                           const char *version);
+extern Uint64 PL_ShaderCache_MakeSourceKey(const char * const *sources,
+                                           int sourceCount);
+extern void PL_ShaderCache_Init(PLShaderCache *cache, Uint64 driverKey);
+extern void PL_ShaderCache_Clear(PLShaderCache *cache);
+extern const PLShaderCacheEntry *PL_ShaderCache_Find(const PLShaderCache *cache,
+                                                     Uint64 sourceKey);
+extern int PL_ShaderCache_Store(PLShaderCache *cache, Uint64 sourceKey,
+                                unsigned int binaryFormat,
+                                const void *data, int length);
+extern int PL_ShaderCache_Remove(PLShaderCache *cache, Uint64 sourceKey);
+extern int PL_ShaderCache_Serialize(const PLShaderCache *cache,
+                                    unsigned char *buffer, int bufferSize);
+extern int PL_ShaderCache_Deserialize(PLShaderCache *cache,
+                                      const unsigned char *buffer, int bufferSize);
+extern int PL_ShaderCache_LoadFile(PLShaderCache *cache, const char *filename);
+extern int PL_ShaderCache_SaveFile(PLShaderCache *cache, const char *filename);
+extern int PL_ShaderCache_SetFilename(const char *filename);
+extern const char *PL_ShaderCache_GetFilename();
+extern void PL_ShaderCache_End();
 
 /* ------------------------------------------------------------ File.c */
 typedef int (*PLFileOpenFileFunction)(const char *filename);
@@ -196,6 +309,8 @@ typedef struct _PL_FileFunctions {
 
 extern void PL_File_SetOpenReadFunction(PLFileOpenFileFunction func);
 extern int PL_File_OpenRead(const char *filename);
+extern void PL_File_Lock();
+extern void PL_File_Unlock();
 extern int PL_File_OpenWrite(const char *filename);
 extern int PL_File_CreateHandle(const PL_FileFunctions *funcs, void *userdata);
 extern int PL_File_CreateHandleFromMemory(void *data, int length, int freeOnClose);
@@ -419,6 +534,10 @@ typedef struct _PLTextureBase {
     void (*releaseFunc)(int handle);
 } PLTextureBase;
 
+/* Renderer statistics, as exposed through DPL_Render_GetStats.
+ * Counters are accumulated between EndFrame calls. */
+typedef DPL_RenderStats PLRenderStats;
+
 typedef struct _PLIGraphics {
     void (*SetBlendMode)(
                 int blendEquation,
@@ -506,6 +625,10 @@ typedef struct _PLIGraphics {
                int vertexBufferHandle, int vertexStart, int vertexCount,
                int indexBufferHandle,
                int primitiveType, int indexStart, int indexCount);
+    int (*DrawVertexArrayIndexBuffer)(const VertexDefinition *def,
+               const char *vertexData, int vertexStart, int vertexCount,
+               int indexBufferHandle,
+               int primitiveType, int indexStart, int indexCount);
 
     int (*SetViewport)(int x, int y, int w, int h);
     int (*SetZRange)(float nearZ, float farZ);
@@ -516,9 +639,19 @@ typedef struct _PLIGraphics {
     int (*Clear)(PLClearType clearType);
     
     int (*Finish)();
+    
+    /* Waits until another frame can be queued without going over the
+     * frame latency limit. Returns the time waited in microseconds. */
+    int (*LimitFrameLatency)();
+    
+    /* Builds every stock shader now, rather than on first use.
+     * Returns how many are ready. */
+    int (*PrecompileShaders)();
 
     int (*StartFrame)();
     int (*EndFrame)();
+    
+    int (*GetRenderStats)(PLRenderStats *frameStats, PLRenderStats *totalStats);
 
     int (*Init)();
     int (*End)();
@@ -548,10 +681,13 @@ extern int PL_Surface_ApplyTransparentColor(int surfaceID,
 extern int PL_Surface_ApplyPMAToSDLSurface(SDL_Surface *sdlSurface);
 extern int PL_Surface_ApplyPMAToSurface(int surfaceID);
 extern int PL_Surface_FlipSurface(int surfaceID);
+extern int PL_Surface_CreateExtruded(int surfaceID, const PLRect *rect,
+                                     int border);
 
 extern int PL_Surface_GetSize(int surfaceID, int *w, int *h);
 extern int PL_Surface_HasTransparency(int surfaceID);
 
+extern int PL_Surface_PrepareThreadedLoad();
 extern int PL_Surface_Load(const char *filename);
 extern int PL_Surface_Delete(int surfaceID);
 
@@ -631,8 +767,9 @@ extern int PL_Random_SeedLuna(int randomSeed);
 /* --------------------------------------------------------------- Audio.c */
 #ifndef DXPORTLIB_NO_SOUND
 
-extern int PL_LoadSoundMem(const char *filename);
+extern int PL_LoadSoundMem(const char *filename, int bufferNum);
 extern int PL_LoadSoundMem2(const char *filenameA, const char *filenameB);
+extern int PL_DuplicateSoundMem(int srcSoundID, int bufferNum);
 extern int PL_DeleteSoundMem(int soundID);
 extern int PL_PlaySoundMem(int soundID, int playType, int startPositionFlag);
 extern int PL_StopSoundMem(int soundID);
@@ -640,6 +777,11 @@ extern int PL_CheckSoundMem(int soundID);
 extern int PL_SetVolumeSoundMemDirect(int volume, int soundID);
 extern int PL_SetVolumeSoundMem(int volume, int soundID);
 extern int PL_ChangeVolumeSoundMem(int volume, int soundID);
+extern int PL_SetPanSoundMem(int pan, int soundID);
+extern int PL_ChangePanSoundMem(int pan, int soundID);
+extern int PL_GetPanSoundMem(int soundID);
+extern int PL_SetFrequencySoundMem(int frequency, int soundID);
+extern int PL_GetFrequencySoundMem(int soundID);
 extern int PL_SetUseOldVolumeCalcFlag(int volumeFlag);
 extern int PL_InitSoundMem();
 extern int PL_SetCreateSoundDataType(int soundDataType);
@@ -654,10 +796,37 @@ extern int PL_Audio_RemoveLoopPoints(int soundID);
 
 extern int PL_Audio_GetCurrentPositionSoundMem(int soundID);
 
+extern int PL_Audio_SetStreamBufferTime(int milliseconds);
+extern int PL_Audio_GetStreamUnderrunCount(int soundID);
+extern int PL_Audio_SetVoiceStealMode(int mode);
+
+extern int PL_Audio_SetDeviceBufferSize(int frames);
+extern int PL_Audio_SetDeviceFrequency(int frequency);
+extern int PL_Audio_SetDeviceFormat(int format);
+extern int PL_Audio_GetDeviceState(int *frequency, int *bufferFrames, int *format);
+extern int PL_Audio_GetDeviceLatency(int *latency, int *jitter);
+
 extern int PL_Audio_ResetSettings();
 extern int PL_Audio_Init();
 extern int PL_Audio_End();
 
+
+/* ------------------------------------------------------------ AudioMix.c */
+#define PL_AUDIOMIX_KERNEL_SCALAR   0
+#define PL_AUDIOMIX_KERNEL_SSE2     1
+#define PL_AUDIOMIX_KERNEL_AVX2     2
+#define PL_AUDIOMIX_KERNEL_NEON     3
+
+extern int PL_AudioMix_SetKernelLevel(int level);
+extern void PL_AudioMix_Add(float *bus, const short *src, int frames,
+                            float gainLeft, float gainRight);
+extern int PL_AudioMix_AddResampled(float *bus, int frames,
+                                    const short *src, unsigned int srcFrames,
+                                    unsigned int *position, unsigned int *fraction,
+                                    unsigned int step, float gainLeft, float gainRight);
+extern void PL_AudioMix_ToS16(const float *bus, short *dest, int count);
+extern void PL_AudioMix_ToF32(const float *bus, float *dest, int count);
+
 #endif /* #ifndef DXPORTLIB_NO_SOUND */
 
 #ifdef __cplusplus
@@ -0,0 +1,403 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+    
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+#include "PLInternal.h"
+
+/* Shader program binary cache.
+ *
+ * Linked program binaries are kept between runs, so the renderer can
+ * hand them straight back to the driver instead of compiling again.
+ * Each entry is keyed by a hash of the shader source, and the cache as
+ * a whole by a hash of the driver strings, as a binary is only any good
+ * to the driver that made it. Nothing here touches GL; the renderer
+ * fetches and supplies the binaries.
+ *
+ * The file is little-endian throughout:
+ *
+ *   "DPLS", version, driver hash (8 bytes), entry count
+ *   then for each entry:
+ *   source hash (8 bytes), binary format, length, checksum, data
+ *
+ * If anything about it is off, the whole file is thrown away, and the
+ * cache simply starts over empty.
+ */
+
+#define SHADERCACHE_VERSION 1
+#define SHADERCACHE_HEADER_SIZE 20
+#define SHADERCACHE_ENTRY_HEADER_SIZE 20
+#define SHADERCACHE_MAX_ENTRIES 4096
+
+#define FNV64_OFFSET 0xcbf29ce484222325ULL
+#define FNV64_PRIME 0x100000001b3ULL
+
+static const unsigned char s_magic[4] = { 'D', 'P', 'L', 'S' };
+
+static char *s_cacheFilename = NULL;
+
+/* ------------------------------------------------------------------ Keys */
+
+static Uint64 s_HashBytes(Uint64 hash, const unsigned char *data, size_t length) {
+    size_t i;
+    for (i = 0; i < length; ++i) {
+        hash ^= data[i];
+        hash *= FNV64_PRIME;
+    }
+    return hash;
+}
+
+/* Each string is hashed with its terminator, so that moving text from
+ * one string to the next changes the key. NULL strings count as empty. */
+static Uint64 s_HashStrings(const char * const *strings, int count) {
+    Uint64 hash = FNV64_OFFSET;
+    int i;
+    
+    for (i = 0; i < count; ++i) {
+        const char *string = (strings[i] != NULL) ? strings[i] : "";
+        hash = s_HashBytes(hash, (const unsigned char *)string, SDL_strlen(string) + 1);
+    }
+    
+    return hash;
+}
+
+Uint64 PL_ShaderCache_MakeDriverKey(const char *vendor, const char *renderer,
+                                    const char *version) {
+    const char *strings[3];
+    
+    strings[0] = vendor;
+    strings[1] = renderer;
+    strings[2] = version;
+    
+    return s_HashStrings(strings, 3);
+}
+
+Uint64 PL_ShaderCache_MakeSourceKey(const char * const *sources, int sourceCount) {
+    return s_HashStrings(sources, sourceCount);
+}
+
+static unsigned int s_Checksum(const unsigned char *data, int length) {
+    Uint64 hash = s_HashBytes(FNV64_OFFSET, data, (size_t)length);
+    return (unsigned int)(hash ^ (hash >> 32));
+}
+
+/* --------------------------------------------------------------- Entries */
+
+void PL_ShaderCache_Init(PLShaderCache *cache, Uint64 driverKey) {
+    SDL_memset(cache, 0, sizeof(PLShaderCache));
+    cache->driverKey = driverKey;
+}
+
+void PL_ShaderCache_Clear(PLShaderCache *cache) {
+    int i;
+    
+    for (i = 0; i < cache->entryCount; ++i) {
+        DXFREE(cache->entries[i].data);
+    }
+    if (cache->entries != NULL) {
+        DXFREE(cache->entries);
+    }
+    
+    cache->entries = NULL;
+    cache->entryCount = 0;
+    cache->entryCapacity = 0;
+    cache->dirtyFlag = DXFALSE;
+}
+
+static int s_FindIndex(const PLShaderCache *cache, Uint64 sourceKey) {
+    int i;
+    for (i = 0; i < cache->entryCount; ++i) {
+        if (cache->entries[i].sourceKey == sourceKey) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const PLShaderCacheEntry *PL_ShaderCache_Find(const PLShaderCache *cache, Uint64 sourceKey) {
+    int index = s_FindIndex(cache, sourceKey);
+    
+    return (index >= 0) ? &cache->entries[index] : NULL;
+}
+
+/* Adds a binary, replacing any with the same key. */
+int PL_ShaderCache_Store(PLShaderCache *cache, Uint64 sourceKey,
+                         unsigned int binaryFormat, const void *data, int length) {
+    PLShaderCacheEntry *entry;
+    unsigned char *copy;
+    int index;
+    
+    if (data == NULL || length <= 0) {
+        return -1;
+    }
+    
+    copy = (unsigned char *)DXALLOC((size_t)length);
+    if (copy == NULL) {
+        return -1;
+    }
+    SDL_memcpy(copy, data, (size_t)length);
+    
+    index = s_FindIndex(cache, sourceKey);
+    if (index >= 0) {
+        entry = &cache->entries[index];
+        DXFREE(entry->data);
+    } else {
+        if (cache->entryCount >= SHADERCACHE_MAX_ENTRIES) {
+            DXFREE(copy);
+            return -1;
+        }
+        if (cache->entryCount >= cache->entryCapacity) {
+            int capacity = (cache->entryCapacity > 0) ? cache->entryCapacity * 2 : 16;
+            PLShaderCacheEntry *entries = (PLShaderCacheEntry *)
+                DXREALLOC(cache->entries, sizeof(PLShaderCacheEntry) * (size_t)capacity);
+            if (entries == NULL) {
+                DXFREE(copy);
+                return -1;
+            }
+            cache->entries = entries;
+            cache->entryCapacity = capacity;
+        }
+        entry = &cache->entries[cache->entryCount];
+        cache->entryCount += 1;
+    }
+    
+    entry->sourceKey = sourceKey;
+    entry->binaryFormat = binaryFormat;
+    entry->length = length;
+    entry->data = copy;
+    
+    cache->dirtyFlag = DXTRUE;
+    
+    return 0;
+}
+
+/* For binaries the driver turned down, usually after an update that
+ * kept the same version string. */
+int PL_ShaderCache_Remove(PLShaderCache *cache, Uint64 sourceKey) {
+    int index = s_FindIndex(cache, sourceKey);
+    if (index < 0) {
+        return -1;
+    }
+    
+    DXFREE(cache->entries[index].data);
+    cache->entryCount -= 1;
+    if (index < cache->entryCount) {
+        cache->entries[index] = cache->entries[cache->entryCount];
+    }
+    
+    cache->dirtyFlag = DXTRUE;
+    
+    return 0;
+}
+
+/* ----------------------------------------------------------- File format */
+
+static void s_Write32(unsigned char *dest, unsigned int value) {
+    dest[0] = (unsigned char)value;
+    dest[1] = (unsigned char)(value >> 8);
+    dest[2] = (unsigned char)(value >> 16);
+    dest[3] = (unsigned char)(value >> 24);
+}
+static void s_Write64(unsigned char *dest, Uint64 value) {
+    s_Write32(dest, (unsigned int)value);
+    s_Write32(dest + 4, (unsigned int)(value >> 32));
+}
+static unsigned int s_Read32(const unsigned char *src) {
+    return (unsigned int)src[0] | ((unsigned int)src[1] << 8)
+           | ((unsigned int)src[2] << 16) | ((unsigned int)src[3] << 24);
+}
+static Uint64 s_Read64(const unsigned char *src) {
+    return (Uint64)s_Read32(src) | ((Uint64)s_Read32(src + 4) << 32);
+}
+
+/* Writes the cache into buffer, if it is big enough, and returns the
+ * size it needs either way. Pass a NULL buffer to only get the size. */
+int PL_ShaderCache_Serialize(const PLShaderCache *cache,
+                             unsigned char *buffer, int bufferSize) {
+    int size = SHADERCACHE_HEADER_SIZE;
+    int i;
+    
+    for (i = 0; i < cache->entryCount; ++i) {
+        size += SHADERCACHE_ENTRY_HEADER_SIZE + cache->entries[i].length;
+    }
+    
+    if (buffer == NULL || bufferSize < size) {
+        return size;
+    }
+    
+    SDL_memcpy(buffer, s_magic, 4);
+    s_Write32(buffer + 4, SHADERCACHE_VERSION);
+    s_Write64(buffer + 8, cache->driverKey);
+    s_Write32(buffer + 16, (unsigned int)cache->entryCount);
+    buffer += SHADERCACHE_HEADER_SIZE;
+    
+    for (i = 0; i < cache->entryCount; ++i) {
+        const PLShaderCacheEntry *entry = &cache->entries[i];
+    
+        s_Write64(buffer, entry->sourceKey);
+        s_Write32(buffer + 8, entry->binaryFormat);
+        s_Write32(buffer + 12, (unsigned int)entry->length);
+        s_Write32(buffer + 16, s_Checksum(entry->data, entry->length));
+        SDL_memcpy(buffer + SHADERCACHE_ENTRY_HEADER_SIZE, entry->data, (size_t)entry->length);
+        buffer += SHADERCACHE_ENTRY_HEADER_SIZE + entry->length;
+    }
+    
+    return size;
+}
+
+/* Replaces the contents of the cache with what is in buffer. Returns
+ * -1, leaving the cache empty, if the data is damaged, from another
+ * version, or from a different driver than the cache's. */
+int PL_ShaderCache_Deserialize(PLShaderCache *cache,
+                               const unsigned char *buffer, int bufferSize) {
+    const unsigned char *end = buffer + bufferSize;
+    unsigned int count;
+    unsigned int i;
+    
+    PL_ShaderCache_Clear(cache);
+    
+    if (buffer == NULL || bufferSize < SHADERCACHE_HEADER_SIZE
+        || SDL_memcmp(buffer, s_magic, 4) != 0
+        || s_Read32(buffer + 4) != SHADERCACHE_VERSION
+        || s_Read64(buffer + 8) != cache->driverKey
+    ) {
+        return -1;
+    }
+    
+    count = s_Read32(buffer + 16);
+    if (count > SHADERCACHE_MAX_ENTRIES) {
+        return -1;
+    }
+    buffer += SHADERCACHE_HEADER_SIZE;
+    
+    for (i = 0; i < count; ++i) {
+        unsigned int length;
+    
+        if ((end - buffer) < SHADERCACHE_ENTRY_HEADER_SIZE) {
+            break;
+        }
+        length = s_Read32(buffer + 12);
+        if (length == 0 || length > (unsigned int)(end - buffer - SHADERCACHE_ENTRY_HEADER_SIZE)
+            || s_Read32(buffer + 16) != s_Checksum(buffer + SHADERCACHE_ENTRY_HEADER_SIZE, (int)length)
+            || PL_ShaderCache_Store(cache, s_Read64(buffer), s_Read32(buffer + 8),
+                                    buffer + SHADERCACHE_ENTRY_HEADER_SIZE, (int)length) < 0
+        ) {
+            break;
+        }
+        buffer += SHADERCACHE_ENTRY_HEADER_SIZE + length;
+    }
+    
+    if (i < count || buffer != end) {
+        PL_ShaderCache_Clear(cache);
+        return -1;
+    }
+    
+    cache->dirtyFlag = DXFALSE;
+    
+    return 0;
+}
+
+/* ----------------------------------------------------------------- Files */
+
+int PL_ShaderCache_LoadFile(PLShaderCache *cache, const char *filename) {
+    unsigned char *buffer;
+    int64_t size;
+    int fileHandle;
+    int retval = -1;
+    
+    PL_ShaderCache_Clear(cache);
+    
+    fileHandle = PL_Platform_FileOpenReadDirect(filename);
+    if (fileHandle < 0) {
+        return -1;
+    }
+    
+    size = PL_File_GetSize(fileHandle);
+    if (size > 0 && size < 0x7fffffff) {
+        buffer = (unsigned char *)DXALLOC((size_t)size);
+        if (buffer != NULL) {
+            if (PL_File_Read(fileHandle, buffer, (int)size) == size) {
+                retval = PL_ShaderCache_Deserialize(cache, buffer, (int)size);
+            }
+            DXFREE(buffer);
+        }
+    }
+    
+    PL_File_Close(fileHandle);
+    
+    return retval;
+}
+
+int PL_ShaderCache_SaveFile(PLShaderCache *cache, const char *filename) {
+    unsigned char *buffer;
+    int size;
+    int fileHandle;
+    int retval = -1;
+    
+    size = PL_ShaderCache_Serialize(cache, NULL, 0);
+    buffer = (unsigned char *)DXALLOC((size_t)size);
+    if (buffer == NULL) {
+        return -1;
+    }
+    PL_ShaderCache_Serialize(cache, buffer, size);
+    
+    fileHandle = PL_Platform_FileOpenWriteDirect(filename);
+    if (fileHandle >= 0) {
+        if (PL_File_Write(fileHandle, buffer, size) == size) {
+            cache->dirtyFlag = DXFALSE;
+            retval = 0;
+        }
+        PL_File_Close(fileHandle);
+    }
+    
+    DXFREE(buffer);
+    
+    return retval;
+}
+
+/* Where the renderer keeps its cache. NULL, the default, turns
+ * caching off. */
+int PL_ShaderCache_SetFilename(const char *filename) {
+    PL_ShaderCache_End();
+    
+    if (filename != NULL && *filename != '\0') {
+        size_t length = SDL_strlen(filename) + 1;
+        s_cacheFilename = (char *)DXALLOC(length);
+        if (s_cacheFilename == NULL) {
+            return -1;
+        }
+        SDL_memcpy(s_cacheFilename, filename, length);
+    }
+    
+    return 0;
+}
+
+const char *PL_ShaderCache_GetFilename() {
+    return s_cacheFilename;
+}
+
+/* Frees the filename at library shutdown. The renderer may come and go
+ * before then, and keeps using the same cache. */
+void PL_ShaderCache_End() {
+    if (s_cacheFilename != NULL) {
+        DXFREE(s_cacheFilename);
+        s_cacheFilename = NULL;
+    }
+}
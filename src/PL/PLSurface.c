@@ -30,7 +30,8 @@
  * Very minimalistic right now, plans to remove SDL from this code
  * eventually... */
 
-static int s_surfaceCount = 0;
+/* Surfaces may be created on background loading threads. */
+static SDL_atomic_t s_surfaceCount = { 0 };
 
 typedef struct Surface {
     SDL_Surface *sdlSurface;
@@ -55,7 +56,7 @@ static int s_AllocateSurfaceID(SDL_Surface *sdlSurface, int hasTransparencyFlag)
     surface->sdlSurface = sdlSurface;
     surface->hasTransparencyFlag = hasTransparencyFlag;
     
-    s_surfaceCount += 1;
+    SDL_AtomicAdd(&s_surfaceCount, 1);
     
     return surfaceID;
 }
@@ -269,6 +270,102 @@ int PL_Surface_FlipSurface(int surfaceID) {
     return DXTRUE;
 }
 
+/* Copies rect out of a surface into a new 32-bit surface, surrounded
+ * by a border of the given size that repeats the edge pixels.
+ *
+ * Used when packing images together into one texture, so that filtering
+ * at the edges samples the image itself instead of its neighbours.
+ */
+int PL_Surface_CreateExtruded(int surfaceID, const PLRect *rect, int border) {
+    Surface *surface = s_GetSurface(surfaceID);
+    SDL_Surface *src, *dest;
+    PLRect r;
+    int x, y, w, h;
+    
+    if (surface == NULL || border < 0) {
+        return -1;
+    }
+    
+    src = surface->sdlSurface;
+    if (rect != NULL) {
+        r = *rect;
+    } else {
+        r.x = 0;
+        r.y = 0;
+        r.w = src->w;
+        r.h = src->h;
+    }
+    if (r.x < 0) {
+        r.w += r.x;
+        r.x = 0;
+    }
+    if (r.y < 0) {
+        r.h += r.y;
+        r.y = 0;
+    }
+    if ((r.x + r.w) > src->w) {
+        r.w = src->w - r.x;
+    }
+    if ((r.y + r.h) > src->h) {
+        r.h = src->h - r.y;
+    }
+    if (r.w <= 0 || r.h <= 0) {
+        return -1;
+    }
+    
+    /* Converting handles palettes and color keys for us. */
+    src = SDL_ConvertSurfaceFormat(src, SDL_PIXELFORMAT_ARGB8888, 0);
+    if (src == NULL) {
+        return -1;
+    }
+    
+    w = r.w + (border * 2);
+    h = r.h + (border * 2);
+    dest = SDL_CreateRGBSurface(0, w, h, 32, 0xff0000, 0x00ff00, 0x0000ff, 0xff000000);
+    if (dest == NULL) {
+        SDL_FreeSurface(src);
+        return -1;
+    }
+    
+    SDL_LockSurface(src);
+    SDL_LockSurface(dest);
+    
+    for (y = 0; y < h; ++y) {
+        int sy = y - border;
+        const Uint32 *srcLine;
+        Uint32 *destLine;
+        
+        if (sy < 0) {
+            sy = 0;
+        } else if (sy >= r.h) {
+            sy = r.h - 1;
+        }
+        
+        srcLine = (const Uint32 *)((const Uint8 *)src->pixels + ((sy + r.y) * src->pitch)) + r.x;
+        destLine = (Uint32 *)((Uint8 *)dest->pixels + (y * dest->pitch));
+        
+        for (x = 0; x < border; ++x) {
+            destLine[x] = srcLine[0];
+            destLine[w - 1 - x] = srcLine[r.w - 1];
+        }
+        SDL_memcpy(destLine + border, srcLine, (size_t)r.w * 4);
+    }
+    
+    SDL_UnlockSurface(dest);
+    SDL_UnlockSurface(src);
+    SDL_FreeSurface(src);
+    
+    return s_AllocateSurfaceID(dest, surface->hasTransparencyFlag);
+}
+
+/* SDL_image sets up its JPG and PNG decoders on first use, which is not
+ * safe to do from two threads at once. Call this on the main thread
+ * before loading surfaces anywhere else. */
+int PL_Surface_PrepareThreadedLoad() {
+    IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG);
+    return 0;
+}
+
 int PL_Surface_Load(const char *filename) {
     SDL_RWops *file;
     SDL_Surface *sdlSurface;
@@ -346,7 +443,7 @@ int PL_Surface_Delete(int surfaceID) {
     
     PL_Handle_ReleaseID(surfaceID, DXTRUE);
     
-    s_surfaceCount -= 1;
+    SDL_AtomicAdd(&s_surfaceCount, -1);
     
     return 0;
 }
@@ -400,7 +497,7 @@ int PL_Surface_DrawToTexture(int surfaceID, int textureID, const PLRect *rect) {
 }
 
 int PL_Surface_GetCount() {
-    return s_surfaceCount;
+    return SDL_AtomicGet(&s_surfaceCount);
 }
 
 int PL_Surface_GetSize(int surfaceID, int *w, int *h) {
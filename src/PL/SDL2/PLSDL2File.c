@@ -25,6 +25,18 @@
 
 #include "SDL.h"
 
+#if defined(_WIN32)
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#  define PLSDL2_MAP_WIN32
+#elif defined(__unix__) || defined(__APPLE__)
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  define PLSDL2_MAP_POSIX
+#endif
+
 static int64_t SDLCALL PLSDL2_RWops_GetSize(void *userdata) {
     SDL_RWops *rwops = (SDL_RWops *)userdata;
     return SDL_RWsize(rwops);
@@ -157,4 +169,86 @@ int PL_Platform_FileOpenReadDirect(const char *filename) {
     return PLSDL2_RWopsToFile(rwops);
 }
 
+/* Maps the whole file read-only into memory. Returns NULL if the file
+ * can't be mapped, including on platforms without support for it, so
+ * callers must be able to fall back to reading normally. */
+void *PL_Platform_MapFile(const char *filename, int64_t *dSize, void **dMapHandle) {
+#if defined(PLSDL2_MAP_WIN32)
+    wchar_t wFilename[2048];
+    HANDLE file;
+    HANDLE mapping;
+    LARGE_INTEGER size;
+    void *data;
+    
+    if (MultiByteToWideChar(CP_UTF8, 0, filename, -1, wFilename, 2048) == 0) {
+        return NULL;
+    }
+    
+    file = CreateFileW(wFilename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    if (GetFileSizeEx(file, &size) == 0 || size.QuadPart <= 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    
+    mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        return NULL;
+    }
+    
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        return NULL;
+    }
+    
+    *dSize = (int64_t)size.QuadPart;
+    *dMapHandle = (void *)mapping;
+    return data;
+#elif defined(PLSDL2_MAP_POSIX)
+    struct stat st;
+    void *data;
+    int fd;
+    
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size <= 0
+        || (uint64_t)st.st_size > (uint64_t)((size_t)-1)
+    ) {
+        close(fd);
+        return NULL;
+    }
+    
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    
+    *dSize = (int64_t)st.st_size;
+    *dMapHandle = NULL;
+    return data;
+#else
+    return NULL;
+#endif
+}
+
+void PL_Platform_UnmapFile(void *data, int64_t size, void *mapHandle) {
+    if (data == NULL) {
+        return;
+    }
+#if defined(PLSDL2_MAP_WIN32)
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mapHandle);
+#elif defined(PLSDL2_MAP_POSIX)
+    munmap(data, (size_t)size);
+#endif
+}
+
 #endif /* #ifdef DXPORTLIB_PLATFORM_SDL2 */
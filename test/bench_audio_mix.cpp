@@ -0,0 +1,211 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Mixes 64, 128 and 256 voices of noise into 1024-frame callbacks, the
+ * old way with SDL_MixAudioFormat straight into 16-bit, and through the
+ * float bus at each kernel level the CPU supports. Reports the time per
+ * callback, and checks that every level matches the plain C output to
+ * within one step.
+ *
+ * One voice in eight is pitched, which goes through the resampler.
+ *
+ * Usage: bench_audio_mix [callbacks]
+ */
+
+#include "DxLib.h"
+
+#ifdef DXPORTLIB
+#  include "SDL_main.h"
+#endif
+
+#if defined(DX_NON_SOUND) || !defined(DXLIB_VERSION) || !defined(DXPORTLIB)
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    printf("DxPortLib was compiled without sound support.\n");
+    return -1;
+}
+
+#else
+
+#include "PL/PLInternal.h"
+#include "SDL.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const char *s_levelNames[] = { "scalar", "sse2", "avx2", "neon" };
+
+static const int CALLBACK_FRAMES = 1024;
+static const unsigned int SOURCE_FRAMES = 44100;
+
+struct BenchVoice {
+    unsigned int position;
+    unsigned int fraction;
+    unsigned int step;
+    int volume;
+    float gainLeft;
+    float gainRight;
+};
+
+static double NowSeconds() {
+    return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+}
+
+static void SetupVoices(std::vector<BenchVoice> &voices, int count) {
+    voices.resize(count);
+    for (int i = 0; i < count; ++i) {
+        BenchVoice &voice = voices[i];
+        voice.position = (unsigned int)(i * 997) % SOURCE_FRAMES;
+        voice.fraction = 0;
+        voice.step = ((i % 8) == 7) ? 0x11200 : 0x10000;
+        voice.volume = 16 + (i * 37) % (SDL_MIX_MAXVOLUME - 16);
+    
+        /* Pan a little to one side or the other. */
+        float gain = (float)voice.volume / SDL_MIX_MAXVOLUME;
+        float pan = (float)((i * 13) % 9) / 16.0f;
+        voice.gainLeft = ((i & 1) ? (1.0f - pan) : 1.0f) * gain;
+        voice.gainRight = ((i & 1) ? 1.0f : (1.0f - pan)) * gain;
+    }
+}
+
+/* What the mixer did before: every voice straight into the output,
+ * clamping at each step. Volume only, as that is all it had. */
+static double BenchOld(const short *source, short *output,
+                       std::vector<BenchVoice> &voices, int callbacks) {
+    double start = NowSeconds();
+    
+    for (int c = 0; c < callbacks; ++c) {
+        memset(output, 0, sizeof(short) * CALLBACK_FRAMES * 2);
+        for (size_t v = 0; v < voices.size(); ++v) {
+            BenchVoice &voice = voices[v];
+            unsigned int amount = SOURCE_FRAMES - voice.position;
+            if (amount > (unsigned int)CALLBACK_FRAMES) {
+                amount = CALLBACK_FRAMES;
+            }
+            SDL_MixAudioFormat((Uint8 *)output, (const Uint8 *)(source + voice.position * 2),
+                               AUDIO_S16SYS, amount * 4, voice.volume);
+            voice.position = (voice.position + CALLBACK_FRAMES) % SOURCE_FRAMES;
+        }
+    }
+    
+    return (NowSeconds() - start) * 1e6 / callbacks;
+}
+
+static double BenchBus(const short *source, float *bus, short *output,
+                       std::vector<BenchVoice> &voices, int callbacks) {
+    double start = NowSeconds();
+    
+    for (int c = 0; c < callbacks; ++c) {
+        memset(bus, 0, sizeof(float) * CALLBACK_FRAMES * 2);
+        for (size_t v = 0; v < voices.size(); ++v) {
+            BenchVoice &voice = voices[v];
+            int done = 0;
+    
+            /* Loop the source, as a looping voice would. */
+            while (done < CALLBACK_FRAMES) {
+                float *dest = bus + done * 2;
+                int amount;
+    
+                if (voice.step == 0x10000) {
+                    amount = (int)(SOURCE_FRAMES - voice.position);
+                    if (amount > CALLBACK_FRAMES - done) {
+                        amount = CALLBACK_FRAMES - done;
+                    }
+                    PL_AudioMix_Add(dest, source + voice.position * 2, amount,
+                                    voice.gainLeft, voice.gainRight);
+                    voice.position += amount;
+                } else {
+                    amount = PL_AudioMix_AddResampled(dest, CALLBACK_FRAMES - done,
+                                                      source, SOURCE_FRAMES,
+                                                      &voice.position, &voice.fraction,
+                                                      voice.step, voice.gainLeft, voice.gainRight);
+                }
+    
+                done += amount;
+                if (voice.position >= SOURCE_FRAMES) {
+                    voice.position = 0;
+                }
+            }
+        }
+        PL_AudioMix_ToS16(bus, output, CALLBACK_FRAMES * 2);
+    }
+    
+    return (NowSeconds() - start) * 1e6 / callbacks;
+}
+
+int main(int argc, char **argv) {
+    int callbacks = 500;
+    if (argc > 1) {
+        callbacks = atoi(argv[1]);
+    }
+    if (callbacks < 1) {
+        callbacks = 1;
+    }
+    
+    /* Quiet enough that 64 voices rarely clip, loud enough that 256
+     * sometimes do. */
+    std::vector<short> source(SOURCE_FRAMES * 2);
+    unsigned int seed = 1;
+    for (size_t i = 0; i < source.size(); ++i) {
+        seed = seed * 1103515245u + 12345u;
+        source[i] = (short)((int)((seed >> 16) & 0x7ff) - 0x400);
+    }
+    
+    std::vector<float> bus(CALLBACK_FRAMES * 2);
+    std::vector<short> output(CALLBACK_FRAMES * 2);
+    std::vector<short> reference(CALLBACK_FRAMES * 2);
+    
+    int bestLevel = PL_AudioMix_SetKernelLevel(-1);
+    
+    static const int voiceCounts[] = { 64, 128, 256 };
+    for (int n = 0; n < 3; ++n) {
+        std::vector<BenchVoice> voices;
+    
+        SetupVoices(voices, voiceCounts[n]);
+        printf("%3d voices  old     %8.1f us/callback\n",
+               voiceCounts[n], BenchOld(&source[0], &output[0], voices, callbacks));
+    
+        for (int level = PL_AUDIOMIX_KERNEL_SCALAR; level <= bestLevel; ++level) {
+            if (PL_AudioMix_SetKernelLevel(level) != level) {
+                continue;
+            }
+    
+            SetupVoices(voices, voiceCounts[n]);
+            double time = BenchBus(&source[0], &bus[0], &output[0], voices, callbacks);
+    
+            int maxDiff = 0;
+            if (level == PL_AUDIOMIX_KERNEL_SCALAR) {
+                reference = output;
+            } else {
+                for (size_t i = 0; i < output.size(); ++i) {
+                    int diff = abs((int)output[i] - (int)reference[i]);
+                    if (diff > maxDiff) {
+                        maxDiff = diff;
+                    }
+                }
+            }
+    
+            printf("%3d voices  %-7s %8.1f us/callback%s\n",
+                   voiceCounts[n], s_levelNames[level], time,
+                   (maxDiff > 1) ? " (MISMATCH)" : "");
+        }
+    }
+    
+    return 0;
+}
+
+#endif
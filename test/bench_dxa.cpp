@@ -0,0 +1,230 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Reads every file out of a DXA archive and reports how long it took,
+ * along with memory use and page faults where the platform has them.
+ *
+ * Usage: bench_dxa [-map] [-preload] [-nostream] [-key keystring] archive.dxa
+ *
+ * -nostream decompresses compressed files whole when they are opened,
+ * for comparing peak memory and time to first byte against streaming.
+ */
+
+#include "DxLib.h"
+
+#ifdef DXPORTLIB
+#  include "SDL_main.h"
+#  include "SDL_timer.h"
+#endif
+
+#if defined(DX_NON_DXA) || !defined(DXLIB_VERSION)
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    printf("DxPortLib was compiled without DXA archive support.\n");
+    return -1;
+}
+
+#else
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <sys/resource.h>
+#  include <unistd.h>
+#  define BENCH_HAVE_RUSAGE
+#endif
+
+static void PrintMemoryUsage(const char *label) {
+#ifdef BENCH_HAVE_RUSAGE
+    struct rusage usage;
+    long rssKB = -1;
+    
+#  ifdef __linux__
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp != NULL) {
+        long totalPages, residentPages;
+        if (fscanf(fp, "%ld %ld", &totalPages, &residentPages) == 2) {
+            rssKB = residentPages * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+        fclose(fp);
+    }
+#  endif
+    
+    getrusage(RUSAGE_SELF, &usage);
+    printf("%-8s rss %ld KB, peak rss %ld KB, minor faults %ld, major faults %ld\n",
+           label, rssKB, (long)usage.ru_maxrss,
+           (long)usage.ru_minflt, (long)usage.ru_majflt);
+#else
+    printf("%-8s (memory statistics unavailable on this platform)\n", label);
+#endif
+}
+
+static void CollectFiles(const std::string &dir, std::vector<std::string> &files) {
+    FILEINFO info;
+    std::string pattern = dir + "/*";
+    DWORD_PTR findHandle = FileRead_findFirst(pattern.c_str(), &info);
+    if (findHandle == (DWORD_PTR)-1 || findHandle == 0) {
+        return;
+    }
+    
+    do {
+        if (!strcmp(info.Name, ".") || !strcmp(info.Name, "..")) {
+            continue;
+        }
+        if (info.DirFlag) {
+            CollectFiles(dir + "/" + info.Name, files);
+        } else {
+            files.push_back(dir + "/" + info.Name);
+        }
+    } while (FileRead_findNext(findHandle, &info) == 0);
+    
+    FileRead_findClose(findHandle);
+}
+
+static double NowMS() {
+#ifdef DXPORTLIB
+    return (double)SDL_GetPerformanceCounter() * 1000.0 / (double)SDL_GetPerformanceFrequency();
+#else
+    return (double)GetNowCount();
+#endif
+}
+
+static int ReadAllFiles(const std::vector<std::string> &files,
+                        LONGLONG *bytesRead, unsigned int *checksum,
+                        double *maxFirstByteMS) {
+    static unsigned char buffer[65536];
+    int failCount = 0;
+    
+    for (size_t i = 0; i < files.size(); ++i) {
+        double openTime = NowMS();
+        int fileHandle = FileRead_open(files[i].c_str());
+        if (fileHandle == 0 || fileHandle == -1) {
+            failCount += 1;
+            continue;
+        }
+        
+        FileRead_read(buffer, 1, fileHandle);
+        double firstByteMS = NowMS() - openTime;
+        if (firstByteMS > *maxFirstByteMS) {
+            *maxFirstByteMS = firstByteMS;
+        }
+        FileRead_seek(fileHandle, 0, SEEK_SET);
+        
+        while (FileRead_eof(fileHandle) == 0) {
+            LONGLONG before = FileRead_tell(fileHandle);
+            FileRead_read(buffer, sizeof(buffer), fileHandle);
+            LONGLONG got = FileRead_tell(fileHandle) - before;
+            if (got <= 0) {
+                break;
+            }
+            for (LONGLONG n = 0; n < got; n += 64) {
+                *checksum = (*checksum * 31) + buffer[n];
+            }
+            *bytesRead += got;
+        }
+        
+        FileRead_close(fileHandle);
+    }
+    
+    return failCount;
+}
+
+int main(int argc, char **argv) {
+    int mapFlag = FALSE;
+    int preloadFlag = FALSE;
+    int streamFlag = TRUE;
+    const char *key = NULL;
+    
+    int n = 1;
+    while (n < argc && argv[n][0] == '-') {
+        if (!strcmp(argv[n], "-map")) {
+            mapFlag = TRUE;
+        } else if (!strcmp(argv[n], "-preload")) {
+            preloadFlag = TRUE;
+        } else if (!strcmp(argv[n], "-nostream")) {
+            streamFlag = FALSE;
+        } else if (!strcmp(argv[n], "-key") && (n + 1) < argc) {
+            n += 1;
+            key = argv[n];
+        }
+        n += 1;
+    }
+    
+    if (n >= argc) {
+        printf("Usage: %s [-map] [-preload] [-nostream] [-key keystring] archive.dxa\n", argv[0]);
+        return -1;
+    }
+    
+    /* Files inside "foo.dxa" are accessed as "foo/..." */
+    std::string archivePath = argv[n];
+    std::string dir = archivePath;
+    size_t dot = dir.find_last_of('.');
+    if (dot != std::string::npos && dir.find_first_of("/\\", dot) == std::string::npos) {
+        dir = dir.substr(0, dot);
+    }
+    
+#ifdef DXPORTLIB
+    SetUseCharSet(DX_CHARSET_EXT_UTF8);
+    EXT_SetDXArchiveMapFlag(mapFlag);
+    EXT_SetDXArchiveStreamCompressedFlag(streamFlag);
+#endif
+    
+    SetUseDXArchiveFlag(TRUE);
+    if (key != NULL) {
+        SetDXArchiveKeyString(key);
+    }
+    
+    ChangeWindowMode(TRUE);
+    if (DxLib_Init() == -1) {
+        return -1;
+    }
+    
+    PrintMemoryUsage("start");
+    
+    int startTime = GetNowCount();
+    
+    if (preloadFlag) {
+        DXArchivePreLoad(archivePath.c_str());
+    }
+    
+    std::vector<std::string> files;
+    CollectFiles(dir, files);
+    
+    int listTime = GetNowCount();
+    
+    LONGLONG bytesRead = 0;
+    unsigned int checksum = 0;
+    double maxFirstByteMS = 0;
+    int failCount = ReadAllFiles(files, &bytesRead, &checksum, &maxFirstByteMS);
+    
+    int endTime = GetNowCount();
+    
+    printf("%d files (%d failed), %lld bytes, checksum %08x\n",
+           (int)files.size(), failCount, (long long)bytesRead, checksum);
+    printf("list %d ms, read %d ms, total %d ms\n",
+           listTime - startTime, endTime - listTime, endTime - startTime);
+    printf("slowest time to first byte %.3f ms\n", maxFirstByteMS);
+    PrintMemoryUsage("end");
+    
+    DxLib_End();
+    
+    return 0;
+}
+
+#endif
@@ -0,0 +1,150 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Measures the DXA key XOR and LZ match copy kernels at each level the
+ * CPU supports, and checks that every level gives the same output.
+ *
+ * Usage: bench_dxa_kernels [megabytes]
+ */
+
+#include "DxLib.h"
+
+#ifdef DXPORTLIB
+#  include "SDL_main.h"
+#endif
+
+#if defined(DX_NON_DXA) || !defined(DXLIB_VERSION)
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    printf("DxPortLib was compiled without DXA archive support.\n");
+    return -1;
+}
+
+#else
+
+#include "PL/PLInternal.h"
+#include "DxLib/DxInternal.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *s_levelNames[] = { "scalar", "sse2", "avx2" };
+
+static double NowSeconds() {
+    return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+}
+
+static double BenchXor(const unsigned char *src, unsigned char *dest, size_t size, int repeat) {
+    static const unsigned char key[DXA_KEY_LENGTH] = {
+        0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x0f, 0x1e, 0x2d, 0x3c
+    };
+    double start = NowSeconds();
+    
+    for (int i = 0; i < repeat; ++i) {
+        DXA_Kernel_Xor(src, dest, size, key);
+    }
+    
+    return ((double)size * repeat) / (NowSeconds() - start) / 1e9;
+}
+
+/* Plays back a fixed list of matches, much like the decompressor does,
+ * with mostly short distances where the pattern has to be replicated. */
+static double BenchCopyMatch(unsigned char *dest, size_t size, int repeat) {
+    static const size_t distances[] = { 1, 2, 3, 4, 7, 8, 12, 15, 16, 24, 31, 33, 64, 200, 4096 };
+    const size_t distanceCount = sizeof(distances) / sizeof(distances[0]);
+    size_t written = 0;
+    double start = NowSeconds();
+    
+    for (int i = 0; i < repeat; ++i) {
+        size_t position = 4096;
+        unsigned int seed = 1;
+        
+        while (position < size) {
+            size_t distance, count;
+            
+            seed = seed * 1103515245u + 12345u;
+            distance = distances[(seed >> 16) % distanceCount];
+            count = 4 + ((seed >> 8) % 252);
+            if (position + count > size) {
+                count = size - position;
+            }
+            
+            DXA_Kernel_CopyMatch(dest + position, distance, count);
+            position += count;
+            written += count;
+        }
+    }
+    
+    return (double)written / (NowSeconds() - start) / 1e9;
+}
+
+int main(int argc, char **argv) {
+    size_t size = 64;
+    if (argc > 1) {
+        size = (size_t)atoi(argv[1]);
+    }
+    size *= 1024 * 1024;
+    if (size < 8192) {
+        size = 8192;
+    }
+    
+    unsigned char *src = (unsigned char *)malloc(size);
+    unsigned char *dest = (unsigned char *)malloc(size);
+    unsigned char *xorReference = (unsigned char *)malloc(size);
+    unsigned char *copyReference = (unsigned char *)malloc(size);
+    
+    for (size_t i = 0; i < size; ++i) {
+        src[i] = (unsigned char)((i * 2654435761u) >> 13);
+    }
+    
+    int bestLevel = DXA_Kernel_SetLevel(-1);
+    
+    for (int level = DXA_KERNEL_SCALAR; level <= bestLevel; ++level) {
+        DXA_Kernel_SetLevel(level);
+        
+        /* Odd sizes and offsets, to check the tails. */
+        double xorRate = BenchXor(src + 1, dest + 3, size - 7, 4);
+        int xorMatch = DXTRUE;
+        if (level == DXA_KERNEL_SCALAR) {
+            memcpy(xorReference, dest, size);
+        } else if (memcmp(xorReference + 3, dest + 3, size - 7) != 0) {
+            xorMatch = DXFALSE;
+        }
+        
+        memcpy(dest, src, 4096);
+        double copyRate = BenchCopyMatch(dest, size, 4);
+        int copyMatch = DXTRUE;
+        if (level == DXA_KERNEL_SCALAR) {
+            memcpy(copyReference, dest, size);
+        } else if (memcmp(copyReference, dest, size) != 0) {
+            copyMatch = DXFALSE;
+        }
+        
+        printf("%-7s xor %6.2f GB/s%s   copy match %6.2f GB/s%s\n",
+               s_levelNames[level],
+               xorRate, xorMatch ? "" : " (MISMATCH)",
+               copyRate, copyMatch ? "" : " (MISMATCH)");
+    }
+    
+    free(src);
+    free(dest);
+    free(xorReference);
+    free(copyReference);
+    
+    return 0;
+}
+
+#endif
@@ -0,0 +1,221 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Reads a 10 MB line-oriented text file with FileRead_gets and
+ * FileRead_getc at a few read buffer sizes, and reports the throughput
+ * of each. The smallest buffer is close to how the stream was read
+ * before there was one at all.
+ *
+ * The file is written to the current directory first if it is not
+ * there already. With -dxa, the same file is also read out of an
+ * archive, which has to be built beforehand with the DxLib archiver
+ * and contain bench_fileread.txt at its root.
+ *
+ * Usage: bench_fileread [-dxa archive.dxa] [-key keystring]
+ */
+
+#include "DxLib.h"
+
+#ifdef DXPORTLIB
+#  include "SDL_main.h"
+#  include "SDL_timer.h"
+#endif
+
+#if !defined(DXLIB_VERSION) || !defined(DXPORTLIB)
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    printf("This benchmark needs DxPortLib.\n");
+    return -1;
+}
+
+#else
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static const char *TEST_FILENAME = "bench_fileread.txt";
+static const long TEST_FILE_SIZE = 10 * 1024 * 1024;
+
+static double NowMS() {
+    return (double)SDL_GetPerformanceCounter() * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+/* Rows of comma separated values, like a game's data tables, with a
+ * few lines of Japanese text mixed in. */
+static int WriteTestFile() {
+    FILE *fp = fopen(TEST_FILENAME, "rb");
+    if (fp != NULL) {
+        fclose(fp);
+        return 0;
+    }
+    
+    fp = fopen(TEST_FILENAME, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+    
+    unsigned int seed = 1;
+    long written = 0;
+    int row = 0;
+    while (written < TEST_FILE_SIZE) {
+        char line[256];
+        int length;
+    
+        seed = seed * 1103515245u + 12345u;
+        if ((row % 16) == 15) {
+            length = sprintf(line, "%d,\xe3\x83\x86\xe3\x82\xb9\xe3\x83\x88\xe8\xa1\x8c %u\r\n",
+                             row, seed >> 16);
+        } else {
+            length = sprintf(line, "%d,%u,%u,%u,enemy_%u,%d.%02d\r\n",
+                             row, seed >> 20, (seed >> 8) & 0xfff, seed & 0xff,
+                             (seed >> 4) % 97, row % 1000, (int)(seed % 100));
+        }
+        fwrite(line, 1, (size_t)length, fp);
+        written += length;
+        row += 1;
+    }
+    
+    fclose(fp);
+    return 0;
+}
+
+struct ReadResult {
+    double milliseconds;
+    long count;
+    unsigned int checksum;
+};
+
+static bool ReadLines(const char *filename, ReadResult *result) {
+    static char line[4096];
+    
+    double start = NowMS();
+    int fileHandle = FileRead_open(filename);
+    if (fileHandle == 0 || fileHandle == -1) {
+        return false;
+    }
+    
+    result->count = 0;
+    result->checksum = 0;
+    int length;
+    while ((length = FileRead_gets(line, sizeof(line), fileHandle)) >= 0) {
+        result->count += 1;
+        result->checksum = result->checksum * 31 + (unsigned int)length;
+    }
+    
+    FileRead_close(fileHandle);
+    result->milliseconds = NowMS() - start;
+    return true;
+}
+
+static bool ReadChars(const char *filename, ReadResult *result) {
+    double start = NowMS();
+    int fileHandle = FileRead_open(filename);
+    if (fileHandle == 0 || fileHandle == -1) {
+        return false;
+    }
+    
+    result->count = 0;
+    result->checksum = 0;
+    while (FileRead_eof(fileHandle) == 0) {
+        result->checksum = result->checksum * 31 + (unsigned char)FileRead_getc(fileHandle);
+        result->count += 1;
+    }
+    
+    FileRead_close(fileHandle);
+    result->milliseconds = NowMS() - start;
+    return true;
+}
+
+static void Report(const char *label, int bufferSize, const char *what,
+                   const ReadResult &result) {
+    double megabytes = (double)TEST_FILE_SIZE / (1024.0 * 1024.0);
+    printf("%-5s buffer %6d  %-5s %8.1f ms  %7.1f MB/s  (%ld, %08x)\n",
+           label, bufferSize, what, result.milliseconds,
+           megabytes * 1000.0 / result.milliseconds,
+           result.count, result.checksum);
+}
+
+static void RunAll(const char *label, const char *filename) {
+    static const int bufferSizes[] = { 64, 4096, 32768, 262144 };
+    
+    for (int i = 0; i < 4; ++i) {
+        ReadResult result;
+    
+        EXT_FileRead_SetBufferSize(bufferSizes[i]);
+    
+        if (!ReadLines(filename, &result)) {
+            printf("%-5s could not open %s\n", label, filename);
+            return;
+        }
+        Report(label, bufferSizes[i], "gets", result);
+    
+        ReadChars(filename, &result);
+        Report(label, bufferSizes[i], "getc", result);
+    }
+    
+    EXT_FileRead_SetBufferSize(32768);
+}
+
+int main(int argc, char **argv) {
+    const char *archive = NULL;
+    const char *key = NULL;
+    
+    for (int n = 1; n < argc; ++n) {
+        if (!strcmp(argv[n], "-dxa") && (n + 1) < argc) {
+            archive = argv[++n];
+        } else if (!strcmp(argv[n], "-key") && (n + 1) < argc) {
+            key = argv[++n];
+        }
+    }
+    
+    if (WriteTestFile() < 0) {
+        printf("Could not write %s.\n", TEST_FILENAME);
+        return -1;
+    }
+    
+    SetUseCharSet(DX_CHARSET_EXT_UTF8);
+    SetUseDXArchiveFlag(archive != NULL ? TRUE : FALSE);
+    if (key != NULL) {
+        SetDXArchiveKeyString(key);
+    }
+    
+    ChangeWindowMode(TRUE);
+    if (DxLib_Init() == -1) {
+        return -1;
+    }
+    
+    RunAll("disk", TEST_FILENAME);
+    
+    /* Files inside "foo.dxa" are accessed as "foo/..." */
+    if (archive != NULL) {
+        std::string path = archive;
+        size_t dot = path.find_last_of('.');
+        if (dot != std::string::npos && path.find_first_of("/\\", dot) == std::string::npos) {
+            path = path.substr(0, dot);
+        }
+        path += "/";
+        path += TEST_FILENAME;
+    
+        RunAll("dxa", path.c_str());
+    }
+    
+    DxLib_End();
+    
+    return 0;
+}
+
+#endif
@@ -0,0 +1,207 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Draws a 10,000 character Japanese string over and over and reports
+ * how many characters per second DrawStringToHandle gets through once
+ * every glyph is cached, along with the glyph cache statistics.
+ *
+ * With -layout, the string is laid out once with
+ * EXT_CreateTextLayoutToHandle and drawn with EXT_DrawTextLayout.
+ * With -nocache, the DrawString layout cache is turned off.
+ * With -prewarm, the glyphs are cached in the background first, and the
+ * time that takes is reported separately.
+ *
+ * Usage: bench_font [-edge] [-layout] [-nocache] [-prewarm] [-frames n] fontfile.ttf
+ */
+
+#include "DxLib.h"
+
+#ifdef DXPORTLIB
+#  include "SDL_main.h"
+#  include "SDL_timer.h"
+#endif
+
+#if defined(DX_NON_FONT) || !defined(DXLIB_VERSION) || !defined(DXPORTLIB)
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    printf("DxPortLib was compiled without font support.\n");
+    return -1;
+}
+
+#else
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static const int s_charCount = 10000;
+
+static void AppendUTF8(std::string &str, unsigned int ch) {
+    if (ch < 0x80) {
+        str += (char)ch;
+    } else if (ch < 0x800) {
+        str += (char)(0xc0 | (ch >> 6));
+        str += (char)(0x80 | (ch & 0x3f));
+    } else {
+        str += (char)(0xe0 | (ch >> 12));
+        str += (char)(0x80 | ((ch >> 6) & 0x3f));
+        str += (char)(0x80 | (ch & 0x3f));
+    }
+}
+
+/* A mix of kana and the first 2,000 kanji, in a scrambled but fixed
+ * order, with a line break every 40 characters to stay on screen. */
+static std::string MakeJapaneseText() {
+    std::string text;
+    unsigned int seed = 1;
+    
+    for (int i = 0; i < s_charCount; ++i) {
+        unsigned int ch;
+        
+        if ((i % 40) == 39) {
+            text += '\n';
+            continue;
+        }
+        
+        seed = seed * 1103515245u + 12345u;
+        switch ((seed >> 16) % 4) {
+            case 0: ch = 0x3041 + ((seed >> 8) % 83); break;    /* hiragana */
+            case 1: ch = 0x30a1 + ((seed >> 8) % 86); break;    /* katakana */
+            default: ch = 0x4e00 + ((seed >> 8) % 2000); break; /* kanji */
+        }
+        AppendUTF8(text, ch);
+    }
+    
+    return text;
+}
+
+static double NowMS() {
+    return (double)SDL_GetPerformanceCounter() * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char **argv) {
+    int fontType = DX_FONTTYPE_ANTIALIASING;
+    int frames = 120;
+    int layoutFlag = FALSE;
+    int noCacheFlag = FALSE;
+    int prewarmFlag = FALSE;
+    
+    int n = 1;
+    while (n < argc && argv[n][0] == '-') {
+        if (!strcmp(argv[n], "-edge")) {
+            fontType = DX_FONTTYPE_ANTIALIASING_EDGE;
+        } else if (!strcmp(argv[n], "-layout")) {
+            layoutFlag = TRUE;
+        } else if (!strcmp(argv[n], "-nocache")) {
+            noCacheFlag = TRUE;
+        } else if (!strcmp(argv[n], "-prewarm")) {
+            prewarmFlag = TRUE;
+        } else if (!strcmp(argv[n], "-frames") && (n + 1) < argc) {
+            n += 1;
+            frames = atoi(argv[n]);
+        }
+        n += 1;
+    }
+    
+    if (n >= argc) {
+        printf("Usage: %s [-edge] [-layout] [-nocache] [-prewarm] [-frames n] fontfile.ttf\n", argv[0]);
+        return -1;
+    }
+    
+    SetUseCharSet(DX_CHARSET_EXT_UTF8);
+    SetGraphMode(1024, 768, 32);
+    ChangeWindowMode(TRUE);
+    
+    if (DxLib_Init() == -1) {
+        return -1;
+    }
+    
+    EXT_MapFontFileToName(argv[n], "BenchFont", -1, FALSE);
+    int font = CreateFontToHandle("BenchFont", 16, 4, fontType);
+    if (font < 0) {
+        printf("Could not load %s\n", argv[n]);
+        DxLib_End();
+        return -1;
+    }
+    
+    if (noCacheFlag) {
+        EXT_SetTextLayoutCacheSize(0);
+    }
+    
+    std::string text = MakeJapaneseText();
+    
+    SetDrawScreen(DX_SCREEN_BACK);
+    
+    double start;
+    if (prewarmFlag) {
+        start = NowMS();
+        EXT_PrewarmFontToHandle(text.c_str(), font);
+        double submitMS = NowMS() - start;
+        while (EXT_CheckFontPrewarmToHandle(font) == TRUE && ProcessMessage() == 0) {
+            SDL_Delay(1);
+        }
+        printf("prewarm: %.2f ms on the main thread, %.2f ms until done\n",
+               submitMS, NowMS() - start);
+    }
+    
+    /* The first draw caches every glyph. */
+    start = NowMS();
+    int layout = -1;
+    if (layoutFlag) {
+        layout = EXT_CreateTextLayoutToHandle(text.c_str(), font);
+    } else {
+        DrawStringToHandle(0, 0, text.c_str(), GetColor(255, 255, 255), font, GetColor(0, 0, 0));
+    }
+    double cacheMS = NowMS() - start;
+    
+    double drawMS = 0;
+    int frame;
+    for (frame = 0; frame < frames && ProcessMessage() == 0; ++frame) {
+        ClearDrawScreen();
+        
+        start = NowMS();
+        if (layout >= 0) {
+            EXT_DrawTextLayout(0, 0, layout, GetColor(255, 255, 255), GetColor(0, 0, 0));
+        } else {
+            DrawStringToHandle(0, 0, text.c_str(), GetColor(255, 255, 255), font, GetColor(0, 0, 0));
+        }
+        drawMS += NowMS() - start;
+        
+        ScreenFlip();
+    }
+    
+    int pageCount, glyphCount, growCount;
+    double occupancy;
+    EXT_GetFontCacheStatsToHandle(font, &pageCount, &glyphCount, &occupancy, &growCount);
+    
+    printf("first draw (caching) %.2f ms\n", cacheMS);
+    if (frame > 0) {
+        printf("%d draws, %.3f ms each, %.0f characters/second\n",
+               frame, drawMS / frame, (double)s_charCount * frame * 1000.0 / drawMS);
+    }
+    printf("%d glyphs on %d pages, %.1f%% occupied, %d pages added\n",
+           glyphCount, pageCount, occupancy * 100.0, growCount);
+    
+    if (layout >= 0) {
+        EXT_DeleteTextLayout(layout);
+    }
+    
+    DxLib_End();
+    
+    return 0;
+}
+
+#endif
@@ -0,0 +1,263 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Renders every JIS level 1 kanji, then draws edges of size 1 to 4 for
+ * all of them with the old pattern stamping and with each font edge
+ * kernel level the CPU supports. Reports the time each takes and checks
+ * that every level matches the stamped output exactly.
+ *
+ * Usage: bench_font_edge fontfile.ttf [pointsize]
+ */
+
+#include "DxLib.h"
+
+#ifdef DXPORTLIB
+#  include "SDL_main.h"
+#endif
+
+#if defined(DX_NON_FONT) || !defined(DXLIB_VERSION) || !defined(DXPORTLIB)
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    printf("DxPortLib was compiled without font support.\n");
+    return -1;
+}
+
+#else
+
+#include "PL/PLInternal.h"
+#include "DxLib/DxInternal.h"
+#include "SDL_ttf.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const char *s_levelNames[] = { "scalar", "sse2", "avx2", "neon" };
+
+/* The edge patterns and stamping loop DxFont used to draw edges with. */
+static const unsigned char s_fontEdgePattern2[5 * 5] = {
+    0, 1, 1, 1, 0,
+    1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1,
+    0, 1, 1, 1, 0
+};
+static const unsigned char s_fontEdgePattern3[7 * 7] = {
+    0, 0, 0, 1, 0, 0, 0,
+    0, 1, 1, 1, 1, 1, 0,
+    0, 1, 1, 1, 1, 1, 0,
+    1, 1, 1, 1, 1, 1, 1,
+    0, 1, 1, 1, 1, 1, 0,
+    0, 1, 1, 1, 1, 1, 0,
+    0, 0, 0, 1, 0, 0, 0
+};
+static const unsigned char s_fontEdgePattern4[9 * 9] = {
+    0, 0, 1, 1, 1, 1, 1, 0, 0,
+    0, 1, 1, 1, 1, 1, 1, 1, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1,
+    0, 1, 1, 1, 1, 1, 1, 1, 0,
+    0, 0, 1, 1, 1, 1, 1, 0, 0
+};
+static const unsigned char *s_fontEdgePatternTable[3] = {
+    s_fontEdgePattern2,
+    s_fontEdgePattern3,
+    s_fontEdgePattern4
+};
+
+static void StampEdge(const unsigned int *src, int srcPitch, int w, int h,
+                      int edgeSize, unsigned int *destPixels, int destPitch) {
+    const unsigned int *srcPixels = src;
+    
+    if (edgeSize == 1) {
+        destPixels += destPitch + 1;
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                unsigned int alpha = srcPixels[x];
+                if (alpha > 0xffffff) {
+                    destPixels[x] = 0xffffffff;
+                    
+                    if (destPixels[x + 1] < alpha) { destPixels[x + 1] = alpha; }
+                    if (destPixels[x - 1] < alpha) { destPixels[x - 1] = alpha; }
+                    if (destPixels[x + destPitch] < alpha) { destPixels[x + destPitch] = alpha; }
+                    if (destPixels[x - destPitch] < alpha) { destPixels[x - destPitch] = alpha; }
+                }
+            }
+            srcPixels += srcPitch;
+            destPixels += destPitch;
+        }
+    } else {
+        const unsigned char *edgePattern = s_fontEdgePatternTable[edgeSize - 2];
+        int ec = edgeSize + edgeSize + 1;
+        int offset = (edgeSize * destPitch) + edgeSize;
+        
+        destPixels += offset;
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                unsigned int alpha = srcPixels[x];
+                if (alpha > 0xffffff) {
+                    const unsigned char *pattern = edgePattern;
+                    unsigned int *dest = destPixels + x - offset;
+                    
+                    destPixels[x] = alpha;
+                    
+                    for (int by = 0; by < ec; ++by) {
+                        for (int bx = 0; bx < ec; ++bx) {
+                            if (*pattern++ > 0 && dest[bx] < alpha) {
+                                dest[bx] = alpha;
+                            }
+                        }
+                        dest += destPitch;
+                    }
+                }
+            }
+            srcPixels += srcPitch;
+            destPixels += destPitch;
+        }
+    }
+}
+
+struct Glyph {
+    SDL_Surface *surface;
+    std::vector<unsigned int> expected;
+    std::vector<unsigned int> result;
+};
+
+static double NowMS() {
+    return (double)SDL_GetPerformanceCounter() * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+/* JIS X 0208 rows 16 to 47, through Shift-JIS to Unicode. */
+static std::vector<unsigned int> MakeJISLevel1() {
+    std::vector<unsigned int> codepoints;
+    
+    for (int ku = 16; ku <= 47; ++ku) {
+        int lastTen = (ku == 47) ? 51 : 94;
+        for (int ten = 1; ten <= lastTen; ++ten) {
+            int j1 = ku + 0x20;
+            int j2 = ten + 0x20;
+            char sjis[3];
+            const char *p = sjis;
+            
+            sjis[0] = (char)(((j1 + 1) >> 1) + ((j1 <= 0x5e) ? 0x70 : 0xb0));
+            if ((j1 & 1) != 0) {
+                sjis[1] = (char)(j2 + ((j2 >= 0x60) ? 0x20 : 0x1f));
+            } else {
+                sjis[1] = (char)(j2 + 0x7e);
+            }
+            sjis[2] = 0;
+            
+            codepoints.push_back(PL_Text_ReadSJISChar(&p));
+        }
+    }
+    
+    return codepoints;
+}
+
+static double RunEdges(std::vector<Glyph> &glyphs, int edgeSize, int level) {
+    double start = NowMS();
+    
+    for (size_t i = 0; i < glyphs.size(); ++i) {
+        Glyph &glyph = glyphs[i];
+        SDL_Surface *surface = glyph.surface;
+        int width = surface->w + edgeSize * 2;
+        std::vector<unsigned int> &out = (level < 0) ? glyph.expected : glyph.result;
+        
+        out.assign((size_t)width * (surface->h + edgeSize * 2), 0);
+        if (level < 0) {
+            StampEdge((const unsigned int *)surface->pixels, surface->pitch / 4,
+                      surface->w, surface->h, edgeSize, &out[0], width);
+        } else {
+            FontEdge_Draw((const unsigned int *)surface->pixels, surface->pitch / 4,
+                          surface->w, surface->h, edgeSize, &out[0], width);
+        }
+    }
+    
+    return NowMS() - start;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Usage: %s fontfile.ttf [pointsize]\n", argv[0]);
+        return -1;
+    }
+    int pointSize = (argc > 2) ? atoi(argv[2]) : 24;
+    
+    if (TTF_Init() < 0) {
+        return -1;
+    }
+    TTF_Font *font = TTF_OpenFont(argv[1], pointSize);
+    if (font == NULL) {
+        printf("Could not load %s\n", argv[1]);
+        return -1;
+    }
+    
+    std::vector<unsigned int> codepoints = MakeJISLevel1();
+    std::vector<Glyph> glyphs;
+    SDL_Color white = { 0xff, 0xff, 0xff, 0xff };
+    
+    double start = NowMS();
+    for (size_t i = 0; i < codepoints.size(); ++i) {
+        SDL_Surface *surface = TTF_RenderGlyph_Blended(font, (Uint16)codepoints[i], white);
+        if (surface != NULL) {
+            Glyph glyph;
+            glyph.surface = surface;
+            glyphs.push_back(glyph);
+        }
+    }
+    printf("%d glyphs at %dpt, rendered in %.1f ms\n",
+           (int)glyphs.size(), pointSize, NowMS() - start);
+    
+    int bestLevel = FontEdge_Kernel_SetLevel(-1);
+    int failed = 0;
+    
+    for (int edgeSize = 1; edgeSize <= FONTEDGE_MAX_SIZE; ++edgeSize) {
+        double stampMS = RunEdges(glyphs, edgeSize, -1);
+        printf("edge %d: stamping %8.2f ms\n", edgeSize, stampMS);
+        
+        for (int level = 0; level <= bestLevel; ++level) {
+            if (FontEdge_Kernel_SetLevel(level) != level) {
+                continue;
+            }
+            
+            double ms = RunEdges(glyphs, edgeSize, level);
+            
+            int mismatches = 0;
+            for (size_t i = 0; i < glyphs.size(); ++i) {
+                if (glyphs[i].expected != glyphs[i].result) {
+                    mismatches += 1;
+                }
+            }
+            failed += mismatches;
+            
+            printf("        %-8s %8.2f ms  %5.2fx  %s\n", s_levelNames[level], ms, stampMS / ms,
+                   (mismatches == 0) ? "identical" : "MISMATCH");
+        }
+    }
+    
+    for (size_t i = 0; i < glyphs.size(); ++i) {
+        SDL_FreeSurface(glyphs[i].surface);
+    }
+    TTF_CloseFont(font);
+    TTF_Quit();
+    
+    return (failed == 0) ? 0 : 1;
+}
+
+#endif
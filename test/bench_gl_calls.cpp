@@ -0,0 +1,313 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Counts the GL calls it takes to set up a draw with a shader program,
+ * with and without vertex array objects. No context is needed: the GL
+ * function table is filled with fakes that only count how often they
+ * are called.
+ *
+ * The "no vertex arrays" column is the fallback path for drivers that
+ * lack them, as it is now. It is not the code as it was before vertex
+ * arrays were added, which also set the sampler uniforms on every draw.
+ *
+ * The draws switch between two programs, two vertex layouts and three
+ * sets of buffers, including the streaming buffer, both where the
+ * vertices are drawn from a new offset each time and where they are
+ * not.
+ *
+ * Usage: bench_gl_calls [draws]
+ */
+
+#include "DxLib.h"
+
+#ifdef DXPORTLIB
+#  include "SDL_main.h"
+#endif
+
+#include "DPLBuildConfig.h"
+
+#if !defined(DXLIB_VERSION) || !defined(DXPORTLIB) || !defined(DXPORTLIB_DRAW_OPENGL)
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    printf("DxPortLib was compiled without OpenGL support.\n");
+    return -1;
+}
+
+#else
+
+extern "C" {
+#include "PL/GL/PLGLInternal.h"
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ------------------------------------------------------ Counting fakes */
+
+extern "C" {
+
+GLInfo PL_GL;
+PLRenderStats PLGL_frameStats;
+
+/* The shader cache is off, as the fakes have no program binaries. */
+int PL_Platform_FileOpenReadDirect(const char *filename) { return -1; }
+int PL_Platform_FileOpenWriteDirect(const char *filename) { return -1; }
+int64_t PL_File_GetSize(int fileHandle) { return -1; }
+int64_t PL_File_Read(int fileHandle, void *data, int size) { return -1; }
+int64_t PL_File_Write(int fileHandle, void *data, int size) { return -1; }
+int PL_File_Close(int fileHandle) { return -1; }
+
+}
+
+static int s_callCount = 0;
+static GLuint s_nextName = 1;
+
+static void APIENTRY Fake_glEnable(GLenum) { s_callCount += 1; }
+static void APIENTRY Fake_glDisable(GLenum) { s_callCount += 1; }
+static GLenum APIENTRY Fake_glGetError() { s_callCount += 1; return GL_NO_ERROR; }
+static const GLubyte *APIENTRY Fake_glGetString(GLenum) {
+    s_callCount += 1;
+    return (const GLubyte *)"fake";
+}
+static void APIENTRY Fake_glDeleteTextures(GLsizei, const GLuint *) { s_callCount += 1; }
+static void APIENTRY Fake_glActiveTexture(GLenum) { s_callCount += 1; }
+static void APIENTRY Fake_glBindTexture(GLenum, GLuint) { s_callCount += 1; }
+static void APIENTRY Fake_glDrawArrays(GLenum, GLint, GLsizei) { s_callCount += 1; }
+static void APIENTRY Fake_glDrawElements(GLenum, GLsizei, GLenum, const GLvoid *) {
+    s_callCount += 1;
+}
+static void APIENTRY Fake_glBindBuffer(GLenum, GLuint) { s_callCount += 1; }
+static void APIENTRY Fake_glDeleteBuffers(GLsizei, const GLuint *) { s_callCount += 1; }
+static void APIENTRY Fake_glGenBuffers(GLsizei n, GLuint *buffers) {
+    s_callCount += 1;
+    for (GLsizei i = 0; i < n; ++i) {
+        buffers[i] = s_nextName++;
+    }
+}
+static void APIENTRY Fake_glGenVertexArrays(GLsizei n, GLuint *arrays) {
+    s_callCount += 1;
+    for (GLsizei i = 0; i < n; ++i) {
+        arrays[i] = s_nextName++;
+    }
+}
+static void APIENTRY Fake_glDeleteVertexArrays(GLsizei, const GLuint *) { s_callCount += 1; }
+static void APIENTRY Fake_glBindVertexArray(GLuint) { s_callCount += 1; }
+static GLuint APIENTRY Fake_glCreateShader(GLenum) { s_callCount += 1; return s_nextName++; }
+static GLuint APIENTRY Fake_glDeleteShader(GLuint) { s_callCount += 1; return 0; }
+static void APIENTRY Fake_glShaderSource(GLuint, GLsizei, const GLchar * const *, const GLint *) {
+    s_callCount += 1;
+}
+static void APIENTRY Fake_glCompileShader(GLuint) { s_callCount += 1; }
+static void APIENTRY Fake_glGetShaderiv(GLuint, GLenum, GLint *params) {
+    s_callCount += 1;
+    *params = GL_TRUE;
+}
+static GLint APIENTRY Fake_glGetUniformLocation(GLuint, const GLchar *name) {
+    s_callCount += 1;
+    if (strcmp(name, "projection") == 0) { return 0; }
+    if (strcmp(name, "modelView") == 0) { return 1; }
+    if (strcmp(name, "texture") == 0) { return 2; }
+    if (strcmp(name, "alphaTest") == 0) { return 3; }
+    return -1;
+}
+static GLint APIENTRY Fake_glGetAttribLocation(GLuint, const GLchar *name) {
+    s_callCount += 1;
+    if (strcmp(name, "position") == 0) { return 0; }
+    if (strcmp(name, "texcoord") == 0) { return 1; }
+    if (strcmp(name, "color") == 0) { return 2; }
+    return -1;
+}
+static GLuint APIENTRY Fake_glCreateProgram() { s_callCount += 1; return s_nextName++; }
+static void APIENTRY Fake_glDeleteProgram(GLuint) { s_callCount += 1; }
+static void APIENTRY Fake_glUseProgram(GLuint) { s_callCount += 1; }
+static void APIENTRY Fake_glLinkProgram(GLuint) { s_callCount += 1; }
+static void APIENTRY Fake_glAttachShader(GLuint, GLuint) { s_callCount += 1; }
+static void APIENTRY Fake_glGetProgramiv(GLuint, GLenum, GLint *params) {
+    s_callCount += 1;
+    *params = GL_TRUE;
+}
+static void APIENTRY Fake_glEnableVertexAttribArray(GLuint) { s_callCount += 1; }
+static void APIENTRY Fake_glDisableVertexAttribArray(GLuint) { s_callCount += 1; }
+static void APIENTRY Fake_glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean,
+                                                GLsizei, const void *) {
+    s_callCount += 1;
+}
+static void APIENTRY Fake_glUniform1i(GLint, GLint) { s_callCount += 1; }
+static void APIENTRY Fake_glUniform1f(GLint, GLfloat) { s_callCount += 1; }
+static void APIENTRY Fake_glUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat *) {
+    s_callCount += 1;
+}
+
+static void SetupFakeGL(int vertexArrayFlag) {
+    memset(&PL_GL, 0, sizeof(PL_GL));
+    
+    PL_GL.glEnable = Fake_glEnable;
+    PL_GL.glDisable = Fake_glDisable;
+    PL_GL.glGetError = Fake_glGetError;
+    PL_GL.glGetString = Fake_glGetString;
+    PL_GL.glDeleteTextures = Fake_glDeleteTextures;
+    PL_GL.glActiveTexture = Fake_glActiveTexture;
+    PL_GL.glBindTexture = Fake_glBindTexture;
+    PL_GL.glDrawArrays = Fake_glDrawArrays;
+    PL_GL.glDrawElements = Fake_glDrawElements;
+    
+    PL_GL.hasVBOSupport = DXTRUE;
+    PL_GL.glBindBuffer = Fake_glBindBuffer;
+    PL_GL.glDeleteBuffers = Fake_glDeleteBuffers;
+    PL_GL.glGenBuffers = Fake_glGenBuffers;
+    
+    PL_GL.hasVertexArraySupport = vertexArrayFlag;
+    PL_GL.glGenVertexArrays = Fake_glGenVertexArrays;
+    PL_GL.glDeleteVertexArrays = Fake_glDeleteVertexArrays;
+    PL_GL.glBindVertexArray = Fake_glBindVertexArray;
+    
+    PL_GL.hasShaderSupport = DXTRUE;
+    PL_GL.glCreateShader = Fake_glCreateShader;
+    PL_GL.glDeleteShader = Fake_glDeleteShader;
+    PL_GL.glShaderSource = Fake_glShaderSource;
+    PL_GL.glCompileShader = Fake_glCompileShader;
+    PL_GL.glGetShaderiv = Fake_glGetShaderiv;
+    PL_GL.glGetUniformLocation = Fake_glGetUniformLocation;
+    PL_GL.glGetAttribLocation = Fake_glGetAttribLocation;
+    PL_GL.glCreateProgram = Fake_glCreateProgram;
+    PL_GL.glDeleteProgram = Fake_glDeleteProgram;
+    PL_GL.glUseProgram = Fake_glUseProgram;
+    PL_GL.glLinkProgram = Fake_glLinkProgram;
+    PL_GL.glAttachShader = Fake_glAttachShader;
+    PL_GL.glGetProgramiv = Fake_glGetProgramiv;
+    PL_GL.glEnableVertexAttribArray = Fake_glEnableVertexAttribArray;
+    PL_GL.glDisableVertexAttribArray = Fake_glDisableVertexAttribArray;
+    PL_GL.glVertexAttribPointer = Fake_glVertexAttribPointer;
+    PL_GL.glUniform1i = Fake_glUniform1i;
+    PL_GL.glUniform1f = Fake_glUniform1f;
+    PL_GL.glUniformMatrix4fv = Fake_glUniformMatrix4fv;
+}
+
+/* ------------------------------------------------------------ Vertices */
+
+typedef struct _BenchVertexColor {
+    float x, y;
+    unsigned int color;
+} BenchVertexColor;
+static const VertexElement s_BenchVertexColorElements[] = {
+    { VERTEX_POSITION, 2, VERTEXSIZE_FLOAT, offsetof(BenchVertexColor, x) },
+    { VERTEX_COLOR, 4, VERTEXSIZE_UNSIGNED_BYTE, offsetof(BenchVertexColor, color) },
+};
+VERTEX_DEFINITION(BenchVertexColor)
+
+typedef struct _BenchVertexTex {
+    float x, y;
+    float tcx, tcy;
+    unsigned int color;
+} BenchVertexTex;
+static const VertexElement s_BenchVertexTexElements[] = {
+    { VERTEX_POSITION, 2, VERTEXSIZE_FLOAT, offsetof(BenchVertexTex, x) },
+    { VERTEX_TEXCOORD0, 2, VERTEXSIZE_FLOAT, offsetof(BenchVertexTex, tcx) },
+    { VERTEX_COLOR, 4, VERTEXSIZE_UNSIGNED_BYTE, offsetof(BenchVertexTex, color) },
+};
+VERTEX_DEFINITION(BenchVertexTex)
+
+/* ----------------------------------------------------------- The bench */
+
+enum {
+    DRAW_STATIC,        /* A vertex and index buffer of its own */
+    DRAW_STREAM,        /* The streaming buffer, always drawn from offset 0 */
+    DRAW_STREAM_INDEXED /* The streaming buffers, at a new offset each time */
+};
+
+/* Counts the calls for the draws as PLGL_DrawVertexIndexBuffer and the
+ * streamed draws make them, from picking the program to the draw. */
+static double CountCallsPerDraw(int vertexArrayFlag, int drawKind, int draws) {
+    SetupFakeGL(vertexArrayFlag);
+    PLGL_State_Reset();
+    PLGL_Shaders_Init();
+    
+    int colorProgram = PLGL_Shaders_GetStockProgramForID(PLGL_SHADER_BASIC_COLOR_NOTEX,
+                                                         PL_ALPHAFUNC_ALWAYS);
+    int texProgram = PLGL_Shaders_GetStockProgramForID(PLGL_SHADER_BASIC_COLOR_TEX1,
+                                                       PL_ALPHAFUNC_ALWAYS);
+    
+    GLuint buffers[6];
+    PL_GL.glGenBuffers(6, buffers);
+    
+    s_callCount = 0;
+    for (int i = 0; i < draws; ++i) {
+        int useTex = (i & 1);
+        int program = useTex ? texProgram : colorProgram;
+        const VertexDefinition *def = useTex ? &s_BenchVertexTexDefinition
+                                             : &s_BenchVertexColorDefinition;
+    
+        PLGL_Shaders_UseProgram(program);
+    
+        switch (drawKind) {
+            case DRAW_STATIC: {
+                int set = i % 3;
+                PLGL_Shaders_BindVertexBuffers(program, def,
+                                               buffers[set * 2], buffers[set * 2 + 1], 0);
+                PL_GL.glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+                break;
+            }
+            case DRAW_STREAM:
+                PLGL_Shaders_BindVertexBuffers(program, def, buffers[0], 0, 0);
+                PL_GL.glDrawArrays(GL_TRIANGLES, i * 6, 6);
+                break;
+            default: {
+                const char *base = (const char *)(size_t)(i * 4 * def->vertexByteSize);
+                PLGL_Shaders_BindVertexBuffers(program, def, buffers[0], buffers[1], base);
+                PL_GL.glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT,
+                                     (void *)(size_t)(i * 12));
+                break;
+            }
+        }
+    }
+    double callsPerDraw = (double)s_callCount / draws;
+    
+    PLGL_Shaders_Cleanup();
+    for (int i = 0; i < 6; ++i) {
+        PLGL_State_DeleteBuffer(buffers[i]);
+    }
+    
+    return callsPerDraw;
+}
+
+int main(int argc, char **argv) {
+    int draws = 10000;
+    if (argc > 1) {
+        draws = atoi(argv[1]);
+    }
+    if (draws < 1) {
+        draws = 1;
+    }
+    
+    PL_Handle_Init();
+    
+    static const char *kindNames[] = {
+        "buffers", "streamed", "streamed, indexed"
+    };
+    
+    for (int kind = DRAW_STATIC; kind <= DRAW_STREAM_INDEXED; ++kind) {
+        printf("%-18s  no vertex arrays %5.2f calls/draw  vertex arrays %5.2f calls/draw\n",
+               kindNames[kind],
+               CountCallsPerDraw(DXFALSE, kind, draws),
+               CountCallsPerDraw(DXTRUE, kind, draws));
+    }
+    
+    PL_Handle_End();
+    
+    return 0;
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Checks for the test programs that run without a window. Each check
+ * that fails is printed, and CheckResult gives what main returns. */
+
+#ifndef DXPORTLIB_TEST_CHECK_H_HEADER
+#define DXPORTLIB_TEST_CHECK_H_HEADER
+
+#include <stdio.h>
+
+static int s_failures = 0;
+
+static void Check(bool condition, const char *what) {
+    if (!condition) {
+        printf("FAIL: %s\n", what);
+        s_failures += 1;
+    }
+}
+
+static int CheckResult(const char *name) {
+    if (s_failures > 0) {
+        printf("%d check(s) failed.\n", s_failures);
+        return 1;
+    }
+    
+    printf("All %s checks passed.\n", name);
+    return 0;
+}
+
+#endif /* #ifndef DXPORTLIB_TEST_CHECK_H_HEADER */
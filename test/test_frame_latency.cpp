@@ -0,0 +1,248 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Runs the frame latency limiter against a simulated GPU and clock, and
+ * checks that it never lets more frames queue up than allowed, only
+ * waits when the GPU is behind, falls back on finish without fences,
+ * and deletes every fence it creates.
+ *
+ * Usage: test_frame_latency
+ */
+
+#include "DxLib.h"
+
+#ifdef DXPORTLIB
+#  include "SDL_main.h"
+#endif
+
+#if !defined(DXLIB_VERSION) || !defined(DXPORTLIB)
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    printf("This test needs DxPortLib.\n");
+    return -1;
+}
+
+#else
+
+#include "PL/PLInternal.h"
+#include "test_check.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* The GPU works through frames one after another, each taking gpuCost
+ * microseconds, starting no earlier than when its fence was inserted.
+ * The clock is in microseconds. */
+struct FakeFence {
+    Uint64 doneTime;
+    bool deleted;
+};
+
+struct FakeGPU {
+    Uint64 now;
+    Uint64 gpuCost;
+    Uint64 lastDoneTime;
+    
+    FakeFence fences[1024];
+    int fenceCount;
+    int deleteCount;
+    int finishCount;
+    
+    int queued;
+    int maxQueued;
+};
+
+static FakeGPU s_gpu;
+
+static Uint64 FakeNow(void *userdata) {
+    return ((FakeGPU *)userdata)->now;
+}
+
+static void *FakeFenceInsert(void *userdata) {
+    FakeGPU *gpu = (FakeGPU *)userdata;
+    if (gpu->fenceCount >= 1024) {
+        return NULL;
+    }
+    
+    Uint64 start = (gpu->lastDoneTime > gpu->now) ? gpu->lastDoneTime : gpu->now;
+    FakeFence *fence = &gpu->fences[gpu->fenceCount++];
+    fence->doneTime = start + gpu->gpuCost;
+    fence->deleted = false;
+    gpu->lastDoneTime = fence->doneTime;
+    return fence;
+}
+
+static int FakeFenceWait(void *userdata, void *fence, int blockFlag) {
+    FakeGPU *gpu = (FakeGPU *)userdata;
+    FakeFence *f = (FakeFence *)fence;
+    if (gpu->now >= f->doneTime) {
+        return DXTRUE;
+    }
+    if (blockFlag == DXFALSE) {
+        return DXFALSE;
+    }
+    gpu->now = f->doneTime;
+    return DXTRUE;
+}
+
+static void FakeFenceDelete(void *userdata, void *fence) {
+    FakeGPU *gpu = (FakeGPU *)userdata;
+    FakeFence *f = (FakeFence *)fence;
+    if (!f->deleted) {
+        f->deleted = true;
+        gpu->deleteCount += 1;
+    }
+}
+
+static void FakeFinish(void *userdata) {
+    FakeGPU *gpu = (FakeGPU *)userdata;
+    if (gpu->lastDoneTime > gpu->now) {
+        gpu->now = gpu->lastDoneTime;
+    }
+    gpu->finishCount += 1;
+}
+
+/* Frames the GPU has not finished yet, counting one just submitted. */
+static int CountQueued(FakeGPU *gpu) {
+    int count = 0;
+    for (int i = 0; i < gpu->fenceCount; ++i) {
+        if (gpu->fences[i].doneTime > gpu->now) {
+            count += 1;
+        }
+    }
+    return count;
+}
+
+static void Start(Uint64 gpuCost, bool useFences, int maxFrames) {
+    PLFrameLatencyFunctions funcs;
+    
+    memset(&s_gpu, 0, sizeof(s_gpu));
+    s_gpu.now = 1000;
+    s_gpu.gpuCost = gpuCost;
+    
+    memset(&funcs, 0, sizeof(funcs));
+    if (useFences) {
+        funcs.fenceInsert = FakeFenceInsert;
+        funcs.fenceWait = FakeFenceWait;
+        funcs.fenceDelete = FakeFenceDelete;
+    }
+    funcs.finish = FakeFinish;
+    funcs.now = FakeNow;
+    funcs.frequency = 1000000;
+    funcs.userdata = &s_gpu;
+    
+    PL_FrameLatency_SetFunctions(&funcs);
+    PL_FrameLatency_SetMaxFrames(maxFrames);
+}
+
+/* Waits, then spends cpuCost building a frame and submits it. */
+static void RunFrames(int count, Uint64 cpuCost) {
+    for (int i = 0; i < count; ++i) {
+        PL_FrameLatency_Wait();
+    
+        /* The frame about to be drawn counts as in flight. */
+        int queued = CountQueued(&s_gpu) + 1;
+        if (queued > s_gpu.maxQueued) {
+            s_gpu.maxQueued = queued;
+        }
+    
+        s_gpu.now += cpuCost;
+        PL_FrameLatency_EndFrame();
+    }
+}
+
+static void TestGPUBound() {
+    PLFrameLatencyStats stats;
+    
+    for (int maxFrames = 1; maxFrames <= 3; ++maxFrames) {
+        Start(20000, true, maxFrames);
+        RunFrames(100, 5000);
+    
+        Uint64 before = s_gpu.now;
+        RunFrames(100, 5000);
+        Uint64 elapsed = s_gpu.now - before;
+    
+        PL_FrameLatency_GetStats(&stats);
+        Check(s_gpu.maxQueued <= maxFrames, "never more frames in flight than allowed");
+        Check(s_gpu.maxQueued == maxFrames, "GPU-bound frames fill the queue");
+        /* With one frame, the CPU and GPU take turns. With more, they
+         * overlap, and the GPU sets the pace. */
+        Uint64 period = (maxFrames == 1) ? 25000 : 20000;
+        Check(elapsed >= 100 * period - period && elapsed <= 100 * period + period,
+              "CPU runs at the GPU's rate");
+        Check(stats.frameCount == 200, "every wait counted");
+        Check(stats.waitCount >= 190, "GPU-bound frames wait");
+        Check(stats.maxFramesInFlight == maxFrames, "limit reported");
+        Check(stats.usingFinish == DXFALSE, "fences in use");
+        Check(stats.maxWaitTime <= 20000, "never waits longer than a GPU frame");
+    }
+}
+
+static void TestCPUBound() {
+    PLFrameLatencyStats stats;
+    
+    Start(5000, true, 2);
+    RunFrames(200, 16000);
+    PL_FrameLatency_GetStats(&stats);
+    
+    Check(stats.waitCount == 0, "no waits when the GPU keeps up");
+    Check(stats.totalWaitTime == 0, "no time spent waiting");
+    Check(stats.framesInFlight <= 1, "only the previous frame is in flight");
+}
+
+static void TestFallback() {
+    PLFrameLatencyStats stats;
+    
+    Start(20000, false, 2);
+    for (int i = 0; i < 50; ++i) {
+        PL_FrameLatency_Wait();
+        Check(CountQueued(&s_gpu) == 0, "finish drains the queue");
+        s_gpu.now += 5000;
+    
+        /* No fences are used here, but the GPU still gets the work. */
+        PL_FrameLatency_EndFrame();
+        FakeFenceInsert(&s_gpu);
+    }
+    PL_FrameLatency_GetStats(&stats);
+    
+    Check(stats.usingFinish == DXTRUE, "fallback is reported");
+    Check(s_gpu.finishCount == 50, "finish called once a frame");
+    Check(stats.waitCount == 50, "every fallback wait counts");
+    Check(stats.lastWaitTime == 20000, "fallback wait time measured");
+}
+
+static void TestFenceCleanup() {
+    Start(20000, true, 3);
+    RunFrames(20, 5000);
+    Check(s_gpu.deleteCount < s_gpu.fenceCount, "fences still in flight");
+    
+    PL_FrameLatency_SetFunctions(NULL);
+    Check(s_gpu.deleteCount == s_gpu.fenceCount, "every fence is deleted");
+    
+    /* Without functions, nothing happens at all. */
+    Check(PL_FrameLatency_Wait() == 0, "no wait without functions");
+    Check(PL_FrameLatency_EndFrame() == 0, "no fence without functions");
+}
+
+int main(int argc, char **argv) {
+    TestGPUBound();
+    TestCPUBound();
+    TestFallback();
+    TestFenceCleanup();
+    
+    return CheckResult("frame latency");
+}
+
+#endif
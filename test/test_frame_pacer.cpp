@@ -0,0 +1,201 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Runs the frame pacer on a simulated clock, and checks that it keeps
+ * to the frame rate without drifting, makes up for late frames, starts
+ * over after a stall, learns how far sleeps overshoot, and reports the
+ * right statistics.
+ *
+ * Nothing here depends on the real clock, so the results are the same
+ * on every run and every machine.
+ *
+ * Usage: test_frame_pacer
+ */
+
+#include "DxLib.h"
+
+#ifdef DXPORTLIB
+#  include "SDL_main.h"
+#endif
+
+#if !defined(DXLIB_VERSION) || !defined(DXPORTLIB)
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    printf("This test needs DxPortLib.\n");
+    return -1;
+}
+
+#else
+
+#include "PL/PLInternal.h"
+#include "test_check.h"
+
+#include <stdio.h>
+
+/* A microsecond clock. Every read costs a little time, as a real one
+ * does, which is also what moves it along while the pacer spins. Every
+ * sleep overshoots by an amount taken in turn from a table. */
+struct FakeClock {
+    Uint64 now;
+    Uint64 readCost;
+    const int *oversleep;
+    int oversleepCount;
+    int oversleepPos;
+    int sleepCount;
+};
+
+static FakeClock s_clock;
+
+static Uint64 FakeNow(void *userdata) {
+    FakeClock *clock = (FakeClock *)userdata;
+    clock->now += clock->readCost;
+    return clock->now;
+}
+
+static void FakeSleep(void *userdata, int milliseconds) {
+    FakeClock *clock = (FakeClock *)userdata;
+    int oversleep = 0;
+    if (clock->oversleepCount > 0) {
+        oversleep = clock->oversleep[clock->oversleepPos];
+        clock->oversleepPos = (clock->oversleepPos + 1) % clock->oversleepCount;
+    }
+    clock->now += (Uint64)milliseconds * 1000 + (Uint64)oversleep;
+    clock->sleepCount += 1;
+}
+
+static void StartClock(const int *oversleep, int oversleepCount, Uint64 readCost) {
+    s_clock.now = 1000000;
+    s_clock.readCost = readCost;
+    s_clock.oversleep = oversleep;
+    s_clock.oversleepCount = oversleepCount;
+    s_clock.oversleepPos = 0;
+    s_clock.sleepCount = 0;
+    PL_FramePacer_SetClock(FakeNow, FakeSleep, 1000000, &s_clock);
+}
+
+/* Runs frames that each take the given work time before syncing. */
+static void RunFrames(int count, int workTime) {
+    for (int i = 0; i < count; ++i) {
+        s_clock.now += (Uint64)workTime;
+        PL_FramePacer_Sync();
+    }
+}
+
+static const int s_smallOversleep[] = { 300, 1100, 50, 1800, 700, 0, 1500, 900 };
+static const int s_largeOversleep[] = { 3000, 3100, 2900, 3050 };
+
+static void TestSteadyRate() {
+    PLFramePacerStats stats;
+    
+    StartClock(s_smallOversleep, 8, 2);
+    PL_FramePacer_SetFrameRate(60);
+    PL_FramePacer_Sync();
+    Uint64 start = s_clock.now;
+    
+    RunFrames(600, 5000);
+    PL_FramePacer_GetStats(&stats);
+    
+    /* 600 frames at 60 FPS is ten seconds, give or take the last spin. */
+    Uint64 elapsed = s_clock.now - start;
+    Check(elapsed >= 10000000 && elapsed < 10000010, "600 frames take ten seconds");
+    Check(stats.frameCount == 256, "history holds 256 frames");
+    Check(stats.missedCount == 0, "no missed frames at a steady rate");
+    Check(stats.averageTime >= 16666 && stats.averageTime <= 16667, "average frame time");
+    Check(stats.minTime >= 16660 && stats.maxTime <= 16675, "no 16/17 ms wobble");
+    Check(s_clock.sleepCount > 0, "pacer sleeps rather than only spinning");
+}
+
+static void TestLateFrames() {
+    PLFramePacerStats stats;
+    
+    StartClock(s_smallOversleep, 8, 2);
+    PL_FramePacer_SetFrameRate(60);
+    PL_FramePacer_Sync();
+    RunFrames(10, 5000);
+    
+    /* A little late: the next frame is shorter to make up for it. */
+    Uint64 before = s_clock.now;
+    s_clock.now += 20000;
+    Check(PL_FramePacer_Sync() == DXTRUE, "late frame is reported");
+    s_clock.now += 5000;
+    Check(PL_FramePacer_Sync() == DXFALSE, "frame after a late one is on time");
+    Uint64 pair = s_clock.now - before;
+    Check(pair >= 33333 && pair < 33340, "late frame is made up for");
+    
+    /* More than a whole frame late: start over, rather than rush. */
+    s_clock.now += 50000;
+    PL_FramePacer_Sync();
+    before = s_clock.now;
+    s_clock.now += 1000;
+    PL_FramePacer_Sync();
+    Uint64 after = s_clock.now - before;
+    Check(after >= 16660 && after < 16675, "stall is followed by a full frame");
+    
+    RunFrames(60, 5000);
+    PL_FramePacer_GetStats(&stats);
+    Check(stats.missedCount == 2, "one miss for each late frame, and no more");
+}
+
+static void TestCalibration() {
+    PLFramePacerStats stats;
+    
+    /* Sleeps overshooting by 3 ms would miss every deadline if the
+     * pacer kept sleeping until 2 ms before it. */
+    StartClock(s_largeOversleep, 4, 2);
+    PL_FramePacer_SetFrameRate(60);
+    PL_FramePacer_Sync();
+    RunFrames(10, 5000);
+    
+    PL_FramePacer_Reset();
+    PL_FramePacer_Sync();
+    RunFrames(100, 5000);
+    PL_FramePacer_GetStats(&stats);
+    Check(stats.missedCount == 0, "no missed frames once calibrated");
+    Check(stats.maxTime <= 16675, "no oversleeping once calibrated");
+}
+
+static void TestStatistics() {
+    PLFramePacerStats stats;
+    
+    /* No frame rate, so frame times are just the work times. */
+    StartClock(NULL, 0, 0);
+    PL_FramePacer_SetFrameRate(0);
+    PL_FramePacer_Sync();
+    for (int i = 1; i <= 200; ++i) {
+        s_clock.now += (Uint64)i * 100;
+        PL_FramePacer_Sync();
+    }
+    PL_FramePacer_GetStats(&stats);
+    
+    Check(stats.frameCount == 200, "frame count");
+    Check(stats.minTime == 100, "minimum");
+    Check(stats.maxTime == 20000, "maximum");
+    Check(stats.averageTime == 10050, "average");
+    Check(stats.p99Time == 19800, "99th percentile");
+    Check(stats.missedCount == 0, "no misses without a frame rate");
+}
+
+int main(int argc, char **argv) {
+    TestSteadyRate();
+    TestLateFrames();
+    TestCalibration();
+    TestStatistics();
+    
+    PL_FramePacer_SetClock(NULL, NULL, 0, NULL);
+    
+    return CheckResult("frame pacer");
+}
+
+#endif
@@ -0,0 +1,242 @@
+/*
+  DxPortLib - A portability library for DxLib-based software.
+  Copyright (C) 2013-2016 Patrick McCarthy <mauve@sandwich.net>
+  
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+  
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+ */
+
+/* Checks the shader program cache without a GL context: that keys
+ * change with every part of the source and driver strings, that
+ * entries survive a trip through the file format and a file on disk,
+ * and that anything damaged or made by another driver is thrown away
+ * rather than handed back.
+ *
+ * Usage: test_shader_cache [scratch file]
+ */
+
+#include "DxLib.h"
+
+#ifdef DXPORTLIB
+#  include "SDL_main.h"
+#endif
+
+#if !defined(DXLIB_VERSION) || !defined(DXPORTLIB)
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    printf("This test needs DxPortLib.\n");
+    return -1;
+}
+
+#else
+
+#include "PL/PLInternal.h"
+#include "test_check.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static Uint64 s_driverA;
+static Uint64 s_driverB;
+
+static void TestKeys() {
+    const char *sourcesA[] = { "void main() {}", "precision", "discard;", "}" };
+    const char *sourcesB[] = { "void main() {}", "precision", "", "}" };
+    const char *splitA[] = { "ab", "c" };
+    const char *splitB[] = { "a", "bc" };
+    const char *withNull[] = { "a", NULL };
+    const char *withEmpty[] = { "a", "" };
+    
+    Check(PL_ShaderCache_MakeSourceKey(sourcesA, 4) == PL_ShaderCache_MakeSourceKey(sourcesA, 4),
+          "same source, same key");
+    Check(PL_ShaderCache_MakeSourceKey(sourcesA, 4) != PL_ShaderCache_MakeSourceKey(sourcesB, 4),
+          "alpha test code changes the key");
+    Check(PL_ShaderCache_MakeSourceKey(sourcesA, 4) != PL_ShaderCache_MakeSourceKey(sourcesA, 3),
+          "source count changes the key");
+    Check(PL_ShaderCache_MakeSourceKey(splitA, 2) != PL_ShaderCache_MakeSourceKey(splitB, 2),
+          "moving text between strings changes the key");
+    Check(PL_ShaderCache_MakeSourceKey(withNull, 2) == PL_ShaderCache_MakeSourceKey(withEmpty, 2),
+          "NULL source counts as empty");
+    
+    s_driverA = PL_ShaderCache_MakeDriverKey("Vendor", "Renderer", "4.5 1.0");
+    s_driverB = PL_ShaderCache_MakeDriverKey("Vendor", "Renderer", "4.5 1.1");
+    Check(s_driverA != s_driverB, "driver version changes the key");
+    Check(s_driverA != PL_ShaderCache_MakeDriverKey("Vendor", "Other", "4.5 1.0"),
+          "renderer changes the key");
+    Check(s_driverA != PL_ShaderCache_MakeDriverKey("Other", "Renderer", "4.5 1.0"),
+          "vendor changes the key");
+    Check(PL_ShaderCache_MakeDriverKey(NULL, NULL, NULL) == PL_ShaderCache_MakeDriverKey("", "", ""),
+          "missing driver strings count as empty");
+}
+
+/* Three entries of different sizes, with recognisable contents. */
+static void FillCache(PLShaderCache *cache) {
+    unsigned char data[300];
+    
+    for (int n = 0; n < 3; ++n) {
+        for (int i = 0; i < (int)sizeof(data); ++i) {
+            data[i] = (unsigned char)(i * 7 + n);
+        }
+        PL_ShaderCache_Store(cache, 0x1000 + n, 0x8740 + n, data, 100 * (n + 1));
+    }
+}
+
+static bool SameEntries(const PLShaderCache *a, const PLShaderCache *b) {
+    if (a->entryCount != b->entryCount) {
+        return false;
+    }
+    for (int i = 0; i < a->entryCount; ++i) {
+        const PLShaderCacheEntry *entryA = &a->entries[i];
+        const PLShaderCacheEntry *entryB = PL_ShaderCache_Find(b, entryA->sourceKey);
+        if (entryB == NULL
+            || entryB->binaryFormat != entryA->binaryFormat
+            || entryB->length != entryA->length
+            || memcmp(entryB->data, entryA->data, entryA->length) != 0
+        ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void TestEntries() {
+    PLShaderCache cache;
+    unsigned char data[4] = { 1, 2, 3, 4 };
+    
+    PL_ShaderCache_Init(&cache, s_driverA);
+    Check(PL_ShaderCache_Find(&cache, 1) == NULL, "new cache is empty");
+    Check(PL_ShaderCache_Store(&cache, 1, 7, data, 0) < 0, "empty binaries are refused");
+    
+    PL_ShaderCache_Store(&cache, 1, 7, data, 4);
+    Check(cache.dirtyFlag == DXTRUE, "storing marks the cache dirty");
+    
+    data[0] = 9;
+    PL_ShaderCache_Store(&cache, 1, 8, data, 2);
+    const PLShaderCacheEntry *entry = PL_ShaderCache_Find(&cache, 1);
+    Check(cache.entryCount == 1, "storing the same key replaces it");
+    Check(entry != NULL && entry->binaryFormat == 8 && entry->length == 2 && entry->data[0] == 9,
+          "replacement has the new binary");
+    
+    FillCache(&cache);
+    Check(PL_ShaderCache_Remove(&cache, 1) == 0, "remove finds the entry");
+    Check(PL_ShaderCache_Find(&cache, 1) == NULL, "removed entry is gone");
+    Check(PL_ShaderCache_Find(&cache, 0x1002) != NULL, "other entries stay");
+    Check(PL_ShaderCache_Remove(&cache, 1) < 0, "removing twice fails");
+    
+    PL_ShaderCache_Clear(&cache);
+    Check(cache.entryCount == 0 && cache.dirtyFlag == DXFALSE, "clear empties the cache");
+}
+
+static std::vector<unsigned char> Serialize(const PLShaderCache *cache) {
+    std::vector<unsigned char> buffer(PL_ShaderCache_Serialize(cache, NULL, 0));
+    PL_ShaderCache_Serialize(cache, &buffer[0], (int)buffer.size());
+    return buffer;
+}
+
+static int Deserialize(PLShaderCache *cache, const std::vector<unsigned char> &buffer) {
+    return PL_ShaderCache_Deserialize(cache, buffer.empty() ? NULL : &buffer[0], (int)buffer.size());
+}
+
+static void TestFormat() {
+    PLShaderCache source;
+    PLShaderCache loaded;
+    
+    PL_ShaderCache_Init(&source, s_driverA);
+    PL_ShaderCache_Init(&loaded, s_driverA);
+    
+    std::vector<unsigned char> buffer = Serialize(&source);
+    Check(buffer.size() == 20, "empty cache is only a header");
+    Check(Deserialize(&loaded, buffer) == 0 && loaded.entryCount == 0, "empty cache loads");
+    
+    FillCache(&source);
+    buffer = Serialize(&source);
+    Check(buffer.size() == 20 + 3 * 20 + 600, "serialized size");
+    Check(PL_ShaderCache_Serialize(&source, &buffer[0], 100) == (int)buffer.size(),
+          "small buffer only returns the size");
+    
+    Check(Deserialize(&loaded, buffer) == 0, "round trip loads");
+    Check(SameEntries(&source, &loaded), "round trip keeps every entry");
+    Check(loaded.dirtyFlag == DXFALSE, "freshly loaded cache is clean");
+    
+    PLShaderCache other;
+    PL_ShaderCache_Init(&other, s_driverB);
+    Check(Deserialize(&other, buffer) < 0 && other.entryCount == 0,
+          "another driver's cache is refused");
+    
+    std::vector<unsigned char> damaged = buffer;
+    damaged[damaged.size() - 50] ^= 0x40;
+    Check(Deserialize(&loaded, damaged) < 0 && loaded.entryCount == 0,
+          "damaged binary is refused");
+    
+    damaged = buffer;
+    damaged.resize(damaged.size() - 1);
+    Check(Deserialize(&loaded, damaged) < 0, "truncated file is refused");
+    
+    damaged = buffer;
+    damaged.push_back(0);
+    Check(Deserialize(&loaded, damaged) < 0, "trailing bytes are refused");
+    
+    damaged = buffer;
+    damaged[0] = 'X';
+    Check(Deserialize(&loaded, damaged) < 0, "bad magic is refused");
+    
+    damaged = buffer;
+    damaged[4] += 1;
+    Check(Deserialize(&loaded, damaged) < 0, "other versions are refused");
+    
+    damaged = buffer;
+    damaged[16] = 0xff;
+    damaged[17] = 0xff;
+    Check(Deserialize(&loaded, damaged) < 0, "absurd entry count is refused");
+    
+    damaged.clear();
+    Check(Deserialize(&loaded, damaged) < 0, "empty file is refused");
+    
+    PL_ShaderCache_Clear(&source);
+    PL_ShaderCache_Clear(&loaded);
+}
+
+static void TestFile(const char *filename) {
+    PLShaderCache source;
+    PLShaderCache loaded;
+    
+    PL_ShaderCache_Init(&source, s_driverA);
+    FillCache(&source);
+    Check(PL_ShaderCache_SaveFile(&source, filename) == 0, "cache saves");
+    Check(source.dirtyFlag == DXFALSE, "saving clears the dirty flag");
+    
+    PL_ShaderCache_Init(&loaded, s_driverA);
+    Check(PL_ShaderCache_LoadFile(&loaded, filename) == 0, "cache loads");
+    Check(SameEntries(&source, &loaded), "file keeps every entry");
+    
+    PL_ShaderCache_Clear(&loaded);
+    PL_ShaderCache_Init(&loaded, s_driverB);
+    Check(PL_ShaderCache_LoadFile(&loaded, filename) < 0, "file from another driver is refused");
+    
+    remove(filename);
+    Check(PL_ShaderCache_LoadFile(&loaded, filename) < 0, "missing file is refused");
+    
+    PL_ShaderCache_Clear(&source);
+    PL_ShaderCache_Clear(&loaded);
+}
+
+int main(int argc, char **argv) {
+    const char *filename = (argc > 1) ? argv[1] : "test_shader_cache.bin";
+    
+    TestKeys();
+    TestEntries();
+    TestFormat();
+    TestFile(filename);
+    
+    return CheckResult("shader cache");
+}
+
+#endif